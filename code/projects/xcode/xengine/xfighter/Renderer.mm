@@ -32,6 +32,12 @@
         
         XE_Initialise();
         
+        /* Launching with -memtags <path> dumps the memory tags there on shutdown */
+        NSString * memTagsPath = [[NSUserDefaults standardUserDefaults] stringForKey:@"memtags"];
+        if ( memTagsPath != nil ) {
+            XE_SetMemTagsPath( [memTagsPath UTF8String] );
+        }
+        
         render_params_t renderParams;
         renderParams.displayWidth = -1;
         renderParams.displayHeight = -1;
@@ -35,12 +35,15 @@
 #include "gameplay/CompTransform.h"
 #include "gameplay/CompShipModel.h"
 #include "gameplay/CompPreview.h"
+#include "gameplay/CompMessages.h"
+
+#define GAME_MAX_SHIPS 64
 
 typedef struct game_s {
+    resource_t *    shipModelRes;
     model_t *       shipModel;
     material_t *    shipMaterial;
     camera_t        camera;
-    float           rotation;
     
     int32_t         shipModelSystem;
     int32_t         transformSystem;
@@ -90,9 +93,37 @@ void Game_Initialise(void) {
     
     xprintf("=== Game Init ==================\n");
 
-    resource_t * modelRes = Resource_Load( "~/models/barbarian/barbarian.bmdl" );
+    game->shipModelRes = Resource_Load( "~/models/barbarian/barbarian.bmdl" );
+    game->shipModel = (model_t *) Resource_GetData( game->shipModelRes );
+    
+    Ecs_Initialise();
+    Ecs_RegisterComponent( comp_transform_t, GAME_MAX_SHIPS );
+    Ecs_RegisterComponent( comp_shipmodel_t, GAME_MAX_SHIPS );
+    Ecs_RegisterComponent( comp_preview_t, GAME_MAX_SHIPS );
+    
+    game->transformSystem = (int32_t) Ecs_RegisterSystem( &sys_transform, comp_transform_t );
+    game->shipModelSystem = (int32_t) Ecs_RegisterSystem( &sys_shipmodel, comp_shipmodel_t );
+    game->previewSystem = (int32_t) Ecs_RegisterSystem( &sys_preview, comp_preview_t );
+    
+    /* The ship model gets its transform from the topic that the transform system publishes */
+    Ecs_SystemPublishTopic( game->transformSystem, TOPIC_TRANSFORM );
+    Ecs_SystemSubscribeTopic( game->shipModelSystem, TOPIC_TRANSFORM );
+    
+    /* The preview sends the transform its location, and the ship model has to submit between Render_Begin and Render_End */
+    Ecs_SystemSetFlags( game->previewSystem, ECS_SYSTEM_FLAG_SENDS_MESSAGES );
+    Ecs_SystemSetFlags( game->shipModelSystem, ECS_SYSTEM_FLAG_MAIN_THREAD );
+    
+    /* The player ship spins on the spot in front of the camera. The ship model looks up the transform when constructed, so that goes first */
+    game->player = Ecs_EntityAlloc();
+    Ecs_AddComponent( game->player, comp_transform_t );
+    
+    comp_shipmodel_t * shipModel = Ecs_AddComponent( game->player, comp_shipmodel_t );
+    shipModel->model = game->shipModel;
+    shipModel->materials = Model_GetMaterials( game->shipModel );
     
-    game->shipModel = (model_t *) Resource_GetData( modelRes );
+    comp_preview_t * preview = Ecs_AddComponent( game->player, comp_preview_t );
+    preview->rotSpeed = 45.0f;
+    Vec3_SetXyz( preview->location, 0, 0, 0 );
     
     Camera_Initialise( &gameLocal.camera );
     
@@ -100,26 +131,31 @@ void Game_Initialise(void) {
     vec3_t lookat = {0, 1, 0 };
     vec3_t up = {0, 1, 0 };
     Camera_SetLookAt( &gameLocal.camera, &eye, &lookat, &up );
-    
-    gameLocal.rotation = 0;
 }
 
 /*=======================================================================================================================================*/
 void Game_Finalise(void) {
-
+    Resource_Release( game->shipModelRes );
+    game->shipModelRes = NULL;
+    game->shipModel = NULL;
+    
+    Ecs_Finalise();
 }
 
 /*=======================================================================================================================================*/
 void Game_Think( float timeStep ) {
-    gameLocal.rotation += 45 * (1.0f / 60.0f );
-    while (gameLocal.rotation > 360.0f ) gameLocal.rotation -= 360.0f;
+    const ecs_system_id_t thinkSystems[] = { game->previewSystem, game->transformSystem };
+    
+    /* The ECS frame starts here and ends in Game_Draw, once the ship models have been submitted */
+    gameLocal.thinkParams.timeStep = timeStep;
+    Ecs_RunSystems( thinkSystems, sizeof( thinkSystems ) / sizeof( thinkSystems[ 0 ] ), &gameLocal.thinkParams );
 }
 
 /*=======================================================================================================================================*/
 void Game_Draw( float timeStep ) {
     uint32_t dispW, dispH;
     float aspect;
-    mat4_t modelMat;
+    const ecs_system_id_t drawSystems[] = { game->shipModelSystem };
     
     Render_GetDisplaySize( &dispW, &dispH );
     aspect = (float) dispW / (float) dispH;
@@ -127,15 +163,12 @@ void Game_Draw( float timeStep ) {
     Camera_SetShape( &gameLocal.camera, 80.0f, aspect, 1, 1000 );
     Camera_UpdateMatrices( &gameLocal.camera );
     
-    vec3_t axis = {0, 1, 0};
-    _Mat4_SetRotationAA( &modelMat, &axis, scalar_DegToRad( gameLocal.rotation ) );
-    Vec4_Set( modelMat.rows[3], 0, 0, 0, 1 );
-    
     int32_t viewport[] = {0, 0, (int32_t)dispW, (int32_t) dispH };
     
     Render_Begin( &gameLocal.camera, viewport );
-        Render_SubmitModel( gameLocal.shipModel, Model_GetMaterials( gameLocal.shipModel ), &modelMat );
-        //Ecs_SystemThink( gameLocal.shipModelSystem, &gameLocal.thinkParams );
+        Ecs_RunSystems( drawSystems, sizeof( drawSystems ) / sizeof( drawSystems[ 0 ] ), &gameLocal.thinkParams );
     Render_End();
+    
+    Ecs_EndFrame();
 }
 
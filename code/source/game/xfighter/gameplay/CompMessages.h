@@ -28,6 +28,10 @@ typedef enum comp_message_e {
     MSG_TRANSORM,
 } comp_message_t;
 
+typedef enum comp_topic_e {
+    TOPIC_TRANSFORM = ECS_TOPIC_BROADCAST + 1,     /* MSG_TRANSORM for each entity, published by the transform system */
+} comp_topic_t;
+
 typedef struct msg_loc_rot_s {
     ecs_msg_t       header;
     vec3_t          location;
@@ -26,8 +26,10 @@ static void PreviewConstruct( ecs_entity_t ent, void * component );
 static void PreviewDestroy( void * component );
 static void PreviewThink( ecs_entity_t ent, void * component, ecs_think_params_t * params );
 
+ECS_COMPONENT_DEFINE( comp_preview_t );
+
 ecs_system_t sys_preview = {
-    "Ship Model System", PreviewConstruct, PreviewDestroy, PreviewThink, NULL
+    "Preview System", PreviewConstruct, PreviewDestroy, PreviewThink, NULL
 };
 
 /*=======================================================================================================================================*/
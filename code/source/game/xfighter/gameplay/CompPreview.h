@@ -33,6 +33,8 @@ typedef struct comp_preview_s {
     mat4_t      transform;
 } comp_preview_t;
 
+ECS_COMPONENT_DECLARE( comp_preview_t );
+
 extern ecs_system_t sys_preview;
 
 
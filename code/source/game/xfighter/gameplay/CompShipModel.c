@@ -29,6 +29,8 @@ static void ShipModel_Destroy( void * component );
 static void ShipModel_Think( ecs_entity_t ent, void * component, ecs_think_params_t * params );
 static void ShipModel_Message( ecs_msg_t * msg, void * componentPtr );
 
+ECS_COMPONENT_DEFINE( comp_shipmodel_t );
+
 ecs_system_t sys_shipmodel = {
     "Ship Model System",
     ShipModel_Construct,
@@ -45,7 +47,7 @@ void ShipModel_Construct( ecs_entity_t ent, void * component ) {
     xassert( comp->transformComponent >= 0 );
     
     comp->model = NULL;
-    comp->material = NULL;
+    comp->materials = NULL;
 }
 
 /*=======================================================================================================================================*/
@@ -69,5 +71,9 @@ void ShipModel_Message( ecs_msg_t * msg, void * componentPtr ) {
 /*=======================================================================================================================================*/
 void ShipModel_Think( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
     comp_shipmodel_t * comp = (comp_shipmodel_t *) component;
-    Render_SubmitModel( comp->model, comp->material, &comp->transform );
+    if ( comp->model == NULL ) {
+        return;
+    }
+    
+    Render_SubmitModel( comp->model, comp->materials, &comp->transform );
 }
@@ -30,10 +30,13 @@
 typedef struct comp_shipmodel_s {
     ecs_component_index_t transformComponent;
     model_t *       model;
-    material_t *    material;
+    material_t **   materials;      /* One per mesh of the model */
     mat4_t          transform;
 } comp_shipmodel_t;
 
+ECS_COMPONENT_DECLARE( comp_shipmodel_t );
+
+/* Takes the transform from TOPIC_TRANSFORM, Game_Initialise subscribes the system to it when registering it */
 extern ecs_system_t sys_shipmodel;
 
 #endif
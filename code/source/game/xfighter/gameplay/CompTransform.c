@@ -23,11 +23,13 @@
 
 static void Construct( ecs_entity_t ent, void * component );
 static void Destroy( void * component );
-static void Think( ecs_entity_t ent, void * component, ecs_think_params_t * params );
+static void Transform_ThinkBatch( const ecs_batch_t * batch, ecs_think_params_t * params );
 static void Transform_Message( ecs_msg_t * msg, void * componentPtr );
 
+ECS_COMPONENT_DEFINE( comp_transform_t );
+
 ecs_system_t sys_transform = {
-    "Transform System", Construct, Destroy, Think, Transform_Message
+    "Transform System", Construct, Destroy, NULL, Transform_Message, Transform_ThinkBatch
 };
 
 /*=======================================================================================================================================*/
@@ -56,13 +58,17 @@ void Transform_Message( ecs_msg_t * msg, void * componentPtr  ) {
 }
 
 /*=======================================================================================================================================*/
-void Think( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
-    comp_transform_t * comp = (comp_transform_t*) component;
+void Transform_ThinkBatch( const ecs_batch_t * batch, ecs_think_params_t * params ) {
+    uint8_t * components = (uint8_t *) batch->components;
     msg_transform_t msgTransform;
-        
-    Mat4_SetRotationQ( msgTransform.transform, comp->rotation );
-    Mat4_SetTranslationVec3( msgTransform.transform, comp->location );
     
-    /* Broadcast the completed transform to the rest of the component */
-    Ecs_SendMessage( ent, MSG_TRANSORM, &msgTransform, sizeof( msgTransform ) );
+    for ( uint32_t n = 0; n < batch->count; ++n ) {
+        comp_transform_t * comp = (comp_transform_t*) ( components + batch->stride * n );
+        
+        Mat4_SetRotationQ( msgTransform.transform, comp->rotation );
+        Mat4_SetTranslationVec3( msgTransform.transform, comp->location );
+        
+        /* Publish the completed transform for the rest of the components, the systems that want it subscribe to the topic */
+        Ecs_Publish( TOPIC_TRANSFORM, batch->entities[ n ], MSG_TRANSORM, &msgTransform, sizeof( msgTransform ) );
+    }
 }
@@ -30,6 +30,9 @@ typedef struct comp_transform_s {
     vec3_t      location;
 } comp_transform_t;
 
+ECS_COMPONENT_DECLARE( comp_transform_t );
+
+/* Publishes to TOPIC_TRANSFORM every think */
 extern ecs_system_t sys_transform;
 
 #endif
@@ -0,0 +1,173 @@
+//======================================================================================================================
+// CONFIDENTIAL AND PROPRIETARY INFORMATION / NOT FOR DISCLOSURE WITHOUT WRITTEN PERMISSION
+// Copyright (C) 2022, 2023 James Steele. All Rights Reserved.
+//======================================================================================================================
+
+#include "pakbuilder/PakBuilder.h"
+#include "core/Fs.h"
+#include "core/Sys.h"
+#include <algorithm>
+#include <filesystem>
+#include <zlib.h>
+
+//======================================================================================================================
+PakBuilder::PakBuilder() {
+
+}
+
+//======================================================================================================================
+PakBuilder::~PakBuilder() {
+    
+}
+
+//======================================================================================================================
+void PakBuilder::AddFolder( const char * folderPath ) {
+    // Resolve the '~' and '@' prefixes the same way the engine does
+    str_t fullPath = nullptr;
+    FS_MakePath( &fullPath, folderPath );
+    std::filesystem::path root( fullPath );
+    Str_Destroy( &fullPath );
+    
+    std::error_code err;
+    
+    for ( std::filesystem::recursive_directory_iterator it( root, err ), end; it != end; it.increment( err ) ) {
+        xerror( (bool) err, "Error reading folder %s: %s\n", folderPath, err.message().c_str() );
+        
+        if ( it->is_regular_file() == false ) {
+            continue;
+        }
+        
+        std::string relPath = it->path().lexically_relative( root ).generic_string();
+        
+        // Skip hidden files, and any packs that were built into the folder
+        if ( relPath.empty() == true || relPath[ 0 ] == '.' || it->path().extension() == ".xpak" ) {
+            continue;
+        }
+        
+        FileInfo info;
+        info.path = relPath;
+        info.fullPath = it->path().string();
+        info.hash = PakStream_CalcPathHash( relPath.c_str() );
+        memset( &info.entry, 0, sizeof( info.entry ) );
+        
+        files.push_back( info );
+    }
+    
+    xerror( (bool) err, "Error reading folder %s: %s\n", folderPath, err.message().c_str() );
+}
+
+//======================================================================================================================
+void PakBuilder::Build( ToolMemStream & str, bool compress ) {
+    // Payloads go in path order so the files in a folder end up next to each other in the pack
+    std::sort( files.begin(), files.end(), []( const FileInfo & lhs, const FileInfo & rhs ) {
+        return lhs.path < rhs.path;
+    } );
+    
+    ToolMemStream names;
+    for ( FileInfo & file : files ) {
+        file.entry.offsName = ( uint32_t ) names.Tell();
+        names.Write( file.path.c_str(), file.path.size() + 1 );
+    }
+    
+    // The table of contents is sorted by hash for the binary search at runtime
+    std::vector<const FileInfo*> toc;
+    for ( const FileInfo & file : files ) {
+        toc.push_back( &file );
+    }
+    
+    std::sort( toc.begin(), toc.end(), []( const FileInfo * lhs, const FileInfo * rhs ) {
+        return lhs->hash < rhs->hash;
+    } );
+    
+    for ( size_t f = 1; f < toc.size(); ++f ) {
+        xerror( toc[ f ]->hash == toc[ f - 1 ]->hash, "Path hash collision between '%s' and '%s'\n", toc[ f - 1 ]->path.c_str(), toc[ f ]->path.c_str() );
+    }
+    
+    pak_stream_t header;
+    memset( &header, 0, sizeof( header ) );
+    header.magic        = PAKSTREAM_MAGIC;
+    header.version      = PAKSTREAM_VERSION;
+    header.entryCount   = ( uint32_t ) files.size();
+    header.align        = PAKSTREAM_ALIGN;
+    
+    uintptr_t offsHeader = str.Tell();
+    WriteHeader( str, header );
+    
+    // The entries are written again once the payload offsets are known
+    str.PadToAlignment( PAKSTREAM_ALIGN );
+    header.offsHashes = str.Tell() - offsHeader;
+    for ( const FileInfo * file : toc ) {
+        str.Write( &file->hash );
+    }
+    
+    str.PadToAlignment( PAKSTREAM_ALIGN );
+    header.offsEntries = str.Tell() - offsHeader;
+    for ( const FileInfo * file : toc ) {
+        str.Write( ( const uint8_t * ) &file->entry, sizeof( pak_stream_entry_t ) );
+    }
+    
+    str.PadToAlignment( PAKSTREAM_ALIGN );
+    header.offsNames = str.Tell() - offsHeader;
+    str.Write( names );
+    
+    str.PadToAlignment( PAKSTREAM_ALIGN );
+    header.offsData = str.Tell() - offsHeader;
+    for ( FileInfo & file : files ) {
+        file.entry.offset = str.Tell() - offsHeader;
+        WritePayload( str, file, compress );
+        str.PadToAlignment( PAKSTREAM_ALIGN );
+    }
+    
+    uintptr_t endPos = str.Length();
+    str.Seek( offsHeader );
+    WriteHeader( str, header );
+    
+    str.Seek( offsHeader + header.offsEntries );
+    for ( const FileInfo * file : toc ) {
+        str.Write( ( const uint8_t * ) &file->entry, sizeof( pak_stream_entry_t ) );
+    }
+    str.Seek( endPos );
+}
+
+//======================================================================================================================
+void PakBuilder::WriteHeader( ToolMemStream & str, pak_stream_t & header ) {
+    str.Write( ( const uint8_t * ) &header, sizeof( header ) );
+}
+
+//======================================================================================================================
+void PakBuilder::WritePayload( ToolMemStream & str, FileInfo & file, bool compress ) {
+    std::vector<uint8_t> data;
+    
+    {
+        xeScopedFile in( file.fullPath.c_str(), "rb" );
+        xerror( in.IsValid() == false, "Unable to open '%s'\n", file.fullPath.c_str() );
+        
+        data.resize( in.Length() );
+        size_t amtRead = in.Read<uint8_t>( data.data(), data.size() );
+        xerror( amtRead != data.size(), "Error reading '%s'\n", file.fullPath.c_str() );
+    }
+    
+    file.entry.size = data.size();
+    file.entry.compressedSize = data.size();
+    file.entry.flags = 0;
+    bytesIn += data.size();
+    
+    if ( compress == true && data.empty() == false ) {
+        uLongf packedSize = compressBound( ( uLong ) data.size() );
+        std::vector<uint8_t> packed( packedSize );
+        
+        int res = compress2( packed.data(), &packedSize, data.data(), ( uLong ) data.size(), Z_BEST_COMPRESSION );
+        xerror( res != Z_OK, "Error compressing '%s'\n", file.fullPath.c_str() );
+        
+        // Only keep the compressed copy if it saves enough to be worth inflating at load time
+        if ( packedSize < data.size() - data.size() / 8 ) {
+            packed.resize( packedSize );
+            data.swap( packed );
+            file.entry.compressedSize = data.size();
+            file.entry.flags |= PAKSTREAM_F_ZLIB;
+        }
+    }
+    
+    bytesStored += data.size();
+    str.Write( data.data(), data.size() );
+}
@@ -0,0 +1,44 @@
+//======================================================================================================================
+// CONFIDENTIAL AND PROPRIETARY INFORMATION / NOT FOR DISCLOSURE WITHOUT WRITTEN PERMISSION
+// Copyright (C) 2022, 2023 James Steele. All Rights Reserved.
+//======================================================================================================================
+
+#ifndef __PAKBUILDER_H__
+#define __PAKBUILDER_H__
+
+#include "toolapp/ToolMemStream.h"
+#include "core/PakStream.h"
+#include <string>
+#include <vector>
+
+class PakBuilder {
+public:
+    class FileInfo {
+    public:
+        std::string         path;               // Relative to the data folder, with '/' separators
+        std::string         fullPath;
+        uint64_t            hash = 0;
+        pak_stream_entry_t  entry;
+    };
+    
+    PakBuilder();
+
+    ~PakBuilder();
+    
+    void AddFolder( const char * folderPath );
+    
+    void Build( ToolMemStream & str, bool compress );
+    
+    void WriteHeader( ToolMemStream & str, pak_stream_t & header );
+    
+    void WritePayload( ToolMemStream & str, FileInfo & file, bool compress );
+    
+    size_t GetFileCount() const { return files.size(); }
+    
+public:
+    std::vector<FileInfo>       files;
+    uint64_t                    bytesIn = 0;
+    uint64_t                    bytesStored = 0;
+};
+
+#endif
@@ -0,0 +1,113 @@
+//======================================================================================================================
+// CONFIDENTIAL AND PROPRIETARY INFORMATION / NOT FOR DISCLOSURE WITHOUT WRITTEN PERMISSION
+// Copyright (C) 2022, 2023 James Steele. All Rights Reserved.
+//======================================================================================================================
+
+#include "pakbuilder/PakBuilderApp.h"
+#include "pakbuilder/PakBuilder.h"
+
+TOOL_APP( PakBuilderApp )
+
+enum ARG {
+    ARG_FOLDER = 0,
+    ARG_COMPRESS,
+};
+
+static const char * HELP_TEXT_FOLDER =
+    "+folder <path>            Adds the files in a folder, paths in the pack are relative to it. Defaults to +infile\n";
+
+static const char * HELP_TEXT_COMPRESS =
+    "+compress                 Stores files zlib compressed when it makes them at least 1/8th smaller\n";
+
+static const char * HELP_TEXT[] = {
+    HELP_TEXT_FOLDER,
+    HELP_TEXT_COMPRESS,
+    nullptr,
+    nullptr
+};
+
+//======================================================================================================================
+PakBuilderApp::PakBuilderApp() {
+    PublishArgId( ARG_FOLDER, "folder" );
+    PublishArgId( ARG_COMPRESS, "compress" );
+}
+
+//======================================================================================================================
+PakBuilderApp::~PakBuilderApp() {
+    
+}
+
+//======================================================================================================================
+bool PakBuilderApp::HandleArg( Arg * arg, int32_t argId ) {
+    switch ( argId ) {
+        case ARG_FOLDER:
+            if ( arg->m_params.size() != 1 ) {
+                DisplayHelpText( ARG_FOLDER );
+                return false;
+            }
+            folders.push_back( arg->m_params[ 0 ] );
+            break;
+            
+        case ARG_COMPRESS:
+            if ( arg->m_params.size() != 0 ) {
+                DisplayHelpText( ARG_COMPRESS );
+                return false;
+            }
+            compress = true;
+            break;
+            
+        default:
+            DisplayHelpText( -1 );
+            return false;
+    }
+    
+    return true;
+}
+
+//======================================================================================================================
+bool PakBuilderApp::Process() {
+    if ( folders.empty() == true && m_infilePath.empty() == false ) {
+        folders.push_back( m_infilePath );
+    }
+    
+    xerror( folders.empty() == true, "No data folder to pack, use +infile or +folder\n" );
+    xerror( m_outfilePath.empty() == true, "No pack to write, use +outfile\n" );
+    
+    PakBuilder builder;
+    for ( const std::string & folder : folders ) {
+        xprintf("Adding files from %s\n", folder.c_str() );
+        builder.AddFolder( folder.c_str() );
+    }
+    
+    ToolMemStream stream;
+    builder.Build( stream, compress );
+    
+    xprintf("Writing %zu files to %s\n", builder.GetFileCount(), m_outfilePath.c_str() );
+    bool folderOk = CreateFolderAtPath( m_outfilePath.c_str() );
+    xerror( folderOk == false, "Unable to create folder at %s\n", m_outfilePath.c_str() );
+    
+    stream.Save( m_outfilePath.c_str() );
+    
+    xprintf("Packed %llu bytes into %llu bytes\n", ( unsigned long long ) builder.bytesIn, ( unsigned long long ) builder.bytesStored );
+    xprintf("Done.\n");
+    return true;
+}
+
+//======================================================================================================================
+bool PakBuilderApp::DisplayBuiltinArgHelp( TOOL_ARG_ID argId ) {
+    return false;
+}
+
+//======================================================================================================================
+void PakBuilderApp::DisplayHelpText( int32_t argId ) {
+    if ( argId < 0 ) {
+        for ( int n = 0; HELP_TEXT[ n ] != nullptr; ++n ) {
+            xprintf("%s", HELP_TEXT[ n ] );
+        }
+    }
+    else {
+        xprintf("%s", HELP_TEXT[ argId ] );
+    }
+    
+    Sys_Exit( -1 );
+}
@@ -0,0 +1,32 @@
+//======================================================================================================================
+// CONFIDENTIAL AND PROPRIETARY INFORMATION / NOT FOR DISCLOSURE WITHOUT WRITTEN PERMISSION
+// Copyright (C) 2022, 2023 James Steele. All Rights Reserved.
+//======================================================================================================================
+
+#ifndef __PAKBUILDERAPP_H__
+#define __PAKBUILDERAPP_H__
+
+#include "toolapp/ToolApp.h"
+#include "toolapp/ToolMemStream.h"
+#include "pakbuilder/PakBuilder.h"
+
+class PakBuilderApp : public ToolApp {
+public:
+    PakBuilderApp();
+
+    virtual ~PakBuilderApp();
+
+    virtual bool HandleArg( Arg * arg, int32_t argId );
+
+    virtual bool Process();
+
+    virtual bool DisplayBuiltinArgHelp( TOOL_ARG_ID argId );
+
+    void DisplayHelpText( int32_t argId );
+    
+public:
+    std::vector<std::string>    folders;
+    bool                        compress = false;
+};
+
+#endif
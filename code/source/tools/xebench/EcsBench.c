@@ -0,0 +1,729 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Job.h"
+#include "mem/Mem.h"
+#include "ecs/Ecs.h"
+#include "math/Math3d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ECSBENCH_COMMAND_COUNT      ( 64 * 1024 )       /* Entities that record commands, enough to run past the schedule heap */
+#define ECSBENCH_BIG_EVERY          64                  /* Every so many entities also add a component bigger than a block of the command stage */
+#define ECSBENCH_CHILD_FLAG         0x80000000u         /* Marks the tag of an entity spawned by a command */
+#define ECSBENCH_LAYOUT_COUNT       ( 64 * 1024 )       /* Entities moved by each storage layout */
+#define ECSBENCH_LAYOUT_FRAMES      32                  /* Frames each layout is timed over */
+#define ECSBENCH_LOOKUP_COUNT       ( 64 * 1024 )       /* Entities looked up, each has one component of every lookup type */
+#define ECSBENCH_LOOKUP_ROUNDS      16                  /* Passes over the entities for each kind of lookup */
+#define ECSBENCH_BATCH_COUNT        ( 10 * 1000 )       /* Entities with a transform to update */
+#define ECSBENCH_BATCH_FRAMES       64                  /* Frames each transform system is timed over */
+#define ECSBENCH_TOPIC_TRANSFORM    ( ECS_TOPIC_BROADCAST + 1 )
+#define ECSBENCH_MSG_TRANSFORM      1
+
+/* What the system records for an entity depends on its value */
+typedef enum ecsbench_case_e {
+    ECSBENCH_CASE_READD = 0,                            /* Add, remove and add the tag again, the entity ends up with the second tag */
+    ECSBENCH_CASE_SPAWN,                                /* Spawn an entity and add, remove and add components to its pending handle */
+    ECSBENCH_CASE_FREE,                                 /* Add the tag, free the entity, then add the tag to the freed entity */
+    ECSBENCH_CASE_COUNT
+} ecsbench_case_t;
+
+typedef struct ecsbench_value_s {
+    uint32_t        value;
+} ecsbench_value_t;
+
+typedef struct ecsbench_tag_s {
+    uint32_t        value;
+} ecsbench_tag_t;
+
+typedef struct ecsbench_big_s {
+    uint32_t        value;
+    uint8_t         fill[ ECS_MESSAGE_STAGE_BLOCK_SIZE + 1024 ];
+} ecsbench_big_t;
+
+typedef struct ecsbench_pos_s {
+    float           x, y, z, w;
+} ecsbench_pos_t;
+
+/* The same position and velocity pair, stored once in the per-type arrays and once in archetype chunks */
+typedef struct ecsbench_arraypos_s {
+    float           x, y, z, w;
+} ecsbench_arraypos_t;
+
+typedef struct ecsbench_arrayvel_s {
+    float           x, y, z, w;
+} ecsbench_arrayvel_t;
+
+typedef struct ecsbench_chunkpos_s {
+    float           x, y, z, w;
+} ecsbench_chunkpos_t;
+
+typedef struct ecsbench_chunkvel_s {
+    float           x, y, z, w;
+} ecsbench_chunkvel_t;
+
+/* Two lookup components of each storage, the values say which entity and type they belong to */
+typedef struct ecsbench_lookarray0_s {
+    uint32_t        value;
+    uint32_t        pad[ 3 ];
+} ecsbench_lookarray0_t;
+
+typedef struct ecsbench_lookarray1_s {
+    uint32_t        value;
+    uint32_t        pad[ 3 ];
+} ecsbench_lookarray1_t;
+
+typedef struct ecsbench_lookchunk0_s {
+    uint32_t        value;
+    uint32_t        pad[ 3 ];
+} ecsbench_lookchunk0_t;
+
+typedef struct ecsbench_lookchunk1_s {
+    uint32_t        value;
+    uint32_t        pad[ 3 ];
+} ecsbench_lookchunk1_t;
+
+/* A transform as the game's transform system builds it, from a rotation and a location */
+typedef struct ecsbench_xform_s {
+    quat_t          rotation;
+    vec3_t          location;
+    mat4_t          transform;
+} ecsbench_xform_t;
+
+typedef struct ecsbench_msg_transform_s {
+    ecs_msg_t       header;
+    mat4_t          transform;
+} ecsbench_msg_transform_t;
+
+typedef struct ecsbench_s {
+    uint32_t        count;
+    uint32_t        childCount;                         /* Spawned entities found with the components they should have */
+    uint32_t        badCount;
+} ecsbench_t;
+
+static void EcsBench_RecordThink( ecs_entity_t ent, void * component, ecs_think_params_t * params );
+static void EcsBench_CheckThink( ecs_entity_t ent, void * component, ecs_think_params_t * params );
+static void EcsBench_MoveThink( ecs_entity_t ent, void * component, ecs_think_params_t * params );
+static void EcsBench_XformThink( ecs_entity_t ent, void * component, ecs_think_params_t * params );
+static void EcsBench_XformThinkBatch( const ecs_batch_t * batch, ecs_think_params_t * params );
+static void EcsBench_XformPublishThink( ecs_entity_t ent, void * component, ecs_think_params_t * params );
+static void EcsBench_XformPublishThinkBatch( const ecs_batch_t * batch, ecs_think_params_t * params );
+
+ECS_COMPONENT_DEFINE( ecsbench_value_t );
+ECS_COMPONENT_DEFINE( ecsbench_tag_t );
+ECS_COMPONENT_DEFINE( ecsbench_pos_t );
+ECS_COMPONENT_DEFINE( ecsbench_big_t );
+ECS_COMPONENT_DEFINE( ecsbench_arraypos_t );
+ECS_COMPONENT_DEFINE( ecsbench_arrayvel_t );
+ECS_COMPONENT_DEFINE( ecsbench_chunkpos_t );
+ECS_COMPONENT_DEFINE( ecsbench_chunkvel_t );
+ECS_COMPONENT_DEFINE( ecsbench_lookarray0_t );
+ECS_COMPONENT_DEFINE( ecsbench_lookarray1_t );
+ECS_COMPONENT_DEFINE( ecsbench_lookchunk0_t );
+ECS_COMPONENT_DEFINE( ecsbench_lookchunk1_t );
+ECS_COMPONENT_DEFINE( ecsbench_xform_t );
+
+static ecs_system_t sys_ecsbench_record = {
+    "Command Recorder", NULL, NULL, EcsBench_RecordThink, NULL, NULL
+};
+
+static ecs_system_t sys_ecsbench_check = {
+    "Command Checker", NULL, NULL, EcsBench_CheckThink, NULL, NULL
+};
+
+/* Walks the velocities and finds each position by entity, as the systems over the per-type arrays do */
+static ecs_system_t sys_ecsbench_move = {
+    "Array Mover", NULL, NULL, EcsBench_MoveThink, NULL, NULL
+};
+
+/* The same transform update through a think per entity and through a batch think, written into the component or published */
+static ecs_system_t sys_ecsbench_xform = {
+    "Transform Think", NULL, NULL, EcsBench_XformThink, NULL, NULL
+};
+
+static ecs_system_t sys_ecsbench_xform_batch = {
+    "Transform Batch", NULL, NULL, NULL, NULL, EcsBench_XformThinkBatch
+};
+
+static ecs_system_t sys_ecsbench_xform_publish = {
+    "Transform Publish Think", NULL, NULL, EcsBench_XformPublishThink, NULL, NULL
+};
+
+static ecs_system_t sys_ecsbench_xform_publish_batch = {
+    "Transform Publish Batch", NULL, NULL, NULL, NULL, EcsBench_XformPublishThinkBatch
+};
+
+static ecsbench_t ecsBench;
+static ecsbench_big_t ecsBenchBig[ JOB_MAX_WORKERS + 1 ];     /* Scratch for the big components, one per worker */
+
+/*=======================================================================================================================================*/
+static void EcsBench_RecordThink( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
+    uint32_t value = ( ( ecsbench_value_t * ) component )->value;
+    ecsbench_tag_t tag;
+    ecsbench_pos_t pos;
+    
+    switch ( value % ECSBENCH_CASE_COUNT ) {
+        case ECSBENCH_CASE_READD:
+            tag.value = value;
+            Ecs_DeferAddComponent( ent, ecsbench_tag_t, &tag );
+            Ecs_DeferRemoveComponent( ent, ecsbench_tag_t );
+            tag.value = value + 1;
+            Ecs_DeferAddComponent( ent, ecsbench_tag_t, &tag );
+            
+            if ( value % ECSBENCH_BIG_EVERY == 0 ) {
+                ecsbench_big_t * big = &ecsBenchBig[ Job_GetWorkerIndex() ];
+                big->value = value;
+                memset( big->fill, (uint8_t) value, sizeof( big->fill ) );
+                Ecs_DeferAddComponent( ent, ecsbench_big_t, big );
+            }
+            break;
+            
+        case ECSBENCH_CASE_SPAWN: {
+            ecs_entity_t child = Ecs_DeferSpawn( NULL );
+            pos.x = pos.y = pos.z = pos.w = 0.0f;
+            Ecs_DeferAddComponent( child, ecsbench_pos_t, &pos );
+            Ecs_DeferRemoveComponent( child, ecsbench_pos_t );
+            pos.x = (float) value;
+            Ecs_DeferAddComponent( child, ecsbench_pos_t, &pos );
+            tag.value = value | ECSBENCH_CHILD_FLAG;
+            Ecs_DeferAddComponent( child, ecsbench_tag_t, &tag );
+            break;
+        }
+            
+        default:
+            tag.value = value;
+            Ecs_DeferAddComponent( ent, ecsbench_tag_t, &tag );
+            Ecs_DeferFree( ent );
+            Ecs_DeferAddComponent( ent, ecsbench_tag_t, &tag );
+            break;
+    }
+}
+
+/*=======================================================================================================================================*/
+static void EcsBench_CheckThink( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
+    uint32_t value = ( ( ecsbench_tag_t * ) component )->value;
+    
+    if ( ( value & ECSBENCH_CHILD_FLAG ) == 0 ) {
+        return;
+    }
+    
+    /* The position added last wins, the earlier add was taken away by the remove between them */
+    value &= ~ECSBENCH_CHILD_FLAG;
+    const ecsbench_pos_t * pos = ( Ecs_HasComponent( ent, ecsbench_pos_t ) == true ) ? Ecs_GetComponent( ent, ecsbench_pos_t ) : NULL;
+    bool_t good = ( pos != NULL && pos->x == (float) value && value % ECSBENCH_CASE_COUNT == ECSBENCH_CASE_SPAWN ) ? true : false;
+    
+    ecsBench.badCount += ( good == true ) ? 0 : 1;
+    ecsBench.childCount += ( good == true ) ? 1 : 0;
+}
+
+/*=======================================================================================================================================*/
+static void EcsBench_MoveThink( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
+    const ecsbench_arrayvel_t * vel = ( const ecsbench_arrayvel_t * ) component;
+    ecsbench_arraypos_t * pos = Ecs_GetComponent( ent, ecsbench_arraypos_t );
+    
+    pos->x += vel->x * params->timeStep;
+    pos->y += vel->y * params->timeStep;
+    pos->z += vel->z * params->timeStep;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void EcsBench_XformUpdate( ecsbench_xform_t * comp, mat4_t * transform ) {
+    Mat4_SetRotationQ( *transform, comp->rotation );
+    Mat4_SetTranslationVec3( *transform, comp->location );
+}
+
+/*=======================================================================================================================================*/
+static void EcsBench_XformThink( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
+    ecsbench_xform_t * comp = ( ecsbench_xform_t * ) component;
+    EcsBench_XformUpdate( comp, &comp->transform );
+}
+
+/*=======================================================================================================================================*/
+static void EcsBench_XformThinkBatch( const ecs_batch_t * batch, ecs_think_params_t * params ) {
+    uint8_t * components = ( uint8_t * ) batch->components;
+    
+    for ( uint32_t n = 0; n < batch->count; ++n ) {
+        ecsbench_xform_t * comp = ( ecsbench_xform_t * ) ( components + batch->stride * n );
+        EcsBench_XformUpdate( comp, &comp->transform );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void EcsBench_XformPublishThink( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
+    ecsbench_msg_transform_t msg;
+    
+    EcsBench_XformUpdate( ( ecsbench_xform_t * ) component, &msg.transform );
+    Ecs_Publish( ECSBENCH_TOPIC_TRANSFORM, ent, ECSBENCH_MSG_TRANSFORM, &msg, sizeof( msg ) );
+}
+
+/*=======================================================================================================================================*/
+static void EcsBench_XformPublishThinkBatch( const ecs_batch_t * batch, ecs_think_params_t * params ) {
+    uint8_t * components = ( uint8_t * ) batch->components;
+    ecsbench_msg_transform_t msg;
+    
+    for ( uint32_t n = 0; n < batch->count; ++n ) {
+        EcsBench_XformUpdate( ( ecsbench_xform_t * ) ( components + batch->stride * n ), &msg.transform );
+        Ecs_Publish( ECSBENCH_TOPIC_TRANSFORM, batch->entities[ n ], ECSBENCH_MSG_TRANSFORM, &msg, sizeof( msg ) );
+    }
+}
+
+/*=======================================================================================================================================*/
+bool_t EcsBench_RunCommands( const xebench_params_t * params ) {
+    memset( &ecsBench, 0, sizeof( ecsBench ) );
+    ecsBench.count = ( params->count > 0 ) ? params->count : ECSBENCH_COMMAND_COUNT;
+    
+    Ecs_Initialise();
+    Ecs_RegisterComponent( ecsbench_value_t, ecsBench.count );
+    Ecs_RegisterComponent( ecsbench_tag_t, ecsBench.count );
+    Ecs_RegisterArchetypeComponent( ecsbench_pos_t );
+    Ecs_RegisterComponent( ecsbench_big_t, ecsBench.count / ECSBENCH_BIG_EVERY + 1 );
+    
+    ecs_system_id_t recordSystem = Ecs_RegisterSystem( &sys_ecsbench_record, ecsbench_value_t );
+    ecs_system_id_t checkSystem = Ecs_RegisterSystem( &sys_ecsbench_check, ecsbench_tag_t );
+    
+    ecs_entity_t * ents = ( ecs_entity_t * ) malloc( sizeof( ecs_entity_t ) * ecsBench.count );
+    xerror( ents == NULL, "Out of memory for the entities\n" );
+    
+    for ( uint32_t n = 0; n < ecsBench.count; ++n ) {
+        ents[ n ] = Ecs_EntityAlloc();
+        Ecs_AddComponent( ents[ n ], ecsbench_value_t )->value = n;
+    }
+    
+    printf( "%u entities record commands across the jobs of one system, %u jobs of %u entities\n", ecsBench.count,
+            ( ecsBench.count + ECS_SYSTEM_CHUNK_SIZE - 1 ) / ECS_SYSTEM_CHUNK_SIZE, ECS_SYSTEM_CHUNK_SIZE );
+    
+    ecs_think_params_t thinkParams;
+    memset( &thinkParams, 0, sizeof( thinkParams ) );
+    
+    uint64_t startNs = Sys_GetTicksNs();
+    Ecs_RunSystems( &recordSystem, 1, &thinkParams );
+    uint64_t ns = Sys_GetTicksNs() - startNs;
+    
+    /* Each entity's commands have to have been played in the order they were recorded */
+    uint32_t expectChildren = 0;
+    for ( uint32_t n = 0; n < ecsBench.count; ++n ) {
+        bool_t good = false;
+        
+        switch ( n % ECSBENCH_CASE_COUNT ) {
+            case ECSBENCH_CASE_READD:
+                good = ( Ecs_HasComponent( ents[ n ], ecsbench_tag_t ) == true && Ecs_GetComponent( ents[ n ], ecsbench_tag_t )->value == n + 1 ) ? true : false;
+                
+                if ( n % ECSBENCH_BIG_EVERY == 0 ) {
+                    const ecsbench_big_t * big = ( Ecs_HasComponent( ents[ n ], ecsbench_big_t ) == true ) ? Ecs_GetComponent( ents[ n ], ecsbench_big_t ) : NULL;
+                    good = ( good == true && big != NULL && big->value == n && big->fill[ sizeof( big->fill ) - 1 ] == (uint8_t) n ) ? true : false;
+                }
+                break;
+                
+            case ECSBENCH_CASE_SPAWN:
+                good = ( Ecs_HasComponent( ents[ n ], ecsbench_tag_t ) == false ) ? true : false;
+                ++expectChildren;
+                break;
+                
+            default:
+                good = ( Ecs_EntityIsValid( ents[ n ] ) == false ) ? true : false;
+                break;
+        }
+        
+        ecsBench.badCount += ( good == true ) ? 0 : 1;
+    }
+    
+    Ecs_SystemThink( (int32_t) checkSystem, &thinkParams );
+    
+    printf( "    recorded and played back in %.2f ms, %u spawned entities of %u checked, %u bad\n", (double) ns / 1e6, ecsBench.childCount, expectChildren,
+            ecsBench.badCount );
+    
+    free( ents );
+    Ecs_Finalise();
+    
+    return ( ecsBench.badCount == 0 && ecsBench.childCount == expectChildren ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static uint64_t EcsBench_MoveArrays( ecs_system_id_t moveSystem, ecs_think_params_t * thinkParams ) {
+    uint64_t startNs = Sys_GetTicksNs();
+    
+    for ( uint32_t f = 0; f < ECSBENCH_LAYOUT_FRAMES; ++f ) {
+        Ecs_SystemThink( (int32_t) moveSystem, thinkParams );
+    }
+    
+    return Sys_GetTicksNs() - startNs;
+}
+
+/*=======================================================================================================================================*/
+static uint64_t EcsBench_MoveChunks( const ecs_query_t * query, float timeStep ) {
+    uint64_t startNs = Sys_GetTicksNs();
+    
+    for ( uint32_t f = 0; f < ECSBENCH_LAYOUT_FRAMES; ++f ) {
+        ecs_query_iter_t iter;
+        ecs_chunk_view_t view;
+        
+        Ecs_QueryBegin( query, &iter );
+        while ( Ecs_QueryNext( &iter, &view ) == true ) {
+            ecsbench_chunkpos_t * pos = ( ecsbench_chunkpos_t * ) view.components[ 0 ];
+            const ecsbench_chunkvel_t * vel = ( const ecsbench_chunkvel_t * ) view.components[ 1 ];
+            
+            for ( uint32_t i = 0; i < view.count; ++i ) {
+                pos[ i ].x += vel[ i ].x * timeStep;
+                pos[ i ].y += vel[ i ].y * timeStep;
+                pos[ i ].z += vel[ i ].z * timeStep;
+            }
+        }
+    }
+    
+    return Sys_GetTicksNs() - startNs;
+}
+
+/*=======================================================================================================================================*/
+bool_t EcsBench_RunLayout( const xebench_params_t * params ) {
+    uint32_t count = ( params->count > 0 ) ? params->count : ECSBENCH_LAYOUT_COUNT;
+    uint32_t badCount = 0;
+    
+    Ecs_Initialise();
+    Ecs_RegisterComponent( ecsbench_arraypos_t, count );
+    Ecs_RegisterComponent( ecsbench_arrayvel_t, count );
+    Ecs_RegisterArchetypeComponent( ecsbench_chunkpos_t );
+    Ecs_RegisterArchetypeComponent( ecsbench_chunkvel_t );
+    
+    ecs_system_id_t moveSystem = Ecs_RegisterSystem( &sys_ecsbench_move, ecsbench_arrayvel_t );
+    
+    ecs_query_t query;
+    Ecs_QueryInit( &query );
+    Ecs_QueryAdd( &query, ecsbench_chunkpos_t );
+    Ecs_QueryAdd( &query, ecsbench_chunkvel_t );
+    
+    ecs_entity_t * ents = ( ecs_entity_t * ) malloc( sizeof( ecs_entity_t ) * count );
+    uint32_t * order = ( uint32_t * ) malloc( sizeof( uint32_t ) * count );
+    xerror( ents == NULL || order == NULL, "Out of memory for the entities\n" );
+    
+    /* Whole number positions and velocities keep the sums exact, so both layouts can be checked against the same answer */
+    for ( uint32_t n = 0; n < count; ++n ) {
+        ents[ n ] = Ecs_EntityAlloc();
+        order[ n ] = n;
+        
+        ecsbench_arrayvel_t * vel = Ecs_AddComponent( ents[ n ], ecsbench_arrayvel_t );
+        vel->x = (float) ( n % 7 + 1 );
+        vel->y = (float) ( n % 5 + 1 );
+        vel->z = (float) ( n % 3 + 1 );
+        vel->w = 0.0f;
+        
+        ecsbench_chunkpos_t * cpos = Ecs_AddComponent( ents[ n ], ecsbench_chunkpos_t );
+        cpos->x = cpos->y = cpos->z = (float) n;
+        cpos->w = 0.0f;
+        
+        ecsbench_chunkvel_t * cvel = Ecs_AddComponent( ents[ n ], ecsbench_chunkvel_t );
+        cvel->x = vel->x;
+        cvel->y = vel->y;
+        cvel->z = vel->z;
+        cvel->w = 0.0f;
+    }
+    
+    /* The positions go in out of step with the velocities, so the array walk finds them scattered as it would once entities come
+       and go, the chunks keep both columns side by side whatever order they were added in */
+    uint32_t state = 0x9e3779b9u;
+    for ( uint32_t n = count - 1; n > 0; --n ) {
+        state = state * 1664525u + 1013904223u;
+        uint32_t swap = state % ( n + 1 );
+        uint32_t tmp = order[ n ];
+        order[ n ] = order[ swap ];
+        order[ swap ] = tmp;
+    }
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        ecsbench_arraypos_t * pos = Ecs_AddComponent( ents[ order[ n ] ], ecsbench_arraypos_t );
+        pos->x = pos->y = pos->z = (float) order[ n ];
+        pos->w = 0.0f;
+    }
+    
+    ecs_think_params_t thinkParams;
+    memset( &thinkParams, 0, sizeof( thinkParams ) );
+    thinkParams.timeStep = 1.0f;
+    
+    printf( "%u entities moved for %u frames, a %u byte position and velocity each\n", count, ECSBENCH_LAYOUT_FRAMES,
+            (uint32_t) ( sizeof( ecsbench_chunkpos_t ) + sizeof( ecsbench_chunkvel_t ) ) );
+    printf( "%-28s %12s %12s\n", "layout", "total ms", "ns/entity" );
+    
+    uint64_t arrayNs = EcsBench_MoveArrays( moveSystem, &thinkParams );
+    uint64_t chunkNs = EcsBench_MoveChunks( &query, thinkParams.timeStep );
+    double moves = (double) count * ECSBENCH_LAYOUT_FRAMES;
+    
+    printf( "%-28s %12.2f %12.2f\n", "per-type arrays, by entity", (double) arrayNs / 1e6, (double) arrayNs / moves );
+    printf( "%-28s %12.2f %12.2f\n", "archetype chunks, by query", (double) chunkNs / 1e6, (double) chunkNs / moves );
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        const ecsbench_arraypos_t * pos = Ecs_GetComponent( ents[ n ], ecsbench_arraypos_t );
+        const ecsbench_chunkpos_t * cpos = Ecs_GetComponent( ents[ n ], ecsbench_chunkpos_t );
+        float x = (float) n + (float) ( n % 7 + 1 ) * ECSBENCH_LAYOUT_FRAMES;
+        float y = (float) n + (float) ( n % 5 + 1 ) * ECSBENCH_LAYOUT_FRAMES;
+        float z = (float) n + (float) ( n % 3 + 1 ) * ECSBENCH_LAYOUT_FRAMES;
+        
+        bool_t good = ( pos->x == x && pos->y == y && pos->z == z && cpos->x == x && cpos->y == y && cpos->z == z ) ? true : false;
+        badCount += ( good == true ) ? 0 : 1;
+    }
+    
+    printf( "    chunks %.2fx the arrays, %u bad\n", ( chunkNs > 0 ) ? (double) arrayNs / (double) chunkNs : 0.0, badCount );
+    
+    free( order );
+    free( ents );
+    Ecs_Finalise();
+    
+    return ( badCount == 0 ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static void EcsBench_PrintLookup( const char * name, uint64_t ns, uint32_t lookups, uint64_t sum, uint64_t expectSum ) {
+    printf( "%-28s %12.2f %12.2f   %s\n", name, (double) ns / 1e6, (double) ns / (double) lookups, ( sum == expectSum ) ? "ok" : "BAD" );
+}
+
+/*=======================================================================================================================================*/
+bool_t EcsBench_RunLookup( const xebench_params_t * params ) {
+    uint32_t count = ( params->count > 0 ) ? params->count : ECSBENCH_LOOKUP_COUNT;
+    uint32_t lookups = count * ECSBENCH_LOOKUP_ROUNDS * 4;
+    uint32_t badCount = 0;
+    
+    Ecs_Initialise();
+    Ecs_RegisterComponent( ecsbench_lookarray0_t, count );
+    Ecs_RegisterComponent( ecsbench_lookarray1_t, count );
+    Ecs_RegisterArchetypeComponent( ecsbench_lookchunk0_t );
+    Ecs_RegisterArchetypeComponent( ecsbench_lookchunk1_t );
+    
+    const ecs_component_id_t ids[ 4 ] = {
+        ECS_COMPONENT_ID( ecsbench_lookarray0_t ), ECS_COMPONENT_ID( ecsbench_lookarray1_t ),
+        ECS_COMPONENT_ID( ecsbench_lookchunk0_t ), ECS_COMPONENT_ID( ecsbench_lookchunk1_t )
+    };
+    
+    ecs_entity_t * ents = ( ecs_entity_t * ) malloc( sizeof( ecs_entity_t ) * count );
+    xerror( ents == NULL, "Out of memory for the entities\n" );
+    
+    uint64_t expectSum = 0;
+    for ( uint32_t n = 0; n < count; ++n ) {
+        ents[ n ] = Ecs_EntityAlloc();
+        Ecs_AddComponent( ents[ n ], ecsbench_lookarray0_t )->value = n * 4 + 0;
+        Ecs_AddComponent( ents[ n ], ecsbench_lookarray1_t )->value = n * 4 + 1;
+        Ecs_AddComponent( ents[ n ], ecsbench_lookchunk0_t )->value = n * 4 + 2;
+        Ecs_AddComponent( ents[ n ], ecsbench_lookchunk1_t )->value = n * 4 + 3;
+        expectSum += (uint64_t) n * 16 + 6;
+    }
+    expectSum *= ECSBENCH_LOOKUP_ROUNDS;
+    
+    /* Look the entities up out of order, as systems do when they follow handles to other entities */
+    uint32_t state = 0x9e3779b9u;
+    for ( uint32_t n = count - 1; n > 0; --n ) {
+        state = state * 1664525u + 1013904223u;
+        uint32_t swap = state % ( n + 1 );
+        ecs_entity_t tmp = ents[ n ];
+        ents[ n ] = ents[ swap ];
+        ents[ swap ] = tmp;
+    }
+    
+    printf( "%u entities with two array and two archetype components, %u lookups for each kind\n", count, lookups );
+    printf( "%-28s %12s %12s\n", "lookup", "total ms", "ns/lookup" );
+    
+    /* One untimed pass first, so the first kind timed doesn't pay for bringing the entities and components in */
+    uint64_t sum = 0;
+    for ( uint32_t n = 0; n < count; ++n ) {
+        for ( uint32_t t = 0; t < 4; ++t ) {
+            sum += ( ( const ecsbench_lookarray0_t * ) Ecs_GetComponentById( ents[ n ], ids[ t ] ) )->value;
+        }
+    }
+    xerror( sum * ECSBENCH_LOOKUP_ROUNDS != expectSum, "Lookup components don't hold their values\n" );
+    
+    sum = 0;
+    uint64_t startNs = Sys_GetTicksNs();
+    for ( uint32_t r = 0; r < ECSBENCH_LOOKUP_ROUNDS; ++r ) {
+        for ( uint32_t n = 0; n < count; ++n ) {
+            sum += Ecs_GetComponent( ents[ n ], ecsbench_lookarray0_t )->value;
+            sum += Ecs_GetComponent( ents[ n ], ecsbench_lookarray1_t )->value;
+            sum += Ecs_GetComponent( ents[ n ], ecsbench_lookchunk0_t )->value;
+            sum += Ecs_GetComponent( ents[ n ], ecsbench_lookchunk1_t )->value;
+        }
+    }
+    EcsBench_PrintLookup( "get by id", Sys_GetTicksNs() - startNs, lookups, sum, expectSum );
+    badCount += ( sum == expectSum ) ? 0 : 1;
+    
+    /* Every entity has every type, so the has count stands in for the sum */
+    uint64_t hasCount = 0;
+    startNs = Sys_GetTicksNs();
+    for ( uint32_t r = 0; r < ECSBENCH_LOOKUP_ROUNDS; ++r ) {
+        for ( uint32_t n = 0; n < count; ++n ) {
+            for ( uint32_t t = 0; t < 4; ++t ) {
+                hasCount += ( Ecs_HasComponentById( ents[ n ], ids[ t ] ) == true ) ? 1 : 0;
+            }
+        }
+    }
+    EcsBench_PrintLookup( "has by id", Sys_GetTicksNs() - startNs, lookups, hasCount, lookups );
+    badCount += ( hasCount == lookups ) ? 0 : 1;
+    
+    sum = 0;
+    startNs = Sys_GetTicksNs();
+    for ( uint32_t r = 0; r < ECSBENCH_LOOKUP_ROUNDS; ++r ) {
+        for ( uint32_t n = 0; n < count; ++n ) {
+            int32_t index = Ecs_GetEntityNamedComponentIndex( ents[ n ], "ecsbench_lookarray0_t" );
+            sum += ( ( const ecsbench_lookarray0_t * ) Ecs_GetEntityIndexedComponent( ents[ n ], index ) )->value;
+            index = Ecs_GetEntityNamedComponentIndex( ents[ n ], "ecsbench_lookarray1_t" );
+            sum += ( ( const ecsbench_lookarray1_t * ) Ecs_GetEntityIndexedComponent( ents[ n ], index ) )->value;
+            index = Ecs_GetEntityNamedComponentIndex( ents[ n ], "ecsbench_lookchunk0_t" );
+            sum += ( ( const ecsbench_lookchunk0_t * ) Ecs_GetEntityIndexedComponent( ents[ n ], index ) )->value;
+            index = Ecs_GetEntityNamedComponentIndex( ents[ n ], "ecsbench_lookchunk1_t" );
+            sum += ( ( const ecsbench_lookchunk1_t * ) Ecs_GetEntityIndexedComponent( ents[ n ], index ) )->value;
+        }
+    }
+    EcsBench_PrintLookup( "get by name", Sys_GetTicksNs() - startNs, lookups, sum, expectSum );
+    badCount += ( sum == expectSum ) ? 0 : 1;
+    
+    /* Take the array components away and put them back, the archetype ones would move the entity between chunks each time */
+    sum = 0;
+    startNs = Sys_GetTicksNs();
+    for ( uint32_t r = 0; r < ECSBENCH_LOOKUP_ROUNDS / 2; ++r ) {
+        for ( uint32_t n = 0; n < count; ++n ) {
+            for ( uint32_t t = 0; t < 2; ++t ) {
+                uint32_t value = ( ( const ecsbench_lookarray0_t * ) Ecs_GetComponentById( ents[ n ], ids[ t ] ) )->value;
+                Ecs_RemoveComponentById( ents[ n ], ids[ t ] );
+                ( ( ecsbench_lookarray0_t * ) Ecs_AddComponentById( ents[ n ], ids[ t ] ) )->value = value;
+                sum += value;
+            }
+        }
+    }
+    uint64_t ns = Sys_GetTicksNs() - startNs;
+    
+    uint64_t addSum = 0;
+    for ( uint32_t n = 0; n < count; ++n ) {
+        addSum += Ecs_GetComponent( ents[ n ], ecsbench_lookarray0_t )->value + Ecs_GetComponent( ents[ n ], ecsbench_lookarray1_t )->value;
+    }
+    addSum *= ECSBENCH_LOOKUP_ROUNDS / 2;
+    EcsBench_PrintLookup( "remove and add by id", ns, count * ECSBENCH_LOOKUP_ROUNDS, sum, addSum );
+    badCount += ( sum == addSum ) ? 0 : 1;
+    
+    printf( "    %u bad\n", badCount );
+    
+    free( ents );
+    Ecs_Finalise();
+    
+    return ( badCount == 0 ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static uint32_t EcsBench_CheckXforms( const ecs_entity_t * ents, uint32_t count, bool_t published ) {
+    uint32_t badCount = 0;
+    uint32_t msgCount = 0;
+    
+    if ( published == true ) {
+        ecs_topic_iter_t iter;
+        ecs_entity_t ent;
+        const ecs_msg_t * msg;
+        
+        Ecs_TopicBegin( ECSBENCH_TOPIC_TRANSFORM, &iter );
+        while ( ( msg = Ecs_TopicNext( &iter, &ent ) ) != NULL ) {
+            mat4_t expect;
+            EcsBench_XformUpdate( Ecs_GetComponent( ent, ecsbench_xform_t ), &expect );
+            badCount += ( memcmp( &expect, &( ( const ecsbench_msg_transform_t * ) msg )->transform, sizeof( expect ) ) == 0 ) ? 0 : 1;
+            ++msgCount;
+        }
+        
+        return badCount + ( ( msgCount == count ) ? 0 : 1 );
+    }
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        ecsbench_xform_t * comp = Ecs_GetComponent( ents[ n ], ecsbench_xform_t );
+        mat4_t expect;
+        
+        EcsBench_XformUpdate( comp, &expect );
+        badCount += ( memcmp( &expect, &comp->transform, sizeof( expect ) ) == 0 ) ? 0 : 1;
+        memset( &comp->transform, 0, sizeof( comp->transform ) );
+    }
+    
+    return badCount;
+}
+
+/*=======================================================================================================================================*/
+bool_t EcsBench_RunBatch( const xebench_params_t * params ) {
+    uint32_t count = ( params->count > 0 ) ? params->count : ECSBENCH_BATCH_COUNT;
+    uint32_t badCount = 0;
+    
+    Ecs_Initialise();
+    Ecs_RegisterComponent( ecsbench_xform_t, count );
+    
+    const ecs_system_id_t systems[ 4 ] = {
+        Ecs_RegisterSystem( &sys_ecsbench_xform, ecsbench_xform_t ),
+        Ecs_RegisterSystem( &sys_ecsbench_xform_batch, ecsbench_xform_t ),
+        Ecs_RegisterSystem( &sys_ecsbench_xform_publish, ecsbench_xform_t ),
+        Ecs_RegisterSystem( &sys_ecsbench_xform_publish_batch, ecsbench_xform_t )
+    };
+    Ecs_SystemPublishTopic( systems[ 2 ], ECSBENCH_TOPIC_TRANSFORM );
+    Ecs_SystemPublishTopic( systems[ 3 ], ECSBENCH_TOPIC_TRANSFORM );
+    
+    ecs_entity_t * ents = ( ecs_entity_t * ) malloc( sizeof( ecs_entity_t ) * count );
+    xerror( ents == NULL, "Out of memory for the entities\n" );
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        vec3_t axis;
+        Vec3_Set( axis, (float) ( n % 3 ), 1.0f, (float) ( n % 5 ) );
+        Vec3_Normalise( axis, axis );
+        
+        ents[ n ] = Ecs_EntityAlloc();
+        ecsbench_xform_t * comp = Ecs_AddComponent( ents[ n ], ecsbench_xform_t );
+        Quat_SetAA( comp->rotation, axis, (float) n * 0.01f );
+        Vec3_Set( comp->location, (float) n, (float) ( n % 100 ), -(float) n );
+        memset( &comp->transform, 0, sizeof( comp->transform ) );
+    }
+    
+    printf( "%u entities build a transform from a rotation and location for %u frames, %u entities a job\n", count, ECSBENCH_BATCH_FRAMES,
+            ECS_SYSTEM_CHUNK_SIZE );
+    printf( "%-36s %12s %12s\n", "system", "us/frame", "ns/entity" );
+    
+    static const char * const names[ 4 ] = {
+        "think, into the component", "batch think, into the component", "think, published", "batch think, published"
+    };
+    
+    ecs_think_params_t thinkParams;
+    memset( &thinkParams, 0, sizeof( thinkParams ) );
+    
+    uint64_t ns[ 4 ];
+    for ( uint32_t s = 0; s < 4; ++s ) {
+        bool_t published = ( s >= 2 ) ? true : false;
+        uint64_t startNs = Sys_GetTicksNs();
+        
+        for ( uint32_t f = 0; f < ECSBENCH_BATCH_FRAMES; ++f ) {
+            Ecs_RunSystems( &systems[ s ], 1, &thinkParams );
+            
+            /* Keep the last frame's messages to check them */
+            if ( f + 1 < ECSBENCH_BATCH_FRAMES ) {
+                Ecs_EndFrame();
+            }
+        }
+        
+        ns[ s ] = Sys_GetTicksNs() - startNs;
+        badCount += EcsBench_CheckXforms( ents, count, published );
+        Ecs_EndFrame();
+        
+        printf( "%-36s %12.2f %12.2f\n", names[ s ], (double) ns[ s ] / 1e3 / ECSBENCH_BATCH_FRAMES,
+                (double) ns[ s ] / ( (double) count * ECSBENCH_BATCH_FRAMES ) );
+    }
+    
+    printf( "    batch think %.2fx into the component, %.2fx published, %u bad\n", ( ns[ 1 ] > 0 ) ? (double) ns[ 0 ] / (double) ns[ 1 ] : 0.0,
+            ( ns[ 3 ] > 0 ) ? (double) ns[ 2 ] / (double) ns[ 3 ] : 0.0, badCount );
+    
+    free( ents );
+    Ecs_Finalise();
+    
+    return ( badCount == 0 ) ? true : false;
+}
@@ -0,0 +1,216 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Array.h"
+#include "core/Bsearch.h"
+#include "core/HashMap.h"
+#include "mem/Mem.h"
+#include <stdio.h>
+#include <string.h>
+
+#define HASHBENCH_SIZE_COUNT    3
+
+static const uint32_t HASHBENCH_SIZES[ HASHBENCH_SIZE_COUNT ] = { 10 * 1000, 50 * 1000, 100 * 1000 };
+
+typedef enum hashbench_op_e {
+    HASHBENCH_OP_INSERT = 0,
+    HASHBENCH_OP_FIND,
+    HASHBENCH_OP_MISS,
+    HASHBENCH_OP_COUNT
+} hashbench_op_t;
+
+static const char * HASHBENCH_OP_NAMES[ HASHBENCH_OP_COUNT ] = { "insert", "find", "miss" };
+
+/* Keys are looked up in a different order to the one they were added in, so the lookups don't walk memory in order */
+typedef struct hashbench_s {
+    uint32_t        count;
+    uint64_t *      keys;
+    uint64_t *      missKeys;
+    uint32_t *      findOrder;
+    uint64_t        timeNs[ HASHBENCH_OP_COUNT ];
+} hashbench_t;
+
+/*=======================================================================================================================================*/
+static X_INLINE uint64_t HashBench_Random( uint64_t * state ) {
+    /* xorshift64*, the keys stand in for the 64 bit path and name hashes the maps are used with */
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/*=======================================================================================================================================*/
+static bool_t HashBench_RunSorted( hashbench_t * bench ) {
+    /* The parallel sorted arrays that Resource.c used to keep, each insert moves everything after it along one */
+    uint64_t * keys = (uint64_t *) Mem_Alloc( sizeof( uint64_t ) * bench->count );
+    uint64_t * values = (uint64_t *) Mem_Alloc( sizeof( uint64_t ) * bench->count );
+    uint32_t count = 0;
+    uint32_t badCount = 0;
+    int32_t index = 0;
+    
+    uint64_t startNs = Sys_GetTicksNs();
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        bool_t found = Bsearch_FindUint64( &index, bench->keys[ n ], keys, count );
+        if ( found == false ) {
+            Array_InsertAtPosUint64( index, bench->keys[ n ], keys, count, bench->count );
+            Array_InsertAtPosUint64( index, n, values, count, bench->count );
+            ++count;
+        }
+    }
+    bench->timeNs[ HASHBENCH_OP_INSERT ] = Sys_GetTicksNs() - startNs;
+    
+    startNs = Sys_GetTicksNs();
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        uint32_t k = bench->findOrder[ n ];
+        bool_t found = Bsearch_FindUint64( &index, bench->keys[ k ], keys, count );
+        badCount += ( found == false || values[ index ] != k ) ? 1 : 0;
+    }
+    bench->timeNs[ HASHBENCH_OP_FIND ] = Sys_GetTicksNs() - startNs;
+    
+    startNs = Sys_GetTicksNs();
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        badCount += ( Bsearch_FindUint64( &index, bench->missKeys[ n ], keys, count ) == true ) ? 1 : 0;
+    }
+    bench->timeNs[ HASHBENCH_OP_MISS ] = Sys_GetTicksNs() - startNs;
+    
+    Mem_Free( values );
+    Mem_Free( keys );
+    
+    if ( count != bench->count || badCount > 0 ) {
+        printf( "Sorted array holds %u of %u keys, %u lookups were wrong\n", count, bench->count, badCount );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static bool_t HashBench_RunMap( hashbench_t * bench ) {
+    /* Starts at the minimum size like the maps in the engine do, so the inserts pay for the growing */
+    hash_map_t map;
+    uint32_t badCount = 0;
+    uint64_t value = 0;
+    
+    HashMap_Create( &map, 0, MEM_HEAP_DEFAULT );
+    
+    uint64_t startNs = Sys_GetTicksNs();
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        HashMap_Insert( &map, bench->keys[ n ], n );
+    }
+    bench->timeNs[ HASHBENCH_OP_INSERT ] = Sys_GetTicksNs() - startNs;
+    
+    startNs = Sys_GetTicksNs();
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        uint32_t k = bench->findOrder[ n ];
+        bool_t found = HashMap_Find( &map, bench->keys[ k ], &value );
+        badCount += ( found == false || value != k ) ? 1 : 0;
+    }
+    bench->timeNs[ HASHBENCH_OP_FIND ] = Sys_GetTicksNs() - startNs;
+    
+    startNs = Sys_GetTicksNs();
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        badCount += ( HashMap_Find( &map, bench->missKeys[ n ], &value ) == true ) ? 1 : 0;
+    }
+    bench->timeNs[ HASHBENCH_OP_MISS ] = Sys_GetTicksNs() - startNs;
+    
+    uint32_t count = HashMap_GetCount( &map );
+    HashMap_Destroy( &map );
+    
+    if ( count != bench->count || badCount > 0 ) {
+        printf( "Map holds %u of %u keys, %u lookups were wrong\n", count, bench->count, badCount );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static void HashBench_PrintRow( const char * name, const hashbench_t * bench ) {
+    printf( "%-14s %8u", name, bench->count );
+    for ( uint32_t op = 0; op < HASHBENCH_OP_COUNT; ++op ) {
+        printf( " %12.1f", (double) bench->timeNs[ op ] / (double) bench->count );
+    }
+    printf( "\n" );
+}
+
+/*=======================================================================================================================================*/
+bool_t HashBench_Run( const xebench_params_t * params ) {
+    hashbench_t bench;
+    bool_t passed = true;
+    
+    /* A count on the command line runs just that size */
+    uint32_t sizeCount = ( params->count > 0 ) ? 1 : HASHBENCH_SIZE_COUNT;
+    
+    printf( "%-14s %8s", "ns per op", "entries" );
+    for ( uint32_t op = 0; op < HASHBENCH_OP_COUNT; ++op ) {
+        printf( " %12s", HASHBENCH_OP_NAMES[ op ] );
+    }
+    printf( "\n" );
+    
+    for ( uint32_t s = 0; s < sizeCount; ++s ) {
+        memset( &bench, 0, sizeof( bench ) );
+        bench.count = ( params->count > 0 ) ? params->count : HASHBENCH_SIZES[ s ];
+        bench.keys = (uint64_t *) Mem_Alloc( sizeof( uint64_t ) * bench.count );
+        bench.missKeys = (uint64_t *) Mem_Alloc( sizeof( uint64_t ) * bench.count );
+        bench.findOrder = (uint32_t *) Mem_Alloc( sizeof( uint32_t ) * bench.count );
+        
+        /* Keys with the low bit clear are added and the misses have it set, so a miss can't be one of the keys but still
+           lands in amongst them */
+        uint64_t state = 0x9E3779B97F4A7C15ULL + bench.count;
+        for ( uint32_t n = 0; n < bench.count; ++n ) {
+            bench.keys[ n ] = HashBench_Random( &state ) & ~1ULL;
+            bench.missKeys[ n ] = HashBench_Random( &state ) | 1ULL;
+            bench.findOrder[ n ] = n;
+        }
+        
+        /* The random keys could repeat, make them unique so both containers end up holding the same count */
+        hash_map_t seen;
+        HashMap_Create( &seen, bench.count, MEM_HEAP_DEFAULT );
+        for ( uint32_t n = 0; n < bench.count; ++n ) {
+            while ( HashMap_Insert( &seen, bench.keys[ n ], n ) == false ) {
+                bench.keys[ n ] = HashBench_Random( &state ) & ~1ULL;
+            }
+        }
+        HashMap_Destroy( &seen );
+        
+        for ( uint32_t n = bench.count - 1; n > 0; --n ) {
+            uint32_t swap = (uint32_t) ( HashBench_Random( &state ) % ( n + 1 ) );
+            uint32_t tmp = bench.findOrder[ n ];
+            bench.findOrder[ n ] = bench.findOrder[ swap ];
+            bench.findOrder[ swap ] = tmp;
+        }
+        
+        passed = ( HashBench_RunSorted( &bench ) == true ) ? passed : false;
+        HashBench_PrintRow( "sorted array", &bench );
+        
+        passed = ( HashBench_RunMap( &bench ) == true ) ? passed : false;
+        HashBench_PrintRow( "hash map", &bench );
+        
+        Mem_Free( bench.findOrder );
+        Mem_Free( bench.missKeys );
+        Mem_Free( bench.keys );
+    }
+    
+    return passed;
+}
@@ -0,0 +1,383 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Job.h"
+#include "core/Atomic.h"
+#include "mem/Mem.h"
+#include <stdio.h>
+#include <string.h>
+
+#define JOBBENCH_DEFAULT_COUNT  ( 1024 * 1024 )     /* Items in the parallel for */
+#define JOBBENCH_ITEM_WORK      32                  /* Rounds of hashing for each item, so the items cost something */
+#define JOBBENCH_NEST_DEPTH     4
+#define JOBBENCH_NEST_FANOUT    8
+#define JOBBENCH_STAGE_COUNT    16
+#define JOBBENCH_STAGE_JOBS     64
+#define JOBBENCH_FOREIGN_JOBS   256                 /* Jobs each foreign thread submits */
+#define JOBBENCH_FOREIGN_ROUNDS 16
+
+static const uint32_t JOBBENCH_GRAIN_SIZES[] = { 0, 1, 64, 4096 };
+
+#define JOBBENCH_GRAIN_COUNT ( sizeof( JOBBENCH_GRAIN_SIZES ) / sizeof( JOBBENCH_GRAIN_SIZES[ 0 ] ) )
+
+typedef struct jobbench_node_s {
+    uint32_t        depth;
+    uint32_t        pad;
+} jobbench_node_t;
+
+typedef struct jobbench_stage_s {
+    uint32_t        stage;
+    uint32_t        job;
+} jobbench_stage_t;
+
+typedef struct jobbench_s {
+    uint32_t        count;
+    atomic_uint *   hits;                           /* Times each parallel for item was visited */
+    uint32_t *      results;
+    atomic_uint     badCount;
+    atomic_uint     leafCount;
+    atomic_uint     stageDone[ JOBBENCH_STAGE_COUNT ];
+    atomic_uint     foreignDone[ XEBENCH_MAX_THREADS ];
+} jobbench_t;
+
+static jobbench_t jobBench;
+
+/*=======================================================================================================================================*/
+static X_INLINE uint32_t JobBench_Work( uint32_t value ) {
+    /* Enough arithmetic that the item is worth handing to another core, and that the compiler can't skip */
+    for ( uint32_t n = 0; n < JOBBENCH_ITEM_WORK; ++n ) {
+        value ^= value << 13;
+        value ^= value >> 17;
+        value ^= value << 5;
+    }
+    return value;
+}
+
+/*=======================================================================================================================================*/
+static void JobBench_ForRange( void * arg, uint32_t start, uint32_t end ) {
+    jobbench_t * bench = (jobbench_t *) arg;
+    
+    for ( uint32_t n = start; n < end; ++n ) {
+        atomic_fetch_add_explicit( &bench->hits[ n ], 1, memory_order_relaxed );
+        bench->results[ n ] = JobBench_Work( n + 1 );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void JobBench_WorkRange( void * arg, uint32_t start, uint32_t end ) {
+    jobbench_t * bench = (jobbench_t *) arg;
+    
+    for ( uint32_t n = start; n < end; ++n ) {
+        bench->results[ n ] = JobBench_Work( n + 1 );
+    }
+}
+
+/*=======================================================================================================================================*/
+static bool_t JobBench_ParallelFor( jobbench_t * bench ) {
+    bool_t passed = true;
+    
+    /* Serial first, to time against and to check the results with */
+    uint64_t startNs = Sys_GetTicksNs();
+    JobBench_WorkRange( bench, 0, bench->count );
+    uint64_t serialNs = Sys_GetTicksNs() - startNs;
+    
+    uint32_t checksum = 0;
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        checksum += bench->results[ n ];
+    }
+    
+    printf( "parallel for, %u items\n", bench->count );
+    printf( "    %-10s %12s %10s\n", "grain", "ms", "speedup" );
+    printf( "    %-10s %12.2f %10.2f\n", "serial", (double) serialNs / 1e6, 1.0 );
+    
+    for ( uint32_t g = 0; g < JOBBENCH_GRAIN_COUNT; ++g ) {
+        memset( bench->results, 0, sizeof( uint32_t ) * bench->count );
+        for ( uint32_t n = 0; n < bench->count; ++n ) {
+            atomic_store_explicit( &bench->hits[ n ], 0, memory_order_relaxed );
+        }
+        
+        startNs = Sys_GetTicksNs();
+        Job_ParallelFor( bench->count, JOBBENCH_GRAIN_SIZES[ g ], JobBench_ForRange, bench, NULL );
+        uint64_t timeNs = Sys_GetTicksNs() - startNs;
+        
+        /* Every item exactly once, with the same answer as the serial loop */
+        uint32_t missed = 0;
+        uint32_t check = 0;
+        for ( uint32_t n = 0; n < bench->count; ++n ) {
+            missed += ( atomic_load_explicit( &bench->hits[ n ], memory_order_relaxed ) == 1 ) ? 0 : 1;
+            check += bench->results[ n ];
+        }
+        
+        if ( missed > 0 || check != checksum ) {
+            printf( "    Grain %u visited %u items other than once\n", JOBBENCH_GRAIN_SIZES[ g ], missed );
+            passed = false;
+        }
+        
+        char grainName[ 16 ];
+        snprintf( grainName, sizeof( grainName ), ( JOBBENCH_GRAIN_SIZES[ g ] == 0 ) ? "auto" : "%u", JOBBENCH_GRAIN_SIZES[ g ] );
+        printf( "    %-10s %12.2f %10.2f\n", grainName, (double) timeNs / 1e6, (double) serialNs / (double) ( timeNs > 0 ? timeNs : 1 ) );
+    }
+    
+    return passed;
+}
+
+/*=======================================================================================================================================*/
+static void JobBench_NestJob( void * arg ) {
+    const jobbench_node_t * node = (const jobbench_node_t *) arg;
+    
+    if ( node->depth == JOBBENCH_NEST_DEPTH ) {
+        atomic_fetch_add( &jobBench.leafCount, 1 );
+        return;
+    }
+    
+    /* Each level waits on its children from inside a job, so the worker has to run other jobs while it waits */
+    jobbench_node_t children[ JOBBENCH_NEST_FANOUT ];
+    job_decl_t jobs[ JOBBENCH_NEST_FANOUT ];
+    job_counter_t counter;
+    
+    for ( uint32_t c = 0; c < JOBBENCH_NEST_FANOUT; ++c ) {
+        children[ c ].depth = node->depth + 1;
+        children[ c ].pad = 0;
+        jobs[ c ].func = JobBench_NestJob;
+        jobs[ c ].arg = &children[ c ];
+    }
+    
+    Job_CounterInit( &counter );
+    Job_Run( jobs, JOBBENCH_NEST_FANOUT, &counter );
+    Job_Wait( &counter );
+    
+    if ( Job_CounterGet( &counter ) != 0 ) {
+        atomic_fetch_add( &jobBench.badCount, 1 );
+    }
+}
+
+/*=======================================================================================================================================*/
+static bool_t JobBench_NestedWaits( jobbench_t * bench ) {
+    jobbench_node_t root = { 0, 0 };
+    job_decl_t job = { JobBench_NestJob, &root };
+    job_counter_t counter;
+    
+    uint32_t expected = 1;
+    for ( uint32_t d = 0; d < JOBBENCH_NEST_DEPTH; ++d ) {
+        expected *= JOBBENCH_NEST_FANOUT;
+    }
+    
+    atomic_store( &bench->leafCount, 0 );
+    atomic_store( &bench->badCount, 0 );
+    
+    uint64_t startNs = Sys_GetTicksNs();
+    Job_CounterInit( &counter );
+    Job_Run( &job, 1, &counter );
+    Job_Wait( &counter );
+    uint64_t timeNs = Sys_GetTicksNs() - startNs;
+    
+    uint32_t leaves = atomic_load( &bench->leafCount );
+    printf( "nested waits, depth %u fanout %u: %u leaves in %.2f ms\n", JOBBENCH_NEST_DEPTH, JOBBENCH_NEST_FANOUT, leaves, (double) timeNs / 1e6 );
+    
+    if ( leaves != expected || atomic_load( &bench->badCount ) != 0 ) {
+        printf( "    Expected %u leaves, %u waits returned early\n", expected, atomic_load( &bench->badCount ) );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static void JobBench_StageJob( void * arg ) {
+    const jobbench_stage_t * stage = (const jobbench_stage_t *) arg;
+    
+    /* The stage before must have finished all of its jobs before any of this one starts */
+    if ( stage->stage > 0 && atomic_load( &jobBench.stageDone[ stage->stage - 1 ] ) != JOBBENCH_STAGE_JOBS ) {
+        atomic_fetch_add( &jobBench.badCount, 1 );
+    }
+    
+    JobBench_Work( stage->job );
+    atomic_fetch_add( &jobBench.stageDone[ stage->stage ], 1 );
+}
+
+/*=======================================================================================================================================*/
+static bool_t JobBench_Dependencies( jobbench_t * bench ) {
+    static jobbench_stage_t stages[ JOBBENCH_STAGE_COUNT ][ JOBBENCH_STAGE_JOBS ];
+    job_decl_t jobs[ JOBBENCH_STAGE_JOBS ];
+    job_counter_t counters[ JOBBENCH_STAGE_COUNT ];
+    
+    atomic_store( &bench->badCount, 0 );
+    for ( uint32_t s = 0; s < JOBBENCH_STAGE_COUNT; ++s ) {
+        atomic_store( &bench->stageDone[ s ], 0 );
+        Job_CounterInit( &counters[ s ] );
+    }
+    
+    /* The whole chain is queued up front, each stage parked on the counter of the one before */
+    uint64_t startNs = Sys_GetTicksNs();
+    for ( uint32_t s = 0; s < JOBBENCH_STAGE_COUNT; ++s ) {
+        for ( uint32_t j = 0; j < JOBBENCH_STAGE_JOBS; ++j ) {
+            stages[ s ][ j ].stage = s;
+            stages[ s ][ j ].job = j;
+            jobs[ j ].func = JobBench_StageJob;
+            jobs[ j ].arg = &stages[ s ][ j ];
+        }
+        
+        if ( s == 0 ) {
+            Job_Run( jobs, JOBBENCH_STAGE_JOBS, &counters[ s ] );
+        }
+        else {
+            Job_RunAfter( jobs, JOBBENCH_STAGE_JOBS, &counters[ s ], &counters[ s - 1 ] );
+        }
+    }
+    
+    Job_Wait( &counters[ JOBBENCH_STAGE_COUNT - 1 ] );
+    uint64_t timeNs = Sys_GetTicksNs() - startNs;
+    
+    printf( "dependencies, %u stages of %u jobs in %.2f ms\n", JOBBENCH_STAGE_COUNT, JOBBENCH_STAGE_JOBS, (double) timeNs / 1e6 );
+    
+    uint32_t ran = 0;
+    for ( uint32_t s = 0; s < JOBBENCH_STAGE_COUNT; ++s ) {
+        ran += atomic_load( &bench->stageDone[ s ] );
+    }
+    
+    if ( ran != JOBBENCH_STAGE_COUNT * JOBBENCH_STAGE_JOBS || atomic_load( &bench->badCount ) != 0 ) {
+        printf( "    %u of %u jobs ran, %u started before their dependency finished\n", ran, JOBBENCH_STAGE_COUNT * JOBBENCH_STAGE_JOBS, atomic_load( &bench->badCount ) );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static void JobBench_ForeignJob( void * arg ) {
+    atomic_uint * done = (atomic_uint *) arg;
+    atomic_fetch_add( done, 1 );
+}
+
+/*=======================================================================================================================================*/
+static void JobBench_ForeignThread( uint32_t threadIndex, void * user ) {
+    jobbench_t * bench = (jobbench_t *) user;
+    job_decl_t jobs[ JOBBENCH_FOREIGN_JOBS ];
+    job_counter_t counter;
+    
+    /* None of these threads are workers, so their jobs go through the shared queue and the waits take jobs from it */
+    if ( Job_GetWorkerIndex() != 0 ) {
+        atomic_fetch_add( &bench->badCount, 1 );
+    }
+    
+    for ( uint32_t j = 0; j < JOBBENCH_FOREIGN_JOBS; ++j ) {
+        jobs[ j ].func = JobBench_ForeignJob;
+        jobs[ j ].arg = &bench->foreignDone[ threadIndex ];
+    }
+    
+    for ( uint32_t r = 0; r < JOBBENCH_FOREIGN_ROUNDS; ++r ) {
+        Job_CounterInit( &counter );
+        Job_Run( jobs, JOBBENCH_FOREIGN_JOBS, &counter );
+        Job_Wait( &counter );
+        
+        if ( atomic_load( &bench->foreignDone[ threadIndex ] ) != ( r + 1 ) * JOBBENCH_FOREIGN_JOBS ) {
+            atomic_fetch_add( &bench->badCount, 1 );
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static bool_t JobBench_Foreign( jobbench_t * bench, uint32_t threadCount ) {
+    atomic_store( &bench->badCount, 0 );
+    for ( uint32_t t = 0; t < XEBENCH_MAX_THREADS; ++t ) {
+        atomic_store( &bench->foreignDone[ t ], 0 );
+    }
+    
+    uint64_t timeNs = XeBench_RunThreads( threadCount, JobBench_ForeignThread, bench );
+    
+    uint32_t ran = 0;
+    for ( uint32_t t = 0; t < threadCount; ++t ) {
+        ran += atomic_load( &bench->foreignDone[ t ] );
+    }
+    
+    uint32_t expected = threadCount * JOBBENCH_FOREIGN_JOBS * JOBBENCH_FOREIGN_ROUNDS;
+    printf( "foreign threads, %u threads submitting %u jobs: %.2f ms\n", threadCount, expected, (double) timeNs / 1e6 );
+    
+    if ( ran != expected || atomic_load( &bench->badCount ) != 0 ) {
+        printf( "    %u of %u jobs ran, %u waits returned early\n", ran, expected, atomic_load( &bench->badCount ) );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static bool_t JobBench_Scaling( jobbench_t * bench, uint32_t threadCount ) {
+    uint64_t baseNs = 0;
+    bool_t passed = true;
+    
+    /* The same parallel for with the job system brought up again with more workers each time */
+    printf( "worker scaling, %u items\n", bench->count );
+    printf( "    %-10s %12s %10s %12s\n", "workers", "ms", "speedup", "stolen" );
+    
+    uint32_t maxWorkers = ( threadCount > JOB_MAX_WORKERS ) ? JOB_MAX_WORKERS : threadCount;
+    for ( uint32_t workers = 1; workers <= maxWorkers; workers = XeBench_NextThreadCount( workers, maxWorkers ) ) {
+        Job_Finalise();
+        Job_Initialise( workers );
+        
+        if ( Job_GetWorkerCount() != workers ) {
+            printf( "    Asked for %u workers and got %u\n", workers, Job_GetWorkerCount() );
+            passed = false;
+        }
+        
+        uint64_t startNs = Sys_GetTicksNs();
+        Job_ParallelFor( bench->count, 0, JobBench_WorkRange, bench, NULL );
+        uint64_t timeNs = Sys_GetTicksNs() - startNs;
+        
+        job_stats_t stats;
+        Job_GetStats( &stats );
+        
+        baseNs = ( workers == 1 ) ? timeNs : baseNs;
+        printf( "    %-10u %12.2f %10.2f %12llu\n", workers, (double) timeNs / 1e6, (double) baseNs / (double) ( timeNs > 0 ? timeNs : 1 ),
+               (unsigned long long) stats.numStolen );
+    }
+    
+    /* Back to the default the rest of the tests run with */
+    Job_Finalise();
+    Job_Initialise( 0 );
+    
+    return passed;
+}
+
+/*=======================================================================================================================================*/
+bool_t JobBench_Run( const xebench_params_t * params ) {
+    jobbench_t * bench = &jobBench;
+    bool_t passed = true;
+    
+    memset( bench, 0, sizeof( *bench ) );
+    bench->count = ( params->count > 0 ) ? params->count : JOBBENCH_DEFAULT_COUNT;
+    bench->hits = (atomic_uint *) Mem_Alloc( sizeof( atomic_uint ) * bench->count );
+    bench->results = (uint32_t *) Mem_Alloc( sizeof( uint32_t ) * bench->count );
+    
+    printf( "%u workers\n", Job_GetWorkerCount() );
+    
+    passed = ( JobBench_ParallelFor( bench ) == true ) ? passed : false;
+    passed = ( JobBench_NestedWaits( bench ) == true ) ? passed : false;
+    passed = ( JobBench_Dependencies( bench ) == true ) ? passed : false;
+    passed = ( JobBench_Foreign( bench, params->threadCount ) == true ) ? passed : false;
+    passed = ( JobBench_Scaling( bench, params->threadCount ) == true ) ? passed : false;
+    
+    Mem_Free( bench->results );
+    Mem_Free( bench->hits );
+    
+    return passed;
+}
@@ -0,0 +1,336 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Fs.h"
+#include "core/Str.h"
+#include "mem/Mem.h"
+#include "render/Render3d.h"
+#include "render/Model.h"
+#include "render/ModelStream.h"
+#include "null/Model_null.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LOADBENCH_DEFAULT_COUNT     16              /* Model files loaded by each way of reading them */
+#define LOADBENCH_VERTEX_COUNT      ( 128 * 1024 )  /* 4MB of vertices a model */
+#define LOADBENCH_INDEX_COUNT       ( 192 * 1024 )
+#define LOADBENCH_MESH_COUNT        4
+#define LOADBENCH_MATERIAL_NAMES    16
+
+/* How a row gets the model stream into memory */
+typedef enum loadbench_mode_e {
+    LOADBENCH_MODE_COPY = 0,                        /* Mem_Alloc the file size and FS_FileRead it, as the loaders used to */
+    LOADBENCH_MODE_MAP,                             /* FS_FileMap and use the stream in place, as the loaders do now */
+    LOADBENCH_MODE_COUNT
+} loadbench_mode_t;
+
+/* A model file while its stream is in memory */
+typedef struct loadbench_stream_s {
+    file_t          file;
+    file_map_t      map;
+    model_stream_t * data;
+} loadbench_stream_t;
+
+typedef struct loadbench_s {
+    uint32_t        count;
+    size_t          fileSize;
+    str_t *         paths;
+    model_t *       models;
+    loadbench_stream_t * streams;
+} loadbench_t;
+
+typedef struct loadbench_result_s {
+    uint64_t        ns;
+    size_t          peakResident;                   /* Most memory above the start of the row, sampled while streams are in memory */
+    size_t          peakPrivate;
+    uint32_t        badCount;
+} loadbench_result_t;
+
+static loadbench_t loadBench;
+
+/*=======================================================================================================================================*/
+static bool_t LoadBench_WriteModel( const char * path, uint32_t seed ) {
+    /* Same layout the model tool writes, meshes then vertices, indices and the material names, each 16 byte aligned */
+    size_t offsMeshes = ( sizeof( model_stream_t ) + 15 ) & ~(size_t) 15;
+    size_t offsVertices = offsMeshes + ( ( sizeof( mesh_stream_t ) * LOADBENCH_MESH_COUNT + 15 ) & ~(size_t) 15 );
+    size_t offsIndices = offsVertices + sizeof( vertex_t ) * LOADBENCH_VERTEX_COUNT;
+    size_t offsNames = offsIndices + sizeof( uint32_t ) * LOADBENCH_INDEX_COUNT;
+    size_t size = offsNames + LOADBENCH_MATERIAL_NAMES;
+    
+    uint8_t * data = Mem_Alloc( size );
+    xerror( data == NULL, "Out of memory for a model stream\n" );
+    memset( data, 0, size );
+    
+    model_stream_t * str = ( model_stream_t * ) data;
+    str->version = MODEL_STREAM_VERSION;
+    str->vertexCount = LOADBENCH_VERTEX_COUNT;
+    str->indexCount = LOADBENCH_INDEX_COUNT;
+    str->meshCount = LOADBENCH_MESH_COUNT;
+    str->vertexDataSize = (uint32_t) ( sizeof( vertex_t ) * LOADBENCH_VERTEX_COUNT );
+    str->indexDataSize = (uint32_t) ( sizeof( uint32_t ) * LOADBENCH_INDEX_COUNT );
+    str->materialNamesSize = LOADBENCH_MATERIAL_NAMES;
+    str->offsMeshes = (uint32_t) offsMeshes;
+    str->offsVertices = (uint32_t) offsVertices;
+    str->offsIndices = (uint32_t) offsIndices;
+    str->offsMaterialNames = (uint32_t) offsNames;
+    
+    mesh_stream_t * meshes = ( mesh_stream_t * ) ( data + offsMeshes );
+    for ( uint32_t m = 0; m < LOADBENCH_MESH_COUNT; ++m ) {
+        meshes[ m ].vertexStart = m * ( LOADBENCH_VERTEX_COUNT / LOADBENCH_MESH_COUNT );
+        meshes[ m ].vertexCount = LOADBENCH_VERTEX_COUNT / LOADBENCH_MESH_COUNT;
+        meshes[ m ].indexStart = m * ( LOADBENCH_INDEX_COUNT / LOADBENCH_MESH_COUNT );
+        meshes[ m ].indexCount = LOADBENCH_INDEX_COUNT / LOADBENCH_MESH_COUNT;
+    }
+    
+    float * vertices = ( float * ) ( data + offsVertices );
+    for ( size_t v = 0; v < LOADBENCH_VERTEX_COUNT * 8; ++v ) {
+        vertices[ v ] = (float) ( ( v + seed ) % 977 ) * 0.5f;
+    }
+    
+    uint32_t * indices = ( uint32_t * ) ( data + offsIndices );
+    for ( uint32_t i = 0; i < LOADBENCH_INDEX_COUNT; ++i ) {
+        indices[ i ] = ( i + seed ) % ( LOADBENCH_VERTEX_COUNT / LOADBENCH_MESH_COUNT );
+    }
+    
+    strcpy( ( char * ) data + offsNames, "material" );
+    
+    file_t file;
+    bool_t written = false;
+    if ( FS_FileOpen( &file, path, "wb" ) == true ) {
+        written = ( FS_FileWrite( &file, data, size, 1 ) == 1 ) ? true : false;
+        FS_FileClose( &file );
+    }
+    
+    Mem_Free( data );
+    loadBench.fileSize = size;
+    return written;
+}
+
+/*=======================================================================================================================================*/
+static void LoadBench_CreateModel( model_t * model, model_stream_t * str ) {
+    /* What Model_LoadData does with the stream, less the materials */
+    vec3_t boundsMin, boundsMax;
+    
+    Model_Create( model, str->vertexCount, str->indexCount, str->meshCount, 0 );
+    Model_WriteVertexData( model, ModelStream_GetVertices( str ), 0, str->vertexCount );
+    Model_WriteIndexData( model, ModelStream_GetIndices( str ), 0, str->indexCount );
+    Model_WriteMeshData( model, ModelStream_GetMeshes( str ), 0, str->meshCount );
+    ModelStream_GetBounds( str, &boundsMin, &boundsMax );
+    Model_SetBounds( model, &boundsMin, &boundsMax );
+}
+
+/*=======================================================================================================================================*/
+static bool_t LoadBench_CheckModel( model_t * model, model_stream_t * str ) {
+    const model_null_t * modelNull = ( const model_null_t * ) model;
+    
+    return ( modelNull->vertexCount == str->vertexCount && modelNull->indexCount == str->indexCount &&
+             memcmp( modelNull->vertices, ModelStream_GetVertices( str ), str->vertexDataSize ) == 0 &&
+             memcmp( modelNull->indices, ModelStream_GetIndices( str ), str->indexDataSize ) == 0 ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static bool_t LoadBench_OpenStream( loadbench_stream_t * stream, const char * path, loadbench_mode_t mode ) {
+    stream->data = NULL;
+    
+    if ( FS_FileOpen( &stream->file, path, "rb" ) == false ) {
+        return false;
+    }
+    
+    if ( mode == LOADBENCH_MODE_COPY ) {
+        size_t size = FS_FileLength( &stream->file );
+        stream->data = Mem_Alloc( size );
+        xerror( stream->data == NULL, "Out of memory for a model file\n" );
+        
+        if ( FS_FileRead( &stream->file, stream->data, size, 1 ) != 1 ) {
+            Mem_Free( stream->data );
+            stream->data = NULL;
+        }
+    }
+    else if ( FS_FileMap( &stream->file, &stream->map ) == true ) {
+        stream->data = ( model_stream_t * ) stream->map.data;
+    }
+    
+    if ( stream->data == NULL ) {
+        FS_FileClose( &stream->file );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static void LoadBench_CloseStream( loadbench_stream_t * stream, loadbench_mode_t mode ) {
+    if ( mode == LOADBENCH_MODE_COPY ) {
+        Mem_Free( stream->data );
+    }
+    else {
+        FS_FileUnmap( &stream->map );
+    }
+    
+    FS_FileClose( &stream->file );
+    stream->data = NULL;
+}
+
+/*=======================================================================================================================================*/
+static void LoadBench_Sample( size_t startResident, size_t startPrivate, loadbench_result_t * result ) {
+    size_t resident, privateBytes;
+    
+    XeBench_GetResident( &resident, &privateBytes );
+    resident = ( resident > startResident ) ? resident - startResident : 0;
+    privateBytes = ( privateBytes > startPrivate ) ? privateBytes - startPrivate : 0;
+    
+    result->peakResident = ( resident > result->peakResident ) ? resident : result->peakResident;
+    result->peakPrivate = ( privateBytes > result->peakPrivate ) ? privateBytes : result->peakPrivate;
+}
+
+/*=======================================================================================================================================*/
+static void LoadBench_RunMode( loadbench_mode_t mode, bool_t allInFlight, loadbench_result_t * result ) {
+    size_t startResident, startPrivate;
+    uint32_t openCount = 0;
+    
+    memset( result, 0, sizeof( *result ) );
+    XeBench_GetResident( &startResident, &startPrivate );
+    
+    /* One file at a time is a sync load. With all of them in flight every stream is read before the first model is built,
+       as happens when the async loads are queued faster than their finish runs. Only the loading is timed, the models stay
+       until the row is done as a level's would */
+    for ( uint32_t n = 0; n < loadBench.count; ++n ) {
+        loadbench_stream_t * stream = &loadBench.streams[ n ];
+        
+        uint64_t startNs = Sys_GetTicksNs();
+        if ( LoadBench_OpenStream( stream, loadBench.paths[ n ], mode ) == false ) {
+            ++result->badCount;
+            break;
+        }
+        
+        ++openCount;
+        
+        if ( allInFlight == false ) {
+            LoadBench_CreateModel( &loadBench.models[ n ], stream->data );
+            result->ns += Sys_GetTicksNs() - startNs;
+            
+            LoadBench_Sample( startResident, startPrivate, result );
+            result->badCount += ( LoadBench_CheckModel( &loadBench.models[ n ], stream->data ) == true ) ? 0 : 1;
+            
+            startNs = Sys_GetTicksNs();
+            LoadBench_CloseStream( stream, mode );
+        }
+        
+        result->ns += Sys_GetTicksNs() - startNs;
+    }
+    
+    if ( allInFlight == true ) {
+        uint64_t startNs = Sys_GetTicksNs();
+        for ( uint32_t n = 0; n < openCount; ++n ) {
+            LoadBench_CreateModel( &loadBench.models[ n ], loadBench.streams[ n ].data );
+        }
+        result->ns += Sys_GetTicksNs() - startNs;
+        
+        LoadBench_Sample( startResident, startPrivate, result );
+        
+        for ( uint32_t n = 0; n < openCount; ++n ) {
+            result->badCount += ( LoadBench_CheckModel( &loadBench.models[ n ], loadBench.streams[ n ].data ) == true ) ? 0 : 1;
+        }
+        
+        startNs = Sys_GetTicksNs();
+        for ( uint32_t n = 0; n < openCount; ++n ) {
+            LoadBench_CloseStream( &loadBench.streams[ n ], mode );
+        }
+        result->ns += Sys_GetTicksNs() - startNs;
+    }
+    
+    for ( uint32_t n = 0; n < openCount; ++n ) {
+        Model_Destroy( &loadBench.models[ n ] );
+    }
+}
+
+/*=======================================================================================================================================*/
+bool_t LoadBench_Run( const xebench_params_t * params ) {
+    loadbench_result_t results[ LOADBENCH_MODE_COUNT ];
+    render_params_t renderParams;
+    uint32_t badCount = 0;
+    
+    memset( &loadBench, 0, sizeof( loadBench ) );
+    loadBench.count = ( params->count > 0 ) ? params->count : LOADBENCH_DEFAULT_COUNT;
+    
+    memset( &renderParams, 0, sizeof( renderParams ) );
+    Render_Initialise( &renderParams );
+    
+    loadBench.paths = Mem_Alloc( sizeof( str_t ) * loadBench.count );
+    loadBench.models = Mem_Alloc( sizeof( model_t ) * loadBench.count );
+    loadBench.streams = Mem_Alloc( sizeof( loadbench_stream_t ) * loadBench.count );
+    xerror( loadBench.paths == NULL || loadBench.models == NULL || loadBench.streams == NULL, "Out of memory for the models\n" );
+    memset( loadBench.paths, 0, sizeof( str_t ) * loadBench.count );
+    memset( loadBench.models, 0, sizeof( model_t ) * loadBench.count );
+    memset( loadBench.streams, 0, sizeof( loadbench_stream_t ) * loadBench.count );
+    
+    for ( uint32_t n = 0; n < loadBench.count; ++n ) {
+        char name[ 64 ];
+        snprintf( name, sizeof( name ), "xebench_load%u.bmdl", n );
+        XeBench_GetTempPath( &loadBench.paths[ n ], name );
+        
+        if ( LoadBench_WriteModel( loadBench.paths[ n ], n ) == false ) {
+            printf( "Couldn't write %s\n", loadBench.paths[ n ] );
+            ++badCount;
+            break;
+        }
+    }
+    
+    if ( badCount == 0 ) {
+        static const char * const modeNames[ LOADBENCH_MODE_COUNT ] = { "read+copy", "mapped" };
+        
+        /* The files were just written, so every row reads them from the page cache */
+        printf( "%u models of %.1f MB, %.1f MB in all, loaded into the null renderer\n", loadBench.count, (double) loadBench.fileSize / ( 1024.0 * 1024.0 ),
+                (double) loadBench.fileSize * loadBench.count / ( 1024.0 * 1024.0 ) );
+        printf( "%-12s %-14s %12s %12s %14s %14s\n", "read", "in flight", "total ms", "ms/model", "peak RSS MB", "private MB" );
+        
+        for ( uint32_t f = 0; f < 2; ++f ) {
+            bool_t allInFlight = ( f == 1 ) ? true : false;
+            
+            for ( uint32_t m = 0; m < LOADBENCH_MODE_COUNT; ++m ) {
+                loadbench_result_t result;
+                LoadBench_RunMode( (loadbench_mode_t) m, allInFlight, &result );
+                
+                printf( "%-12s %-14s %12.2f %12.2f %14.1f %14.1f\n", modeNames[ m ], ( allInFlight == true ) ? "all" : "one at a time", (double) result.ns / 1e6,
+                        (double) result.ns / 1e6 / loadBench.count, (double) result.peakResident / ( 1024.0 * 1024.0 ),
+                        (double) result.peakPrivate / ( 1024.0 * 1024.0 ) );
+                badCount += result.badCount;
+            }
+        }
+        
+        printf( "    %u bad\n", badCount );
+    }
+    
+    for ( uint32_t n = 0; n < loadBench.count; ++n ) {
+        if ( loadBench.paths[ n ] != NULL ) {
+            remove( loadBench.paths[ n ] );
+            Str_Destroy( &loadBench.paths[ n ] );
+        }
+    }
+    
+    Mem_Free( loadBench.streams );
+    Mem_Free( loadBench.models );
+    Mem_Free( loadBench.paths );
+    Render_Finalise();
+    
+    return ( badCount == 0 ) ? true : false;
+}
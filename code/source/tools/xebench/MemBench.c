@@ -0,0 +1,243 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Atomic.h"
+#include "mem/Mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMBENCH_DEFAULT_COUNT  ( 1024 * 1024 )
+#define MEMBENCH_LIVE_COUNT     256                 /* Blocks each thread keeps alive, a random one is replaced each step */
+#define MEMBENCH_MAX_SIZE       1024                /* Sizes go up to the biggest small block size class */
+#define MEMBENCH_HANDOFF_COUNT  ( 64 * 1024 )       /* Blocks each thread allocates for another thread to free */
+
+typedef enum membench_alloc_e {
+    MEMBENCH_ALLOC_MEM = 0,
+    MEMBENCH_ALLOC_MALLOC,
+    MEMBENCH_ALLOC_LOCKED_MALLOC,                   /* malloc behind one global mutex, the way Mem_Alloc used to work */
+    MEMBENCH_ALLOC_COUNT
+} membench_alloc_t;
+
+static const char * MEMBENCH_ALLOC_NAMES[ MEMBENCH_ALLOC_COUNT ] = { "Mem_Alloc", "malloc", "locked malloc" };
+
+typedef struct membench_s {
+    membench_alloc_t    alloc;
+    uint32_t            count;
+    uint32_t            threadCount;
+    sys_mutex_t         mutex;
+    atomic_uint         badCount;
+    void **             handoff;                    /* MEMBENCH_HANDOFF_COUNT blocks for each thread */
+} membench_t;
+
+/*=======================================================================================================================================*/
+static X_INLINE uint32_t MemBench_Random( uint32_t * state ) {
+    /* xorshift32, cheap enough that it doesn't show up next to the allocator */
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE size_t MemBench_RandomSize( uint32_t * state ) {
+    /* Mostly small blocks, the way the engine allocates, with every size class getting some */
+    uint32_t r = MemBench_Random( state );
+    size_t size = (size_t) 16 << ( r % 7 );
+    size += ( r >> 8 ) % size;
+    return ( size > MEMBENCH_MAX_SIZE ) ? MEMBENCH_MAX_SIZE : size;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void * MemBench_Alloc( membench_t * bench, size_t size ) {
+    void * ptr = NULL;
+    
+    switch ( bench->alloc ) {
+        case MEMBENCH_ALLOC_MEM:
+            ptr = Mem_Alloc( size );
+            break;
+        case MEMBENCH_ALLOC_MALLOC:
+            ptr = malloc( size );
+            break;
+        default:
+            Sys_MutexLock( &bench->mutex );
+            ptr = malloc( size );
+            Sys_MutexUnlock( &bench->mutex );
+            break;
+    }
+    
+    return ptr;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void MemBench_Free( membench_t * bench, void * ptr ) {
+    switch ( bench->alloc ) {
+        case MEMBENCH_ALLOC_MEM:
+            Mem_Free( ptr );
+            break;
+        case MEMBENCH_ALLOC_MALLOC:
+            free( ptr );
+            break;
+        default:
+            Sys_MutexLock( &bench->mutex );
+            free( ptr );
+            Sys_MutexUnlock( &bench->mutex );
+            break;
+    }
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void MemBench_Fill( void * ptr, size_t size, uint32_t tag ) {
+    /* The size and a tag go at the start and the tag at the end, so a block handed out twice or overrun by its
+       neighbour shows up when it's freed */
+    uint32_t * words = ( uint32_t * ) ptr;
+    words[ 0 ] = (uint32_t) size;
+    words[ 1 ] = tag;
+    ( ( uint8_t * ) ptr )[ size - 1 ] = (uint8_t) tag;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE bool_t MemBench_Check( const void * ptr ) {
+    const uint32_t * words = ( const uint32_t * ) ptr;
+    size_t size = words[ 0 ];
+    return ( ( const uint8_t * ) ptr )[ size - 1 ] == (uint8_t) words[ 1 ];
+}
+
+/*=======================================================================================================================================*/
+static void MemBench_Churn( uint32_t threadIndex, void * user ) {
+    membench_t * bench = ( membench_t * ) user;
+    void * live[ MEMBENCH_LIVE_COUNT ];
+    uint32_t rng = 0x9E3779B9u ^ ( threadIndex * 0x85EBCA6Bu + 1 );
+    uint32_t bad = 0;
+    
+    memset( live, 0, sizeof( live ) );
+    
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        uint32_t slot = MemBench_Random( &rng ) % MEMBENCH_LIVE_COUNT;
+        if ( live[ slot ] != NULL ) {
+            bad += ( MemBench_Check( live[ slot ] ) == true ) ? 0 : 1;
+            MemBench_Free( bench, live[ slot ] );
+        }
+        
+        size_t size = MemBench_RandomSize( &rng );
+        live[ slot ] = MemBench_Alloc( bench, size );
+        MemBench_Fill( live[ slot ], size, n );
+    }
+    
+    for ( uint32_t n = 0; n < MEMBENCH_LIVE_COUNT; ++n ) {
+        if ( live[ n ] != NULL ) {
+            bad += ( MemBench_Check( live[ n ] ) == true ) ? 0 : 1;
+            MemBench_Free( bench, live[ n ] );
+        }
+    }
+    
+    atomic_fetch_add( &bench->badCount, bad );
+}
+
+/*=======================================================================================================================================*/
+static void MemBench_HandoffAlloc( uint32_t threadIndex, void * user ) {
+    membench_t * bench = ( membench_t * ) user;
+    void ** blocks = &bench->handoff[ threadIndex * MEMBENCH_HANDOFF_COUNT ];
+    uint32_t rng = 0x2545F491u ^ ( threadIndex * 0x85EBCA6Bu + 1 );
+    
+    for ( uint32_t n = 0; n < MEMBENCH_HANDOFF_COUNT; ++n ) {
+        size_t size = MemBench_RandomSize( &rng );
+        blocks[ n ] = MemBench_Alloc( bench, size );
+        MemBench_Fill( blocks[ n ], size, n );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void MemBench_HandoffFree( uint32_t threadIndex, void * user ) {
+    /* Free the blocks the next thread along allocated, so every block goes back through a cache that didn't hand it out */
+    membench_t * bench = ( membench_t * ) user;
+    void ** blocks = &bench->handoff[ ( ( threadIndex + 1 ) % bench->threadCount ) * MEMBENCH_HANDOFF_COUNT ];
+    uint32_t bad = 0;
+    
+    for ( uint32_t n = 0; n < MEMBENCH_HANDOFF_COUNT; ++n ) {
+        bad += ( MemBench_Check( blocks[ n ] ) == true ) ? 0 : 1;
+        MemBench_Free( bench, blocks[ n ] );
+    }
+    
+    atomic_fetch_add( &bench->badCount, bad );
+}
+
+/*=======================================================================================================================================*/
+bool_t MemBench_Run( const xebench_params_t * params ) {
+    membench_t bench;
+    memset( &bench, 0, sizeof( bench ) );
+    Sys_MutexCreate( &bench.mutex );
+    bench.count = ( params->count > 0 ) ? params->count : MEMBENCH_DEFAULT_COUNT;
+    bench.handoff = ( void ** ) malloc( sizeof( void * ) * MEMBENCH_HANDOFF_COUNT * params->threadCount );
+    xerror( bench.handoff == NULL, "Out of memory for the hand off blocks\n" );
+    
+    mem_stats_t statsBefore;
+    Mem_GetStats( &statsBefore );
+    
+    printf( "Alloc and free of random 16 to %u byte blocks, %u live per thread, %u per thread\n", MEMBENCH_MAX_SIZE, MEMBENCH_LIVE_COUNT, bench.count );
+    printf( "M ops/s over all threads, one op is a free and an alloc\n\n" );
+    printf( "threads  %14s %14s %14s\n", MEMBENCH_ALLOC_NAMES[ 0 ], MEMBENCH_ALLOC_NAMES[ 1 ], MEMBENCH_ALLOC_NAMES[ 2 ] );
+    
+    for ( uint32_t threadCount = 1; threadCount <= params->threadCount; threadCount = XeBench_NextThreadCount( threadCount, params->threadCount ) ) {
+        printf( "%7u ", threadCount );
+        
+        for ( uint32_t a = 0; a < MEMBENCH_ALLOC_COUNT; ++a ) {
+            bench.alloc = ( membench_alloc_t ) a;
+            uint64_t ns = XeBench_RunThreads( threadCount, MemBench_Churn, &bench );
+            printf( " %14.1f", ( (double) bench.count * threadCount ) / ( (double) ns / 1e3 ) );
+        }
+        printf( "\n" );
+    }
+    
+    printf( "\nEach thread allocates %u blocks and the next thread along frees them, M ops/s of the frees\n\n", MEMBENCH_HANDOFF_COUNT );
+    printf( "threads  %14s %14s\n", MEMBENCH_ALLOC_NAMES[ 0 ], MEMBENCH_ALLOC_NAMES[ 1 ] );
+    bench.threadCount = params->threadCount;
+    
+    for ( uint32_t a = 0; a < MEMBENCH_ALLOC_LOCKED_MALLOC; ++a ) {
+        bench.alloc = ( membench_alloc_t ) a;
+        XeBench_RunThreads( bench.threadCount, MemBench_HandoffAlloc, &bench );
+        uint64_t ns = XeBench_RunThreads( bench.threadCount, MemBench_HandoffFree, &bench );
+        
+        if ( a == 0 ) {
+            printf( "%7u ", bench.threadCount );
+        }
+        printf( " %14.1f", ( (double) MEMBENCH_HANDOFF_COUNT * bench.threadCount ) / ( (double) ns / 1e3 ) );
+    }
+    printf( "\n\n" );
+    
+    mem_stats_t statsAfter;
+    Mem_GetStats( &statsAfter );
+    
+    uint64_t allocs = statsAfter.numAllocs - statsBefore.numAllocs;
+    uint64_t frees = statsAfter.numFrees - statsBefore.numFrees;
+    uint32_t badCount = atomic_load( &bench.badCount );
+    
+    printf( "Mem_Alloc %llu allocs, %llu frees, %llu bytes still allocated, %u damaged blocks\n", (unsigned long long) allocs, (unsigned long long) frees,
+            (unsigned long long) statsAfter.sizeAlloc, badCount );
+    
+    free( bench.handoff );
+    Sys_MutexDestroy( &bench.mutex );
+    
+    return ( badCount == 0 && allocs == frees && statsAfter.sizeAlloc == statsBefore.sizeAlloc ) ? true : false;
+}
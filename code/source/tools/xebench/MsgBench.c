@@ -0,0 +1,293 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Atomic.h"
+#include "mem/Mem.h"
+#include "ecs/Ecs.h"
+#include "ecs/EcsMessage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MSGBENCH_STRESS_COUNT       ( 16 * 1024 )
+#define MSGBENCH_THROUGHPUT_COUNT   ( 64 * 1024 )
+#define MSGBENCH_BIG_EVERY          97                  /* Every so often a writer sends a message too big for a pool block */
+#define MSGBENCH_BIG_PAYLOAD        600
+
+typedef enum msgbench_msg_id_e {
+    MSGBENCH_MSG_SMALL = 1,
+    MSGBENCH_MSG_BIG,
+} msgbench_msg_id_t;
+
+typedef struct msgbench_msg_s {
+    ecs_msg_t       header;
+    uint32_t        thread;
+    uint32_t        seq;
+} msgbench_msg_t;
+
+typedef struct msgbench_big_msg_s {
+    ecs_msg_t       header;
+    uint32_t        thread;
+    uint32_t        seq;
+    uint8_t         payload[ MSGBENCH_BIG_PAYLOAD ];
+} msgbench_big_msg_t;
+
+/* The component of the entities the messages are sent to, it's only there to say which entity the messages are for */
+typedef struct msgbench_target_s {
+    uint32_t        slot;
+} msgbench_target_t;
+
+typedef struct msgbench_s {
+    uint32_t        count;
+    uint32_t        writerCount;
+    bool_t          spread;                             /* Each writer sends to its own entity rather than all to the first */
+    ecs_entity_t    entities[ XEBENCH_MAX_THREADS ];
+    ecs_system_id_t system;
+    atomic_uint     writersDone;
+    
+    /* Only touched by the thread reading the messages */
+    int64_t         lastSeq[ XEBENCH_MAX_THREADS ][ XEBENCH_MAX_THREADS ];  /* Last message seen for each entity from each writer */
+    uint64_t        readCount;                          /* Messages seen by the current read */
+    uint32_t        badCount;
+} msgbench_t;
+
+static void MsgBench_Message( ecs_msg_t * msg, void * componentPtr );
+static void MsgBench_Think( ecs_entity_t ent, void * component, ecs_think_params_t * params );
+
+ECS_COMPONENT_DEFINE( msgbench_target_t );
+
+static ecs_system_t sys_msgbench = {
+    "Message Bench", NULL, NULL, MsgBench_Think, MsgBench_Message, NULL
+};
+
+/* The system's message function has no user pointer, so there is only ever one bench */
+static msgbench_t msgBench;
+
+/*=======================================================================================================================================*/
+static void MsgBench_Message( ecs_msg_t * msg, void * componentPtr ) {
+    const msgbench_target_t * target = ( const msgbench_target_t * ) componentPtr;
+    const msgbench_msg_t * small = ( const msgbench_msg_t * ) msg;
+    uint32_t bad = 0;
+    
+    if ( small->thread >= msgBench.writerCount ) {
+        ++msgBench.badCount;
+        return;
+    }
+    
+    /* Each writer's messages must come out in the order it sent them, with none missing */
+    int64_t * lastSeq = &msgBench.lastSeq[ target->slot ][ small->thread ];
+    bad += ( (int64_t) small->seq == *lastSeq + 1 ) ? 0 : 1;
+    *lastSeq = small->seq;
+    
+    if ( msg->msg == MSGBENCH_MSG_BIG ) {
+        const msgbench_big_msg_t * big = ( const msgbench_big_msg_t * ) msg;
+        bad += ( msg->size == sizeof( msgbench_big_msg_t ) ) ? 0 : 1;
+        for ( uint32_t n = 0; n < MSGBENCH_BIG_PAYLOAD; ++n ) {
+            bad += ( big->payload[ n ] == (uint8_t) ( big->seq + n ) ) ? 0 : 1;
+        }
+    }
+    else {
+        bad += ( msg->msg == MSGBENCH_MSG_SMALL && msg->size == sizeof( msgbench_msg_t ) ) ? 0 : 1;
+    }
+    
+    msgBench.badCount += bad;
+    ++msgBench.readCount;
+}
+
+/*=======================================================================================================================================*/
+static void MsgBench_Think( ecs_entity_t ent, void * component, ecs_think_params_t * params ) {
+}
+
+/*=======================================================================================================================================*/
+static uint64_t MsgBench_Read( void ) {
+    /* Messages stay in the queues until the end of the frame, so every read starts again from the first one */
+    for ( uint32_t e = 0; e < XEBENCH_MAX_THREADS; ++e ) {
+        for ( uint32_t t = 0; t < XEBENCH_MAX_THREADS; ++t ) {
+            msgBench.lastSeq[ e ][ t ] = -1;
+        }
+    }
+    msgBench.readCount = 0;
+    
+    ecs_think_params_t params;
+    memset( &params, 0, sizeof( params ) );
+    Ecs_SystemThink( msgBench.system, &params );
+    
+    return msgBench.readCount;
+}
+
+/*=======================================================================================================================================*/
+static void MsgBench_Send( uint32_t writer, bool_t withBig ) {
+    ecs_entity_t ent = msgBench.entities[ ( msgBench.spread == true ) ? writer : 0 ];
+    
+    for ( uint32_t n = 0; n < msgBench.count; ++n ) {
+        if ( withBig == true && ( n % MSGBENCH_BIG_EVERY ) == 0 ) {
+            msgbench_big_msg_t big;
+            big.thread = writer;
+            big.seq = n;
+            for ( uint32_t p = 0; p < MSGBENCH_BIG_PAYLOAD; ++p ) {
+                big.payload[ p ] = (uint8_t) ( n + p );
+            }
+            Ecs_SendMessage( ent, MSGBENCH_MSG_BIG, &big, sizeof( big ) );
+        }
+        else {
+            msgbench_msg_t small;
+            small.thread = writer;
+            small.seq = n;
+            Ecs_SendMessage( ent, MSGBENCH_MSG_SMALL, &small, sizeof( small ) );
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static void MsgBench_StressThread( uint32_t threadIndex, void * user ) {
+    if ( threadIndex > 0 ) {
+        MsgBench_Send( threadIndex - 1, true );
+        atomic_fetch_add( &msgBench.writersDone, 1 );
+        return;
+    }
+    
+    /* Thread zero reads while the others write. Nothing is retired while they run, so a read can never see
+       fewer messages than the one before it */
+    uint64_t lastRead = 0;
+    uint32_t readCount = 0;
+    
+    while ( atomic_load( &msgBench.writersDone ) < msgBench.writerCount ) {
+        uint64_t read = MsgBench_Read();
+        msgBench.badCount += ( read >= lastRead ) ? 0 : 1;
+        lastRead = read;
+        ++readCount;
+    }
+    
+    printf( "    %u reads while writing, the last saw %llu messages\n", readCount, (unsigned long long) lastRead );
+}
+
+/*=======================================================================================================================================*/
+static void MsgBench_Begin( uint32_t entityCount, uint32_t count ) {
+    Ecs_Initialise();
+    Ecs_RegisterComponent( msgbench_target_t, XEBENCH_MAX_THREADS );
+    
+    memset( &msgBench, 0, sizeof( msgBench ) );
+    msgBench.count = count;
+    msgBench.system = Ecs_RegisterSystem( &sys_msgbench, msgbench_target_t );
+    
+    for ( uint32_t e = 0; e < entityCount; ++e ) {
+        msgBench.entities[ e ] = Ecs_EntityAlloc();
+        msgbench_target_t * target = Ecs_AddComponent( msgBench.entities[ e ], msgbench_target_t );
+        target->slot = e;
+    }
+}
+
+/*=======================================================================================================================================*/
+static bool_t MsgBench_End( void ) {
+    /* Every message has been seen, so the end of the frame gives all of the blocks back */
+    Ecs_EndFrame();
+    
+    ecs_msg_pool_stats_t poolStats;
+    EcsMessage_GetPoolStats( &poolStats );
+    bool_t empty = ( poolStats.blocksUsed == 0 && poolStats.largeBlocksUsed == 0 ) ? true : false;
+    
+    if ( empty == false ) {
+        printf( "    %u blocks and %u large blocks still used after the end of the frame\n", poolStats.blocksUsed, poolStats.largeBlocksUsed );
+    }
+    
+    Ecs_Finalise();
+    return empty;
+}
+
+/*=======================================================================================================================================*/
+bool_t MsgBench_RunStress( const xebench_params_t * params ) {
+    /* One thread reads, so there is one less writer than there are threads */
+    uint32_t writerCount = ( params->threadCount < XEBENCH_MAX_THREADS ) ? params->threadCount : XEBENCH_MAX_THREADS - 1;
+    uint32_t count = ( params->count > 0 ) ? params->count : MSGBENCH_STRESS_COUNT;
+    bool_t passed = true;
+    
+    printf( "%u writers send %u messages each, every %uth is %u bytes, while another thread reads\n\n", writerCount, count, MSGBENCH_BIG_EVERY,
+            (uint32_t) sizeof( msgbench_big_msg_t ) );
+    
+    for ( uint32_t spread = 0; spread < 2; ++spread ) {
+        printf( "%s\n", ( spread == 0 ) ? "All to one entity" : "An entity each" );
+        
+        MsgBench_Begin( writerCount, count );
+        msgBench.writerCount = writerCount;
+        msgBench.spread = ( spread == 1 ) ? true : false;
+        atomic_store( &msgBench.writersDone, 0 );
+        
+        XeBench_RunThreads( writerCount + 1, MsgBench_StressThread, NULL );
+        
+        /* Now the writers are done the read has to see every message, with the last one from each writer */
+        uint64_t read = MsgBench_Read();
+        uint32_t missing = 0;
+        for ( uint32_t w = 0; w < writerCount; ++w ) {
+            missing += ( msgBench.lastSeq[ ( spread == 1 ) ? w : 0 ][ w ] == (int64_t) count - 1 ) ? 0 : 1;
+        }
+        
+        printf( "    final read saw %llu of %llu messages, %u writers incomplete, %u bad messages\n", (unsigned long long) read,
+                (unsigned long long) count * writerCount, missing, msgBench.badCount );
+        
+        passed = ( read == (uint64_t) count * writerCount && missing == 0 && msgBench.badCount == 0 ) ? passed : false;
+        passed = ( MsgBench_End() == true ) ? passed : false;
+    }
+    
+    return passed;
+}
+
+/*=======================================================================================================================================*/
+static void MsgBench_ThroughputThread( uint32_t threadIndex, void * user ) {
+    MsgBench_Send( threadIndex, false );
+}
+
+/*=======================================================================================================================================*/
+bool_t MsgBench_RunThroughput( const xebench_params_t * params ) {
+    uint32_t count = ( params->count > 0 ) ? params->count : MSGBENCH_THROUGHPUT_COUNT;
+    bool_t passed = true;
+    
+    MsgBench_Begin( params->threadCount, count );
+    
+    printf( "Ecs_SendMessage of %u byte messages, %u per thread\n", (uint32_t) sizeof( msgbench_msg_t ), count );
+    printf( "M msgs/s over all threads\n\n" );
+    printf( "threads  %14s %14s\n", "one entity", "entity each" );
+    
+    for ( uint32_t threadCount = 1; threadCount <= params->threadCount; threadCount = XeBench_NextThreadCount( threadCount, params->threadCount ) ) {
+        double rates[ 2 ];
+        
+        for ( uint32_t spread = 0; spread < 2; ++spread ) {
+            msgBench.writerCount = threadCount;
+            msgBench.spread = ( spread == 1 ) ? true : false;
+            msgBench.badCount = 0;
+            
+            uint64_t ns = XeBench_RunThreads( threadCount, MsgBench_ThroughputThread, NULL );
+            rates[ spread ] = ( (double) count * threadCount ) / ( (double) ns / 1e3 );
+            
+            /* Read them back, outside of the timing, so they can be retired before the next run */
+            uint64_t read = MsgBench_Read();
+            passed = ( read == (uint64_t) count * threadCount && msgBench.badCount == 0 ) ? passed : false;
+            Ecs_EndFrame();
+        }
+        
+        /* The row is printed in one go, so a heap overflow warning from the runs doesn't land in the middle of it */
+        printf( "%7u  %14.1f %14.1f\n", threadCount, rates[ 0 ], rates[ 1 ] );
+    }
+    printf( "\n" );
+    
+    passed = ( MsgBench_End() == true ) ? passed : false;
+    return passed;
+}
@@ -0,0 +1,302 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Fs.h"
+#include "core/Str.h"
+#include "mem/Mem.h"
+#include "render/Render3d.h"
+#include "render/Camera.h"
+#include "render/Model.h"
+#include "render/Material.h"
+#include "render/Texture.h"
+#include "resource/Resource.h"
+#include "null/Render_null.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RENDERBENCH_DEFAULT_COUNT   2048            /* Models submitted each frame */
+#define RENDERBENCH_FRAME_COUNT     240
+#define RENDERBENCH_MODEL_COUNT     64
+#define RENDERBENCH_MESH_COUNT      4
+#define RENDERBENCH_MATERIAL_COUNT  16
+#define RENDERBENCH_GRID_SIZE       8               /* Each mesh is a grid of quads this many across */
+#define RENDERBENCH_TEXTURE_SIZE    8
+
+#define RENDERBENCH_MESH_VERTICES   ( ( RENDERBENCH_GRID_SIZE + 1 ) * ( RENDERBENCH_GRID_SIZE + 1 ) )
+#define RENDERBENCH_MESH_INDICES    ( RENDERBENCH_GRID_SIZE * RENDERBENCH_GRID_SIZE * 6 )
+
+typedef struct renderbench_s {
+    model_t *       models;
+    material_t *    materials;
+    material_t *    modelMaterials[ RENDERBENCH_MODEL_COUNT ][ RENDERBENCH_MESH_COUNT ];
+    resource_t *    textureRes;
+    str_t           texturePath;
+    camera_t        camera;
+} renderbench_t;
+
+static renderbench_t renderBench;
+
+/*=======================================================================================================================================*/
+static bool_t RenderBench_WriteTexture( const char * path ) {
+    /* Uncompressed 32 bit TGA, it goes through the same stb_image path as the game's textures */
+    uint8_t header[ 18 ];
+    uint8_t pixels[ RENDERBENCH_TEXTURE_SIZE * RENDERBENCH_TEXTURE_SIZE * 4 ];
+    file_t file;
+    
+    memset( header, 0, sizeof( header ) );
+    header[ 2 ] = 2;
+    header[ 12 ] = RENDERBENCH_TEXTURE_SIZE;
+    header[ 14 ] = RENDERBENCH_TEXTURE_SIZE;
+    header[ 16 ] = 32;
+    header[ 17 ] = 8;
+    
+    for ( uint32_t p = 0; p < RENDERBENCH_TEXTURE_SIZE * RENDERBENCH_TEXTURE_SIZE; ++p ) {
+        pixels[ p * 4 + 0 ] = (uint8_t) ( p * 4 );
+        pixels[ p * 4 + 1 ] = (uint8_t) ( 255 - p * 4 );
+        pixels[ p * 4 + 2 ] = 128;
+        pixels[ p * 4 + 3 ] = 255;
+    }
+    
+    if ( FS_FileOpen( &file, path, "wb" ) == false ) {
+        return false;
+    }
+    
+    bool_t written = ( FS_FileWrite( &file, header, sizeof( header ), 1 ) == 1 && FS_FileWrite( &file, pixels, sizeof( pixels ), 1 ) == 1 ) ? true : false;
+    FS_FileClose( &file );
+    return written;
+}
+
+/*=======================================================================================================================================*/
+static void RenderBench_CreateModel( model_t * model ) {
+    float vertices[ RENDERBENCH_MESH_VERTICES * RENDERBENCH_MESH_COUNT ][ 8 ];
+    uint32_t indices[ RENDERBENCH_MESH_INDICES * RENDERBENCH_MESH_COUNT ];
+    mesh_t meshes[ RENDERBENCH_MESH_COUNT ];
+    const uint32_t rowSize = RENDERBENCH_GRID_SIZE + 1;
+    
+    /* A grid for each mesh, stacked up in y. The vertex layout is position and u, then normal and v */
+    for ( uint32_t m = 0; m < RENDERBENCH_MESH_COUNT; ++m ) {
+        float (*meshVertices)[ 8 ] = &vertices[ m * RENDERBENCH_MESH_VERTICES ];
+        uint32_t * meshIndices = &indices[ m * RENDERBENCH_MESH_INDICES ];
+        
+        for ( uint32_t v = 0; v < RENDERBENCH_MESH_VERTICES; ++v ) {
+            float u = (float) ( v % rowSize ) / (float) RENDERBENCH_GRID_SIZE;
+            float w = (float) ( v / rowSize ) / (float) RENDERBENCH_GRID_SIZE;
+            float vertex[ 8 ] = { u - 0.5f, (float) m, w - 0.5f, u, 0, 1, 0, w };
+            memcpy( meshVertices[ v ], vertex, sizeof( vertex ) );
+        }
+        
+        uint32_t * index = meshIndices;
+        for ( uint32_t y = 0; y < RENDERBENCH_GRID_SIZE; ++y ) {
+            for ( uint32_t x = 0; x < RENDERBENCH_GRID_SIZE; ++x ) {
+                uint32_t corner = m * RENDERBENCH_MESH_VERTICES + y * rowSize + x;
+                *index++ = corner;
+                *index++ = corner + rowSize;
+                *index++ = corner + 1;
+                *index++ = corner + 1;
+                *index++ = corner + rowSize;
+                *index++ = corner + rowSize + 1;
+            }
+        }
+        
+        meshes[ m ].vertexStart = m * RENDERBENCH_MESH_VERTICES;
+        meshes[ m ].vertexCount = RENDERBENCH_MESH_VERTICES;
+        meshes[ m ].indexStart = m * RENDERBENCH_MESH_INDICES;
+        meshes[ m ].indexCount = RENDERBENCH_MESH_INDICES;
+        meshes[ m ].material = m;
+        meshes[ m ].pad = 0;
+    }
+    
+    vec3_t boundsMin = { -0.5f, 0, -0.5f };
+    vec3_t boundsMax = { 0.5f, (float) RENDERBENCH_MESH_COUNT, 0.5f };
+    
+    Model_Create( model, RENDERBENCH_MESH_VERTICES * RENDERBENCH_MESH_COUNT, RENDERBENCH_MESH_INDICES * RENDERBENCH_MESH_COUNT, RENDERBENCH_MESH_COUNT, 0 );
+    Model_WriteVertexData( model, vertices, 0, RENDERBENCH_MESH_VERTICES * RENDERBENCH_MESH_COUNT );
+    Model_WriteIndexData( model, indices, 0, RENDERBENCH_MESH_INDICES * RENDERBENCH_MESH_COUNT );
+    Model_WriteMeshData( model, meshes, 0, RENDERBENCH_MESH_COUNT );
+    Model_SetBounds( model, &boundsMin, &boundsMax );
+}
+
+/*=======================================================================================================================================*/
+static bool_t RenderBench_Setup( void ) {
+    renderbench_t * bench = &renderBench;
+    render_params_t renderParams;
+    
+    memset( &renderParams, 0, sizeof( renderParams ) );
+    Render_Initialise( &renderParams );
+    Resource_Initialise();
+    Material_Initialise();
+    Resource_RegisterFactory( texture_resource_factory, "tga" );
+    
+    /* The texture is loaded through the resource system, so the null texture is written by the same loader as the game's */
+    XeBench_GetTempPath( &bench->texturePath, "xebench_render.tga" );
+    if ( RenderBench_WriteTexture( bench->texturePath ) == false ) {
+        printf( "Unable to write '%s'\n", bench->texturePath );
+        return false;
+    }
+    
+    bench->textureRes = Resource_Load( bench->texturePath );
+    texture_t * texture = (texture_t *) Resource_GetData( bench->textureRes );
+    if ( Resource_GetState( bench->textureRes ) != RESOURCE_STATE_LOADED || Texture_GetWidth( texture ) != RENDERBENCH_TEXTURE_SIZE ) {
+        printf( "Texture '%s' didn't load\n", bench->texturePath );
+        return false;
+    }
+    
+    /* Every material holds a reference to the texture, the bench's own is given back when they have all been set */
+    bench->materials = (material_t *) Mem_Alloc( sizeof( material_t ) * RENDERBENCH_MATERIAL_COUNT );
+    for ( uint32_t m = 0; m < RENDERBENCH_MATERIAL_COUNT; ++m ) {
+        Material_Create( &bench->materials[ m ] );
+        Material_SetTextureAlbedo( &bench->materials[ m ], Resource_Load( bench->texturePath ) );
+    }
+    
+    Resource_Release( bench->textureRes );
+    
+    bench->models = (model_t *) Mem_Alloc( sizeof( model_t ) * RENDERBENCH_MODEL_COUNT );
+    for ( uint32_t n = 0; n < RENDERBENCH_MODEL_COUNT; ++n ) {
+        RenderBench_CreateModel( &bench->models[ n ] );
+        
+        for ( uint32_t m = 0; m < RENDERBENCH_MESH_COUNT; ++m ) {
+            bench->modelMaterials[ n ][ m ] = &bench->materials[ ( n + m ) % RENDERBENCH_MATERIAL_COUNT ];
+        }
+    }
+    
+    vec3_t eye = { 0, 10, -20 };
+    vec3_t target = { 0, 0, 0 };
+    vec3_t up = { 0, 1, 0 };
+    Camera_Initialise( &bench->camera );
+    Camera_SetLookAt( &bench->camera, &eye, &target, &up );
+    Camera_SetShape( &bench->camera, 80.0f, 16.0f / 9.0f, 1, 1000 );
+    Camera_UpdateMatrices( &bench->camera );
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static void RenderBench_Teardown( void ) {
+    renderbench_t * bench = &renderBench;
+    
+    if ( bench->models != NULL ) {
+        for ( uint32_t n = 0; n < RENDERBENCH_MODEL_COUNT; ++n ) {
+            Model_Destroy( &bench->models[ n ] );
+        }
+        Mem_Free( bench->models );
+    }
+    
+    /* Destroying the materials gives back the last references to the texture */
+    if ( bench->materials != NULL ) {
+        for ( uint32_t m = 0; m < RENDERBENCH_MATERIAL_COUNT; ++m ) {
+            Material_Destroy( &bench->materials[ m ] );
+        }
+        Mem_Free( bench->materials );
+    }
+    
+    Resource_Finalise();
+    Material_Finalise();
+    Render_Finalise();
+    
+    if ( bench->texturePath != NULL ) {
+        remove( bench->texturePath );
+        Str_Destroy( &bench->texturePath );
+    }
+    
+    memset( bench, 0, sizeof( *bench ) );
+}
+
+/*=======================================================================================================================================*/
+bool_t RenderBench_Run( const xebench_params_t * params ) {
+    renderbench_t * bench = &renderBench;
+    uint32_t count = ( params->count > 0 ) ? params->count : RENDERBENCH_DEFAULT_COUNT;
+    bool_t passed = true;
+    
+    memset( bench, 0, sizeof( *bench ) );
+    
+    if ( RenderBench_Setup() == false ) {
+        RenderBench_Teardown();
+        return false;
+    }
+    
+    /* The draws of a frame have to fit in its batch heap, with room left for the scene and the material commands */
+    size_t drawSize = sizeof( render_cmd_draw_t ) * RENDERBENCH_MESH_COUNT;
+    size_t maxCount = ( render3d->batchMemSize / 2 ) / drawSize;
+    if ( count > maxCount ) {
+        printf( "%u models a frame won't fit in the batch heap, using %u\n", count, (uint32_t) maxCount );
+        count = (uint32_t) maxCount;
+    }
+    
+    int32_t viewport[] = { 0, 0, 1280, 720 };
+    uint64_t scenesBefore = render3dNull->scenesSubmitted;
+    uint64_t indicesBefore = render3dNull->indicesSubmitted;
+    
+    /* Headless frames through the null backend, the cost is the batching in Render_SubmitModel and the walk of
+       the batches that stands in for the GPU submit */
+    uint64_t startNs = Sys_GetTicksNs();
+    
+    for ( uint32_t f = 0; f < RENDERBENCH_FRAME_COUNT; ++f ) {
+        Render_Begin( &bench->camera, viewport );
+        
+        for ( uint32_t n = 0; n < count; ++n ) {
+            uint32_t modelIndex = n % RENDERBENCH_MODEL_COUNT;
+            mat4_t xform;
+            
+            Mat4_SetIdentity( xform );
+            Vec4_Set( xform.rows[ 3 ], (float) ( n % 64 ) * 2.0f, 0, (float) ( n / 64 ) * 2.0f, 1 );
+            Render_SubmitModel( &bench->models[ modelIndex ], bench->modelMaterials[ modelIndex ], &xform );
+        }
+        
+        Render_End();
+    }
+    
+    uint64_t timeNs = Sys_GetTicksNs() - startNs;
+    
+    /* Check that every draw made it through the batching to the backend */
+    render_stats_t stats;
+    Render_GetFrameStats( &stats );
+    
+    uint64_t drawsPerFrame = (uint64_t) count * RENDERBENCH_MESH_COUNT;
+    uint64_t scenes = render3dNull->scenesSubmitted - scenesBefore;
+    uint64_t indices = render3dNull->indicesSubmitted - indicesBefore;
+    uint64_t expectedIndices = drawsPerFrame * RENDERBENCH_MESH_INDICES * RENDERBENCH_FRAME_COUNT;
+    uint64_t expectedMaterials = ( count < RENDERBENCH_MATERIAL_COUNT ) ? count + RENDERBENCH_MESH_COUNT - 1 : RENDERBENCH_MATERIAL_COUNT;
+    expectedMaterials = ( expectedMaterials > RENDERBENCH_MATERIAL_COUNT ) ? RENDERBENCH_MATERIAL_COUNT : expectedMaterials;
+    
+    if ( scenes != RENDERBENCH_FRAME_COUNT || indices != expectedIndices ) {
+        printf( "Backend saw %llu scenes and %llu indices, expected %u and %llu\n", (unsigned long long) scenes, (unsigned long long) indices,
+               RENDERBENCH_FRAME_COUNT, (unsigned long long) expectedIndices );
+        passed = false;
+    }
+    
+    if ( stats.drawCalls != drawsPerFrame || stats.materials != expectedMaterials || stats.triangles != drawsPerFrame * ( RENDERBENCH_MESH_INDICES / 3 ) ) {
+        printf( "Frame stats have %llu draws, %llu materials and %llu triangles, expected %llu, %llu and %llu\n",
+               (unsigned long long) stats.drawCalls, (unsigned long long) stats.materials, (unsigned long long) stats.triangles,
+               (unsigned long long) drawsPerFrame, (unsigned long long) expectedMaterials, (unsigned long long) ( drawsPerFrame * ( RENDERBENCH_MESH_INDICES / 3 ) ) );
+        passed = false;
+    }
+    
+    double frameUs = (double) timeNs / 1000.0 / (double) RENDERBENCH_FRAME_COUNT;
+    double drawNs = (double) timeNs / (double) ( drawsPerFrame * RENDERBENCH_FRAME_COUNT );
+    
+    printf( "%-10s %10s %10s %12s %12s\n", "renderer", "frames", "draws", "us/frame", "ns/draw" );
+    printf( "%-10s %10u %10llu %12.1f %12.1f\n", "null", RENDERBENCH_FRAME_COUNT, (unsigned long long) drawsPerFrame, frameUs, drawNs );
+    
+    RenderBench_Teardown();
+    
+    return passed;
+}
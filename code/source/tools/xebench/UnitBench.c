@@ -0,0 +1,201 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Atomic.h"
+#include "mem/Mem.h"
+#include "mem/UnitHeap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNITBENCH_DEFAULT_COUNT ( 1024 * 1024 )
+#define UNITBENCH_LIVE_COUNT    256                 /* Units each thread keeps alive, a random one is replaced each step */
+#define UNITBENCH_UNIT_SIZE     64                  /* About the size of a job, a render command or a resource header */
+
+typedef enum unitbench_alloc_e {
+    UNITBENCH_ALLOC_UNIT_HEAP = 0,
+    UNITBENCH_ALLOC_UNIT_HEAP_SAFE,
+    UNITBENCH_ALLOC_MEM,
+    UNITBENCH_ALLOC_COUNT
+} unitbench_alloc_t;
+
+static const char * UNITBENCH_ALLOC_NAMES[ UNITBENCH_ALLOC_COUNT ] = { "UnitHeap", "UnitHeap safe", "Mem_Alloc" };
+
+typedef struct unitbench_s {
+    unitbench_alloc_t   alloc;
+    uint32_t            count;
+    unit_heap_t *       heap;
+    atomic_uint         badCount;
+} unitbench_t;
+
+/*=======================================================================================================================================*/
+static X_INLINE uint32_t UnitBench_Random( uint32_t * state ) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void * UnitBench_Alloc( unitbench_t * bench ) {
+    return ( bench->alloc == UNITBENCH_ALLOC_MEM ) ? Mem_Alloc( UNITBENCH_UNIT_SIZE ) : UnitHeap_Alloc( bench->heap );
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void UnitBench_Free( unitbench_t * bench, void * unit ) {
+    if ( bench->alloc == UNITBENCH_ALLOC_MEM ) {
+        Mem_Free( unit );
+    }
+    else {
+        UnitHeap_Free( bench->heap, unit );
+    }
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE bool_t UnitBench_Check( const void * unit, uint32_t tag ) {
+    /* The tag is written at both ends of the unit, a unit handed out twice gets a different tag in one of them */
+    const uint32_t * words = ( const uint32_t * ) unit;
+    return ( words[ 0 ] == tag && words[ UNITBENCH_UNIT_SIZE / sizeof( uint32_t ) - 1 ] == tag ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static void UnitBench_Churn( uint32_t threadIndex, void * user ) {
+    unitbench_t * bench = ( unitbench_t * ) user;
+    uint32_t * live[ UNITBENCH_LIVE_COUNT ];
+    uint32_t tags[ UNITBENCH_LIVE_COUNT ];
+    uint32_t rng = 0x9E3779B9u ^ ( threadIndex * 0x85EBCA6Bu + 1 );
+    uint32_t bad = 0;
+    
+    memset( live, 0, sizeof( live ) );
+    
+    for ( uint32_t n = 0; n < bench->count; ++n ) {
+        uint32_t slot = UnitBench_Random( &rng ) % UNITBENCH_LIVE_COUNT;
+        if ( live[ slot ] != NULL ) {
+            bad += ( UnitBench_Check( live[ slot ], tags[ slot ] ) == true ) ? 0 : 1;
+            UnitBench_Free( bench, live[ slot ] );
+        }
+        
+        live[ slot ] = ( uint32_t * ) UnitBench_Alloc( bench );
+        if ( live[ slot ] == NULL ) {
+            ++bad;
+            continue;
+        }
+        
+        tags[ slot ] = ( threadIndex << 24 ) ^ n;
+        live[ slot ][ 0 ] = tags[ slot ];
+        live[ slot ][ UNITBENCH_UNIT_SIZE / sizeof( uint32_t ) - 1 ] = tags[ slot ];
+    }
+    
+    for ( uint32_t n = 0; n < UNITBENCH_LIVE_COUNT; ++n ) {
+        if ( live[ n ] != NULL ) {
+            bad += ( UnitBench_Check( live[ n ], tags[ n ] ) == true ) ? 0 : 1;
+            UnitBench_Free( bench, live[ n ] );
+        }
+    }
+    
+    atomic_fetch_add( &bench->badCount, bad );
+}
+
+/*=======================================================================================================================================*/
+static bool_t UnitBench_CheckHeap( unitbench_t * bench ) {
+    unit_heap_stats_t stats;
+    UnitHeap_GetStats( bench->heap, &stats );
+    
+    /* Everything handed out came back and the heap never ran dry */
+    if ( stats.usedCount != 0 || stats.numAllocs != stats.numFrees || stats.numFailed != 0 ) {
+        printf( "%s has %u units in use after %llu allocs, %llu frees and %llu failures\n", UNITBENCH_ALLOC_NAMES[ bench->alloc ], stats.usedCount,
+               (unsigned long long) stats.numAllocs, (unsigned long long) stats.numFrees, (unsigned long long) stats.numFailed );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+bool_t UnitBench_Run( const xebench_params_t * params ) {
+    unitbench_t bench;
+    bool_t passed = true;
+    
+    memset( &bench, 0, sizeof( bench ) );
+    bench.count = ( params->count > 0 ) ? params->count : UNITBENCH_DEFAULT_COUNT;
+    
+    /* One heap big enough for the live units of every thread, shared by all of them like the job pool is */
+    uint32_t unitCount = UNITBENCH_LIVE_COUNT * params->threadCount;
+    size_t memSize = UnitHeap_CalcMemSize( UNITBENCH_UNIT_SIZE, unitCount );
+    void * memory = Mem_AllocAligned( memSize, 64 );
+    
+    mem_stats_t statsBefore;
+    Mem_GetStats( &statsBefore );
+    
+    printf( "Free and alloc of %u byte units, %u live per thread, %u per thread\n", UNITBENCH_UNIT_SIZE, UNITBENCH_LIVE_COUNT, bench.count );
+    printf( "M ops/s over all threads, one op is a free and an alloc. The plain UnitHeap is only run on one thread\n\n" );
+    printf( "threads " );
+    for ( uint32_t a = 0; a < UNITBENCH_ALLOC_COUNT; ++a ) {
+        printf( " %14s", UNITBENCH_ALLOC_NAMES[ a ] );
+    }
+    printf( "\n" );
+    
+    for ( uint32_t threadCount = 1; threadCount <= params->threadCount; threadCount = XeBench_NextThreadCount( threadCount, params->threadCount ) ) {
+        printf( "%7u ", threadCount );
+        
+        for ( uint32_t a = 0; a < UNITBENCH_ALLOC_COUNT; ++a ) {
+            if ( a == UNITBENCH_ALLOC_UNIT_HEAP && threadCount > 1 ) {
+                printf( " %14s", "-" );
+                continue;
+            }
+            
+            bench.alloc = ( unitbench_alloc_t ) a;
+            if ( a != UNITBENCH_ALLOC_MEM ) {
+                uint32_t flags = ( a == UNITBENCH_ALLOC_UNIT_HEAP_SAFE ) ? UNIT_HEAP_FLAG_THREAD_SAFE : UNIT_HEAP_FLAG_NONE;
+                bench.heap = UnitHeap_Create( (uintptr_t) memory, memSize, UNITBENCH_UNIT_SIZE, flags );
+            }
+            
+            uint64_t ns = XeBench_RunThreads( threadCount, UnitBench_Churn, &bench );
+            printf( " %14.1f", ( (double) bench.count * threadCount ) / ( (double) ns / 1e3 ) );
+            
+            if ( bench.heap != NULL ) {
+                passed = ( UnitBench_CheckHeap( &bench ) == true ) ? passed : false;
+                UnitHeap_Destroy( bench.heap );
+                bench.heap = NULL;
+            }
+        }
+        printf( "\n" );
+    }
+    printf( "\n" );
+    
+    mem_stats_t statsAfter;
+    Mem_GetStats( &statsAfter );
+    Mem_Free( memory );
+    
+    uint32_t badCount = atomic_load( &bench.badCount );
+    uint64_t allocs = statsAfter.numAllocs - statsBefore.numAllocs;
+    uint64_t frees = statsAfter.numFrees - statsBefore.numFrees;
+    
+    if ( badCount > 0 || allocs != frees ) {
+        printf( "%u damaged or missing units, Mem_Alloc %llu allocs and %llu frees\n", badCount, (unsigned long long) allocs, (unsigned long long) frees );
+        passed = false;
+    }
+    
+    return passed;
+}
@@ -0,0 +1,238 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "XeBench.h"
+#include "core/Sys.h"
+#include "core/Job.h"
+#include "core/Atomic.h"
+#include "core/Fs.h"
+#include "mem/Mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __APPLE__ )
+#include <mach/mach.h>
+#endif
+
+typedef struct xebench_test_s {
+    const char *    name;
+    bool_t          (*run)( const xebench_params_t * params );
+    const char *    desc;
+} xebench_test_t;
+
+static const xebench_test_t XEBENCH_TESTS[] = {
+    { "mem",        MemBench_Run,               "Mem_Alloc and Mem_Free throughput against malloc, from 1 up to [threads] threads" },
+    { "unitheap",   UnitBench_Run,              "UnitHeap against Mem_Alloc for fixed size units, from 1 up to [threads] threads sharing one heap" },
+    { "ecscmd",     EcsBench_RunCommands,       "Commands recorded by the jobs of a system play back in record order for each entity" },
+    { "ecslayout",  EcsBench_RunLayout,         "[count] entities moved through per-type component arrays and through archetype chunks" },
+    { "ecslookup",  EcsBench_RunLookup,         "Component get, has and remove and add by id against get by name, over [count] entities" },
+    { "ecsbatch",   EcsBench_RunBatch,          "Transforms of [count] entities, 10k by default, built with a think per entity and with a batch think" },
+    { "msgstress",  MsgBench_RunStress,         "[threads] threads send messages to shared entities while they are read, checking order and contents" },
+    { "msgbench",   MsgBench_RunThroughput,     "Ecs_SendMessage throughput from 1 up to [threads] threads, to one shared entity and to an entity each" },
+    { "render",     RenderBench_Run,            "Headless frames of [count] models through the null renderer, with a texture loaded as a resource" },
+    { "hashmap",    HashBench_Run,              "HashMap against the sorted arrays it replaced, insert and lookup at 10k, 50k and 100k entries or [count]" },
+    { "jobs",       JobBench_Run,               "Parallel for over [count] items, nested waits, dependencies, jobs from [threads] other threads and scaling up to [threads] workers" },
+    { "load",       LoadBench_Run,              "[count] models, 16 by default, loaded from mapped files and through a read into a heap copy, time and resident memory" },
+};
+
+#define XEBENCH_TEST_COUNT ( sizeof( XEBENCH_TESTS ) / sizeof( XEBENCH_TESTS[ 0 ] ) )
+
+typedef struct xebench_thread_s {
+    sys_thread_t        thread;
+    uint32_t            threadIndex;
+    uint64_t            endNs;
+} xebench_thread_t;
+
+typedef struct xebench_run_s {
+    void                (*func)( uint32_t threadIndex, void * user );
+    void *              user;
+    uint32_t            threadCount;
+    atomic_uint         readyCount;
+    atomic_uint         go;
+    xebench_thread_t    threads[ XEBENCH_MAX_THREADS ];
+} xebench_run_t;
+
+static xebench_run_t xebenchRun;
+
+/*=======================================================================================================================================*/
+static void XeBench_ThreadMain( void * arg ) {
+    xebench_thread_t * thread = ( xebench_thread_t * ) arg;
+    
+    atomic_fetch_add( &xebenchRun.readyCount, 1 );
+    while ( atomic_load_explicit( &xebenchRun.go, memory_order_acquire ) == 0 ) {
+        Sys_ThreadYield();
+    }
+    
+    xebenchRun.func( thread->threadIndex, xebenchRun.user );
+    thread->endNs = Sys_GetTicksNs();
+    
+    /* The memory system keeps a cache per thread, hand it back before the thread goes */
+    Mem_ThreadFinalise();
+}
+
+/*=======================================================================================================================================*/
+uint64_t XeBench_RunThreads( uint32_t threadCount, void (*func)( uint32_t threadIndex, void * user ), void * user ) {
+    xerror( threadCount == 0 || threadCount > XEBENCH_MAX_THREADS, "Thread count must be 1 to %u\n", XEBENCH_MAX_THREADS );
+    
+    xebenchRun.func = func;
+    xebenchRun.user = user;
+    xebenchRun.threadCount = threadCount;
+    atomic_store( &xebenchRun.readyCount, 0 );
+    atomic_store( &xebenchRun.go, 0 );
+    
+    for ( uint32_t t = 0; t < threadCount; ++t ) {
+        xebench_thread_t * thread = &xebenchRun.threads[ t ];
+        thread->threadIndex = t;
+        thread->endNs = 0;
+        bool_t created = Sys_ThreadCreate( &thread->thread, XeBench_ThreadMain, thread );
+        xerror( created == false, "Unable to create thread %u\n", t );
+    }
+    
+    /* Hold everyone until all of the threads are up, so thread start up isn't timed */
+    while ( atomic_load( &xebenchRun.readyCount ) < threadCount ) {
+        Sys_ThreadYield();
+    }
+    
+    uint64_t startNs = Sys_GetTicksNs();
+    atomic_store_explicit( &xebenchRun.go, 1, memory_order_release );
+    
+    uint64_t endNs = startNs;
+    for ( uint32_t t = 0; t < threadCount; ++t ) {
+        Sys_ThreadJoin( &xebenchRun.threads[ t ].thread );
+        endNs = ( xebenchRun.threads[ t ].endNs > endNs ) ? xebenchRun.threads[ t ].endNs : endNs;
+    }
+    
+    return endNs - startNs;
+}
+
+/*=======================================================================================================================================*/
+uint32_t XeBench_NextThreadCount( uint32_t threadCount, uint32_t maxThreads ) {
+    return ( threadCount < maxThreads && threadCount * 2 > maxThreads ) ? maxThreads : threadCount * 2;
+}
+
+/*=======================================================================================================================================*/
+void XeBench_GetTempPath( str_t * pathOut, const char * name ) {
+    const char * tempDir = getenv( "TMPDIR" );
+    
+    Str_CopyCStr( pathOut, ( tempDir != NULL && tempDir[ 0 ] != 0 ) ? tempDir : "/tmp" );
+    Str_AppendPathCStr( pathOut, name );
+}
+
+/*=======================================================================================================================================*/
+void XeBench_GetResident( size_t * residentOut, size_t * privateOut ) {
+    *residentOut = 0;
+    *privateOut = 0;
+    
+#if defined( __APPLE__ )
+    /* The footprint is the memory the process is charged for, clean file pages aren't part of it */
+    task_vm_info_data_t info;
+    mach_msg_type_number_t infoCount = TASK_VM_INFO_COUNT;
+    
+    if ( task_info( mach_task_self(), TASK_VM_INFO, (task_info_t) &info, &infoCount ) == KERN_SUCCESS ) {
+        *residentOut = (size_t) info.resident_size;
+        *privateOut = (size_t) info.phys_footprint;
+    }
+#else
+    char line[ 256 ];
+    unsigned long kb = 0;
+    FILE * status = fopen( "/proc/self/status", "r" );
+    
+    if ( status == NULL ) {
+        return;
+    }
+    
+    while ( fgets( line, sizeof( line ), status ) != NULL ) {
+        if ( sscanf( line, "VmRSS: %lu", &kb ) == 1 ) {
+            *residentOut = (size_t) kb * 1024;
+        }
+        else if ( sscanf( line, "RssAnon: %lu", &kb ) == 1 ) {
+            *privateOut = (size_t) kb * 1024;
+        }
+    }
+    
+    fclose( status );
+#endif
+}
+
+/*=======================================================================================================================================*/
+static void XeBench_PrintHelp( void ) {
+    printf( "xebench <test> [threads] [count]\n" );
+    printf( "    test      all, or one of the tests below\n" );
+    printf( "    threads   most threads to use, defaults to the number of CPUs\n" );
+    printf( "    count     operations per thread, defaults to a count that suits each test\n\n" );
+    
+    for ( size_t n = 0; n < XEBENCH_TEST_COUNT; ++n ) {
+        printf( "    %-10s %s\n", XEBENCH_TESTS[ n ].name, XEBENCH_TESTS[ n ].desc );
+    }
+}
+
+/*=======================================================================================================================================*/
+int main( int argc, char ** argv ) {
+    if ( argc < 2 ) {
+        XeBench_PrintHelp();
+        return 1;
+    }
+    
+    Mem_Initialise( NULL );
+    Mem_CreateHeaps();
+    Sys_Initialise();
+    Job_Initialise( 0 );
+    FS_Initialise();
+    
+    xebench_params_t params;
+    params.threadCount = ( argc > 2 ) ? (uint32_t) atoi( argv[ 2 ] ) : Sys_GetCpuCount();
+    params.count = ( argc > 3 ) ? (uint32_t) atoi( argv[ 3 ] ) : 0;
+    
+    if ( params.threadCount == 0 ) {
+        params.threadCount = 1;
+    }
+    if ( params.threadCount > XEBENCH_MAX_THREADS ) {
+        params.threadCount = XEBENCH_MAX_THREADS;
+    }
+    
+    bool_t runAll = ( strcmp( argv[ 1 ], "all" ) == 0 ) ? true : false;
+    uint32_t runCount = 0;
+    uint32_t failCount = 0;
+    
+    for ( size_t n = 0; n < XEBENCH_TEST_COUNT; ++n ) {
+        if ( runAll == false && strcmp( argv[ 1 ], XEBENCH_TESTS[ n ].name ) != 0 ) {
+            continue;
+        }
+        
+        printf( "=== %s ===\n", XEBENCH_TESTS[ n ].name );
+        bool_t passed = XEBENCH_TESTS[ n ].run( &params );
+        printf( "=== %s %s ===\n\n", XEBENCH_TESTS[ n ].name, ( passed == true ) ? "passed" : "FAILED" );
+        
+        ++runCount;
+        failCount += ( passed == true ) ? 0 : 1;
+    }
+    
+    if ( runCount == 0 ) {
+        XeBench_PrintHelp();
+    }
+    
+    FS_Finalise();
+    Job_Finalise();
+    Sys_Finalise();
+    Mem_Finalise();
+    
+    return ( runCount == 0 || failCount > 0 ) ? 1 : 0;
+}
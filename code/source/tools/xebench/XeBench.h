@@ -0,0 +1,67 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __XEBENCH_H__
+#define __XEBENCH_H__
+
+#include "core/Platform.h"
+#include "core/Str.h"
+
+/*
+    xebench runs the stress tests and benchmarks for the engine systems that are shared between threads. Each
+    test returns false when it finds something wrong, the benchmarks print their numbers and only fail if the
+    results they check don't add up.
+*/
+
+#define XEBENCH_MAX_THREADS 64
+
+typedef struct xebench_params_s {
+    uint32_t        threadCount;        /* Most threads to run, the benchmarks step up to this in powers of two */
+    uint32_t        count;              /* Operations per thread, zero for the default of each test */
+} xebench_params_t;
+
+bool_t MemBench_Run( const xebench_params_t * params );
+bool_t EcsBench_RunCommands( const xebench_params_t * params );
+bool_t EcsBench_RunLayout( const xebench_params_t * params );
+bool_t EcsBench_RunLookup( const xebench_params_t * params );
+bool_t EcsBench_RunBatch( const xebench_params_t * params );
+bool_t MsgBench_RunStress( const xebench_params_t * params );
+bool_t MsgBench_RunThroughput( const xebench_params_t * params );
+bool_t RenderBench_Run( const xebench_params_t * params );
+bool_t HashBench_Run( const xebench_params_t * params );
+bool_t JobBench_Run( const xebench_params_t * params );
+bool_t UnitBench_Run( const xebench_params_t * params );
+bool_t LoadBench_Run( const xebench_params_t * params );
+
+/* Starts threadCount threads running func and waits for all of them, the threads are held at a barrier so they
+   all start together. Returns the time from the barrier opening to the last thread finishing */
+uint64_t XeBench_RunThreads( uint32_t threadCount, void (*func)( uint32_t threadIndex, void * user ), void * user );
+
+/* Next thread count for the benchmarks that step up in powers of two, the last step is always maxThreads */
+uint32_t XeBench_NextThreadCount( uint32_t threadCount, uint32_t maxThreads );
+
+/* Path for a scratch file in TMPDIR, or /tmp when that isn't set. The test deletes the file when it's done */
+void XeBench_GetTempPath( str_t * pathOut, const char * name );
+
+/* Memory of the process that is resident right now. The private part leaves out the clean file pages of mappings,
+   which the page cache holds anyway and can drop, and is what a heap copy of a file adds to */
+void XeBench_GetResident( size_t * residentOut, size_t * privateOut );
+
+#endif
@@ -22,12 +22,16 @@
 #include "mem/Mem.h"
 #include "core/CVar.h"
 #include "core/Fs.h"
+#include "core/Job.h"
+#include "core/Pak.h"
 #include "Xe.h"
 #include "resource/Resource.h"
 #include "render/Model.h"
 #include "render/Material.h"
 #include "render/MaterialResource.h"
 #include "render/Texture.h"
+#include "render/Render3d.h"
+#include <string.h>
 
 //CVAR_INT(app_dispWidth, "Display width for the application", 640);
 //CVAR_INT(app_dispHeight, "Display height for the application", 480);
@@ -35,6 +39,7 @@
 //CVAR_STRING(app_title, "Title for the app window", "XEngine");
 
 #define MEM_STATS_FREQUENCY 120
+#define XE_DATA_PAK_PATH "~/data.xpak"
 
 typedef struct engine_s {
     game_interface_t    gameInterface;
@@ -42,6 +47,7 @@ typedef struct engine_s {
     uint64_t            lastTick;
     bool_t              firstFrame;
     uint64_t            memStatFrameCount;
+    char                memTagsPath[ 1024 ];
 } engine_t;
 
 engine_t engine;
@@ -54,10 +60,17 @@ void XE_Initialise(void) {
     engine.memStatFrameCount = MEM_STATS_FREQUENCY;
     
     Mem_Initialise( engine.gameAllocator );
+    Mem_CreateHeaps();
     Sys_Initialise();
+    Job_Initialise( 0 );
     //CVAR_initialise();
     FS_Initialise();
+    
+    /* Data built into a pack by pakbuilder is used in place of the loose files when it's there */
+    Pak_Mount( XE_DATA_PAK_PATH );
+    
     Resource_Initialise();
+    Material_Initialise();
     
     Resource_RegisterFactory( model_resource_factory, "bmdl" );
     Resource_RegisterFactory( texture_resource_factory, "png" );
@@ -65,7 +78,7 @@ void XE_Initialise(void) {
     Resource_RegisterFactory( texture_resource_factory, "jpg" );
     Resource_RegisterFactory( texture_resource_factory, "btex" );
     Resource_RegisterFactory( material_resource_factory, "mat" );
-    Resource_RegisterFactory( material_resource_factory, "bmat" );
+    Resource_RegisterFactory( material_library_resource_factory, "bmat" );
         
     Game_Create( &engine.gameInterface );
 }
@@ -80,11 +93,30 @@ void XE_Finalise(void) {
     engine.gameInterface.finalise();
     Game_Destroy( &engine.gameInterface );
     
+    if ( engine.memTagsPath[ 0 ] != 0 ) {
+        Mem_DumpTags( engine.memTagsPath, MEM_DUMP_CSV );
+    }
+    
+    /* Models release their materials as the resources are unloaded, so the material library goes after them */
     Resource_Finalise();
+    Material_Finalise();
+    Job_Finalise();
     FS_Finalise();
     //CVAR_finalise();
 }
 
+/*=======================================================================================================================================*/
+void XE_SetMemTagsPath( const char * path ) {
+    if ( path == NULL ) {
+        engine.memTagsPath[ 0 ] = 0;
+        return;
+    }
+    
+    xassert( strlen( path ) < sizeof( engine.memTagsPath ) );
+    strncpy( engine.memTagsPath, path, sizeof( engine.memTagsPath ) - 1 );
+    engine.memTagsPath[ sizeof( engine.memTagsPath ) - 1 ] = 0;
+}
+
 /*=======================================================================================================================================*/
 void XE_RegisterCVars(void) {
     //CVAR_register(&app_dispWidth);
@@ -107,14 +139,35 @@ void XE_Think(void) {
         engine.lastTick = currTick;
     }
     
+    /* Finish the async loads that have been read and decoded, so the game sees them this frame */
+    Resource_Update();
+    
     engine.gameInterface.think( deltaTime );
     
+    Mem_TrackFrame();
+    
     --engine.memStatFrameCount;
     if (  engine.memStatFrameCount == 0 ) {
         mem_stats_t stats;
         Mem_GetStats( &stats );
         double allocMB = (double) stats.sizeAlloc / (1024.0f * 1024.0f);
         xprintf("==Mem Stats==\n    Num Allocs %lu\n    Num Frees %lu\n    Total Allocated %4.4lf\n", stats.numAllocs, stats.numFrees, allocMB );
+        
+        for ( uint32_t n = 0; n < MEM_HEAP_CAPACITY; ++n ) {
+            mem_heap_stats_t heapStats;
+            if ( Mem_GetHeapStats( (mem_heap_id_t) n, &heapStats ) == true ) {
+                double usedMB = (double) heapStats.used / (1024.0f * 1024.0f);
+                double sizeMB = (double) heapStats.size / (1024.0f * 1024.0f);
+                xprintf("    Heap %-10s %4.4lf / %4.4lf  Frag %.2f  Overflows %lu\n", heapStats.name, usedMB, sizeMB, heapStats.fragmentation, heapStats.numOverflows );
+            }
+        }
+        
+        render_stats_t renderStats;
+        Render_GetFrameStats( &renderStats );
+        double uploadKB = (double) renderStats.bytesUploaded / 1024.0f;
+        xprintf("==Render Stats==\n    Frame %lu\n    Draws %lu\n    Materials %lu\n    Triangles %lu\n    Uploaded KB %4.4lf\n",
+                renderStats.frameIndex, renderStats.drawCalls, renderStats.materials, renderStats.triangles, uploadKB );
+        
         engine.memStatFrameCount = MEM_STATS_FREQUENCY;
     }
     
@@ -29,4 +29,9 @@ XE_API void XE_Finalise(void);
 XE_API void XE_Think(void);
 XE_API void XE_GameInitialise();
 
+/* Dumps the memory tags as CSV to path when the engine shuts down, in builds with
+   memory tracking. Off until a path is set, and the path should be somewhere
+   writable rather than the data folder. NULL turns it back off */
+XE_API void XE_SetMemTagsPath( const char * path );
+
 #endif
@@ -0,0 +1,109 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __ATOMIC_H__
+#define __ATOMIC_H__
+
+#include "core/Platform.h"
+
+/* The engine uses C11 atomics. The Visual Studio 2019 C compiler has no <stdatomic.h>, so there the part of it
+   the engine uses is mapped onto the Interlocked intrinsics. Only 32 and 64 bit atomics are supported, and the
+   loads and stores lean on the x64 /volatile:ms default, where volatile reads acquire and volatile writes release */
+#if !defined( _MSC_VER ) || defined( __clang__ )
+
+#   include <stdatomic.h>
+
+#else
+
+#include <intrin.h>
+
+typedef enum memory_order {
+    memory_order_relaxed,
+    memory_order_consume,
+    memory_order_acquire,
+    memory_order_release,
+    memory_order_acq_rel,
+    memory_order_seq_cst
+} memory_order;
+
+#define _Atomic( T )                    T volatile
+
+typedef volatile uint32_t               atomic_uint;
+typedef volatile bool_t                 atomic_bool;
+typedef volatile uint64_t               atomic_uint_fast64_t;
+typedef volatile int64_t                atomic_int_fast64_t;
+typedef volatile uintptr_t              atomic_uintptr_t;
+
+/*=======================================================================================================================================*/
+static X_INLINE bool_t Atomic_CompareExchange32( long volatile * ptr, long * expected, long desired ) {
+    long prev = _InterlockedCompareExchange( ptr, desired, *expected );
+    if ( prev == *expected ) {
+        return true;
+    }
+
+    *expected = prev;
+    return false;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE bool_t Atomic_CompareExchange64( __int64 volatile * ptr, __int64 * expected, __int64 desired ) {
+    __int64 prev = _InterlockedCompareExchange64( ptr, desired, *expected );
+    if ( prev == *expected ) {
+        return true;
+    }
+
+    *expected = prev;
+    return false;
+}
+
+/* 32 bit results are widened as unsigned, so they compare the same as the uint32_t they came from */
+#define ATOMIC_IS_64( P )                                   ( sizeof( *(P) ) == 8 )
+#define ATOMIC_OP( P, OP32, OP64, V )                       ( ATOMIC_IS_64( P ) ? (int64_t) OP64( (__int64 volatile *) (P), (__int64) (V) ) \
+                                                                                : (int64_t) (uint32_t) OP32( (long volatile *) (P), (long) (intptr_t) (V) ) )
+
+#define atomic_init( P, V )                                 ( (void) ( *(P) = (V) ) )
+
+#define atomic_load_explicit( P, O )                        ( *(P) )
+#define atomic_load( P )                                    ( *(P) )
+
+#define atomic_exchange_explicit( P, V, O )                 ATOMIC_OP( P, _InterlockedExchange, _InterlockedExchange64, V )
+#define atomic_exchange( P, V )                             atomic_exchange_explicit( P, V, memory_order_seq_cst )
+
+/* Only a sequentially consistent store needs the locked exchange, the others are plain volatile writes */
+#define atomic_store_explicit( P, V, O )                    ( ( (O) == memory_order_seq_cst ) ? (void) atomic_exchange_explicit( P, V, O ) : (void) ( *(P) = (V) ) )
+#define atomic_store( P, V )                                atomic_store_explicit( P, V, memory_order_seq_cst )
+
+#define atomic_fetch_add_explicit( P, V, O )                ATOMIC_OP( P, _InterlockedExchangeAdd, _InterlockedExchangeAdd64, V )
+#define atomic_fetch_add( P, V )                            atomic_fetch_add_explicit( P, V, memory_order_seq_cst )
+#define atomic_fetch_sub_explicit( P, V, O )                ATOMIC_OP( P, _InterlockedExchangeAdd, _InterlockedExchangeAdd64, -(int64_t) (V) )
+#define atomic_fetch_sub( P, V )                            atomic_fetch_sub_explicit( P, V, memory_order_seq_cst )
+
+#define atomic_compare_exchange_strong_explicit( P, E, D, S, F ) \
+    ( ATOMIC_IS_64( P ) ? Atomic_CompareExchange64( (__int64 volatile *) (P), (__int64 *) (E), (__int64) (D) ) \
+                        : Atomic_CompareExchange32( (long volatile *) (P), (long *) (E), (long) (intptr_t) (D) ) )
+#define atomic_compare_exchange_strong( P, E, D )           atomic_compare_exchange_strong_explicit( P, E, D, memory_order_seq_cst, memory_order_seq_cst )
+#define atomic_compare_exchange_weak_explicit( P, E, D, S, F )  atomic_compare_exchange_strong_explicit( P, E, D, S, F )
+#define atomic_compare_exchange_weak( P, E, D )             atomic_compare_exchange_strong( P, E, D )
+
+#define atomic_thread_fence( O )                            ( ( (O) == memory_order_seq_cst ) ? _mm_mfence() : _ReadWriteBarrier() )
+
+#endif
+
+#endif
@@ -28,6 +28,15 @@ typedef struct file_s {
     uint64_t        data[8];
 } file_t;
 
+/* Read only view of the whole of an open file. data points at the first byte of the file, which may be part way
+   into the mapping when the file is inside a pack. The map must be released with FS_FileUnmap before the file is closed */
+typedef struct file_map_s {
+    const void *    data;
+    size_t          size;
+    void *          base;           /* Start of the mapping, NULL when there is nothing to unmap */
+    size_t          baseSize;
+} file_map_t;
+
 XE_API void        FS_Initialise       ( void );
 XE_API void        FS_Finalise         ( void );
 
@@ -38,6 +47,8 @@ XE_API uintptr_t    FS_FileTell         ( file_t * file );
 XE_API bool_t       FS_FileSeek         ( file_t * file, uintptr_t pos );
 XE_API size_t       FS_FileRead         ( file_t * file, void* buffer, size_t elementSize, size_t elementCount );
 XE_API size_t       FS_FileWrite        ( file_t * file, const void* buffer, size_t elementSize, size_t elementCount );
+XE_API bool_t       FS_FileMap          ( file_t * file, file_map_t * mapOut );
+XE_API void         FS_FileUnmap        ( file_map_t * map );
 
 XE_API bool_t       FS_MakePath         ( str_t * pathOut, const char * path );
 XE_API const char * FS_GetExt           ( const char* pathIn );
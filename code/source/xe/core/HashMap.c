@@ -0,0 +1,272 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "core/HashMap.h"
+#include "core/Sys.h"
+#include <string.h>
+#include <assert.h>
+
+#define HASH_MAP_MAX_DIST 255                       /* Probe distances are kept in a byte, the table grows before one gets this long */
+#define HASH_MAP_SCRAMBLE 0x9E3779B97F4A7C15ull     /* 2^64 / golden ratio, spreads keys that differ only in their high bits */
+
+static void HashMap_Allocate( hash_map_t * self_, uint32_t capacity );
+static void HashMap_Grow( hash_map_t * self_ );
+
+/*=======================================================================================================================================*/
+static inline uint32_t HashMap_SlotIndex( const hash_map_t * self_, uint64_t key ) {
+    return (uint32_t) ( ( key * HASH_MAP_SCRAMBLE ) >> self_->shift );
+}
+
+/*=======================================================================================================================================*/
+static bool_t HashMap_Place( hash_map_t * self_, uint64_t * key, uint64_t * value ) {
+    uint32_t mask = self_->capacity - 1;
+    uint32_t index = HashMap_SlotIndex( self_, *key );
+    uint32_t dist = 1;
+    
+    /* Entries that are closer to their home slot give way to the one being placed, which then carries on
+       looking for a slot for the entry it displaced */
+    for ( ;; ) {
+        if ( self_->dists[ index ] == 0 ) {
+            self_->slots[ index ].key = *key;
+            self_->slots[ index ].value = *value;
+            self_->dists[ index ] = (uint8_t) dist;
+            return true;
+        }
+        
+        if ( self_->dists[ index ] < dist ) {
+            hash_map_slot_t displaced = self_->slots[ index ];
+            uint32_t displacedDist = self_->dists[ index ];
+            
+            self_->slots[ index ].key = *key;
+            self_->slots[ index ].value = *value;
+            self_->dists[ index ] = (uint8_t) dist;
+            
+            *key = displaced.key;
+            *value = displaced.value;
+            dist = displacedDist;
+        }
+        
+        index = ( index + 1 ) & mask;
+        ++dist;
+        
+        /* Out of room for the distance, the caller grows the table and places whatever is left in key and value */
+        if ( dist >= HASH_MAP_MAX_DIST ) {
+            return false;
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static void HashMap_Allocate( hash_map_t * self_, uint32_t capacity ) {
+    uint32_t log2Capacity = 0;
+    while ( ( 1u << log2Capacity ) < capacity ) {
+        ++log2Capacity;
+    }
+    
+    self_->capacity = 1u << log2Capacity;
+    self_->shift = 64 - log2Capacity;
+    self_->count = 0;
+    
+    /* Slots and distances share one block */
+    size_t slotsSize = sizeof( hash_map_slot_t ) * self_->capacity;
+    uint8_t * mem = (uint8_t *) Mem_HeapAlloc( self_->heapId, slotsSize + self_->capacity );
+    xerror( mem == NULL, "HashMap: Unable to allocate %u slots\n", self_->capacity );
+    
+    self_->slots = (hash_map_slot_t *) mem;
+    self_->dists = mem + slotsSize;
+    memset( self_->dists, 0, self_->capacity );
+}
+
+/*=======================================================================================================================================*/
+static void HashMap_Grow( hash_map_t * self_ ) {
+    hash_map_slot_t * oldSlots = self_->slots;
+    uint8_t * oldDists = self_->dists;
+    uint32_t oldCapacity = self_->capacity;
+    uint32_t oldCount = self_->count;
+    
+    HashMap_Allocate( self_, ( oldCapacity > 0 ) ? oldCapacity * 2 : HASH_MAP_MIN_CAPACITY );
+    
+    for ( uint32_t s = 0; s < oldCapacity; ++s ) {
+        if ( oldDists[ s ] == 0 ) {
+            continue;
+        }
+        
+        uint64_t key = oldSlots[ s ].key;
+        uint64_t value = oldSlots[ s ].value;
+        while ( HashMap_Place( self_, &key, &value ) == false ) {
+            HashMap_Grow( self_ );
+        }
+    }
+    self_->count = oldCount;
+    
+    if ( oldSlots != NULL ) {
+        Mem_Free( oldSlots );
+    }
+}
+
+/*=======================================================================================================================================*/
+void HashMap_Create( hash_map_t * self_, uint32_t capacity, mem_heap_id_t heapId ) {
+    assert( self_ != NULL );
+    
+    memset( self_, 0, sizeof( hash_map_t ) );
+    self_->heapId = heapId;
+    
+    /* Room for capacity entries without growing */
+    if ( capacity > 0 ) {
+        uint64_t slots = ( (uint64_t) capacity * 8 + 6 ) / 7;
+        HashMap_Allocate( self_, ( slots > HASH_MAP_MIN_CAPACITY ) ? (uint32_t) slots : HASH_MAP_MIN_CAPACITY );
+    }
+}
+
+/*=======================================================================================================================================*/
+void HashMap_Destroy( hash_map_t * self_ ) {
+    assert( self_ != NULL );
+    
+    if ( self_->slots != NULL ) {
+        Mem_Free( self_->slots );
+    }
+    
+    mem_heap_id_t heapId = self_->heapId;
+    memset( self_, 0, sizeof( hash_map_t ) );
+    self_->heapId = heapId;
+}
+
+/*=======================================================================================================================================*/
+void HashMap_Clear( hash_map_t * self_ ) {
+    assert( self_ != NULL );
+    
+    if ( self_->dists != NULL ) {
+        memset( self_->dists, 0, self_->capacity );
+    }
+    self_->count = 0;
+}
+
+/*=======================================================================================================================================*/
+bool_t HashMap_Insert( hash_map_t * self_, uint64_t key, uint64_t value ) {
+    assert( self_ != NULL );
+    
+    if ( HashMap_Find( self_, key, NULL ) == true ) {
+        return false;
+    }
+    
+    if ( ( (uint64_t) self_->count + 1 ) * 8 > (uint64_t) self_->capacity * 7 ) {
+        HashMap_Grow( self_ );
+    }
+    
+    while ( HashMap_Place( self_, &key, &value ) == false ) {
+        HashMap_Grow( self_ );
+    }
+    ++self_->count;
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+bool_t HashMap_Find( const hash_map_t * self_, uint64_t key, uint64_t * valueOut ) {
+    assert( self_ != NULL );
+    
+    if ( self_->count == 0 ) {
+        return false;
+    }
+    
+    uint32_t mask = self_->capacity - 1;
+    uint32_t index = HashMap_SlotIndex( self_, key );
+    
+    /* Once we reach an entry that is closer to its home slot than we are to ours, the key isn't in the map */
+    for ( uint32_t dist = 1; self_->dists[ index ] >= dist; ++dist ) {
+        if ( self_->slots[ index ].key == key ) {
+            if ( valueOut != NULL ) {
+                *valueOut = self_->slots[ index ].value;
+            }
+            return true;
+        }
+        index = ( index + 1 ) & mask;
+    }
+    
+    return false;
+}
+
+/*=======================================================================================================================================*/
+bool_t HashMap_Remove( hash_map_t * self_, uint64_t key, uint64_t * valueOut ) {
+    assert( self_ != NULL );
+    
+    if ( self_->count == 0 ) {
+        return false;
+    }
+    
+    uint32_t mask = self_->capacity - 1;
+    uint32_t index = HashMap_SlotIndex( self_, key );
+    uint32_t dist = 1;
+    
+    while ( self_->dists[ index ] >= dist && self_->slots[ index ].key != key ) {
+        index = ( index + 1 ) & mask;
+        ++dist;
+    }
+    
+    if ( self_->dists[ index ] < dist ) {
+        return false;
+    }
+    
+    if ( valueOut != NULL ) {
+        *valueOut = self_->slots[ index ].value;
+    }
+    
+    /* Shift the entries after it back a slot until one is empty or already in its home slot, so there are no
+       holes in the runs and nothing needs marking as deleted */
+    uint32_t next = ( index + 1 ) & mask;
+    while ( self_->dists[ next ] > 1 ) {
+        self_->slots[ index ] = self_->slots[ next ];
+        self_->dists[ index ] = self_->dists[ next ] - 1;
+        index = next;
+        next = ( next + 1 ) & mask;
+    }
+    self_->dists[ index ] = 0;
+    --self_->count;
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+bool_t HashMap_Next( const hash_map_t * self_, uint32_t * iter, uint64_t * keyOut, uint64_t * valueOut ) {
+    assert( self_ != NULL );
+    assert( iter != NULL );
+    
+    for ( uint32_t s = *iter; s < self_->capacity; ++s ) {
+        if ( self_->dists[ s ] != 0 ) {
+            if ( keyOut != NULL ) {
+                *keyOut = self_->slots[ s ].key;
+            }
+            if ( valueOut != NULL ) {
+                *valueOut = self_->slots[ s ].value;
+            }
+            *iter = s + 1;
+            return true;
+        }
+    }
+    
+    *iter = self_->capacity;
+    return false;
+}
+
+/*=======================================================================================================================================*/
+uint32_t HashMap_GetCount( const hash_map_t * self_ ) {
+    assert( self_ != NULL );
+    return self_->count;
+}
@@ -0,0 +1,58 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __HASHMAP_H__
+#define __HASHMAP_H__
+
+#include "core/Platform.h"
+#include "mem/Mem.h"
+
+#define HASH_MAP_MIN_CAPACITY 16
+
+/* Open addressing map from 64 bit keys, normally hashes of names or paths, to 64 bit values. Collisions are
+   resolved with Robin Hood probing, which keeps probes short when the table is nearly full, and the table
+   doubles in size when it gets more than 7/8 full. A zeroed map is a valid empty map that allocates from
+   the default heap when the first entry is added. Maps are not thread safe */
+typedef struct hash_map_slot_s {
+    uint64_t        key;
+    uint64_t        value;
+} hash_map_slot_t;
+
+typedef struct hash_map_s {
+    hash_map_slot_t *   slots;
+    uint8_t *           dists;          /* One more than the probe distance of the entry in each slot, 0 when the slot is empty */
+    uint32_t            capacity;       /* Number of slots, a power of two */
+    uint32_t            count;
+    uint32_t            shift;          /* Shift that turns a scrambled key into a slot index */
+    mem_heap_id_t       heapId;
+} hash_map_t;
+
+/* Insert returns false and leaves the map alone if the key is already there. Next walks the entries in slot order
+   starting with *iter set to 0, the map must not be changed during the walk */
+XE_API void     HashMap_Create( hash_map_t * self_, uint32_t capacity, mem_heap_id_t heapId );
+XE_API void     HashMap_Destroy( hash_map_t * self_ );
+XE_API void     HashMap_Clear( hash_map_t * self_ );
+XE_API bool_t   HashMap_Insert( hash_map_t * self_, uint64_t key, uint64_t value );
+XE_API bool_t   HashMap_Find( const hash_map_t * self_, uint64_t key, uint64_t * valueOut );
+XE_API bool_t   HashMap_Remove( hash_map_t * self_, uint64_t key, uint64_t * valueOut );
+XE_API bool_t   HashMap_Next( const hash_map_t * self_, uint32_t * iter, uint64_t * keyOut, uint64_t * valueOut );
+XE_API uint32_t HashMap_GetCount( const hash_map_t * self_ );
+
+#endif
@@ -0,0 +1,654 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "core/Job.h"
+#include "core/Sys.h"
+#include "mem/Mem.h"
+#include "mem/UnitHeap.h"
+#include "core/Atomic.h"
+#include <string.h>
+#include <assert.h>
+
+#define JOB_DEQUE_CAPACITY      4096            /* Must be a power of two */
+#define JOB_POOL_CAPACITY       ( 16 * 1024 )
+#define JOB_SPIN_COUNT          64              /* Attempts to find work before a worker goes to sleep */
+#define JOB_CACHE_LINE          64
+
+typedef struct job_s {
+    job_func_t          func;
+    job_range_func_t    rangeFunc;
+    void *              arg;
+    uint32_t            start;
+    uint32_t            end;
+    job_counter_t *     counter;
+    struct job_s *      next;                   /* Link for the injection queue and counter wait lists */
+} job_t;
+
+typedef struct job_counter_local_s {
+    atomic_uint         count;
+    atomic_uint         lock;                   /* Spin lock guarding the wait list, held while the count is decremented */
+    job_t *             waitList;               /* Jobs to submit when the count reaches zero */
+} job_counter_local_t;
+
+/* Chase-Lev deque, the owner pushes and pops at the bottom while other workers steal from the top */
+typedef struct job_deque_s {
+    atomic_int_fast64_t top;
+    uint8_t             pad0[ JOB_CACHE_LINE - sizeof( atomic_int_fast64_t ) ];
+    atomic_int_fast64_t bottom;
+    uint8_t             pad1[ JOB_CACHE_LINE - sizeof( atomic_int_fast64_t ) ];
+    atomic_uintptr_t    items[ JOB_DEQUE_CAPACITY ];
+} job_deque_t;
+
+typedef struct job_worker_s {
+    job_deque_t             deque;
+    sys_thread_t            thread;
+    uint32_t                index;
+    uint32_t                rng;
+    atomic_uint_fast64_t    numRun;
+    atomic_uint_fast64_t    numStolen;
+    atomic_uint_fast64_t    numInline;
+} job_worker_t;
+
+typedef struct job_system_s {
+    job_worker_t *          workers[ JOB_MAX_WORKERS ];
+    uint32_t                workerCount;
+    void *                  poolMem;
+    unit_heap_t *           pool;
+    
+    sys_mutex_t             injectMutex;        /* Queue for jobs submitted from threads that are not workers */
+    job_t *                 injectHead;
+    job_t *                 injectTail;
+    atomic_uint             injectCount;
+    
+    sys_mutex_t             sleepMutex;
+    sys_cond_t              sleepCond;
+    atomic_uint             pendingCount;       /* Jobs queued that have not been taken by a worker */
+    atomic_uint             sleepingCount;
+    atomic_bool             running;
+    atomic_uint_fast64_t    numExternalInline;
+    bool_t                  init;
+} job_system_t;
+
+static job_system_t jobSys;
+static XE_THREAD_LOCAL job_worker_t * jobWorker = NULL;
+
+static void Job_Execute( job_t * job );
+
+/*=======================================================================================================================================*/
+static bool_t Job_DequePush( job_deque_t * deque, job_t * job ) {
+    int_fast64_t b = atomic_load_explicit( &deque->bottom, memory_order_relaxed );
+    int_fast64_t t = atomic_load_explicit( &deque->top, memory_order_acquire );
+    
+    if ( b - t >= JOB_DEQUE_CAPACITY ) {
+        return false;
+    }
+    
+    atomic_store_explicit( &deque->items[ b & ( JOB_DEQUE_CAPACITY - 1 ) ], (uintptr_t) job, memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+    atomic_store_explicit( &deque->bottom, b + 1, memory_order_relaxed );
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static job_t * Job_DequePop( job_deque_t * deque ) {
+    int_fast64_t b = atomic_load_explicit( &deque->bottom, memory_order_relaxed ) - 1;
+    atomic_store_explicit( &deque->bottom, b, memory_order_relaxed );
+    atomic_thread_fence( memory_order_seq_cst );
+    int_fast64_t t = atomic_load_explicit( &deque->top, memory_order_relaxed );
+    
+    if ( t > b ) {
+        /* Empty */
+        atomic_store_explicit( &deque->bottom, b + 1, memory_order_relaxed );
+        return NULL;
+    }
+    
+    job_t * job = (job_t *) atomic_load_explicit( &deque->items[ b & ( JOB_DEQUE_CAPACITY - 1 ) ], memory_order_relaxed );
+    
+    if ( t == b ) {
+        /* Last item, race the thieves for it */
+        if ( atomic_compare_exchange_strong_explicit( &deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed ) == false ) {
+            job = NULL;
+        }
+        atomic_store_explicit( &deque->bottom, b + 1, memory_order_relaxed );
+    }
+    
+    return job;
+}
+
+/*=======================================================================================================================================*/
+static job_t * Job_DequeSteal( job_deque_t * deque ) {
+    int_fast64_t t = atomic_load_explicit( &deque->top, memory_order_acquire );
+    atomic_thread_fence( memory_order_seq_cst );
+    int_fast64_t b = atomic_load_explicit( &deque->bottom, memory_order_acquire );
+    
+    if ( t >= b ) {
+        return NULL;
+    }
+    
+    job_t * job = (job_t *) atomic_load_explicit( &deque->items[ t & ( JOB_DEQUE_CAPACITY - 1 ) ], memory_order_relaxed );
+    if ( atomic_compare_exchange_strong_explicit( &deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed ) == false ) {
+        /* Lost the race to the owner or another thief */
+        return NULL;
+    }
+    
+    return job;
+}
+
+/*=======================================================================================================================================*/
+static void Job_CounterLock( job_counter_local_t * counter ) {
+    while ( atomic_exchange_explicit( &counter->lock, 1, memory_order_acquire ) != 0 ) {
+        while ( atomic_load_explicit( &counter->lock, memory_order_relaxed ) != 0 ) {
+            /* Spin */
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Job_CounterUnlock( job_counter_local_t * counter ) {
+    atomic_store_explicit( &counter->lock, 0, memory_order_release );
+}
+
+/*=======================================================================================================================================*/
+static void Job_Wake( uint32_t count ) {
+    if ( atomic_load( &jobSys.sleepingCount ) == 0 ) {
+        return;
+    }
+    
+    Sys_MutexLock( &jobSys.sleepMutex );
+    if ( count == 1 ) {
+        Sys_CondSignal( &jobSys.sleepCond );
+    }
+    else {
+        Sys_CondBroadcast( &jobSys.sleepCond );
+    }
+    Sys_MutexUnlock( &jobSys.sleepMutex );
+}
+
+/*=======================================================================================================================================*/
+static void Job_Submit( job_t * job ) {
+    if ( jobWorker != NULL ) {
+        if ( Job_DequePush( &jobWorker->deque, job ) == false ) {
+            /* Our deque is full, so just do the work now */
+            atomic_fetch_add_explicit( &jobWorker->numInline, 1, memory_order_relaxed );
+            Job_Execute( job );
+            return;
+        }
+    }
+    else {
+        /* Not a worker thread, so hand the job over through the shared queue */
+        job->next = NULL;
+        
+        Sys_MutexLock( &jobSys.injectMutex );
+        if ( jobSys.injectTail != NULL ) {
+            jobSys.injectTail->next = job;
+        }
+        else {
+            jobSys.injectHead = job;
+        }
+        jobSys.injectTail = job;
+        atomic_fetch_add( &jobSys.injectCount, 1 );
+        Sys_MutexUnlock( &jobSys.injectMutex );
+    }
+    
+    atomic_fetch_add( &jobSys.pendingCount, 1 );
+}
+
+/*=======================================================================================================================================*/
+static job_t * Job_TakeInjected(void) {
+    job_t * job = NULL;
+    
+    if ( atomic_load_explicit( &jobSys.injectCount, memory_order_relaxed ) == 0 ) {
+        return NULL;
+    }
+    
+    Sys_MutexLock( &jobSys.injectMutex );
+    job = jobSys.injectHead;
+    if ( job != NULL ) {
+        jobSys.injectHead = job->next;
+        if ( jobSys.injectHead == NULL ) {
+            jobSys.injectTail = NULL;
+        }
+        atomic_fetch_sub( &jobSys.injectCount, 1 );
+    }
+    Sys_MutexUnlock( &jobSys.injectMutex );
+    
+    return job;
+}
+
+/*=======================================================================================================================================*/
+static job_t * Job_GetNext( job_worker_t * worker ) {
+    job_t * job = NULL;
+    uint32_t start = 0;
+    
+    if ( worker != NULL ) {
+        job = Job_DequePop( &worker->deque );
+        
+        /* xorshift to pick where to start stealing from */
+        worker->rng ^= worker->rng << 13;
+        worker->rng ^= worker->rng >> 17;
+        worker->rng ^= worker->rng << 5;
+        start = worker->rng;
+    }
+    
+    if ( job == NULL ) {
+        job = Job_TakeInjected();
+    }
+    
+    for ( uint32_t i = 0; job == NULL && i < jobSys.workerCount; ++i ) {
+        job_worker_t * victim = jobSys.workers[ ( start + i ) % jobSys.workerCount ];
+        if ( victim != worker ) {
+            job = Job_DequeSteal( &victim->deque );
+            if ( job != NULL && worker != NULL ) {
+                atomic_fetch_add_explicit( &worker->numStolen, 1, memory_order_relaxed );
+            }
+        }
+    }
+    
+    if ( job != NULL ) {
+        atomic_fetch_sub( &jobSys.pendingCount, 1 );
+    }
+    
+    return job;
+}
+
+/*=======================================================================================================================================*/
+static void Job_CounterDecrement( job_counter_t * counter_ ) {
+    job_counter_local_t * counter = (job_counter_local_t *) counter_;
+    job_t * waitList = NULL;
+    uint32_t waitCount = 0;
+    
+    /* The lock is held over the decrement so that a waiter can't see the count reach zero and
+       let the counter go out of scope while we are still touching it */
+    Job_CounterLock( counter );
+    if ( atomic_fetch_sub( &counter->count, 1 ) == 1 ) {
+        waitList = counter->waitList;
+        counter->waitList = NULL;
+    }
+    Job_CounterUnlock( counter );
+    
+    while ( waitList != NULL ) {
+        job_t * job = waitList;
+        waitList = job->next;
+        Job_Submit( job );
+        ++waitCount;
+    }
+    
+    if ( waitCount > 0 ) {
+        Job_Wake( waitCount );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Job_Execute( job_t * job ) {
+    job_counter_t * counter = job->counter;
+    
+    if ( job->rangeFunc != NULL ) {
+        job->rangeFunc( job->arg, job->start, job->end );
+    }
+    else {
+        job->func( job->arg );
+    }
+    
+    if ( jobWorker != NULL ) {
+        atomic_fetch_add_explicit( &jobWorker->numRun, 1, memory_order_relaxed );
+    }
+    
+    UnitHeap_Free( jobSys.pool, job );
+    
+    if ( counter != NULL ) {
+        Job_CounterDecrement( counter );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Job_RunInline( job_func_t func, job_range_func_t rangeFunc, void * arg, uint32_t start, uint32_t end, job_counter_t * counter ) {
+    if ( rangeFunc != NULL ) {
+        rangeFunc( arg, start, end );
+    }
+    else {
+        func( arg );
+    }
+    
+    if ( jobWorker != NULL ) {
+        atomic_fetch_add_explicit( &jobWorker->numInline, 1, memory_order_relaxed );
+    }
+    else {
+        atomic_fetch_add_explicit( &jobSys.numExternalInline, 1, memory_order_relaxed );
+    }
+    
+    if ( counter != NULL ) {
+        Job_CounterDecrement( counter );
+    }
+}
+
+/*=======================================================================================================================================*/
+static job_t * Job_Alloc( job_func_t func, job_range_func_t rangeFunc, void * arg, uint32_t start, uint32_t end, job_counter_t * counter ) {
+    job_t * job = ( jobSys.init == true ) ? (job_t *) UnitHeap_Alloc( jobSys.pool ) : NULL;
+    
+    if ( job != NULL ) {
+        job->func = func;
+        job->rangeFunc = rangeFunc;
+        job->arg = arg;
+        job->start = start;
+        job->end = end;
+        job->counter = counter;
+        job->next = NULL;
+    }
+    
+    return job;
+}
+
+/*=======================================================================================================================================*/
+static void Job_WorkerMain( void * arg ) {
+    job_worker_t * worker = (job_worker_t *) arg;
+    jobWorker = worker;
+    
+    while ( atomic_load( &jobSys.running ) == true ) {
+        job_t * job = NULL;
+        
+        for ( uint32_t spin = 0; job == NULL && spin < JOB_SPIN_COUNT; ++spin ) {
+            job = Job_GetNext( worker );
+            if ( job == NULL ) {
+                Sys_ThreadYield();
+            }
+        }
+        
+        if ( job != NULL ) {
+            Job_Execute( job );
+            continue;
+        }
+        
+        /* Nothing to do, sleep until more jobs are submitted */
+        Sys_MutexLock( &jobSys.sleepMutex );
+        atomic_fetch_add( &jobSys.sleepingCount, 1 );
+        while ( atomic_load( &jobSys.pendingCount ) == 0 && atomic_load( &jobSys.running ) == true ) {
+            Sys_CondWait( &jobSys.sleepCond, &jobSys.sleepMutex );
+        }
+        atomic_fetch_sub( &jobSys.sleepingCount, 1 );
+        Sys_MutexUnlock( &jobSys.sleepMutex );
+    }
+    
+    jobWorker = NULL;
+}
+
+/*=======================================================================================================================================*/
+void Job_Initialise( uint32_t workerCount ) {
+    if ( jobSys.init == true ) {
+        return;
+    }
+    
+    static_assert( sizeof( job_counter_t ) >= sizeof( job_counter_local_t ), "Size of job_counter_t.data is too small for implementation" );
+    
+    if ( workerCount == 0 ) {
+        workerCount = Sys_GetCpuCount();
+    }
+    
+    workerCount = ( workerCount < 1 ) ? 1 : workerCount;
+    workerCount = ( workerCount > JOB_MAX_WORKERS ) ? JOB_MAX_WORKERS : workerCount;
+    
+    memset( &jobSys, 0, sizeof( jobSys ) );
+    
+    size_t poolSize = UnitHeap_CalcMemSize( sizeof( job_t ), JOB_POOL_CAPACITY );
+    jobSys.poolMem = Mem_AllocAligned( poolSize, JOB_CACHE_LINE );
+    jobSys.pool = UnitHeap_Create( (uintptr_t) jobSys.poolMem, poolSize, sizeof( job_t ), UNIT_HEAP_FLAG_THREAD_SAFE );
+    
+    Sys_MutexCreate( &jobSys.injectMutex );
+    Sys_MutexCreate( &jobSys.sleepMutex );
+    Sys_CondCreate( &jobSys.sleepCond );
+    atomic_store( &jobSys.running, true );
+    
+    jobSys.workerCount = workerCount;
+    for ( uint32_t i = 0; i < workerCount; ++i ) {
+        job_worker_t * worker = (job_worker_t *) Mem_AllocAligned( sizeof( job_worker_t ), JOB_CACHE_LINE );
+        memset( worker, 0, sizeof( job_worker_t ) );
+        worker->index = i;
+        worker->rng = 0x9E3779B9u * ( i + 1 );
+        jobSys.workers[ i ] = worker;
+    }
+    
+    /* The calling thread is worker 0 */
+    jobWorker = jobSys.workers[ 0 ];
+    jobSys.init = true;
+    
+    for ( uint32_t i = 1; i < workerCount; ++i ) {
+        bool_t created = Sys_ThreadCreate( &jobSys.workers[ i ]->thread, Job_WorkerMain, jobSys.workers[ i ] );
+        xerror( created == false, "Failed to create job worker %u\n", i );
+    }
+    
+    xprintf( "=== Job Init ===================\n" );
+    xprintf( "    %u workers\n", workerCount );
+}
+
+/*=======================================================================================================================================*/
+void Job_Finalise(void) {
+    if ( jobSys.init == false ) {
+        return;
+    }
+    
+    Sys_MutexLock( &jobSys.sleepMutex );
+    atomic_store( &jobSys.running, false );
+    Sys_CondBroadcast( &jobSys.sleepCond );
+    Sys_MutexUnlock( &jobSys.sleepMutex );
+    
+    for ( uint32_t i = 1; i < jobSys.workerCount; ++i ) {
+        Sys_ThreadJoin( &jobSys.workers[ i ]->thread );
+    }
+    
+    for ( uint32_t i = 0; i < jobSys.workerCount; ++i ) {
+        Mem_Free( jobSys.workers[ i ] );
+        jobSys.workers[ i ] = NULL;
+    }
+    
+    Sys_CondDestroy( &jobSys.sleepCond );
+    Sys_MutexDestroy( &jobSys.sleepMutex );
+    Sys_MutexDestroy( &jobSys.injectMutex );
+    
+    UnitHeap_Destroy( jobSys.pool );
+    Mem_Free( jobSys.poolMem );
+    
+    jobWorker = NULL;
+    jobSys.init = false;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Job_GetWorkerCount(void) {
+    return ( jobSys.init == true ) ? jobSys.workerCount : 1;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Job_GetWorkerIndex(void) {
+    /* Threads that are not workers report the main thread's index */
+    return ( jobWorker != NULL ) ? jobWorker->index : 0;
+}
+
+/*=======================================================================================================================================*/
+void Job_CounterInit( job_counter_t * counter_ ) {
+    job_counter_local_t * counter = (job_counter_local_t *) counter_;
+    
+    atomic_init( &counter->count, 0 );
+    atomic_init( &counter->lock, 0 );
+    counter->waitList = NULL;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Job_CounterGet( const job_counter_t * counter_ ) {
+    job_counter_local_t * counter = (job_counter_local_t *) counter_;
+    return atomic_load( &counter->count );
+}
+
+/*=======================================================================================================================================*/
+void Job_Run( const job_decl_t * jobs, uint32_t count, job_counter_t * counter ) {
+    uint32_t submitted = 0;
+    
+    if ( counter != NULL ) {
+        atomic_fetch_add( &( (job_counter_local_t *) counter )->count, count );
+    }
+    
+    for ( uint32_t i = 0; i < count; ++i ) {
+        job_t * job = Job_Alloc( jobs[ i ].func, NULL, jobs[ i ].arg, 0, 0, counter );
+        if ( job == NULL ) {
+            /* Pool is exhausted or the system isn't running, do the work now */
+            Job_RunInline( jobs[ i ].func, NULL, jobs[ i ].arg, 0, 0, counter );
+            continue;
+        }
+        
+        Job_Submit( job );
+        ++submitted;
+    }
+    
+    if ( submitted > 0 ) {
+        Job_Wake( submitted );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Job_RunAfter( const job_decl_t * jobs, uint32_t count, job_counter_t * counter, job_counter_t * dependency_ ) {
+    job_counter_local_t * dependency = (job_counter_local_t *) dependency_;
+    job_t * waitList = NULL;
+    
+    assert( dependency != NULL );
+    
+    if ( counter != NULL ) {
+        atomic_fetch_add( &( (job_counter_local_t *) counter )->count, count );
+    }
+    
+    for ( uint32_t i = 0; i < count; ++i ) {
+        job_t * job = Job_Alloc( jobs[ i ].func, NULL, jobs[ i ].arg, 0, 0, counter );
+        if ( job == NULL ) {
+            /* No job to park on the dependency, so wait for it here */
+            Job_Wait( dependency_ );
+            Job_RunInline( jobs[ i ].func, NULL, jobs[ i ].arg, 0, 0, counter );
+            continue;
+        }
+        
+        job->next = waitList;
+        waitList = job;
+    }
+    
+    if ( waitList == NULL ) {
+        return;
+    }
+    
+    /* Park the jobs on the dependency, unless it has already finished */
+    Job_CounterLock( dependency );
+    if ( atomic_load( &dependency->count ) != 0 ) {
+        job_t * tail = waitList;
+        while ( tail->next != NULL ) {
+            tail = tail->next;
+        }
+        tail->next = dependency->waitList;
+        dependency->waitList = waitList;
+        waitList = NULL;
+    }
+    Job_CounterUnlock( dependency );
+    
+    uint32_t submitted = 0;
+    while ( waitList != NULL ) {
+        job_t * job = waitList;
+        waitList = job->next;
+        Job_Submit( job );
+        ++submitted;
+    }
+    
+    if ( submitted > 0 ) {
+        Job_Wake( submitted );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Job_Wait( job_counter_t * counter_ ) {
+    job_counter_local_t * counter = (job_counter_local_t *) counter_;
+    
+    /* Help out with the work while we wait. The lock must also be free, as it is held until the
+       thread that finished the last job is done with the counter */
+    while ( atomic_load( &counter->count ) != 0 || atomic_load( &counter->lock ) != 0 ) {
+        job_t * job = ( jobSys.init == true ) ? Job_GetNext( jobWorker ) : NULL;
+        if ( job != NULL ) {
+            Job_Execute( job );
+        }
+        else {
+            Sys_ThreadYield();
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+void Job_ParallelFor( uint32_t count, uint32_t grainSize, job_range_func_t func, void * arg, job_counter_t * counter ) {
+    job_counter_t localCounter;
+    uint32_t submitted = 0;
+    
+    if ( count == 0 ) {
+        return;
+    }
+    
+    if ( grainSize == 0 ) {
+        /* Aim for a few batches per worker so that stealing can balance the load */
+        grainSize = count / ( Job_GetWorkerCount() * 4 );
+        grainSize = ( grainSize < 1 ) ? 1 : grainSize;
+    }
+    
+    if ( counter == NULL ) {
+        Job_CounterInit( &localCounter );
+    }
+    
+    job_counter_t * rangeCounter = ( counter != NULL ) ? counter : &localCounter;
+    uint32_t batchCount = ( count + grainSize - 1 ) / grainSize;
+    atomic_fetch_add( &( (job_counter_local_t *) rangeCounter )->count, batchCount );
+    
+    for ( uint32_t start = 0; start < count; start += grainSize ) {
+        uint32_t end = ( count - start > grainSize ) ? start + grainSize : count;
+        
+        job_t * job = Job_Alloc( NULL, func, arg, start, end, rangeCounter );
+        if ( job == NULL ) {
+            Job_RunInline( NULL, func, arg, start, end, rangeCounter );
+            continue;
+        }
+        
+        Job_Submit( job );
+        ++submitted;
+    }
+    
+    if ( submitted > 0 ) {
+        Job_Wake( submitted );
+    }
+    
+    if ( counter == NULL ) {
+        Job_Wait( &localCounter );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Job_GetStats( job_stats_t * stats ) {
+    assert( stats != NULL );
+    memset( stats, 0, sizeof( job_stats_t ) );
+    
+    if ( jobSys.init == false ) {
+        return;
+    }
+    
+    for ( uint32_t i = 0; i < jobSys.workerCount; ++i ) {
+        stats->numRun += atomic_load_explicit( &jobSys.workers[ i ]->numRun, memory_order_relaxed );
+        stats->numStolen += atomic_load_explicit( &jobSys.workers[ i ]->numStolen, memory_order_relaxed );
+        stats->numInline += atomic_load_explicit( &jobSys.workers[ i ]->numInline, memory_order_relaxed );
+    }
+    
+    stats->numInline += atomic_load_explicit( &jobSys.numExternalInline, memory_order_relaxed );
+}
@@ -0,0 +1,70 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __JOB_H__
+#define __JOB_H__
+
+#include "core/Platform.h"
+
+/*
+    Job system with one worker per core. Each worker owns a work stealing deque, jobs pushed by a worker go on
+    its own deque and idle workers steal from the others. The thread that calls Job_Initialise is worker 0 and
+    only runs jobs while it waits on a counter.
+ 
+    Counters track groups of jobs, they are incremented when jobs are run and decremented as each job finishes.
+    A counter must not be reused until it has reached zero.
+*/
+
+#define JOB_MAX_WORKERS         32
+
+typedef void (*job_func_t)( void * arg );
+typedef void (*job_range_func_t)( void * arg, uint32_t start, uint32_t end );
+
+typedef struct job_decl_s {
+    job_func_t      func;
+    void *          arg;
+} job_decl_t;
+
+typedef struct job_counter_s {
+    uint64_t        data[2];
+} job_counter_t;
+
+typedef struct job_stats_s {
+    uint64_t        numRun;             /* Jobs executed */
+    uint64_t        numStolen;          /* Jobs taken from another worker's deque */
+    uint64_t        numInline;          /* Jobs run on the calling thread because the pool or deque was full */
+} job_stats_t;
+
+XE_API void     Job_Initialise( uint32_t workerCount );
+XE_API void     Job_Finalise(void);
+XE_API uint32_t Job_GetWorkerCount(void);
+XE_API uint32_t Job_GetWorkerIndex(void);
+
+XE_API void     Job_CounterInit( job_counter_t * counter );
+XE_API uint32_t Job_CounterGet( const job_counter_t * counter );
+
+XE_API void     Job_Run( const job_decl_t * jobs, uint32_t count, job_counter_t * counter );
+XE_API void     Job_RunAfter( const job_decl_t * jobs, uint32_t count, job_counter_t * counter, job_counter_t * dependency );
+XE_API void     Job_Wait( job_counter_t * counter );
+XE_API void     Job_ParallelFor( uint32_t count, uint32_t grainSize, job_range_func_t func, void * arg, job_counter_t * counter );
+
+XE_API void     Job_GetStats( job_stats_t * stats );
+
+#endif
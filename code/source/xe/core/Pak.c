@@ -0,0 +1,159 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "core/Pak.h"
+#include "core/PakStream.h"
+#include "core/Bsearch.h"
+#include "core/Sys.h"
+#include "mem/Mem.h"
+#include "stb_image.h"
+#include <string.h>
+#include <assert.h>
+
+typedef struct pak_mount_s {
+    file_t                  file;
+    uint32_t                entryCount;
+    uint64_t *              hashes;
+    pak_stream_entry_t *    entries;
+} pak_mount_t;
+
+typedef struct pak_mgr_s {
+    pak_mount_t             mounts[ PAK_MAX_MOUNTS ];
+    uint32_t                mountCount;
+} pak_mgr_t;
+
+static pak_mgr_t pak;
+
+/*=======================================================================================================================================*/
+static bool_t Pak_ReadAt( file_t * file, void * buffer, uint64_t offset, size_t size ) {
+    FS_FileSeek( file, (uintptr_t) offset );
+    return ( FS_FileRead( file, buffer, 1, size ) == size ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+bool_t Pak_Mount( const char * path ) {
+    xerror( pak.mountCount >= PAK_MAX_MOUNTS, "Maximum number of mounted packs reached\n" );
+    
+    pak_mount_t * mount = &pak.mounts[ pak.mountCount ];
+    memset( mount, 0, sizeof( pak_mount_t ) );
+    
+    if ( FS_FileOpen( &mount->file, path, "rb" ) == false ) {
+        return false;
+    }
+    
+    pak_stream_t header;
+    bool_t readOk = Pak_ReadAt( &mount->file, &header, 0, sizeof( header ) );
+    
+    if ( readOk == false || header.magic != PAKSTREAM_MAGIC || header.version != PAKSTREAM_VERSION ) {
+        xprintf( "'%s' is not a version %u pack\n", path, PAKSTREAM_VERSION );
+        FS_FileClose( &mount->file );
+        return false;
+    }
+    
+    mount->entryCount = header.entryCount;
+    
+    if ( header.entryCount > 0 ) {
+        mount->hashes = (uint64_t *) Mem_Alloc( sizeof( uint64_t ) * header.entryCount );
+        mount->entries = (pak_stream_entry_t *) Mem_Alloc( sizeof( pak_stream_entry_t ) * header.entryCount );
+        
+        readOk = Pak_ReadAt( &mount->file, mount->hashes, header.offsHashes, sizeof( uint64_t ) * header.entryCount );
+        readOk = readOk && Pak_ReadAt( &mount->file, mount->entries, header.offsEntries, sizeof( pak_stream_entry_t ) * header.entryCount );
+        
+        if ( readOk == false ) {
+            xprintf( "Could not read the table of contents of pack '%s'\n", path );
+            Mem_Free( mount->hashes );
+            Mem_Free( mount->entries );
+            FS_FileClose( &mount->file );
+            return false;
+        }
+    }
+    
+    ++pak.mountCount;
+    
+    xprintf( "Mounted pack %s with %u files\n", path, header.entryCount );
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+void Pak_UnmountAll( void ) {
+    for ( uint32_t p = 0; p < pak.mountCount; ++p ) {
+        pak_mount_t * mount = &pak.mounts[ p ];
+        
+        if ( mount->entryCount > 0 ) {
+            Mem_Free( mount->hashes );
+            Mem_Free( mount->entries );
+        }
+        FS_FileClose( &mount->file );
+    }
+    
+    pak.mountCount = 0;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Pak_GetMountCount( void ) {
+    return pak.mountCount;
+}
+
+/*=======================================================================================================================================*/
+bool_t Pak_Find( const char * path, pak_file_t * fileOut ) {
+    assert( path != NULL );
+    
+    if ( pak.mountCount == 0 ) {
+        return false;
+    }
+    
+    uint64_t hash = PakStream_CalcPathHash( path );
+    
+    /* Packs mounted later override the earlier ones */
+    for ( uint32_t p = pak.mountCount; p-- > 0; ) {
+        pak_mount_t * mount = &pak.mounts[ p ];
+        int32_t index = 0;
+        
+        if ( mount->entryCount == 0 || Bsearch_FindUint64( &index, hash, mount->hashes, mount->entryCount ) == false ) {
+            continue;
+        }
+        
+        const pak_stream_entry_t * entry = &mount->entries[ index ];
+        
+        if ( ( entry->flags & ~PAKSTREAM_F_ZLIB ) != 0 ) {
+            xprintf( "Pack entry for '%s' has unknown flags 0x%x\n", path, entry->flags );
+            return false;
+        }
+        
+        if ( fileOut != NULL ) {
+            fileOut->pak = &mount->file;
+            fileOut->offset = entry->offset;
+            fileOut->size = entry->size;
+            fileOut->compressedSize = entry->compressedSize;
+            fileOut->flags = entry->flags;
+        }
+        
+        return true;
+    }
+    
+    return false;
+}
+
+/*=======================================================================================================================================*/
+bool_t Pak_Inflate( void * dest, size_t destSize, const void * src, size_t srcSize ) {
+    int amtInflated = stbi_zlib_decode_buffer( (char *) dest, (int) destSize, (const char *) src, (int) srcSize );
+    return ( amtInflated >= 0 && (size_t) amtInflated == destSize ) ? true : false;
+}
@@ -0,0 +1,47 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __PAK_H__
+#define __PAK_H__
+
+#include "core/Platform.h"
+#include "core/Fs.h"
+
+#define PAK_MAX_MOUNTS 8
+
+/* Where a file lives inside a mounted pack */
+typedef struct pak_file_s {
+    file_t *        pak;                /* The open pack, shared by every file opened from it */
+    uint64_t        offset;
+    uint64_t        size;
+    uint64_t        compressedSize;
+    uint32_t        flags;
+} pak_file_t;
+
+/* Packs are mounted and unmounted from the main thread while no files are open from them, lookups
+   are read only and can be made from any thread. FS_FileOpen looks up '~' paths opened for reading
+   in the mounted packs before the data folder, the most recently mounted pack first */
+XE_API bool_t   Pak_Mount( const char * path );
+XE_API void     Pak_UnmountAll( void );
+XE_API uint32_t Pak_GetMountCount( void );
+XE_API bool_t   Pak_Find( const char * path, pak_file_t * fileOut );
+XE_API bool_t   Pak_Inflate( void * dest, size_t destSize, const void * src, size_t srcSize );
+
+#endif
@@ -0,0 +1,49 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "core/PakStream.h"
+#include "core/fh64.h"
+
+/*=======================================================================================================================================*/
+uint64_t PakStream_CalcPathHash( const char * path ) {
+    char normalised[ PAKSTREAM_MAX_PATH ];
+    size_t len = 0;
+    
+    if ( path[ 0 ] == '~' ) {
+        ++path;
+    }
+    
+    while ( *path == '/' || *path == '\\' ) {
+        ++path;
+    }
+    
+    for ( ; *path != 0 && len < PAKSTREAM_MAX_PATH; ++path ) {
+        char c = *path;
+        if ( c >= 'A' && c <= 'Z' ) {
+            c = 'a' + c - 'A';
+        }
+        else if ( c == '\\' ) {
+            c = '/';
+        }
+        normalised[ len++ ] = c;
+    }
+    
+    return FH64_Calc( (const uint8_t *) normalised, len );
+}
@@ -0,0 +1,58 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __PAKSTREAM_H__
+#define __PAKSTREAM_H__
+
+#include "core/Platform.h"
+
+#define PAKSTREAM_MAGIC 0x4B415058                  /* 'XPAK' */
+#define PAKSTREAM_VERSION 2                         /* 2 - path hashes are the full 64 bits */
+#define PAKSTREAM_ALIGN 16                          /* Payloads start on this alignment */
+#define PAKSTREAM_MAX_PATH 1024
+
+#define PAKSTREAM_F_ZLIB 0x00000001                 /* Payload is zlib compressed, size is the inflated size */
+
+/* A pack is the header, the sorted path hashes, the entries in the same order as the hashes, the entry
+   names, then the payloads. Payloads are written in path order so files from the same folder sit together */
+typedef struct pak_stream_s {
+    uint32_t        magic;
+    uint32_t        version;
+    uint32_t        entryCount;
+    uint32_t        align;
+    uint64_t        offsHashes;
+    uint64_t        offsEntries;
+    uint64_t        offsNames;
+    uint64_t        offsData;
+} pak_stream_t;
+
+typedef struct pak_stream_entry_s {
+    uint64_t        offset;                         /* From the start of the pack */
+    uint64_t        size;
+    uint64_t        compressedSize;                 /* Bytes stored in the pack, same as size when not compressed */
+    uint32_t        flags;
+    uint32_t        offsName;                       /* From offsNames, for tools and debugging */
+} pak_stream_entry_t;
+
+/* Hash of a path relative to the data folder, case and separators don't matter and a leading '~' is skipped
+   so "~/textures/Grass.png" and "textures\grass.png" are the same file */
+XE_API uint64_t PakStream_CalcPathHash( const char * path );
+
+#endif
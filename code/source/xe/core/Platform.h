@@ -25,6 +25,8 @@
 #   include "core/Platform_win.h"
 #elif defined( __APPLE__ )
 #   include "core/Platform_apple.h"
+#elif defined( __linux__ ) || defined( __unix__ )
+#   include "core/Platform_posix.h"
 #else
 #   error Unsupported platform
 #endif
@@ -31,5 +31,6 @@
 
 #define XE_APPLE 1
 #define XE_ENDLIAN_LITTLE 1
+#define XE_THREAD_LOCAL __thread
 
 #endif
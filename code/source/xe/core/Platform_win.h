@@ -27,5 +27,6 @@
 
 #define XE_WIN 1
 #define XE_ENDLIAN_LITTLE 1
+#define XE_THREAD_LOCAL __declspec( thread )
 
 #endif
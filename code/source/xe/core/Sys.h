@@ -27,6 +27,16 @@ typedef struct sys_mutex_s {
     uint64_t data[8];
 } sys_mutex_t;
 
+typedef struct sys_cond_s {
+    uint64_t data[8];
+} sys_cond_t;
+
+typedef struct sys_thread_s {
+    uint64_t data[4];
+} sys_thread_t;
+
+typedef void (*sys_thread_func_t)( void * arg );
+
 #define Sys_Align(V, A) ((V )% (A) == 0 ) ? (V) : (V) + ((A) - ((V) % (A)))
 
 typedef void (*sys_print_listener_t)( const char * buff, void * context );
@@ -34,6 +44,9 @@ typedef void (*sys_print_listener_t)( const char * buff, void * context );
 XE_API void Sys_Initialise(void);
 XE_API void Sys_Finalise(void);
 XE_API uint64_t Sys_GetTicks(void);
+XE_API uint64_t Sys_GetTicksNs(void);
+XE_API void Sys_Sleep( uint32_t ms );
+XE_API uint32_t Sys_GetCpuCount(void);
 
 XE_API void Sys_Printf( const char * fmt, ... );
 XE_API void Sys_AssertPrintf( const char * file, int line, const char * fmt, ... );
@@ -44,9 +57,19 @@ XE_API void Sys_Exit( int code );
 XE_API void Sys_MutexCreate( sys_mutex_t * self_ );
 XE_API void Sys_MutexDestroy( sys_mutex_t * self_ );
 XE_API void Sys_MutexLock( sys_mutex_t * self_ );
-XE_API void Sys_MutexTryLock( sys_mutex_t * self_ );
+XE_API bool_t Sys_MutexTryLock( sys_mutex_t * self_ );
 XE_API void Sys_MutexUnlock( sys_mutex_t * self_ );
 
+XE_API void Sys_CondCreate( sys_cond_t * self_ );
+XE_API void Sys_CondDestroy( sys_cond_t * self_ );
+XE_API void Sys_CondWait( sys_cond_t * self_, sys_mutex_t * mutex );
+XE_API void Sys_CondSignal( sys_cond_t * self_ );
+XE_API void Sys_CondBroadcast( sys_cond_t * self_ );
+
+XE_API bool_t Sys_ThreadCreate( sys_thread_t * self_, sys_thread_func_t func, void * arg );
+XE_API void Sys_ThreadJoin( sys_thread_t * self_ );
+XE_API void Sys_ThreadYield(void);
+
 #if defined( DEBUG ) || defined( _DEBUG ) || defined( XENGINE_TOOLS )
 #   define xassert(C) (void)((C) || ( Sys_AssertPrintf( __FILE__, __LINE__, #C), Sys_Breakpoint(), 0))
 #   define xassertmsg(C, ...) (void)((C) || ( Sys_AssertPrintf( __FILE__, __LINE__, __VA_ARGS__ ), Sys_Breakpoint(), 0))
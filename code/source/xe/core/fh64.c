@@ -23,7 +23,7 @@
 #include <string.h>
 
 uint32_t farmhash32(const char *s, size_t len);
-uint32_t farmhash64(const char *s, size_t len);
+uint64_t farmhash64(const char *s, size_t len);
 
 /*=======================================================================================================================================*/
 uint64_t FH64_Calc( const uint8_t * buffer, size_t bufferLen ) {
@@ -20,47 +20,252 @@
 
 #include "ecs/Ecs.h"
 #include "ecs/EcsComponentArray.h"
+#include "ecs/EcsArchetype.h"
+#include "ecs/EcsMessage.h"
+#include "ecs/EcsTopic.h"
+#include "ecs/EcsProfile.h"
 #include "core/Sys.h"
 #include "core/Array.h"
 #include "core/Bsearch.h"
 #include "core/fh64.h"
+#include "core/HashMap.h"
+#include "core/Job.h"
+#include "mem/Mem.h"
+#include "mem/FrameHeap.h"
+#include "core/Atomic.h"
 
 #include <string.h>
-#include <stdatomic.h>
 
 typedef struct ecs_entity_info_s {
-    uint32_t        componentList[ ECS_MAX_COMPONENT_TYPES ];       /* Index of the component arrays that the entity was added to */
-    uint8_t         messageBuffer[ ECS_MESSAGE_DATA_SIZE ];         /* Messages sent to this entity */
+    ecs_component_mask_t componentMask;                             /* Bit for each component that the entity has */
     uint32_t        componentCount;                                 /* Number of components that the entity has */
-    atomic_uint     messagePtr;                                     /* Pointer into the message buffer of the current buffer end */
-    atomic_uint     messageCommitPtr;                               /* Used to ensure that we only process messesg once they've been commited */
+    uint32_t        generation;                                     /* Bumped when the entity is freed, must match the handle */
+    bool_t          alive;
+    ecs_msg_queue_t messages;                                       /* Messages sent to this entity */
+    atomic_uint     messageDirty;                                   /* Set while the entity is on the dirty list */
+    ecs_archetype_t * archetype;                                    /* Archetype holding the archetype stored components, or NULL */
+    ecs_chunk_t *   chunk;
+    uint32_t        row;
 } ecs_entity_info_t;
 
+/* Messages sent while systems run in parallel are staged and then committed in a fixed order */
+typedef struct ecs_stage_block_s {
+    struct ecs_stage_block_s *  next;
+    uint32_t                    used;
+    uint32_t                    pad;
+    uint8_t                     data[];
+} ecs_stage_block_t;
+
+typedef struct ecs_stage_s {
+    ecs_stage_block_t *         head;
+    ecs_stage_block_t *         tail;
+    uint32_t                    count;              /* Number of records */
+    uint32_t                    pad;
+} ecs_stage_t;
+
+typedef struct ecs_stage_msg_s {
+    ecs_entity_t                ent;
+    uint32_t                    size;
+    uint16_t                    msgId;
+    uint16_t                    topic;              /* ECS_STAGE_NO_TOPIC for a message sent to the entity */
+} ecs_stage_msg_t;
+
+#define ECS_STAGE_NO_TOPIC 0xFFFF
+
+/* Structural changes made by systems are recorded and played back once the systems have finished */
+typedef enum ecs_command_kind_e {
+    ECS_COMMAND_SPAWN = 0,
+    ECS_COMMAND_ADD,
+    ECS_COMMAND_REMOVE,
+    ECS_COMMAND_FREE,
+} ecs_command_kind_t;
+
+typedef struct ecs_command_s {
+    ecs_entity_t                ent;                /* Entity, or the pending handle of a spawned entity */
+    ecs_component_id_t          component;
+    uint16_t                    kind;
+    uint16_t                    pad;
+    uint32_t                    size;               /* Size of the data that follows, the component for an add or the blueprint pointer for a spawn */
+} ecs_command_t;
+
+/* Entities spawned by a system don't exist until playback, they get a pending handle with generation 0 that
+   only the deferred functions understand */
+#define ECS_ENTITY_IS_PENDING( __ent__ ) ( (__ent__) != ECS_ENTITY_NULL && ECS_ENTITY_GENERATION( __ent__ ) == 0 )
+
+/* Snapshots are a header and then sections that each start on 16 bytes */
+#define ECS_SNAPSHOT_MAGIC      0x50534345              /* 'ECSP' */
+#define ECS_SNAPSHOT_VERSION    1
+
+typedef struct ecs_snapshot_header_s {
+    uint32_t                    magic;
+    uint32_t                    version;
+    uint64_t                    size;
+    uint32_t                    componentCount;
+    uint32_t                    archetypeCount;     /* Archetypes with entities */
+    uint32_t                    entityIndexCount;
+    uint32_t                    entityFreeCount;
+    uint32_t                    messageEntityCount; /* Entities with messages that haven't been seen */
+    uint32_t                    pad[ 3 ];
+} ecs_snapshot_header_t;
+
+typedef struct ecs_snapshot_component_s {
+    uint64_t                    nameHash;
+    uint32_t                    size;
+    uint32_t                    storage;
+    uint64_t                    count;              /* Number of components in the array */
+    uint64_t                    pad;
+} ecs_snapshot_component_t;
+
+typedef struct ecs_snapshot_entity_s {
+    ecs_component_mask_t        componentMask;
+    uint32_t                    componentCount;
+    uint32_t                    generation;
+    uint32_t                    alive;
+    uint32_t                    pad;
+} ecs_snapshot_entity_t;
+
+typedef struct ecs_snapshot_messages_s {
+    uint32_t                    index;              /* Entity index, followed by the messages each aligned to 8 bytes */
+    uint32_t                    count;
+} ecs_snapshot_messages_t;
+
+/* Taken from the general heap when a run needs more than the schedule heap has, the data follows the header */
+typedef struct ecs_schedule_overflow_s {
+    struct ecs_schedule_overflow_s *    next;
+    uint64_t                            pad;
+} ecs_schedule_overflow_t;
+
+/* A range of a component array or an archetype chunk that one system thinks over, run as a single job */
+typedef struct ecs_system_chunk_s {
+    ecs_stage_t                 stage;
+    ecs_stage_t                 commands;
+    ecs_think_params_t *        params;
+    ecs_chunk_t *               archetypeChunk;     /* NULL to think over every archetype with the component */
+    int32_t                     systemIndex;
+    uint32_t                    start;
+    uint32_t                    end;
+    uint32_t                    pad;
+#ifdef ECS_PROFILE
+    ecs_profile_job_t           profile;
+#endif
+} ecs_system_chunk_t;
+
 typedef struct ecs_s {
-    /* Entity management */
-    ecs_entity_t            entityFreeList[ ECS_MAX_ENTITIES ];
-    size_t                  entityFreeCount;
-    ecs_entity_info_t       entityInfo[ ECS_MAX_ENTITIES ];
+    /* Entity management, the info is allocated in pages so it only takes up memory for the entities that have been used */
+    uint32_t *              entityFreeList;                 /* Indices of freed entities */
+    uint32_t                entityFreeCount;
+    uint32_t                entityFreeListSize;
+    ecs_entity_info_t **    entityPages;
+    uint32_t                entityPageCount;
+    uint32_t                entityPageArraySize;
+    uint32_t                entityIndexCount;               /* Number of entity indices handed out, live or free */
     
     ecs_system_t *          systems[ ECS_MAX_SYSTEMS ];
     ecs_component_index_t   systemComponent[ ECS_MAX_SYSTEMS ];
+    ecs_component_mask_t    systemReads[ ECS_MAX_SYSTEMS ];
+    ecs_component_mask_t    systemWrites[ ECS_MAX_SYSTEMS ];
+    uint32_t                systemFlags[ ECS_MAX_SYSTEMS ];
+    uint64_t                systemPublishes[ ECS_MAX_SYSTEMS ];     /* Bit per topic */
+    uint64_t                systemSubscribes[ ECS_MAX_SYSTEMS ];
     size_t                  systemCount;
     
     ecs_component_array_t   components[ ECS_MAX_COMPONENT_TYPES ];
     ecs_system_t *          componentSystems[ ECS_MAX_COMPONENT_TYPES ];
-    const char *            componentNames[ ECS_MAX_COMPONENT_TYPES ];
-    uint32_t                componentNameMap[ ECS_MAX_COMPONENT_TYPES ];
-    uint64_t                componentNameHashes[ ECS_MAX_COMPONENT_TYPES ];
-    uint32_t                componentNameHashMap[ ECS_MAX_COMPONENT_TYPES ];
+    ecs_storage_t           componentStorage[ ECS_MAX_COMPONENT_TYPES ];
+    size_t                  componentSizes[ ECS_MAX_COMPONENT_TYPES ];
+    const char *            componentTypeNames[ ECS_MAX_COMPONENT_TYPES ];  /* Name of each component, by index */
+    hash_map_t              componentNameHashMap;                           /* Hash of the name to component index */
     size_t                  componentCount;
     
-    uint8_t                 messageBufferTemp[ ECS_MESSAGE_DATA_SIZE ];
+    ecs_archetype_t *       archetypes[ ECS_MAX_ARCHETYPES ];
+    ecs_component_mask_t    archetypeMasks[ ECS_MAX_ARCHETYPES ];
+    uint32_t                archetypeCount;
     
+    /* Entities that have had messages since the end of the last frame */
+    uint32_t *              messageDirtyList;
+    uint32_t                messageDirtyCount;
+    uint32_t                messageDirtySize;
+    sys_mutex_t             messageDirtyMutex;
     
+    ecs_topic_t             topics[ ECS_MAX_TOPICS ];
+    sys_mutex_t             topicMutex;
+    
+    void *                  scheduleMem;
+    frame_heap_t *          scheduleHeap;
+    atomic_uintptr_t        scheduleOverflow;               /* ecs_schedule_overflow_t blocks of this run, freed on reset */
+    atomic_uint             scheduleOverflowCount;          /* Blocks ever taken, only the first is logged */
+    atomic_uint             pendingCount;                   /* Pending handles given out since the last playback */
 } ecs_t;
 
 static ecs_t ecs;
 static bool_t ecsInit = false;
+static XE_THREAD_LOCAL ecs_stage_t * ecsStage = NULL;
+static XE_THREAD_LOCAL ecs_stage_t * ecsCommandStage = NULL;         /* Set while a system thinks */
+
+#ifdef ECS_PROFILE
+static XE_THREAD_LOCAL ecs_profile_job_t * ecsProfileJob = NULL;     /* Counters of the system thinking on this thread */
+#   define ECS_PROFILE_COUNT( __field__, __count__ ) do { if ( ecsProfileJob != NULL ) { ecsProfileJob->__field__ += (__count__); } } while ( 0 )
+#else
+#   define ECS_PROFILE_COUNT( __field__, __count__ )
+#endif
+
+static void Ecs_SendMessageDirect( ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize );
+static void Ecs_PublishDirect( uint16_t topic, ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize );
+static void Ecs_PlayCommands( ecs_stage_t * stages, size_t stageStride, uint32_t stageCount );
+static void Ecs_CommitStage( ecs_stage_t * stage );
+
+/*=======================================================================================================================================*/
+static inline bool_t Ecs_MaskHasComponent( const ecs_component_mask_t * mask, uint32_t componentIndex ) {
+    return ( mask->bits[ componentIndex / 64 ] & ( 1ull << ( componentIndex % 64 ) ) ) != 0 ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static inline ecs_entity_info_t * Ecs_GetEntityInfoByIndex( uint32_t index ) {
+    return &ecs.entityPages[ index / ECS_ENTITY_PAGE_SIZE ][ index % ECS_ENTITY_PAGE_SIZE ];
+}
+
+/*=======================================================================================================================================*/
+static inline ecs_entity_info_t * Ecs_GetEntityInfo( ecs_entity_t ent ) {
+    xassertmsg( Ecs_EntityIsValid( ent ) == true, "ECS : Stale or invalid entity handle %llx\n", (unsigned long long) ent );
+    return Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( ent ) );
+}
+
+/*=======================================================================================================================================*/
+static void * Ecs_ScheduleAlloc( size_t size ) {
+    void * mem = FrameHeap_TryAlloc( ecs.scheduleHeap, size );
+    if ( mem != NULL ) {
+        return mem;
+    }
+    
+    /* A big run carries on from the general heap rather than fail, the blocks are pushed by whichever job needs one */
+    ecs_schedule_overflow_t * block = (ecs_schedule_overflow_t *) Mem_Alloc( sizeof( ecs_schedule_overflow_t ) + size );
+    xerror( block == NULL, "ECS : Out of memory allocating %zu bytes of schedule data\n", size );
+    
+    if ( atomic_fetch_add( &ecs.scheduleOverflowCount, 1 ) == 0 ) {
+        xprintf( "ECS : The %u byte schedule heap is full, the run carries on from the general heap. Further overflows are not logged\n",
+                 (uint32_t) ECS_SCHEDULE_MEM_SIZE );
+    }
+    
+    uintptr_t head = atomic_load_explicit( &ecs.scheduleOverflow, memory_order_relaxed );
+    do {
+        block->next = (ecs_schedule_overflow_t *) head;
+    } while ( atomic_compare_exchange_weak( &ecs.scheduleOverflow, &head, (uintptr_t) block ) == false );
+    
+    return block + 1;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_ScheduleReset( void ) {
+    ecs_schedule_overflow_t * block = (ecs_schedule_overflow_t *) atomic_exchange( &ecs.scheduleOverflow, 0 );
+    
+    while ( block != NULL ) {
+        ecs_schedule_overflow_t * next = block->next;
+        Mem_Free( block );
+        block = next;
+    }
+    
+    FrameHeap_Reset( ecs.scheduleHeap );
+}
 
 /*=======================================================================================================================================*/
 void Ecs_Initialise(void) {
@@ -73,196 +278,498 @@ void Ecs_Initialise(void) {
     memset( &ecs, 0, sizeof( ecs ) );
     ecsInit = true;
     
-    /* Set up the list of free entity ids */
-    for ( int n = 0; n < ECS_MAX_ENTITIES; ++n ) {
-        ecs.entityFreeList[ n ] = ECS_MAX_ENTITIES - 1 - n;
-        ecs.entityInfo[ n ].componentCount = 0;
-        ecs.entityInfo[ n ].messagePtr = 0;
-        ecs.entityInfo[ n ].messageCommitPtr = 0;
-    }
-    
     for ( int n = 0; n < ECS_MAX_SYSTEMS; ++n ) {
         ecs.systems[ n ] = NULL;
         ecs.systemComponent[ n ] = ECS_COMPONENT_INVALID;
     }
 
     
-    ecs.entityFreeCount = ECS_MAX_ENTITIES;
+    EcsMessage_Initialise();
+    Sys_MutexCreate( &ecs.messageDirtyMutex );
+    
+    for ( int n = 0; n < ECS_MAX_TOPICS; ++n ) {
+        EcsTopic_Init( &ecs.topics[ n ] );
+    }
+    Sys_MutexCreate( &ecs.topicMutex );
+    
+    HashMap_Create( &ecs.componentNameHashMap, ECS_MAX_COMPONENT_TYPES, MEM_HEAP_ECS );
+    
+    ecs.scheduleMem = Mem_HeapAlloc( MEM_HEAP_ECS, ECS_SCHEDULE_MEM_SIZE );
+    ecs.scheduleHeap = FrameHeap_Create( (uintptr_t) ecs.scheduleMem, ECS_SCHEDULE_MEM_SIZE );
+    
+#ifdef ECS_PROFILE
+    EcsProfile_Initialise();
+#endif
 }
 
 /*=======================================================================================================================================*/
 void Ecs_Finalise(void) {
+    if ( ecsInit == false ) {
+        return;
+    }
+    
+    for ( uint32_t n = 0; n < ecs.archetypeCount; ++n ) {
+        EcsArchetype_Destroy( ecs.archetypes[ n ] );
+    }
+    ecs.archetypeCount = 0;
+    
+    for ( size_t n = 0; n < ecs.componentCount; ++n ) {
+        if ( ecs.componentStorage[ n ] != ECS_STORAGE_ARCHETYPE ) {
+            EcsComponentArray_Destroy( &ecs.components[ n ] );
+        }
+    }
+    ecs.componentCount = 0;
+    
+    for ( uint32_t n = 0; n < ecs.entityIndexCount; ++n ) {
+        EcsMessage_Clear( &Ecs_GetEntityInfoByIndex( n )->messages );
+    }
+    
+    for ( uint32_t n = 0; n < ecs.entityPageCount; ++n ) {
+        Mem_Free( ecs.entityPages[ n ] );
+    }
+    
+    if ( ecs.entityPages != NULL ) {
+        Mem_Free( ecs.entityPages );
+    }
+    
+    if ( ecs.entityFreeList != NULL ) {
+        Mem_Free( ecs.entityFreeList );
+    }
     
+    if ( ecs.messageDirtyList != NULL ) {
+        Mem_Free( ecs.messageDirtyList );
+    }
+    
+    Sys_MutexDestroy( &ecs.messageDirtyMutex );
+    EcsMessage_Finalise();
+    
+    for ( int n = 0; n < ECS_MAX_TOPICS; ++n ) {
+        EcsTopic_Destroy( &ecs.topics[ n ] );
+    }
+    Sys_MutexDestroy( &ecs.topicMutex );
+    
+    Ecs_ScheduleReset();
+    Mem_Free( ecs.scheduleMem );
+    ecs.scheduleMem = NULL;
+    ecs.scheduleHeap = NULL;
+    
+    HashMap_Destroy( &ecs.componentNameHashMap );
+    
+#ifdef ECS_PROFILE
+    EcsProfile_Finalise();
+#endif
+    
+    ecsInit = false;
 }
 
 /*=======================================================================================================================================*/
 XE_API void Ecs_EndFrame(void) {
-    uint32_t msgPtr = 0;
-    uint32_t msgDstPtr = 0;
-    ecs_msg_t * msg;
+    uint32_t keepCount = 0;
+    ecs_msg_block_t * freeBlocks = NULL;
+    
+#ifdef ECS_PROFILE
+    uint64_t profileStart = Sys_GetTicksNs();
+#endif
     
-    for ( uint32_t n = 0; n < ECS_MAX_ENTITIES; ++n ) {
-        ecs_entity_info_t * info = &ecs.entityInfo[ n ];
+    /* Only the entities that got messages need looking at. Systems are passed every committed message in order,
+       so the messages that have been seen are always at the front of the queue and are dropped. Anything after
+       that is still pending and the entity stays on the list for the next frame.
+     */
+    for ( uint32_t n = 0; n < ecs.messageDirtyCount; ++n ) {
+        uint32_t index = ecs.messageDirtyList[ n ];
+        ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( index );
         
-        if ( info->messagePtr != 0 ) {
-            /* This entity has messages. But are any pending (the seen flag is 0) ?*/
-            msgPtr = 0;
-            msgDstPtr = 0;
-            
-            /* Go through the message data and copy any messages that have not been seen
-               by the system used by the entity
-            */
-            while ( msgPtr < info->messagePtr ) {
-                msg = (ecs_msg_t*) &info->messageBuffer[ msgPtr ];
-                if ( msg->seen == 0 ) {
-                    memcpy( ecs.messageBufferTemp+msgDstPtr, msg, msg->size );
-                    msgDstPtr += msg->size;
-                }
-                msgPtr += msg->size;
-            }
-            
-            if ( msgDstPtr != 0 ) {
-                /* If we caught any messages that were not seen by the entity
-                   copy over the buffer
-                   Note: msgDstPtr gives us the size of the message data to copy
-                 */
-                memcpy( info->messageBuffer, ecs.messageBufferTemp, msgDstPtr );
-            }
-            
-            /* Set the new end pointer for the entity message buffer. This will
-               be zero if the entity does not have any messages pending.
-             */
-            info->messagePtr = msgDstPtr;
-            info->messageCommitPtr = msgDstPtr;
+        if ( EcsMessage_Retire( &info->messages, &freeBlocks ) == true ) {
+            ecs.messageDirtyList[ keepCount++ ] = index;
+        }
+        else {
+            atomic_store_explicit( &info->messageDirty, 0, memory_order_relaxed );
         }
     }
+    
+    ecs.messageDirtyCount = keepCount;
+    EcsMessage_FreeBlocks( freeBlocks );
+    
+    /* Topics only last for the frame */
+    for ( int n = 0; n < ECS_MAX_TOPICS; ++n ) {
+        EcsTopic_Reset( &ecs.topics[ n ] );
+    }
+    
+#ifdef ECS_PROFILE
+    EcsProfile_AddPhase( ECS_PROFILE_PHASE_END_FRAME, profileStart );
+    EcsProfile_EndFrame();
+#endif
+}
+
+/*=======================================================================================================================================*/
+ecs_component_id_t Ecs_RegisterNamedComponent( const char * name, size_t capacity, size_t structSize ) {
+    return Ecs_RegisterNamedComponentStorage( name, capacity, structSize, ECS_STORAGE_ARRAY );
 }
 
 /*=======================================================================================================================================*/
-void Ecs_RegisterNamedComponent( const char * name, size_t capacity, size_t structSize ) {
+ecs_component_id_t Ecs_RegisterNamedComponentStorage( const char * name, size_t capacity, size_t structSize, ecs_storage_t storage ) {
     xassert( ecs.componentCount < ECS_MAX_COMPONENT_TYPES );
     
     uint32_t componentIndex = ( uint32_t ) ecs.componentCount;
-    int32_t insertIndex = -1;
-    bool_t found;
-    uint64_t nameHash;
-    
-    /* Insert the name pointer into a sorted look-up map  */
-    found = Bsearch_FindVoidPtr( &insertIndex, (void*) name, (const void**) ecs.componentNames, ecs.componentCount );
-    xassert( found == false );
-
-    Array_InsertAtPosVoidPtr( insertIndex, (void *)name, (void**) ecs.componentNames, ecs.componentCount, ECS_MAX_COMPONENT_TYPES );
-    Array_InsertAtPosUint32( insertIndex, componentIndex, ecs.componentNameMap, ecs.componentCount, ECS_MAX_COMPONENT_TYPES );
     
-    /* Insert the hash of the name into a sorted look-up map */
-    nameHash = FH64_CalcFromCStr( name );
+    /* Components are found by the hash of their name, the same name can live at a different address in each module */
+    bool_t added = HashMap_Insert( &ecs.componentNameHashMap, FH64_CalcFromCStr( name ), componentIndex );
+    xassert( added == true );
     
-    found = Bsearch_FindUint64( &insertIndex, nameHash, ecs.componentNameHashes, ecs.componentCount );
-    xassert( found == false );
+    ecs.componentStorage[ componentIndex ] = storage;
+    ecs.componentSizes[ componentIndex ] = structSize;
+    ecs.componentTypeNames[ componentIndex ] = name;
+    ++ecs.componentCount;
     
-    Array_InsertAtPosUint64( insertIndex, nameHash, ecs.componentNameHashes, ecs.componentCount, ECS_MAX_COMPONENT_TYPES );
-    Array_InsertAtPosUint32( insertIndex, componentIndex, ecs.componentNameHashMap, ecs.componentCount, ECS_MAX_COMPONENT_TYPES );
+    /* Archetype components live in the chunks of the archetypes, which are created as entities need them */
+    if ( storage == ECS_STORAGE_ARCHETYPE ) {
+        xprintf( "ECS : Registered archetype component '%s'\n", name );
+        return (ecs_component_id_t) componentIndex;
+    }
     
     /* Create the component array */
     EcsComponentArray_Create( &ecs.components[ componentIndex ], capacity, structSize, name );
-    ++ecs.componentCount;
     
     xprintf( "ECS : Registered component array '%s'\n", name );
+    return (ecs_component_id_t) componentIndex;
 }
 
 /*=======================================================================================================================================*/
-ecs_entity_t Ecs_EntityAlloc(void) {
-    xassert( ecs.entityFreeCount > 0 );
+static void Ecs_AddEntityPage(void) {
+    if ( ecs.entityPageCount == ecs.entityPageArraySize ) {
+        uint32_t newSize = ( ecs.entityPageArraySize == 0 ) ? 16 : ecs.entityPageArraySize * 2;
+        ecs_entity_info_t ** pages = (ecs_entity_info_t **) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( ecs_entity_info_t * ) * newSize );
+        
+        if ( ecs.entityPages != NULL ) {
+            memcpy( pages, ecs.entityPages, sizeof( ecs_entity_info_t * ) * ecs.entityPageCount );
+            Mem_Free( ecs.entityPages );
+        }
+        
+        ecs.entityPages = pages;
+        ecs.entityPageArraySize = newSize;
+    }
+    
+    /* Pages never move once allocated, so entity info pointers stay good as the entity count grows */
+    ecs_entity_info_t * page = (ecs_entity_info_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( ecs_entity_info_t ) * ECS_ENTITY_PAGE_SIZE );
+    for ( uint32_t n = 0; n < ECS_ENTITY_PAGE_SIZE; ++n ) {
+        page[ n ].componentCount = 0;
+        page[ n ].generation = 1;
+        page[ n ].alive = false;
+        EcsMessage_QueueInit( &page[ n ].messages );
+        atomic_init( &page[ n ].messageDirty, 0 );
+        page[ n ].archetype = NULL;
+    }
     
+    ecs.entityPages[ ecs.entityPageCount ] = page;
+    ++ecs.entityPageCount;
+}
+
+/*=======================================================================================================================================*/
+ecs_entity_t Ecs_EntityAlloc(void) {
     ecs_entity_info_t * entInfo = NULL;
+    uint32_t index;
+    
+    xassertmsg( ecsCommandStage == NULL, "ECS : Entities can't be changed while a system thinks, use the deferred functions\n" );
     
-    ecs_entity_t ent = ecs.entityFreeList[ ecs.entityFreeCount - 1 ];
-    --ecs.entityFreeCount;
+    /* Reuse a freed index before growing */
+    if ( ecs.entityFreeCount > 0 ) {
+        index = ecs.entityFreeList[ ecs.entityFreeCount - 1 ];
+        --ecs.entityFreeCount;
+    }
+    else {
+        xassertmsg( ecs.entityIndexCount < ECS_ENTITY_INDEX_MASK, "ECS : Out of entity indices\n" );
+        
+        index = ecs.entityIndexCount;
+        if ( index == ecs.entityPageCount * ECS_ENTITY_PAGE_SIZE ) {
+            Ecs_AddEntityPage();
+        }
+        ++ecs.entityIndexCount;
+    }
    
     /* Init the entity info */
-    entInfo = &ecs.entityInfo[ ent ];
+    entInfo = Ecs_GetEntityInfoByIndex( index );
     
+    entInfo->alive = true;
     entInfo->componentCount = 0;
-    entInfo->messagePtr = 0;
-    entInfo->messageCommitPtr = 0;
+    memset( &entInfo->componentMask, 0, sizeof( ecs_component_mask_t ) );
+    entInfo->archetype = NULL;
+    entInfo->chunk = NULL;
+    entInfo->row = 0;
     
-    return ent;
+    return ECS_ENTITY_MAKE( index, entInfo->generation );
 }
 
 /*=======================================================================================================================================*/
-void Ecs_EntityFree( ecs_entity_t ent ) {
-    xassert( ecs.entityFreeCount < ECS_MAX_ENTITIES );
+static void Ecs_ArchetypeRemoveEntity( ecs_entity_info_t * entInfo ) {
+    /* The last entity of the archetype gets moved into the row, so point it at its new home */
+    ecs_entity_t movedEnt = EcsArchetype_RemoveEntity( entInfo->archetype, entInfo->chunk, entInfo->row );
+    
+    if ( movedEnt != ECS_ENTITY_NULL ) {
+        ecs_entity_info_t * movedInfo = Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( movedEnt ) );
+        movedInfo->chunk = entInfo->chunk;
+        movedInfo->row = entInfo->row;
+    }
+}
+
+/*=======================================================================================================================================*/
+static uint32_t Ecs_FindArchetypeIndex( const ecs_component_mask_t * mask ) {
+    for ( uint32_t n = 0; n < ecs.archetypeCount; ++n ) {
+        if ( memcmp( &ecs.archetypeMasks[ n ], mask, sizeof( ecs_component_mask_t ) ) == 0 ) {
+            return n;
+        }
+    }
+    
+    /* First entity with this set of components */
+    xassertmsg( ecs.archetypeCount < ECS_MAX_ARCHETYPES, "ECS : Too many archetypes\n" );
+    
+    uint32_t components[ ECS_ARCHETYPE_MAX_COMPONENTS ];
+    size_t componentSizes[ ECS_ARCHETYPE_MAX_COMPONENTS ];
+    uint32_t count = 0;
+    
+    for ( uint32_t c = 0; c < ecs.componentCount; ++c ) {
+        if ( ( mask->bits[ c / 64 ] & ( 1ull << ( c % 64 ) ) ) != 0 ) {
+            xassertmsg( count < ECS_ARCHETYPE_MAX_COMPONENTS, "ECS : Too many components in an archetype\n" );
+            components[ count ] = c;
+            componentSizes[ count ] = ecs.componentSizes[ c ];
+            ++count;
+        }
+    }
+    
+    ecs_archetype_t * archetype = EcsArchetype_Create( mask, components, componentSizes, count );
+    ecs.archetypes[ ecs.archetypeCount ] = archetype;
+    ecs.archetypeMasks[ ecs.archetypeCount ] = *mask;
+    ++ecs.archetypeCount;
+    
+    return ecs.archetypeCount - 1;
+}
+
+/*=======================================================================================================================================*/
+static ecs_archetype_t * Ecs_FindArchetype( const ecs_component_mask_t * mask ) {
+    return ecs.archetypes[ Ecs_FindArchetypeIndex( mask ) ];
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_ArchetypeMoveEntity( ecs_entity_t ent, ecs_entity_info_t * entInfo, const ecs_component_mask_t * mask ) {
+    /* Move the entity over to the archetype with the new set of components, copying the components that both have */
+    ecs_archetype_t * archetype = Ecs_FindArchetype( mask );
+    ecs_chunk_t * chunk = NULL;
+    uint32_t row = EcsArchetype_AddEntity( archetype, ent, &chunk );
+    
+    if ( entInfo->archetype != NULL ) {
+        EcsArchetype_CopyEntity( chunk, row, entInfo->chunk, entInfo->row );
+        Ecs_ArchetypeRemoveEntity( entInfo );
+    }
+    
+    entInfo->archetype = archetype;
+    entInfo->chunk = chunk;
+    entInfo->row = row;
+}
+
+/*=======================================================================================================================================*/
+static void * Ecs_ArchetypeAddComponent( ecs_entity_t ent, ecs_entity_info_t * entInfo, uint32_t compIndex ) {
+    ecs_component_mask_t mask;
+    
+    if ( entInfo->archetype != NULL ) {
+        mask = *EcsArchetype_GetMask( entInfo->archetype );
+    }
+    else {
+        memset( &mask, 0, sizeof( mask ) );
+    }
+    
+    xassertmsg( ( mask.bits[ compIndex / 64 ] & ( 1ull << ( compIndex % 64 ) ) ) == 0, "ECS : Entity already has component '%s'\n", ecs.componentTypeNames[ compIndex ] );
+    mask.bits[ compIndex / 64 ] |= 1ull << ( compIndex % 64 );
+    
+    Ecs_ArchetypeMoveEntity( ent, entInfo, &mask );
+    
+    void * compData = EcsChunk_GetComponent( entInfo->chunk, entInfo->row, compIndex );
+    memset( compData, 0, ecs.componentSizes[ compIndex ] );
+    return compData;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_ArchetypeRemoveComponent( ecs_entity_t ent, ecs_entity_info_t * entInfo, uint32_t compIndex ) {
+    ecs_component_mask_t mask = *EcsArchetype_GetMask( entInfo->archetype );
+    mask.bits[ compIndex / 64 ] &= ~( 1ull << ( compIndex % 64 ) );
+    
+    for ( uint32_t w = 0; w < ECS_COMPONENT_MASK_WORDS; ++w ) {
+        if ( mask.bits[ w ] != 0 ) {
+            Ecs_ArchetypeMoveEntity( ent, entInfo, &mask );
+            return;
+        }
+    }
+    
+    /* That was the last archetype component */
+    Ecs_ArchetypeRemoveEntity( entInfo );
+    entInfo->archetype = NULL;
+    entInfo->chunk = NULL;
+    entInfo->row = 0;
+}
+
+/*=======================================================================================================================================*/
+static void * Ecs_GetComponentData( ecs_entity_t ent, uint32_t compIndex ) {
+    if ( ecs.componentStorage[ compIndex ] == ECS_STORAGE_ARCHETYPE ) {
+        ecs_entity_info_t * entInfo = Ecs_GetEntityInfo( ent );
+        return ( entInfo->archetype != NULL ) ? EcsChunk_GetComponent( entInfo->chunk, entInfo->row, compIndex ) : NULL;
+    }
     
-    ecs_entity_info_t * entInfo = &ecs.entityInfo[ ent ];
+    return EcsComponentArray_GetComponentForEntity( &ecs.components[ compIndex ], ent );
+}
+
+/*=======================================================================================================================================*/
+void Ecs_EntityFree( ecs_entity_t ent ) {
+    xassertmsg( ecsCommandStage == NULL, "ECS : Entities can't be changed while a system thinks, use the deferred functions\n" );
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfo( ent );
     
-    /* Loop through any component arrays that have a component aray and free it up */
-    size_t compCount = entInfo->componentCount;
-    uint32_t * compArray = entInfo->componentList;
+    /* Loop through any component arrays that have a component for the entity and free it up */
+    for ( uint32_t c = 0; c < ecs.componentCount && entInfo->componentCount > 0; ++c ) {
+        if ( Ecs_MaskHasComponent( &entInfo->componentMask, c ) == true && ecs.componentStorage[ c ] == ECS_STORAGE_ARRAY ) {
+            EcsComponentArray_RemoveEntity( &ecs.components[ c ], ent );
+        }
+    }
     
-    for ( int n = 0; n < compCount; ++n ) {
-        ecs_component_array_t * compArrayPtr = &ecs.components[ compArray[ n ] ];
-        EcsComponentArray_RemoveEntity( compArrayPtr, ent );
+    /* All of the archetype components go in one go */
+    if ( entInfo->archetype != NULL ) {
+        Ecs_ArchetypeRemoveEntity( entInfo );
+        entInfo->archetype = NULL;
+        entInfo->chunk = NULL;
     }
     
-    /* Add the entity id to the free list */
-    ecs.entityFreeList[ ecs.entityFreeCount ] = ent;
+    /* Any handles still held to the entity are now stale */
+    entInfo->generation = ( entInfo->generation + 1 ) & ECS_ENTITY_GENERATION_MASK;
+    if ( entInfo->generation == 0 ) {
+        entInfo->generation = 1;
+    }
+    entInfo->alive = false;
     entInfo->componentCount = 0;
+    memset( &entInfo->componentMask, 0, sizeof( ecs_component_mask_t ) );
+    
+    /* Drop any messages that haven't been seen, the entity is left on the dirty list until the end of the frame */
+    EcsMessage_Clear( &entInfo->messages );
+    
+    /* Add the entity index to the free list */
+    if ( ecs.entityFreeCount == ecs.entityFreeListSize ) {
+        uint32_t newSize = ( ecs.entityFreeListSize == 0 ) ? ECS_ENTITY_PAGE_SIZE : ecs.entityFreeListSize * 2;
+        uint32_t * freeList = (uint32_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( uint32_t ) * newSize );
+        
+        if ( ecs.entityFreeList != NULL ) {
+            memcpy( freeList, ecs.entityFreeList, sizeof( uint32_t ) * ecs.entityFreeCount );
+            Mem_Free( ecs.entityFreeList );
+        }
+        
+        ecs.entityFreeList = freeList;
+        ecs.entityFreeListSize = newSize;
+    }
+    
+    ecs.entityFreeList[ ecs.entityFreeCount ] = ECS_ENTITY_INDEX( ent );
     ++ecs.entityFreeCount;
 }
 
 /*=======================================================================================================================================*/
-void * Ecs_AddComponentInternal( ecs_entity_t ent, ecs_component_array_t * compArray, uint32_t compArrayIndex ) {
-    /* Add the component array to the list of components for the entity */
-    ecs_entity_info_t * entInfo = &ecs.entityInfo[ ent ];
-    xassert( entInfo->componentCount < ECS_MAX_COMPONENT_TYPES );
+bool_t Ecs_EntityIsValid( ecs_entity_t ent ) {
+    if ( ent < 0 || ECS_ENTITY_INDEX( ent ) >= ecs.entityIndexCount ) {
+        return false;
+    }
+    
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( ent ) );
+    return ( entInfo->alive == true && entInfo->generation == ECS_ENTITY_GENERATION( ent ) ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Ecs_GetEntityCount(void) {
+    return ecs.entityIndexCount - ecs.entityFreeCount;
+}
+
+/*=======================================================================================================================================*/
+void * Ecs_AddComponentById( ecs_entity_t ent, ecs_component_id_t id ) {
+    xassertmsg( ecsCommandStage == NULL, "ECS : Entities can't be changed while a system thinks, use the deferred functions\n" );
+    xassertmsg( id >= 0 && id < (ecs_component_id_t) ecs.componentCount, "ECS : Component id %d has not been registered\n", id );
+    
+    /* Flag the component in the mask of the entity */
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfo( ent );
+    uint32_t compIndex = (uint32_t) id;
     
-    entInfo->componentList[ entInfo->componentCount ] =  compArrayIndex;
+    xassertmsg( Ecs_MaskHasComponent( &entInfo->componentMask, compIndex ) == false, "ECS : Entity already has component '%s'\n", ecs.componentTypeNames[ compIndex ] );
+    entInfo->componentMask.bits[ compIndex / 64 ] |= 1ull << ( compIndex % 64 );
     ++entInfo->componentCount;
     
+    if ( ecs.componentStorage[ compIndex ] == ECS_STORAGE_ARCHETYPE ) {
+        return Ecs_ArchetypeAddComponent( ent, entInfo, compIndex );
+    }
+    
     /* Add the entity to the component array */
-    void * compData = EcsComponentArray_AddEntity( compArray, ent );
+    void * compData = EcsComponentArray_AddEntity( &ecs.components[ compIndex ], ent );
     return compData;
 }
 
 /*=======================================================================================================================================*/
-void * Ecs_AddNamedComponent( ecs_entity_t ent, const char * compName ) {
-    int32_t index = -1;
-    bool_t found = Bsearch_FindVoidPtr( &index, (void*) compName, (const void**) ecs.componentNames, ecs.componentCount );
-    xassert( found == true );
+void Ecs_RemoveComponentById( ecs_entity_t ent, ecs_component_id_t id ) {
+    xassertmsg( ecsCommandStage == NULL, "ECS : Entities can't be changed while a system thinks, use the deferred functions\n" );
+    xassert( id >= 0 && id < (ecs_component_id_t) ecs.componentCount );
+    
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfo( ent );
+    uint32_t compIndex = (uint32_t) id;
+    
+    xassertmsg( Ecs_MaskHasComponent( &entInfo->componentMask, compIndex ) == true, "ECS : Entity doesn't have component '%s'\n", ecs.componentTypeNames[ compIndex ] );
+    entInfo->componentMask.bits[ compIndex / 64 ] &= ~( 1ull << ( compIndex % 64 ) );
+    --entInfo->componentCount;
+    
+    if ( ecs.componentStorage[ compIndex ] == ECS_STORAGE_ARCHETYPE ) {
+        Ecs_ArchetypeRemoveComponent( ent, entInfo, compIndex );
+    }
+    else {
+        EcsComponentArray_RemoveEntity( &ecs.components[ compIndex ], ent );
+    }
+}
+
+/*=======================================================================================================================================*/
+bool_t Ecs_HasComponentById( ecs_entity_t ent, ecs_component_id_t id ) {
+    xassert( id >= 0 && id < (ecs_component_id_t) ecs.componentCount );
+    return Ecs_MaskHasComponent( &Ecs_GetEntityInfo( ent )->componentMask, (uint32_t) id );
+}
+
+/*=======================================================================================================================================*/
+void * Ecs_GetComponentById( ecs_entity_t ent, ecs_component_id_t id ) {
+    xassert( id >= 0 && id < (ecs_component_id_t) ecs.componentCount );
+    
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfo( ent );
+    if ( Ecs_MaskHasComponent( &entInfo->componentMask, (uint32_t) id ) == false ) {
+        return NULL;
+    }
+    
+    if ( ecs.componentStorage[ id ] == ECS_STORAGE_ARCHETYPE ) {
+        return EcsChunk_GetComponent( entInfo->chunk, entInfo->row, (uint32_t) id );
+    }
     
-    /* Returned index is actually an index into the name map, which contains the index of the component
-       array that we want to use */
-    index = (uint32_t) ecs.componentNameMap[ index ];
+    return EcsComponentArray_GetComponentForEntity( &ecs.components[ id ], ent );
+}
+
+/*=======================================================================================================================================*/
+void * Ecs_AddNamedComponent( ecs_entity_t ent, const char * compName ) {
+    uint64_t index = 0;
+    bool_t found = HashMap_Find( &ecs.componentNameHashMap, FH64_CalcFromCStr( compName ), &index );
+    xassertmsg( found == true, "ECS : Unknown component '%s'\n", compName );
     
-    return Ecs_AddComponentInternal( ent, &ecs.components[ index ], index );
+    return Ecs_AddComponentById( ent, (ecs_component_id_t) index );
 }
 
 /*=======================================================================================================================================*/
 void * Ecs_AddHashedNamedComponent( ecs_entity_t ent, const char * compName ) {
-    uint64_t hash = FH64_CalcFromCStr( compName );
-    int32_t index = -1;
-    bool_t found = Bsearch_FindUint64( &index, hash, ecs.componentNameHashes, ecs.componentCount );
+    uint64_t index = 0;
+    bool_t found = HashMap_Find( &ecs.componentNameHashMap, FH64_CalcFromCStr( compName ), &index );
     xassert( found == true );
     
-    /* Returned index is actually an index into the name map, which contains the index of the component
-       array that we want to use */
-    index = (uint32_t) ecs.componentNameMap[ index ];
-    
-    return Ecs_AddComponentInternal( ent, &ecs.components[ index ], index );
+    return Ecs_AddComponentById( ent, (ecs_component_id_t) index );
 }
 
 /*=======================================================================================================================================*/
 int32_t Ecs_GetComponentArrayIndex( const char * name ) {
-    int32_t index = -1;
-    bool_t found = Bsearch_FindVoidPtr( &index, (void*) name, (const void**) ecs.componentNames, ecs.componentCount );
+    uint64_t index = 0;
+    bool_t found = HashMap_Find( &ecs.componentNameHashMap, FH64_CalcFromCStr( name ), &index );
     if ( found == false ) {
         return -1;
     }
     
-    /* Returned index is actually an index into the name map, which contains the index of the component
-       array that we want to use */
-    index = (int32_t) ecs.componentNameMap[ index ];
-    return index;
+    return (int32_t) index;
 }
 
 /*=======================================================================================================================================*/
@@ -272,14 +779,26 @@ ecs_system_id_t Ecs_RegisterSystemNamed( ecs_system_t * system, const char * com
     
     componentArrayIndex = Ecs_GetComponentArrayIndex( componentName );
     xassert( componentArrayIndex >= 0 );
+    xassertmsg( system->think != NULL || system->thinkBatch != NULL, "ECS : System '%s' has no think function\n", system->desc );
     
-    xprintf("ECS : Registering system '%s' for component '%s'\n", system->desc, EcsComponentArray_GetName( &ecs.components[ componentArrayIndex ] ) );
+    xprintf("ECS : Registering system '%s' for component '%s'\n", system->desc, ecs.componentTypeNames[ componentArrayIndex ] );
     
     ecs_system_id_t systemIndex = ecs.systemCount;
     ++ecs.systemCount;
 
     ecs.systems[ systemIndex ] = system;
     ecs.systemComponent[ systemIndex ] = componentArrayIndex;
+#ifdef ECS_PROFILE
+    EcsProfile_SetSystemName( (int32_t) systemIndex, system->desc );
+#endif
+    ecs.systemFlags[ systemIndex ] = ECS_SYSTEM_FLAG_NONE;
+    ecs.systemPublishes[ systemIndex ] = 0;
+    ecs.systemSubscribes[ systemIndex ] = ( system->message != NULL ) ? 1ull << ECS_TOPIC_BROADCAST : 0;
+    
+    /* A system always writes to the components that it thinks on */
+    memset( &ecs.systemReads[ systemIndex ], 0, sizeof( ecs_component_mask_t ) );
+    memset( &ecs.systemWrites[ systemIndex ], 0, sizeof( ecs_component_mask_t ) );
+    ecs.systemWrites[ systemIndex ].bits[ componentArrayIndex / 64 ] |= 1ull << ( componentArrayIndex % 64 );
     
     /*
         Set the primary system for the component if :-
@@ -295,137 +814,1478 @@ ecs_system_id_t Ecs_RegisterSystemNamed( ecs_system_t * system, const char * com
 
 /*=======================================================================================================================================*/
 void Ecs_EntityConstructDefault( ecs_entity_t ent ) {
-    uint32_t numComponents = 0;
-    uint32_t * componentArrayIndices = NULL;
-    
-    ecs_entity_info_t * entInfo = &ecs.entityInfo[ ent ];
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfo( ent );
     if ( entInfo->componentCount == 0 ) {
         return;
     }
     
-    numComponents = entInfo->componentCount;
-    componentArrayIndices = entInfo->componentList;
-    
-    for ( int n = 0; n < numComponents; ++n ) {
-        uint32_t componentIndex = componentArrayIndices[ n ];
-        
-        ecs_component_array_t * compArray = &ecs.components[ componentArrayIndices[ n ] ];
-        void * data = EcsComponentArray_GetComponentForEntity( compArray, ent);
-        if ( ecs.componentSystems[ componentIndex ] != NULL ) {
-            ecs.componentSystems[ componentIndex ]->constructDefault( ent, data );
+    /* Components are constructed in the order they were registered */
+    for ( uint32_t componentIndex = 0; componentIndex < ecs.componentCount; ++componentIndex ) {
+        if ( Ecs_MaskHasComponent( &entInfo->componentMask, componentIndex ) == false || ecs.componentSystems[ componentIndex ] == NULL ) {
+            continue;
         }
+        
+        void * data = Ecs_GetComponentData( ent, componentIndex );
+        ecs.componentSystems[ componentIndex ]->constructDefault( ent, data );
     }
 }
  
 /*=======================================================================================================================================*/
-int32_t Ecs_GetEntityNamedComponentIndex( ecs_entity_t ent, const char * name ) {
-    int32_t index = -1;
-    ecs_entity_info_t * entInfo = &ecs.entityInfo[ ent ];
+void Ecs_BlueprintInit( ecs_blueprint_t * blueprint ) {
+    memset( blueprint, 0, sizeof( ecs_blueprint_t ) );
+    blueprint->archetypeIndex = -1;
+}
+
+/*=======================================================================================================================================*/
+void Ecs_BlueprintDestroy( ecs_blueprint_t * blueprint ) {
+    for ( uint32_t n = 0; n < blueprint->componentCount; ++n ) {
+        Mem_Free( blueprint->defaults[ n ] );
+    }
     
-    xassert( ent != ECS_ENTITY_NULL && ent < ECS_MAX_ENTITIES );
+    Ecs_BlueprintInit( blueprint );
+}
 
-    for ( int n = 0; n < entInfo->componentCount; ++n ) {
-        int32_t currIndex = entInfo->componentList[n];
-        if ( currIndex >= 0 ) {
-            if ( EcsComponentArray_GetName( &ecs.components[currIndex] ) == name ) {
-                index = currIndex;
-                break;
-            }
-        }
+/*=======================================================================================================================================*/
+void * Ecs_BlueprintAddById( ecs_blueprint_t * blueprint, ecs_component_id_t id, const void * defaults ) {
+    xassertmsg( id >= 0 && id < (ecs_component_id_t) ecs.componentCount, "ECS : Component id %d has not been registered\n", id );
+    xassert( blueprint->componentCount < ECS_BLUEPRINT_MAX_COMPONENTS );
+    xassertmsg( Ecs_MaskHasComponent( &blueprint->mask, (uint32_t) id ) == false, "ECS : Blueprint already has component '%s'\n", ecs.componentTypeNames[ id ] );
+    
+    size_t size = ecs.componentSizes[ id ];
+    void * data = Mem_HeapAlloc( MEM_HEAP_ECS, size );
+    
+    if ( defaults != NULL ) {
+        memcpy( data, defaults, size );
+    }
+    else {
+        memset( data, 0, size );
     }
     
-    return index;
+    /* Keep the components in registration order, the order they get constructed in */
+    uint32_t insert = blueprint->componentCount;
+    while ( insert > 0 && blueprint->components[ insert - 1 ] > id ) {
+        blueprint->components[ insert ] = blueprint->components[ insert - 1 ];
+        blueprint->defaults[ insert ] = blueprint->defaults[ insert - 1 ];
+        --insert;
+    }
+    
+    blueprint->components[ insert ] = id;
+    blueprint->defaults[ insert ] = data;
+    blueprint->mask.bits[ id / 64 ] |= 1ull << ( id % 64 );
+    ++blueprint->componentCount;
+    blueprint->archetypeIndex = -1;
+    
+    return data;
 }
 
 /*=======================================================================================================================================*/
-void * Ecs_GetEntityIndexedComponent( ecs_entity_t ent, int32_t index ) {
-    xassert( ent != ECS_ENTITY_NULL && ent < ECS_MAX_ENTITIES );
-    return EcsComponentArray_GetComponentForEntity( &ecs.components[ index ], ent );
+static void Ecs_FillComponents( uint8_t * dst, size_t stride, const void * defaults, size_t size, uint32_t count ) {
+    memcpy( dst, defaults, size );
+    
+    if ( stride != size ) {
+        for ( uint32_t n = 1; n < count; ++n ) {
+            memcpy( dst + stride * n, defaults, size );
+        }
+        return;
+    }
+    
+    /* Packed, so keep doubling up the part that has been filled */
+    size_t filled = size;
+    size_t total = size * count;
+    
+    while ( filled < total ) {
+        size_t copy = ( total - filled < filled ) ? total - filled : filled;
+        memcpy( dst + filled, dst, copy );
+        filled += copy;
+    }
 }
 
 /*=======================================================================================================================================*/
-void Ecs_SystemThink( int32_t systemIndex, ecs_think_params_t * params ) {
-    xassert( systemIndex >= 0 && systemIndex < ecs.systemCount );
+void Ecs_BlueprintSpawn( ecs_blueprint_t * blueprint, uint32_t count, ecs_entity_t * entsOut ) {
+    xassertmsg( ecsCommandStage == NULL, "ECS : Entities can't be changed while a system thinks, use the deferred functions\n" );
+    ecs_component_mask_t archetypeMask;
+    bool_t hasArchetype = false;
     
-    ecs_component_list_t systemComponents;
-    ecs_component_array_t * compArray = &ecs.components[ ecs.systemComponent[ systemIndex ] ];
-    EcsComponentArray_GetActiveComponents( compArray, &systemComponents );
-    ecs_entity_t ent;
-    ecs_entity_info_t * entInfo;
-    uint32_t msgEnd;
-    uintptr_t msgPtr;
-    ecs_msg_t * msg;
+    memset( &archetypeMask, 0, sizeof( archetypeMask ) );
+    for ( uint32_t n = 0; n < blueprint->componentCount; ++n ) {
+        uint32_t c = (uint32_t) blueprint->components[ n ];
+        if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARCHETYPE ) {
+            archetypeMask.bits[ c / 64 ] |= 1ull << ( c % 64 );
+            hasArchetype = true;
+        }
+    }
+    
+    /* The entities get all of their components at once, so there's no moving between archetypes on the way */
+    for ( uint32_t n = 0; n < count; ++n ) {
+        ecs_entity_t ent = Ecs_EntityAlloc();
+        ecs_entity_info_t * entInfo = Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( ent ) );
+        
+        entInfo->componentMask = blueprint->mask;
+        entInfo->componentCount = blueprint->componentCount;
+        entsOut[ n ] = ent;
+    }
     
-    for ( int n = 0; n < systemComponents.count; ++n ) {
+    if ( hasArchetype == true ) {
+        if ( blueprint->archetypeIndex < 0 ) {
+            blueprint->archetypeIndex = (int32_t) Ecs_FindArchetypeIndex( &archetypeMask );
+        }
         
-        ent = systemComponents.entities[ n ];
-        entInfo = &ecs.entityInfo[ ent ];
-               
-        /* If the system has a message function, we'll send messages for this
-           entity to it. */
-        if ( ecs.systems[ systemIndex ]->message != NULL ) {
+        ecs_archetype_t * archetype = ecs.archetypes[ blueprint->archetypeIndex ];
+        uint32_t done = 0;
+        
+        /* A chunk at a time, copying the defaults down each column */
+        while ( done < count ) {
+            ecs_chunk_t * chunk = NULL;
+            uint32_t row = 0;
+            uint32_t added = EcsArchetype_AddEntities( archetype, entsOut + done, count - done, &chunk, &row );
             
-            /* Cache the message end pointer - another thread may add messages and it may
-               be unsafe to process them at this point.
-             */
-            msgEnd = atomic_load( &entInfo->messageCommitPtr );
-            msgPtr = 0;
+            for ( uint32_t n = 0; n < blueprint->componentCount; ++n ) {
+                uint32_t c = (uint32_t) blueprint->components[ n ];
+                if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARCHETYPE ) {
+                    size_t size = ecs.componentSizes[ c ];
+                    Ecs_FillComponents( (uint8_t *) EcsChunk_GetColumn( chunk, c ) + size * row, size, blueprint->defaults[ n ], size, added );
+                }
+            }
             
-            while ( msgPtr < msgEnd ) {
-                
-                /* Get the pointer to the message header and flag. */
-                msg = ( ecs_msg_t *) &entInfo->messageBuffer[ msgPtr ];
-                msg->seen = 1;
-                    
-                /* Process the message and update the pointer to the next message */
-                ecs.systems[ systemIndex ]->message( msg, systemComponents.componentData[ n ] );
-                msgPtr += msg->size;
+            for ( uint32_t n = 0; n < added; ++n ) {
+                ecs_entity_info_t * entInfo = Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( entsOut[ done + n ] ) );
+                entInfo->archetype = archetype;
+                entInfo->chunk = chunk;
+                entInfo->row = row + n;
             }
+            
+            done += added;
+        }
+    }
+    
+    /* New components in an array are at the end of it, so they're contiguous as well */
+    for ( uint32_t n = 0; n < blueprint->componentCount && count > 0; ++n ) {
+        uint32_t c = (uint32_t) blueprint->components[ n ];
+        if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARRAY ) {
+            size_t stride = 0;
+            uint8_t * data = (uint8_t *) EcsComponentArray_AddEntities( &ecs.components[ c ], entsOut, count, &stride );
+            Ecs_FillComponents( data, stride, blueprint->defaults[ n ], ecs.componentSizes[ c ], count );
+        }
+    }
+    
+    /* Then construct them a component at a time */
+    for ( uint32_t n = 0; n < blueprint->componentCount; ++n ) {
+        uint32_t c = (uint32_t) blueprint->components[ n ];
+        ecs_system_t * system = ecs.componentSystems[ c ];
+        
+        if ( system == NULL ) {
+            continue;
         }
         
-        ecs.systems[ systemIndex ]->think( systemComponents.entities[ n ], systemComponents.componentData[n], params );
+        for ( uint32_t e = 0; e < count; ++e ) {
+            system->constructDefault( entsOut[ e ], Ecs_GetComponentData( entsOut[ e ], c ) );
+        }
     }
 }
 
 /*=======================================================================================================================================*/
-static bool_t Ecs_IsMessageCommited( ecs_entity_info_t * info ) {
-    return atomic_load( &info->messagePtr ) == atomic_load( &info->messageCommitPtr ) ? true : false;
+int32_t Ecs_GetEntityNamedComponentIndex( ecs_entity_t ent, const char * name ) {
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfo( ent );
+    int32_t index = Ecs_GetComponentArrayIndex( name );
+    
+    if ( index < 0 || Ecs_MaskHasComponent( &entInfo->componentMask, (uint32_t) index ) == false ) {
+        return -1;
+    }
+    
+    return index;
+}
+
+/*=======================================================================================================================================*/
+void * Ecs_GetEntityIndexedComponent( ecs_entity_t ent, int32_t index ) {
+    xassert( Ecs_EntityIsValid( ent ) == true );
+    return Ecs_GetComponentData( ent, (uint32_t) index );
+}
+
+/*=======================================================================================================================================*/
+void Ecs_SystemDeclareAccess( ecs_system_id_t system, const char * componentName, uint32_t access ) {
+    xassert( system >= 0 && system < ecs.systemCount );
+    
+    int32_t componentArrayIndex = Ecs_GetComponentArrayIndex( componentName );
+    xassertmsg( componentArrayIndex >= 0, "ECS : Unknown component '%s'\n", componentName );
+    
+    uint64_t bit = 1ull << ( componentArrayIndex % 64 );
+    if ( ( access & ECS_ACCESS_READ ) != 0 ) {
+        ecs.systemReads[ system ].bits[ componentArrayIndex / 64 ] |= bit;
+    }
+    
+    if ( ( access & ECS_ACCESS_WRITE ) != 0 ) {
+        ecs.systemWrites[ system ].bits[ componentArrayIndex / 64 ] |= bit;
+    }
+}
+
+/*=======================================================================================================================================*/
+void Ecs_SystemSetFlags( ecs_system_id_t system, uint32_t flags ) {
+    xassert( system >= 0 && system < ecs.systemCount );
+    ecs.systemFlags[ system ] = flags;
+}
+
+/*=======================================================================================================================================*/
+void Ecs_SystemPublishTopic( ecs_system_id_t system, uint16_t topic ) {
+    xassert( system >= 0 && system < ecs.systemCount );
+    xassert( topic < ECS_MAX_TOPICS );
+    ecs.systemPublishes[ system ] |= 1ull << topic;
+}
+
+/*=======================================================================================================================================*/
+void Ecs_SystemSubscribeTopic( ecs_system_id_t system, uint16_t topic ) {
+    xassert( system >= 0 && system < ecs.systemCount );
+    xassert( topic < ECS_MAX_TOPICS );
+    xassertmsg( ecs.systems[ system ]->message != NULL, "ECS : System '%s' has no message function to subscribe with\n", ecs.systems[ system ]->desc );
+    ecs.systemSubscribes[ system ] |= 1ull << topic;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_PrepareTopic( uint16_t topic ) {
+    /* Topics published to outside of Ecs_RunSystems get sorted by the first reader */
+    if ( atomic_load_explicit( &ecs.topics[ topic ].sorted, memory_order_acquire ) == false ) {
+        Sys_MutexLock( &ecs.topicMutex );
+        EcsTopic_Sort( &ecs.topics[ topic ], ecs.entityIndexCount );
+        Sys_MutexUnlock( &ecs.topicMutex );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_SortTopics(void) {
+    for ( uint16_t n = 0; n < ECS_MAX_TOPICS; ++n ) {
+        EcsTopic_Sort( &ecs.topics[ n ], ecs.entityIndexCount );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_TopicIterInit( const ecs_topic_t * topic, uint16_t topicIndex, ecs_entity_t ent, ecs_topic_iter_t * iter ) {
+    iter->topic = topicIndex;
+    iter->pad = 0;
+    iter->ent = ent;
+    iter->allIndex = topic->allStart;
+    iter->allEnd = topic->count;
+    
+    if ( ent == ECS_ENTITY_NULL ) {
+        iter->index = 0;
+        iter->end = topic->allStart;
+    }
+    else {
+        EcsTopic_FindEntity( topic, ent, &iter->index, &iter->end );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Ecs_TopicBegin( uint16_t topic, ecs_topic_iter_t * iter ) {
+    xassert( topic < ECS_MAX_TOPICS );
+    Ecs_PrepareTopic( topic );
+    Ecs_TopicIterInit( &ecs.topics[ topic ], topic, ECS_ENTITY_NULL, iter );
+}
+
+/*=======================================================================================================================================*/
+void Ecs_TopicBeginEntity( uint16_t topic, ecs_entity_t ent, ecs_topic_iter_t * iter ) {
+    xassert( topic < ECS_MAX_TOPICS );
+    xassert( ent != ECS_ENTITY_NULL );
+    Ecs_PrepareTopic( topic );
+    Ecs_TopicIterInit( &ecs.topics[ topic ], topic, ent, iter );
+}
+
+/*=======================================================================================================================================*/
+const ecs_msg_t * Ecs_TopicNext( ecs_topic_iter_t * iter, ecs_entity_t * ent ) {
+    const ecs_topic_t * topic = &ecs.topics[ iter->topic ];
+    
+    while ( iter->index < iter->end ) {
+        ecs_entity_t msgEnt;
+        ecs_msg_t * msg = EcsTopic_GetMessage( topic, iter->index++, &msgEnt );
+        
+        /* Messages published for an earlier entity with the same index are skipped */
+        if ( iter->ent == ECS_ENTITY_NULL || msgEnt == iter->ent ) {
+            if ( ent != NULL ) {
+                *ent = msgEnt;
+            }
+            return msg;
+        }
+    }
+    
+    if ( iter->allIndex < iter->allEnd ) {
+        return EcsTopic_GetMessage( topic, iter->allIndex++, ent );
+    }
+    
+    return NULL;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_SystemMessageEntity( ecs_system_t * system, uint64_t topics, ecs_entity_t ent, void * component ) {
+    ecs_entity_info_t * entInfo = Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( ent ) );
+    ecs_msg_iter_t iter;
+    ecs_msg_t * msg;
+    
+    /* If the system has a message function, we'll send messages for this
+       entity to it. */
+    if ( system->message != NULL ) {
+        
+        /* The iterator stops at the messages committed when it started, another thread may be adding messages
+           and it may be unsafe to process them at this point.
+         */
+        EcsMessage_Begin( &entInfo->messages, &iter );
+        
+        while ( ( msg = EcsMessage_Next( &iter ) ) != NULL ) {
+            system->message( msg, component );
+        }
+        
+        EcsMessage_MarkSeen( &entInfo->messages, iter.count );
+        ECS_PROFILE_COUNT( messageCount, iter.count );
+        
+        /* Then the messages for the entity in the topics that the system is subscribed to */
+        for ( uint16_t t = 0; ( topics >> t ) != 0; ++t ) {
+            if ( ( topics & ( 1ull << t ) ) == 0 || ecs.topics[ t ].count == 0 ) {
+                continue;
+            }
+            
+            ecs_topic_iter_t topicIter;
+            Ecs_TopicIterInit( &ecs.topics[ t ], t, ent, &topicIter );
+            
+            while ( ( msg = (ecs_msg_t *) Ecs_TopicNext( &topicIter, NULL ) ) != NULL ) {
+                system->message( msg, component );
+                ECS_PROFILE_COUNT( messageCount, 1 );
+            }
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_SystemThinkBatch( ecs_system_t * system, uint64_t topics, const ecs_entity_t * entities, uint8_t * components, size_t stride, uint32_t count, ecs_think_params_t * params ) {
+    /* Every entity in the run has its messages before the batch thinks */
+    if ( system->message != NULL ) {
+        for ( uint32_t n = 0; n < count; ++n ) {
+            Ecs_SystemMessageEntity( system, topics, entities[ n ], components + stride * n );
+        }
+    }
+    
+    ecs_batch_t batch;
+    batch.count = count;
+    batch.stride = (uint32_t) stride;
+    batch.entities = entities;
+    batch.components = components;
+    
+    system->thinkBatch( &batch, params );
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_SystemThinkRange( int32_t systemIndex, const ecs_component_list_t * systemComponents, uint32_t start, uint32_t end, ecs_think_params_t * params ) {
+    ecs_system_t * system = ecs.systems[ systemIndex ];
+    uint64_t topics = ecs.systemSubscribes[ systemIndex ];
+    
+    ECS_PROFILE_COUNT( entityCount, end - start );
+    
+    if ( system->thinkBatch != NULL ) {
+        if ( end > start ) {
+            Ecs_SystemThinkBatch( system, topics, systemComponents->entities + start, (uint8_t *) systemComponents->componentData[ start ], systemComponents->stride, end - start, params );
+        }
+        return;
+    }
+    
+    for ( uint32_t n = start; n < end; ++n ) {
+        Ecs_SystemMessageEntity( system, topics, systemComponents->entities[ n ], systemComponents->componentData[ n ] );
+        system->think( systemComponents->entities[ n ], systemComponents->componentData[ n ], params );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_SystemThinkChunk( int32_t systemIndex, ecs_chunk_t * chunk, ecs_think_params_t * params ) {
+    ecs_system_t * system = ecs.systems[ systemIndex ];
+    uint32_t componentIndex = (uint32_t) ecs.systemComponent[ systemIndex ];
+    
+    uint32_t count = EcsChunk_GetCount( chunk );
+    const ecs_entity_t * entities = EcsChunk_GetEntities( chunk );
+    uint8_t * column = (uint8_t *) EcsChunk_GetColumn( chunk, componentIndex );
+    size_t componentSize = ecs.componentSizes[ componentIndex ];
+    uint64_t topics = ecs.systemSubscribes[ systemIndex ];
+    
+    ECS_PROFILE_COUNT( entityCount, count );
+    
+    if ( system->thinkBatch != NULL ) {
+        if ( count > 0 ) {
+            Ecs_SystemThinkBatch( system, topics, entities, column, componentSize, count, params );
+        }
+        return;
+    }
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        Ecs_SystemMessageEntity( system, topics, entities[ n ], column + componentSize * n );
+        system->think( entities[ n ], column + componentSize * n, params );
+    }
+}
+
+/*=======================================================================================================================================*/
+static bool_t Ecs_ArchetypeHasComponent( uint32_t archetypeIndex, uint32_t componentIndex ) {
+    return ( ecs.archetypeMasks[ archetypeIndex ].bits[ componentIndex / 64 ] & ( 1ull << ( componentIndex % 64 ) ) ) != 0 ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_SystemThinkArchetypes( int32_t systemIndex, ecs_think_params_t * params ) {
+    uint32_t componentIndex = (uint32_t) ecs.systemComponent[ systemIndex ];
+    
+    for ( uint32_t a = 0; a < ecs.archetypeCount; ++a ) {
+        if ( Ecs_ArchetypeHasComponent( a, componentIndex ) == false ) {
+            continue;
+        }
+        
+        uint32_t chunkCount = EcsArchetype_GetChunkCount( ecs.archetypes[ a ] );
+        for ( uint32_t c = 0; c < chunkCount; ++c ) {
+            Ecs_SystemThinkChunk( systemIndex, EcsArchetype_GetChunk( ecs.archetypes[ a ], c ), params );
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+void Ecs_SystemThink( int32_t systemIndex, ecs_think_params_t * params ) {
+    xassert( systemIndex >= 0 && systemIndex < ecs.systemCount );
+    xassertmsg( ecsStage == NULL && ecsCommandStage == NULL, "ECS : Ecs_SystemThink can't be called from a system\n" );
+    
+    /* Structural changes are recorded while the system thinks and played back once it's done. Messages are
+       staged too, a publish to a topic the system reads would unsort it while the system walks it */
+    ecs_stage_t messages;
+    ecs_stage_t commands;
+    memset( &messages, 0, sizeof( messages ) );
+    memset( &commands, 0, sizeof( commands ) );
+    ecsStage = &messages;
+    ecsCommandStage = &commands;
+    
+#ifdef ECS_PROFILE
+    ecs_profile_job_t profile;
+    EcsProfile_BeginJob( &profile, systemIndex );
+    ecsProfileJob = &profile;
+#endif
+    
+    for ( uint16_t t = 0; ( ecs.systemSubscribes[ systemIndex ] >> t ) != 0; ++t ) {
+        if ( ( ecs.systemSubscribes[ systemIndex ] & ( 1ull << t ) ) != 0 ) {
+            Ecs_PrepareTopic( t );
+        }
+    }
+    
+    if ( ecs.componentStorage[ ecs.systemComponent[ systemIndex ] ] == ECS_STORAGE_ARCHETYPE ) {
+        Ecs_SystemThinkArchetypes( systemIndex, params );
+    }
+    else {
+        ecs_component_list_t systemComponents;
+        ecs_component_array_t * compArray = &ecs.components[ ecs.systemComponent[ systemIndex ] ];
+        EcsComponentArray_GetActiveComponents( compArray, &systemComponents );
+        
+        Ecs_SystemThinkRange( systemIndex, &systemComponents, 0, (uint32_t) systemComponents.count, params );
+    }
+    
+    ecsStage = NULL;
+    ecsCommandStage = NULL;
+    
+#ifdef ECS_PROFILE
+    ecsProfileJob = NULL;
+    EcsProfile_EndJob( &profile );
+    EcsProfile_AddJob( &profile );
+    uint64_t profileStart = Sys_GetTicksNs();
+#endif
+    
+    Ecs_CommitStage( &messages );
+    
+#ifdef ECS_PROFILE
+    EcsProfile_AddPhase( ECS_PROFILE_PHASE_COMMIT, profileStart );
+    profileStart = Sys_GetTicksNs();
+#endif
+    
+    Ecs_PlayCommands( &commands, sizeof( ecs_stage_t ), 1 );
+    Ecs_ScheduleReset();
+    
+#ifdef ECS_PROFILE
+    EcsProfile_AddPhase( ECS_PROFILE_PHASE_COMMANDS, profileStart );
+#endif
+}
+
+/*=======================================================================================================================================*/
+void Ecs_QueryInit( ecs_query_t * query ) {
+    memset( query, 0, sizeof( ecs_query_t ) );
+}
+
+/*=======================================================================================================================================*/
+void Ecs_QueryAddNamed( ecs_query_t * query, const char * componentName ) {
+    xassert( query->componentCount < ECS_QUERY_MAX_COMPONENTS );
+    
+    int32_t componentIndex = Ecs_GetComponentArrayIndex( componentName );
+    xassertmsg( componentIndex >= 0, "ECS : Unknown component '%s'\n", componentName );
+    xassertmsg( ecs.componentStorage[ componentIndex ] == ECS_STORAGE_ARCHETYPE, "ECS : Query component '%s' is not archetype stored\n", componentName );
+    
+    query->components[ query->componentCount ] = (uint32_t) componentIndex;
+    query->mask.bits[ componentIndex / 64 ] |= 1ull << ( componentIndex % 64 );
+    ++query->componentCount;
+}
+
+/*=======================================================================================================================================*/
+void Ecs_QueryBegin( const ecs_query_t * query, ecs_query_iter_t * iter ) {
+    iter->query = query;
+    iter->archetypeIndex = 0;
+    iter->chunkIndex = 0;
+}
+
+/*=======================================================================================================================================*/
+bool_t Ecs_QueryNext( ecs_query_iter_t * iter, ecs_chunk_view_t * view ) {
+    const ecs_query_t * query = iter->query;
+    
+    while ( iter->archetypeIndex < ecs.archetypeCount ) {
+        ecs_archetype_t * archetype = ecs.archetypes[ iter->archetypeIndex ];
+        const ecs_component_mask_t * mask = &ecs.archetypeMasks[ iter->archetypeIndex ];
+        bool_t match = true;
+        
+        for ( uint32_t w = 0; w < ECS_COMPONENT_MASK_WORDS; ++w ) {
+            if ( ( mask->bits[ w ] & query->mask.bits[ w ] ) != query->mask.bits[ w ] ) {
+                match = false;
+                break;
+            }
+        }
+        
+        if ( match == false || iter->chunkIndex >= EcsArchetype_GetChunkCount( archetype ) ) {
+            ++iter->archetypeIndex;
+            iter->chunkIndex = 0;
+            continue;
+        }
+        
+        ecs_chunk_t * chunk = EcsArchetype_GetChunk( archetype, iter->chunkIndex );
+        ++iter->chunkIndex;
+        
+        view->count = EcsChunk_GetCount( chunk );
+        view->entities = EcsChunk_GetEntities( chunk );
+        for ( uint32_t n = 0; n < query->componentCount; ++n ) {
+            view->components[ n ] = EcsChunk_GetColumn( chunk, query->components[ n ] );
+        }
+        
+        return true;
+    }
+    
+    return false;
+}
+
+/*=======================================================================================================================================*/
+static bool_t Ecs_SystemsConflict( ecs_system_id_t a, ecs_system_id_t b ) {
+    /* Systems can't run at the same time if either writes a component that the other uses */
+    for ( uint32_t w = 0; w < ECS_COMPONENT_MASK_WORDS; ++w ) {
+        uint64_t usedA = ecs.systemReads[ a ].bits[ w ] | ecs.systemWrites[ a ].bits[ w ];
+        uint64_t usedB = ecs.systemReads[ b ].bits[ w ] | ecs.systemWrites[ b ].bits[ w ];
+        
+        if ( ( ecs.systemWrites[ a ].bits[ w ] & usedB ) != 0 || ( ecs.systemWrites[ b ].bits[ w ] & usedA ) != 0 ) {
+            return true;
+        }
+    }
+    
+    /* Messages are only committed between waves, so a receiver has to wait for the senders before it */
+    bool_t aSends = ( ecs.systemFlags[ a ] & ECS_SYSTEM_FLAG_SENDS_MESSAGES ) != 0 ? true : false;
+    bool_t bSends = ( ecs.systemFlags[ b ] & ECS_SYSTEM_FLAG_SENDS_MESSAGES ) != 0 ? true : false;
+    
+    if ( ( aSends == true && ecs.systems[ b ]->message != NULL ) || ( bSends == true && ecs.systems[ a ]->message != NULL ) ) {
+        return true;
+    }
+    
+    /* Same goes for topics, systems that publish to the same topic can run together as the order is fixed on commit */
+    if ( ( ecs.systemPublishes[ a ] & ecs.systemSubscribes[ b ] ) != 0 || ( ecs.systemPublishes[ b ] & ecs.systemSubscribes[ a ] ) != 0 ) {
+        return true;
+    }
+    
+    return false;
+}
+
+/*=======================================================================================================================================*/
+static void * Ecs_StageAlloc( ecs_stage_t * stage, size_t recordSize ) {
+    ecs_stage_block_t * block = stage->tail;
+    
+    if ( block == NULL || block->used + recordSize > ECS_MESSAGE_STAGE_BLOCK_SIZE - sizeof( ecs_stage_block_t ) ) {
+        /* A record too big for a block gets a block of its own, it is left full so the next record starts another */
+        size_t blockSize = sizeof( ecs_stage_block_t ) + recordSize;
+        blockSize = ( blockSize > ECS_MESSAGE_STAGE_BLOCK_SIZE ) ? blockSize : ECS_MESSAGE_STAGE_BLOCK_SIZE;
+        block = (ecs_stage_block_t *) Ecs_ScheduleAlloc( blockSize );
+        block->next = NULL;
+        block->used = 0;
+        
+        if ( stage->tail != NULL ) {
+            stage->tail->next = block;
+        }
+        else {
+            stage->head = block;
+        }
+        stage->tail = block;
+    }
+    
+    void * record = block->data + block->used;
+    block->used += (uint32_t) recordSize;
+    ++stage->count;
+    
+    return record;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_StageMessage( ecs_stage_t * stage, uint16_t topic, ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize ) {
+    size_t recordSize = Sys_Align( sizeof( ecs_stage_msg_t ) + dataSize, 8 );
+    ecs_stage_msg_t * record = (ecs_stage_msg_t *) Ecs_StageAlloc( stage, recordSize );
+    
+    record->ent = ent;
+    record->size = (uint32_t) dataSize;
+    record->msgId = msgId;
+    record->topic = topic;
+    memcpy( record + 1, data, dataSize );
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_CommitStage( ecs_stage_t * stage ) {
+    for ( ecs_stage_block_t * block = stage->head; block != NULL; block = block->next ) {
+        uint32_t ptr = 0;
+        while ( ptr < block->used ) {
+            ecs_stage_msg_t * record = (ecs_stage_msg_t *) ( block->data + ptr );
+            size_t recordSize = Sys_Align( sizeof( ecs_stage_msg_t ) + record->size, 8 );
+            
+            if ( record->topic == ECS_STAGE_NO_TOPIC ) {
+                Ecs_SendMessageDirect( record->ent, record->msgId, record + 1, record->size );
+            }
+            else {
+                Ecs_PublishDirect( record->topic, record->ent, record->msgId, record + 1, record->size );
+            }
+            ptr += (uint32_t) recordSize;
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static ecs_command_t * Ecs_StageCommand( uint16_t kind, ecs_entity_t ent, ecs_component_id_t component, size_t dataSize ) {
+    size_t recordSize = Sys_Align( sizeof( ecs_command_t ) + dataSize, 8 );
+    ecs_command_t * command = (ecs_command_t *) Ecs_StageAlloc( ecsCommandStage, recordSize );
+    ECS_PROFILE_COUNT( bytesCopied, recordSize );
+    
+    command->ent = ent;
+    command->component = component;
+    command->kind = kind;
+    command->pad = 0;
+    command->size = (uint32_t) dataSize;
+    return command;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_ApplyAdd( ecs_entity_t ent, ecs_component_id_t id, const void * data ) {
+    /* Adding a component the entity already has just sets its value */
+    void * compData = ( Ecs_HasComponentById( ent, id ) == true ) ? Ecs_GetComponentById( ent, id ) : Ecs_AddComponentById( ent, id );
+    
+    if ( data != NULL ) {
+        memcpy( compData, data, ecs.componentSizes[ id ] );
+    }
+    else {
+        memset( compData, 0, ecs.componentSizes[ id ] );
+    }
+}
+
+/*=======================================================================================================================================*/
+ecs_entity_t Ecs_DeferSpawn( ecs_blueprint_t * blueprint ) {
+    if ( ecsCommandStage == NULL ) {
+        ecs_entity_t ent = ECS_ENTITY_NULL;
+        if ( blueprint != NULL ) {
+            Ecs_BlueprintSpawn( blueprint, 1, &ent );
+        }
+        else {
+            ent = Ecs_EntityAlloc();
+        }
+        return ent;
+    }
+    
+    uint32_t pendingIndex = atomic_fetch_add_explicit( &ecs.pendingCount, 1, memory_order_relaxed );
+    ecs_command_t * command = Ecs_StageCommand( ECS_COMMAND_SPAWN, ECS_ENTITY_MAKE( pendingIndex, 0 ), 0, sizeof( ecs_blueprint_t * ) );
+    memcpy( command + 1, &blueprint, sizeof( ecs_blueprint_t * ) );
+    return command->ent;
+}
+
+/*=======================================================================================================================================*/
+void Ecs_DeferFree( ecs_entity_t ent ) {
+    if ( ecsCommandStage == NULL ) {
+        if ( Ecs_EntityIsValid( ent ) == true ) {
+            Ecs_EntityFree( ent );
+        }
+        return;
+    }
+    
+    Ecs_StageCommand( ECS_COMMAND_FREE, ent, 0, 0 );
+}
+
+/*=======================================================================================================================================*/
+void Ecs_DeferAddComponentById( ecs_entity_t ent, ecs_component_id_t id, const void * data ) {
+    xassertmsg( id >= 0 && id < (ecs_component_id_t) ecs.componentCount, "ECS : Component id %d has not been registered\n", id );
+    
+    if ( ecsCommandStage == NULL ) {
+        Ecs_ApplyAdd( ent, id, data );
+        return;
+    }
+    
+    /* The value is copied now, the caller's copy can go out of scope before playback */
+    size_t dataSize = ( data != NULL ) ? ecs.componentSizes[ id ] : 0;
+    ecs_command_t * command = Ecs_StageCommand( ECS_COMMAND_ADD, ent, id, dataSize );
+    if ( data != NULL ) {
+        memcpy( command + 1, data, dataSize );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Ecs_DeferRemoveComponentById( ecs_entity_t ent, ecs_component_id_t id ) {
+    xassertmsg( id >= 0 && id < (ecs_component_id_t) ecs.componentCount, "ECS : Component id %d has not been registered\n", id );
+    
+    if ( ecsCommandStage == NULL ) {
+        if ( Ecs_HasComponentById( ent, id ) == true ) {
+            Ecs_RemoveComponentById( ent, id );
+        }
+        return;
+    }
+    
+    Ecs_StageCommand( ECS_COMMAND_REMOVE, ent, id, 0 );
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_PlayCommands( ecs_stage_t * stages, size_t stageStride, uint32_t stageCount ) {
+    uint32_t commandCount = 0;
+    
+    for ( uint32_t s = 0; s < stageCount; ++s ) {
+        commandCount += ( (ecs_stage_t *) ( (uint8_t *) stages + stageStride * s ) )->count;
+    }
+    
+    if ( commandCount == 0 ) {
+        return;
+    }
+    
+    /* Commands are played in the order they were recorded, the stages are in the same fixed order as the
+       message stages. Spawns are pulled out and done first so that every pending handle can be resolved by the
+       commands that use it, spawning only ever makes new entities so it can't change what the others do. */
+    ecs_command_t ** commands = (ecs_command_t **) Ecs_ScheduleAlloc( sizeof( ecs_command_t * ) * commandCount );
+    ecs_command_t ** spawns = (ecs_command_t **) Ecs_ScheduleAlloc( sizeof( ecs_command_t * ) * commandCount );
+    uint32_t otherCount = 0;
+    uint32_t spawnCount = 0;
+    
+    for ( uint32_t s = 0; s < stageCount; ++s ) {
+        ecs_stage_t * stage = (ecs_stage_t *) ( (uint8_t *) stages + stageStride * s );
+        
+        for ( ecs_stage_block_t * block = stage->head; block != NULL; block = block->next ) {
+            uint32_t ptr = 0;
+            while ( ptr < block->used ) {
+                ecs_command_t * command = (ecs_command_t *) ( block->data + ptr );
+                
+                if ( command->kind == ECS_COMMAND_SPAWN ) {
+                    spawns[ spawnCount++ ] = command;
+                }
+                else {
+                    commands[ otherCount++ ] = command;
+                }
+                
+                ptr += (uint32_t) Sys_Align( sizeof( ecs_command_t ) + command->size, 8 );
+            }
+        }
+    }
+    
+    uint32_t pendingCount = atomic_load_explicit( &ecs.pendingCount, memory_order_relaxed );
+    ecs_entity_t * resolved = NULL;
+    uint32_t n = 0;
+    
+    if ( pendingCount > 0 ) {
+        resolved = (ecs_entity_t *) Ecs_ScheduleAlloc( sizeof( ecs_entity_t ) * pendingCount );
+    }
+    
+    /* Runs of spawns from the same blueprint go through Ecs_BlueprintSpawn together */
+    while ( n < spawnCount ) {
+        ecs_blueprint_t * blueprint = *(ecs_blueprint_t **) ( spawns[ n ] + 1 );
+        uint32_t runEnd = n + 1;
+        
+        while ( runEnd < spawnCount && *(ecs_blueprint_t **) ( spawns[ runEnd ] + 1 ) == blueprint ) {
+            ++runEnd;
+        }
+        
+        ecs_entity_t * ents = (ecs_entity_t *) Ecs_ScheduleAlloc( sizeof( ecs_entity_t ) * ( runEnd - n ) );
+        if ( blueprint != NULL ) {
+            Ecs_BlueprintSpawn( blueprint, runEnd - n, ents );
+        }
+        else {
+            for ( uint32_t e = 0; e < runEnd - n; ++e ) {
+                ents[ e ] = Ecs_EntityAlloc();
+            }
+        }
+        
+        for ( uint32_t e = n; e < runEnd; ++e ) {
+            resolved[ ECS_ENTITY_INDEX( spawns[ e ]->ent ) ] = ents[ e - n ];
+        }
+        
+        n = runEnd;
+    }
+    
+    for ( n = 0; n < otherCount; ++n ) {
+        ecs_command_t * command = commands[ n ];
+        ecs_entity_t ent = command->ent;
+        
+        /* Pending handles are only good until the playback after they were handed out */
+        if ( ECS_ENTITY_IS_PENDING( ent ) == true ) {
+            if ( ECS_ENTITY_INDEX( ent ) >= pendingCount ) {
+                continue;
+            }
+            ent = resolved[ ECS_ENTITY_INDEX( ent ) ];
+        }
+        
+        /* The entity may have been freed by an earlier command, e.g. two systems freeing the same entity */
+        if ( Ecs_EntityIsValid( ent ) == false ) {
+            continue;
+        }
+        
+        switch ( command->kind ) {
+            case ECS_COMMAND_ADD:
+                Ecs_ApplyAdd( ent, command->component, ( command->size > 0 ) ? command + 1 : NULL );
+                break;
+                
+            case ECS_COMMAND_REMOVE:
+                if ( Ecs_HasComponentById( ent, command->component ) == true ) {
+                    Ecs_RemoveComponentById( ent, command->component );
+                }
+                break;
+                
+            case ECS_COMMAND_FREE:
+                Ecs_EntityFree( ent );
+                break;
+                
+            default:
+                xassert( 0 );
+                break;
+        }
+    }
+    
+    atomic_store_explicit( &ecs.pendingCount, 0, memory_order_relaxed );
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_RunChunk( void * arg ) {
+    ecs_system_chunk_t * chunk = (ecs_system_chunk_t *) arg;
+    
+    /* Messages sent by the system are staged, a waiting thread can pick up a chunk while running another so keep the previous stage */
+    ecs_stage_t * prevStage = ecsStage;
+    ecs_stage_t * prevCommandStage = ecsCommandStage;
+    ecsStage = &chunk->stage;
+    ecsCommandStage = &chunk->commands;
+    
+#ifdef ECS_PROFILE
+    ecs_profile_job_t * prevProfileJob = ecsProfileJob;
+    EcsProfile_BeginJob( &chunk->profile, chunk->systemIndex );
+    ecsProfileJob = &chunk->profile;
+#endif
+    
+    if ( ecs.componentStorage[ ecs.systemComponent[ chunk->systemIndex ] ] == ECS_STORAGE_ARCHETYPE ) {
+        if ( chunk->archetypeChunk != NULL ) {
+            Ecs_SystemThinkChunk( chunk->systemIndex, chunk->archetypeChunk, chunk->params );
+        }
+        else {
+            Ecs_SystemThinkArchetypes( chunk->systemIndex, chunk->params );
+        }
+    }
+    else {
+        ecs_component_list_t systemComponents;
+        EcsComponentArray_GetActiveComponents( &ecs.components[ ecs.systemComponent[ chunk->systemIndex ] ], &systemComponents );
+        Ecs_SystemThinkRange( chunk->systemIndex, &systemComponents, chunk->start, chunk->end, chunk->params );
+    }
+    
+#ifdef ECS_PROFILE
+    EcsProfile_EndJob( &chunk->profile );
+    ecsProfileJob = prevProfileJob;
+#endif
+    
+    ecsStage = prevStage;
+    ecsCommandStage = prevCommandStage;
+}
+
+/*=======================================================================================================================================*/
+static uint32_t Ecs_GetArchetypeChunkCount( uint32_t componentIndex ) {
+    uint32_t chunkCount = 0;
+    
+    for ( uint32_t a = 0; a < ecs.archetypeCount; ++a ) {
+        if ( Ecs_ArchetypeHasComponent( a, componentIndex ) == true ) {
+            chunkCount += EcsArchetype_GetChunkCount( ecs.archetypes[ a ] );
+        }
+    }
+    
+    return chunkCount;
+}
+
+/*=======================================================================================================================================*/
+static ecs_system_chunk_t * Ecs_AddSystemChunk( ecs_system_chunk_t * chunk, ecs_system_id_t system, ecs_think_params_t * params, ecs_chunk_t * archetypeChunk, uint32_t start, uint32_t end ) {
+    memset( &chunk->stage, 0, sizeof( ecs_stage_t ) );
+    memset( &chunk->commands, 0, sizeof( ecs_stage_t ) );
+    chunk->params = params;
+    chunk->archetypeChunk = archetypeChunk;
+    chunk->systemIndex = (int32_t) system;
+    chunk->start = start;
+    chunk->end = end;
+    return chunk;
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_RunWave( const ecs_system_id_t * systems, const uint32_t * systemWave, uint32_t count, uint32_t wave, ecs_think_params_t * params ) {
+    uint32_t chunkCount = 0;
+    uint32_t jobCount = 0;
+    
+    /* Work out how many chunks the systems in this wave need */
+    for ( uint32_t i = 0; i < count; ++i ) {
+        if ( systemWave[ i ] == wave ) {
+            uint32_t componentIndex = (uint32_t) ecs.systemComponent[ systems[ i ] ];
+            uint32_t systemChunks = 0;
+            
+            /* Archetype components split on the archetype chunks, component arrays on fixed size ranges */
+            if ( ecs.componentStorage[ componentIndex ] == ECS_STORAGE_ARCHETYPE ) {
+                systemChunks = Ecs_GetArchetypeChunkCount( componentIndex );
+            }
+            else {
+                ecs_component_list_t systemComponents;
+                EcsComponentArray_GetActiveComponents( &ecs.components[ componentIndex ], &systemComponents );
+                systemChunks = (uint32_t) ( ( systemComponents.count + ECS_SYSTEM_CHUNK_SIZE - 1 ) / ECS_SYSTEM_CHUNK_SIZE );
+            }
+            
+            if ( systemChunks == 0 ) {
+                continue;
+            }
+            
+            chunkCount += ( ecs.systemFlags[ systems[ i ] ] & ( ECS_SYSTEM_FLAG_NO_SPLIT | ECS_SYSTEM_FLAG_MAIN_THREAD ) ) != 0 ? 1 : systemChunks;
+        }
+    }
+    
+    if ( chunkCount == 0 ) {
+        return;
+    }
+    
+    ecs_system_chunk_t * chunks = (ecs_system_chunk_t *) Ecs_ScheduleAlloc( sizeof( ecs_system_chunk_t ) * chunkCount );
+    job_decl_t * jobs = (job_decl_t *) Ecs_ScheduleAlloc( sizeof( job_decl_t ) * chunkCount );
+    
+    /* Chunks are laid out in the order of the system list and then the entities in each array, this is
+       the order that their staged messages get committed in */
+    uint32_t chunkIndex = 0;
+    for ( uint32_t i = 0; i < count; ++i ) {
+        if ( systemWave[ i ] != wave ) {
+            continue;
+        }
+        
+        uint32_t componentIndex = (uint32_t) ecs.systemComponent[ systems[ i ] ];
+        uint32_t flags = ecs.systemFlags[ systems[ i ] ];
+        bool_t split = ( flags & ( ECS_SYSTEM_FLAG_NO_SPLIT | ECS_SYSTEM_FLAG_MAIN_THREAD ) ) == 0 ? true : false;
+        uint32_t firstChunk = chunkIndex;
+        
+        if ( ecs.componentStorage[ componentIndex ] == ECS_STORAGE_ARCHETYPE ) {
+            if ( split == false ) {
+                if ( Ecs_GetArchetypeChunkCount( componentIndex ) != 0 ) {
+                    Ecs_AddSystemChunk( &chunks[ chunkIndex++ ], systems[ i ], params, NULL, 0, 0 );
+                }
+            }
+            else {
+                for ( uint32_t a = 0; a < ecs.archetypeCount; ++a ) {
+                    if ( Ecs_ArchetypeHasComponent( a, componentIndex ) == false ) {
+                        continue;
+                    }
+                    
+                    uint32_t archetypeChunks = EcsArchetype_GetChunkCount( ecs.archetypes[ a ] );
+                    for ( uint32_t c = 0; c < archetypeChunks; ++c ) {
+                        Ecs_AddSystemChunk( &chunks[ chunkIndex++ ], systems[ i ], params, EcsArchetype_GetChunk( ecs.archetypes[ a ], c ), 0, 0 );
+                    }
+                }
+            }
+        }
+        else {
+            ecs_component_list_t systemComponents;
+            EcsComponentArray_GetActiveComponents( &ecs.components[ componentIndex ], &systemComponents );
+            
+            uint32_t entityCount = (uint32_t) systemComponents.count;
+            uint32_t chunkSize = ( split == false ) ? entityCount : ECS_SYSTEM_CHUNK_SIZE;
+            
+            for ( uint32_t start = 0; start < entityCount; start += chunkSize ) {
+                uint32_t end = ( entityCount - start > chunkSize ) ? start + chunkSize : entityCount;
+                Ecs_AddSystemChunk( &chunks[ chunkIndex++ ], systems[ i ], params, NULL, start, end );
+            }
+        }
+        
+        if ( ( flags & ECS_SYSTEM_FLAG_MAIN_THREAD ) == 0 ) {
+            for ( uint32_t c = firstChunk; c < chunkIndex; ++c ) {
+                jobs[ jobCount ].func = Ecs_RunChunk;
+                jobs[ jobCount ].arg = &chunks[ c ];
+                ++jobCount;
+            }
+        }
+    }
+    
+    xassert( chunkIndex == chunkCount );
+    
+    job_counter_t counter;
+    Job_CounterInit( &counter );
+    Job_Run( jobs, jobCount, &counter );
+    
+    /* Run the main thread systems while the workers get on with the rest */
+    for ( uint32_t c = 0; c < chunkCount; ++c ) {
+        if ( ( ecs.systemFlags[ chunks[ c ].systemIndex ] & ECS_SYSTEM_FLAG_MAIN_THREAD ) != 0 ) {
+            Ecs_RunChunk( &chunks[ c ] );
+        }
+    }
+    
+    Job_Wait( &counter );
+    
+#ifdef ECS_PROFILE
+    for ( uint32_t c = 0; c < chunkCount; ++c ) {
+        EcsProfile_AddJob( &chunks[ c ].profile );
+    }
+    uint64_t profileStart = Sys_GetTicksNs();
+#endif
+    
+    for ( uint32_t c = 0; c < chunkCount; ++c ) {
+        Ecs_CommitStage( &chunks[ c ].stage );
+    }
+    
+#ifdef ECS_PROFILE
+    EcsProfile_AddPhase( ECS_PROFILE_PHASE_COMMIT, profileStart );
+    profileStart = Sys_GetTicksNs();
+#endif
+    
+    /* Then the structural changes, so the next wave sees the entities as they now are */
+    Ecs_PlayCommands( &chunks[ 0 ].commands, sizeof( ecs_system_chunk_t ), chunkCount );
+    
+#ifdef ECS_PROFILE
+    EcsProfile_AddPhase( ECS_PROFILE_PHASE_COMMANDS, profileStart );
+#endif
+    
+    /* Topics are read in the later waves, sort them while nothing else is running */
+    Ecs_SortTopics();
+}
+
+/*=======================================================================================================================================*/
+void Ecs_RunSystems( const ecs_system_id_t * systems, uint32_t count, ecs_think_params_t * params ) {
+    uint32_t systemWave[ ECS_MAX_SYSTEMS ];
+    uint32_t waveCount = 0;
+    
+    xassert( count <= ECS_MAX_SYSTEMS );
+    xassertmsg( ecsStage == NULL, "ECS : Ecs_RunSystems can't be called from a system\n" );
+    
+    Ecs_ScheduleReset();
+    Ecs_SortTopics();
+    
+    /* Build the dependency graph. A system has to run after any earlier system in the list that it
+       conflicts with, so it goes in the wave after the latest of those. Systems in the same wave
+       don't conflict and can all run at once. */
+    for ( uint32_t i = 0; i < count; ++i ) {
+        xassert( systems[ i ] >= 0 && systems[ i ] < ecs.systemCount );
+        
+        uint32_t wave = 0;
+        for ( uint32_t j = 0; j < i; ++j ) {
+            if ( systemWave[ j ] >= wave && Ecs_SystemsConflict( systems[ i ], systems[ j ] ) == true ) {
+                wave = systemWave[ j ] + 1;
+            }
+        }
+        
+        systemWave[ i ] = wave;
+        waveCount = ( wave + 1 > waveCount ) ? wave + 1 : waveCount;
+    }
+    
+    for ( uint32_t wave = 0; wave < waveCount; ++wave ) {
+        Ecs_RunWave( systems, systemWave, count, wave, params );
+    }
 }
 
 /*=======================================================================================================================================*/
 void Ecs_SendMessage( ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize ) {
-    ecs_entity_info_t * info = &ecs.entityInfo[ ent ];
+    ECS_PROFILE_COUNT( bytesCopied, dataSize );
+    
+    if ( ecsStage != NULL ) {
+        /* Called from a system run by Ecs_RunSystems */
+        Ecs_StageMessage( ecsStage, ECS_STAGE_NO_TOPIC, ent, msgId, data, dataSize );
+        return;
+    }
+    
+    Ecs_SendMessageDirect( ent, msgId, data, dataSize );
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_SendMessageDirect( ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize ) {
+    /* The entity may have been freed since the sender got its handle, the message has nowhere to go */
+    if ( Ecs_EntityIsValid( ent ) == false ) {
+        return;
+    }
     
-    uint32_t ptr = 0;
-    uint32_t newPtr = 0;
-    bool_t loop = true;
+    ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( ent ) );
+    EcsMessage_Push( &info->messages, msgId, data, dataSize );
     
-    do {
-        /* Wait for any current messages being written to commit */
-        while ( Ecs_IsMessageCommited( info ) == false ) {
+    /* First message since the end of the last frame, so put the entity on the dirty list */
+    if ( atomic_exchange( &info->messageDirty, 1 ) == 0 ) {
+        Sys_MutexLock( &ecs.messageDirtyMutex );
+        
+        if ( ecs.messageDirtyCount == ecs.messageDirtySize ) {
+            uint32_t newSize = ( ecs.messageDirtySize == 0 ) ? 256 : ecs.messageDirtySize * 2;
+            uint32_t * dirtyList = (uint32_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( uint32_t ) * newSize );
+            
+            if ( ecs.messageDirtyList != NULL ) {
+                memcpy( dirtyList, ecs.messageDirtyList, sizeof( uint32_t ) * ecs.messageDirtyCount );
+                Mem_Free( ecs.messageDirtyList );
+            }
+            
+            ecs.messageDirtyList = dirtyList;
+            ecs.messageDirtySize = newSize;
+        }
+        
+        ecs.messageDirtyList[ ecs.messageDirtyCount++ ] = ECS_ENTITY_INDEX( ent );
+        Sys_MutexUnlock( &ecs.messageDirtyMutex );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Ecs_Publish( uint16_t topic, ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize ) {
+    xassert( topic < ECS_MAX_TOPICS );
+    ECS_PROFILE_COUNT( bytesCopied, dataSize );
+    
+    if ( ecsStage != NULL ) {
+        /* Called from a system run by Ecs_RunSystems */
+        Ecs_StageMessage( ecsStage, topic, ent, msgId, data, dataSize );
+        return;
+    }
+    
+    Ecs_PublishDirect( topic, ent, msgId, data, dataSize );
+}
+
+/*=======================================================================================================================================*/
+void Ecs_Broadcast( uint16_t msgId, const void * data, size_t dataSize ) {
+    Ecs_Publish( ECS_TOPIC_BROADCAST, ECS_ENTITY_NULL, msgId, data, dataSize );
+}
+
+/*=======================================================================================================================================*/
+static void Ecs_PublishDirect( uint16_t topic, ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize ) {
+    if ( ent != ECS_ENTITY_NULL && Ecs_EntityIsValid( ent ) == false ) {
+        return;
+    }
+    
+    Sys_MutexLock( &ecs.topicMutex );
+    EcsTopic_Publish( &ecs.topics[ topic ], ent, msgId, data, dataSize );
+    Sys_MutexUnlock( &ecs.topicMutex );
+}
+
+/*=======================================================================================================================================*/
+static uint8_t * Ecs_SnapshotSection( uint8_t * base, size_t * offset, size_t size ) {
+    /* Sections start on 16 bytes so the raw component data keeps its alignment */
+    uint8_t * section = base + *offset;
+    *offset = Sys_Align( *offset + size, 16 );
+    return section;
+}
+
+/*=======================================================================================================================================*/
+static bool_t Ecs_SnapshotEntityHasMessages( uint32_t index, uint32_t * countOut, size_t * sizeOut ) {
+    ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( index );
+    ecs_msg_iter_t iter;
+    ecs_msg_t * msg;
+    uint32_t seenCount = atomic_load_explicit( &info->messages.seenCount, memory_order_relaxed );
+    uint32_t count = 0;
+    size_t size = 0;
+    
+    if ( info->alive == false ) {
+        return false;
+    }
+    
+    /* Only the messages that no system has seen yet are still pending */
+    EcsMessage_Begin( &info->messages, &iter );
+    while ( ( msg = EcsMessage_Next( &iter ) ) != NULL ) {
+        if ( iter.count > seenCount ) {
+            size += Sys_Align( msg->size, 8 );
+            ++count;
+        }
+    }
+    
+    *countOut = count;
+    *sizeOut = size;
+    return ( count > 0 ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+size_t Ecs_SnapshotSize(void) {
+    size_t size = 0;
+    
+    Ecs_SnapshotSection( NULL, &size, sizeof( ecs_snapshot_header_t ) );
+    Ecs_SnapshotSection( NULL, &size, sizeof( ecs_snapshot_component_t ) * ecs.componentCount );
+    Ecs_SnapshotSection( NULL, &size, sizeof( uint32_t ) * ecs.entityFreeCount );
+    Ecs_SnapshotSection( NULL, &size, sizeof( ecs_snapshot_entity_t ) * ecs.entityIndexCount );
+    
+    for ( uint32_t c = 0; c < ecs.componentCount; ++c ) {
+        if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARRAY ) {
+            Ecs_SnapshotSection( NULL, &size, EcsComponentArray_GetSnapshotSize( &ecs.components[ c ] ) );
+        }
+    }
+    
+    for ( uint32_t a = 0; a < ecs.archetypeCount; ++a ) {
+        if ( EcsArchetype_GetEntityCount( ecs.archetypes[ a ] ) > 0 ) {
+            Ecs_SnapshotSection( NULL, &size, sizeof( ecs_component_mask_t ) + EcsArchetype_GetSnapshotSize( ecs.archetypes[ a ] ) );
+        }
+    }
+    
+    for ( uint32_t n = 0; n < ecs.messageDirtyCount; ++n ) {
+        uint32_t count;
+        size_t msgSize;
+        
+        if ( Ecs_SnapshotEntityHasMessages( ecs.messageDirtyList[ n ], &count, &msgSize ) == true ) {
+            Ecs_SnapshotSection( NULL, &size, sizeof( ecs_snapshot_messages_t ) + msgSize );
+        }
+    }
+    
+    return size;
+}
+
+/*=======================================================================================================================================*/
+size_t Ecs_SnapshotSave( void * buffer, size_t bufferSize ) {
+    xassertmsg( ecsStage == NULL && ecsCommandStage == NULL, "ECS : Snapshots can't be taken while systems think\n" );
+    
+    size_t size = Ecs_SnapshotSize();
+    if ( size > bufferSize ) {
+        return 0;
+    }
+    
+    uint8_t * base = (uint8_t *) buffer;
+    size_t offset = 0;
+    
+    ecs_snapshot_header_t * header = (ecs_snapshot_header_t *) Ecs_SnapshotSection( base, &offset, sizeof( ecs_snapshot_header_t ) );
+    memset( header, 0, sizeof( ecs_snapshot_header_t ) );
+    header->magic = ECS_SNAPSHOT_MAGIC;
+    header->version = ECS_SNAPSHOT_VERSION;
+    header->size = size;
+    header->componentCount = (uint32_t) ecs.componentCount;
+    header->entityIndexCount = ecs.entityIndexCount;
+    header->entityFreeCount = ecs.entityFreeCount;
+    
+    /* Enough about the components to tell if the snapshot was taken with the same ones registered */
+    ecs_snapshot_component_t * components = (ecs_snapshot_component_t *) Ecs_SnapshotSection( base, &offset, sizeof( ecs_snapshot_component_t ) * ecs.componentCount );
+    for ( uint32_t c = 0; c < ecs.componentCount; ++c ) {
+        components[ c ].nameHash = FH64_CalcFromCStr( ecs.componentTypeNames[ c ] );
+        components[ c ].size = (uint32_t) ecs.componentSizes[ c ];
+        components[ c ].storage = (uint32_t) ecs.componentStorage[ c ];
+        
+        if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARRAY ) {
+            ecs_component_list_t list;
+            EcsComponentArray_GetActiveComponents( &ecs.components[ c ], &list );
+            components[ c ].count = list.count;
+        }
+        else {
+            components[ c ].count = 0;
+        }
+    }
+    
+    uint32_t * freeList = (uint32_t *) Ecs_SnapshotSection( base, &offset, sizeof( uint32_t ) * ecs.entityFreeCount );
+    if ( ecs.entityFreeCount > 0 ) {
+        memcpy( freeList, ecs.entityFreeList, sizeof( uint32_t ) * ecs.entityFreeCount );
+    }
+    
+    /* Pointers into the archetypes and messages aren't kept, they're worked out again on restore */
+    ecs_snapshot_entity_t * entities = (ecs_snapshot_entity_t *) Ecs_SnapshotSection( base, &offset, sizeof( ecs_snapshot_entity_t ) * ecs.entityIndexCount );
+    for ( uint32_t n = 0; n < ecs.entityIndexCount; ++n ) {
+        ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( n );
+        
+        entities[ n ].componentMask = info->componentMask;
+        entities[ n ].componentCount = info->componentCount;
+        entities[ n ].generation = info->generation;
+        entities[ n ].alive = ( info->alive == true ) ? 1 : 0;
+        entities[ n ].pad = 0;
+    }
+    
+    for ( uint32_t c = 0; c < ecs.componentCount; ++c ) {
+        if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARRAY ) {
+            size_t arraySize = EcsComponentArray_GetSnapshotSize( &ecs.components[ c ] );
+            EcsComponentArray_WriteSnapshot( &ecs.components[ c ], Ecs_SnapshotSection( base, &offset, arraySize ) );
+        }
+    }
+    
+    for ( uint32_t a = 0; a < ecs.archetypeCount; ++a ) {
+        if ( EcsArchetype_GetEntityCount( ecs.archetypes[ a ] ) == 0 ) {
+            continue;
         }
         
-        /* Allocate space to write the message. If another thread has
-           gotten there before us, we need to go around again*/
-        ptr = atomic_load( &info->messagePtr );
-        newPtr = ptr + (uint32_t) dataSize;
-        xassert( newPtr <= ECS_MESSAGE_DATA_SIZE );
+        size_t archetypeSize = EcsArchetype_GetSnapshotSize( ecs.archetypes[ a ] );
+        ecs_component_mask_t * mask = (ecs_component_mask_t *) Ecs_SnapshotSection( base, &offset, sizeof( ecs_component_mask_t ) + archetypeSize );
         
-        if ( atomic_compare_exchange_strong( &info->messagePtr, &ptr, newPtr ) ) {
-            /* We wrote the internal working pointer successfully, so bail from the loop */
-            loop = false;
+        *mask = ecs.archetypeMasks[ a ];
+        EcsArchetype_WriteSnapshot( ecs.archetypes[ a ], mask + 1 );
+        ++header->archetypeCount;
+    }
+    
+    for ( uint32_t n = 0; n < ecs.messageDirtyCount; ++n ) {
+        uint32_t index = ecs.messageDirtyList[ n ];
+        uint32_t count;
+        size_t msgSize;
+        
+        if ( Ecs_SnapshotEntityHasMessages( index, &count, &msgSize ) == false ) {
+            continue;
+        }
+        
+        ecs_snapshot_messages_t * messages = (ecs_snapshot_messages_t *) Ecs_SnapshotSection( base, &offset, sizeof( ecs_snapshot_messages_t ) + msgSize );
+        messages->index = index;
+        messages->count = count;
+        
+        ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( index );
+        uint32_t seenCount = atomic_load_explicit( &info->messages.seenCount, memory_order_relaxed );
+        uint8_t * ptr = (uint8_t *) ( messages + 1 );
+        ecs_msg_iter_t iter;
+        ecs_msg_t * msg;
+        
+        EcsMessage_Begin( &info->messages, &iter );
+        while ( ( msg = EcsMessage_Next( &iter ) ) != NULL ) {
+            if ( iter.count > seenCount ) {
+                memcpy( ptr, msg, msg->size );
+                ptr += Sys_Align( msg->size, 8 );
+            }
+        }
+        
+        ++header->messageEntityCount;
+    }
+    
+    xassert( offset == size );
+    return size;
+}
+
+/*=======================================================================================================================================*/
+static bool_t Ecs_SnapshotCheck( const ecs_snapshot_header_t * header, size_t size ) {
+    if ( size < sizeof( ecs_snapshot_header_t ) || header->magic != ECS_SNAPSHOT_MAGIC || header->version != ECS_SNAPSHOT_VERSION || header->size > size ) {
+        xprintf( "ECS : Not an ECS snapshot, or the wrong version\n" );
+        return false;
+    }
+    
+    if ( header->componentCount != ecs.componentCount ) {
+        xprintf( "ECS : Snapshot has %u components, %u are registered\n", header->componentCount, (uint32_t) ecs.componentCount );
+        return false;
+    }
+    
+    size_t offset = Sys_Align( sizeof( ecs_snapshot_header_t ), 16 );
+    const ecs_snapshot_component_t * components = (const ecs_snapshot_component_t *) ( (const uint8_t *) header + offset );
+    
+    for ( uint32_t c = 0; c < ecs.componentCount; ++c ) {
+        if ( components[ c ].nameHash != FH64_CalcFromCStr( ecs.componentTypeNames[ c ] ) || components[ c ].size != ecs.componentSizes[ c ] || components[ c ].storage != (uint32_t) ecs.componentStorage[ c ] ) {
+            xprintf( "ECS : Snapshot component %u doesn't match '%s'\n", c, ecs.componentTypeNames[ c ] );
+            return false;
+        }
+        
+        if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARRAY && components[ c ].count > EcsComponentArray_GetCapacity( &ecs.components[ c ] ) ) {
+            xprintf( "ECS : Snapshot has too many '%s' components\n", ecs.componentTypeNames[ c ] );
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+bool_t Ecs_SnapshotRestore( const void * buffer, size_t bufferSize ) {
+    xassertmsg( ecsStage == NULL && ecsCommandStage == NULL, "ECS : Snapshots can't be restored while systems think\n" );
+    
+    const uint8_t * base = (const uint8_t *) buffer;
+    const ecs_snapshot_header_t * header = (const ecs_snapshot_header_t *) base;
+    
+    if ( Ecs_SnapshotCheck( header, bufferSize ) == false ) {
+        return false;
+    }
+    
+    size_t offset = Sys_Align( sizeof( ecs_snapshot_header_t ), 16 );
+    Ecs_SnapshotSection( NULL, &offset, sizeof( ecs_snapshot_component_t ) * header->componentCount );
+    
+    /* Drop the pending messages, the ones in the snapshot are sent again at the end */
+    for ( uint32_t n = 0; n < ecs.messageDirtyCount; ++n ) {
+        ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( ecs.messageDirtyList[ n ] );
+        EcsMessage_Clear( &info->messages );
+        atomic_store_explicit( &info->messageDirty, 0, memory_order_relaxed );
+    }
+    ecs.messageDirtyCount = 0;
+    
+    for ( int n = 0; n < ECS_MAX_TOPICS; ++n ) {
+        EcsTopic_Reset( &ecs.topics[ n ] );
+    }
+    
+    /* Entities */
+    const uint32_t * freeList = (const uint32_t *) Ecs_SnapshotSection( (uint8_t *) base, &offset, sizeof( uint32_t ) * header->entityFreeCount );
+    
+    if ( header->entityFreeCount > ecs.entityFreeListSize ) {
+        if ( ecs.entityFreeList != NULL ) {
+            Mem_Free( ecs.entityFreeList );
         }
+        uint32_t freeListSize = Sys_Align( header->entityFreeCount, ECS_ENTITY_PAGE_SIZE );
+        ecs.entityFreeListSize = freeListSize;
+        ecs.entityFreeList = (uint32_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( uint32_t ) * ecs.entityFreeListSize );
+    }
+    
+    if ( header->entityFreeCount > 0 ) {
+        memcpy( ecs.entityFreeList, freeList, sizeof( uint32_t ) * header->entityFreeCount );
+    }
+    ecs.entityFreeCount = header->entityFreeCount;
+    
+    while ( ecs.entityPageCount * ECS_ENTITY_PAGE_SIZE < header->entityIndexCount ) {
+        Ecs_AddEntityPage();
+    }
+    
+    const ecs_snapshot_entity_t * entities = (const ecs_snapshot_entity_t *) Ecs_SnapshotSection( (uint8_t *) base, &offset, sizeof( ecs_snapshot_entity_t ) * header->entityIndexCount );
+    
+    for ( uint32_t n = 0; n < header->entityIndexCount; ++n ) {
+        ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( n );
+        
+        info->componentMask = entities[ n ].componentMask;
+        info->componentCount = entities[ n ].componentCount;
+        info->generation = entities[ n ].generation;
+        info->alive = ( entities[ n ].alive != 0 ) ? true : false;
+        info->archetype = NULL;
+        info->chunk = NULL;
+        info->row = 0;
+    }
+    
+    /* Indices handed out since the snapshot was taken go back to never having been used */
+    for ( uint32_t n = header->entityIndexCount; n < ecs.entityIndexCount; ++n ) {
+        ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( n );
         
-    } while( loop == true );
+        memset( &info->componentMask, 0, sizeof( ecs_component_mask_t ) );
+        info->componentCount = 0;
+        info->alive = false;
+        info->archetype = NULL;
+        info->chunk = NULL;
+        info->row = 0;
+    }
+    ecs.entityIndexCount = header->entityIndexCount;
+    
+    /* Components */
+    for ( uint32_t c = 0; c < ecs.componentCount; ++c ) {
+        if ( ecs.componentStorage[ c ] == ECS_STORAGE_ARRAY ) {
+            size_t arraySize = EcsComponentArray_ReadSnapshot( &ecs.components[ c ], base + offset );
+            Ecs_SnapshotSection( NULL, &offset, arraySize );
+        }
+    }
     
-    /* Write the message and update the commited memory pointer */
-    ecs_msg_t * msg = (ecs_msg_t*)(info->messageBuffer + ptr);
-    memcpy( msg, data, dataSize );
+    for ( uint32_t a = 0; a < ecs.archetypeCount; ++a ) {
+        EcsArchetype_Clear( ecs.archetypes[ a ] );
+    }
+    
+    for ( uint32_t n = 0; n < header->archetypeCount; ++n ) {
+        const ecs_component_mask_t * mask = (const ecs_component_mask_t *) ( base + offset );
+        ecs_archetype_t * archetype = Ecs_FindArchetype( mask );
+        size_t archetypeSize = EcsArchetype_ReadSnapshot( archetype, mask + 1 );
+        
+        Ecs_SnapshotSection( NULL, &offset, sizeof( ecs_component_mask_t ) + archetypeSize );
+        
+        /* The only fix up, pointing the entities at their rows */
+        uint32_t chunkCount = EcsArchetype_GetChunkCount( archetype );
+        for ( uint32_t c = 0; c < chunkCount; ++c ) {
+            ecs_chunk_t * chunk = EcsArchetype_GetChunk( archetype, c );
+            const ecs_entity_t * chunkEntities = EcsChunk_GetEntities( chunk );
+            uint32_t count = EcsChunk_GetCount( chunk );
+            
+            for ( uint32_t row = 0; row < count; ++row ) {
+                ecs_entity_info_t * info = Ecs_GetEntityInfoByIndex( ECS_ENTITY_INDEX( chunkEntities[ row ] ) );
+                info->archetype = archetype;
+                info->chunk = chunk;
+                info->row = row;
+            }
+        }
+    }
     
-    /* Need to fill in the header info */
-    msg->msg  = msgId;
-    msg->size = dataSize;
-    msg->seen = 0;
+    /* Messages */
+    for ( uint32_t n = 0; n < header->messageEntityCount; ++n ) {
+        const ecs_snapshot_messages_t * messages = (const ecs_snapshot_messages_t *) ( base + offset );
+        ecs_entity_t ent = ECS_ENTITY_MAKE( messages->index, Ecs_GetEntityInfoByIndex( messages->index )->generation );
+        const uint8_t * ptr = (const uint8_t *) ( messages + 1 );
+        
+        for ( uint32_t m = 0; m < messages->count; ++m ) {
+            const ecs_msg_t * msg = (const ecs_msg_t *) ptr;
+            Ecs_SendMessageDirect( ent, msg->msg, msg, msg->size );
+            ptr += Sys_Align( msg->size, 8 );
+        }
+        
+        Ecs_SnapshotSection( NULL, &offset, (size_t) ( ptr - (const uint8_t *) messages ) );
+    }
     
-    atomic_store( &info->messageCommitPtr, newPtr );
+    xassert( offset == header->size );
+    return true;
 }
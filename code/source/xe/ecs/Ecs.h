@@ -24,29 +24,146 @@
 #include "core/Platform.h"
 #include "ecs/EcsTypes.h"
 
+/*
+    Every component struct has an id that is set when it is registered. ECS_COMPONENT_DECLARE goes in the header
+    with the struct and ECS_COMPONENT_DEFINE in one source file, the typed macros then go straight to the id
+    rather than looking up the name.
+*/
+#define ECS_COMPONENT_ID( __struct__ ) __struct__##_ecsId
+#define ECS_COMPONENT_DECLARE( __struct__ ) extern ecs_component_id_t ECS_COMPONENT_ID( __struct__ )
+#define ECS_COMPONENT_DEFINE( __struct__ ) ecs_component_id_t ECS_COMPONENT_ID( __struct__ ) = ECS_COMPONENT_INVALID
+
 #define Ecs_RegisterSystem( __system__, __struct__ ) Ecs_RegisterSystemNamed( __system__, #__struct__ )
-#define Ecs_RegisterComponent( __struct__, __capacity__) Ecs_RegisterNamedComponent( #__struct__, __capacity__, sizeof(__struct__) )
-#define Ecs_AddComponent( __ent__, __struct__ ) (__struct__*) Ecs_AddNamedComponent( __ent__, #__struct__ )
-#define Ecs_GetEntityComponentIndex( __ent__, __struct__ ) Ecs_GetEntityNamedComponentIndex( __ent__, #__struct__ )
+#define Ecs_RegisterComponent( __struct__, __capacity__) ( ECS_COMPONENT_ID( __struct__ ) = Ecs_RegisterNamedComponent( #__struct__, __capacity__, sizeof(__struct__) ) )
+#define Ecs_RegisterArchetypeComponent( __struct__ ) ( ECS_COMPONENT_ID( __struct__ ) = Ecs_RegisterNamedComponentStorage( #__struct__, 0, sizeof(__struct__), ECS_STORAGE_ARCHETYPE ) )
+#define Ecs_AddComponent( __ent__, __struct__ ) ( (__struct__*) Ecs_AddComponentById( __ent__, ECS_COMPONENT_ID( __struct__ ) ) )
+#define Ecs_GetComponent( __ent__, __struct__ ) ( (__struct__*) Ecs_GetComponentById( __ent__, ECS_COMPONENT_ID( __struct__ ) ) )
+#define Ecs_HasComponent( __ent__, __struct__ ) Ecs_HasComponentById( __ent__, ECS_COMPONENT_ID( __struct__ ) )
+#define Ecs_RemoveComponent( __ent__, __struct__ ) Ecs_RemoveComponentById( __ent__, ECS_COMPONENT_ID( __struct__ ) )
+#define Ecs_DeferAddComponent( __ent__, __struct__, __data__ ) Ecs_DeferAddComponentById( __ent__, ECS_COMPONENT_ID( __struct__ ), __data__ )
+#define Ecs_DeferRemoveComponent( __ent__, __struct__ ) Ecs_DeferRemoveComponentById( __ent__, ECS_COMPONENT_ID( __struct__ ) )
+#define Ecs_GetEntityComponentIndex( __ent__, __struct__ ) ( Ecs_HasComponentById( __ent__, ECS_COMPONENT_ID( __struct__ ) ) == true ? ECS_COMPONENT_ID( __struct__ ) : ECS_COMPONENT_INVALID )
+#define Ecs_BlueprintAdd( __blueprint__, __struct__, __defaults__ ) ( (__struct__*) Ecs_BlueprintAddById( __blueprint__, ECS_COMPONENT_ID( __struct__ ), __defaults__ ) )
+#define Ecs_SystemReads( __system__, __struct__ ) Ecs_SystemDeclareAccess( __system__, #__struct__, ECS_ACCESS_READ )
+#define Ecs_SystemWrites( __system__, __struct__ ) Ecs_SystemDeclareAccess( __system__, #__struct__, ECS_ACCESS_WRITE )
+#define Ecs_QueryAdd( __query__, __struct__ ) Ecs_QueryAddNamed( __query__, #__struct__ )
 
 XE_API void Ecs_Initialise(void);
 XE_API void Ecs_Finalise(void);
-XE_API void Ecs_RegisterNamedComponent( const char * name, size_t capacity, size_t structSize );
+XE_API ecs_component_id_t Ecs_RegisterNamedComponent( const char * name, size_t capacity, size_t structSize );
+XE_API ecs_component_id_t Ecs_RegisterNamedComponentStorage( const char * name, size_t capacity, size_t structSize, ecs_storage_t storage );
 XE_API ecs_entity_t Ecs_EntityAlloc(void);
 XE_API void Ecs_EntityFree( ecs_entity_t ent );
+XE_API bool_t Ecs_EntityIsValid( ecs_entity_t ent );
+XE_API uint32_t Ecs_GetEntityCount(void);
 XE_API void * Ecs_AddNamedComponent( ecs_entity_t ent, const char * compName );
 XE_API void * Ecs_AddHashedNamedComponent( ecs_entity_t ent, const char * compName );
+XE_API void * Ecs_AddComponentById( ecs_entity_t ent, ecs_component_id_t id );
+XE_API void * Ecs_GetComponentById( ecs_entity_t ent, ecs_component_id_t id );
+XE_API void Ecs_RemoveComponentById( ecs_entity_t ent, ecs_component_id_t id );
+XE_API bool_t Ecs_HasComponentById( ecs_entity_t ent, ecs_component_id_t id );
 XE_API int32_t Ecs_GetComponentArrayIndex( const char * name );
 XE_API ecs_system_id_t Ecs_RegisterSystemNamed( ecs_system_t * system, const char * componentName );
 XE_API void Ecs_EntityConstructDefault( ecs_entity_t ent );
 XE_API int32_t Ecs_GetEntityNamedComponentIndex( ecs_entity_t ent, const char * name );
 XE_API void * Ecs_GetEntityIndexedComponent( ecs_entity_t ent, int32_t index );
 
+/*
+    Blueprints hold a set of components and their default values. Spawning from a blueprint allocates all of the
+    entities and their components in one go, copies in the defaults and then runs the constructors of the
+    component systems, component by component. The defaults are copied when a component is added and the
+    returned pointer can be used to fill them in.
+*/
+XE_API void Ecs_BlueprintInit( ecs_blueprint_t * blueprint );
+XE_API void Ecs_BlueprintDestroy( ecs_blueprint_t * blueprint );
+XE_API void * Ecs_BlueprintAddById( ecs_blueprint_t * blueprint, ecs_component_id_t id, const void * defaults );
+XE_API void Ecs_BlueprintSpawn( ecs_blueprint_t * blueprint, uint32_t count, ecs_entity_t * entsOut );
+
+/*
+    Entities can't be spawned, freed or have components added or removed while a system thinks, the other systems
+    may be walking the same arrays. The deferred functions record the change in a buffer for the system job and
+    the buffers are played back once the wave of systems has finished, or once Ecs_SystemThink has. Playback
+    does the spawns first, then the adds, removes and frees in the order they were recorded, taking the buffers
+    of the wave's jobs in turn. Commands for entities that have been freed by then are dropped.
+ 
+    A deferred spawn returns a pending handle that can be passed to the other deferred functions until playback,
+    nothing else understands it. The blueprint has to stay around until playback. Outside of a system the
+    deferred functions make the change straight away.
+*/
+XE_API ecs_entity_t Ecs_DeferSpawn( ecs_blueprint_t * blueprint );
+XE_API void Ecs_DeferFree( ecs_entity_t ent );
+XE_API void Ecs_DeferAddComponentById( ecs_entity_t ent, ecs_component_id_t id, const void * data );
+XE_API void Ecs_DeferRemoveComponentById( ecs_entity_t ent, ecs_component_id_t id );
+
+XE_API void Ecs_SystemDeclareAccess( ecs_system_id_t system, const char * componentName, uint32_t access );
+XE_API void Ecs_SystemSetFlags( ecs_system_id_t system, uint32_t flags );
+
+/*
+    A system with a thinkBatch function is passed runs of its components rather than having think called for each
+    entity, a range of a component array or an archetype chunk at a time. The components in a run are stride bytes
+    apart so the loop over them can be done without calls. The message function is still called for each entity,
+    every entity in the run gets its messages before the run thinks.
+*/
 XE_API void Ecs_SystemThink( int32_t systemIndex, ecs_think_params_t * params );
+XE_API void Ecs_RunSystems( const ecs_system_id_t * systems, uint32_t count, ecs_think_params_t * params );
 XE_API void Ecs_SendMessage( ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize );
 
+/*
+    Topics are message streams shared by all of the entities, a message published to a topic is written once
+    rather than into the queue of the entity. Systems subscribed to a topic get the messages for each entity
+    passed to their message function after the entity's own messages, a message published for ECS_ENTITY_NULL
+    goes to every entity of every subscriber. Ecs_Broadcast publishes to ECS_TOPIC_BROADCAST which every system
+    with a message function is subscribed to, so it counts as sending messages when scheduling.
+ 
+    The messages are shared, so they must not be changed by the message functions. Topics are cleared at the
+    end of the frame, a subscriber that thinks before a message is published doesn't get it. Messages sent or
+    published by a system are held until the wave of systems, or the Ecs_SystemThink, has finished.
+*/
+XE_API void Ecs_SystemPublishTopic( ecs_system_id_t system, uint16_t topic );
+XE_API void Ecs_SystemSubscribeTopic( ecs_system_id_t system, uint16_t topic );
+XE_API void Ecs_Publish( uint16_t topic, ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize );
+XE_API void Ecs_Broadcast( uint16_t msgId, const void * data, size_t dataSize );
+XE_API void Ecs_TopicBegin( uint16_t topic, ecs_topic_iter_t * iter );
+XE_API void Ecs_TopicBeginEntity( uint16_t topic, ecs_entity_t ent, ecs_topic_iter_t * iter );
+XE_API const ecs_msg_t * Ecs_TopicNext( ecs_topic_iter_t * iter, ecs_entity_t * ent );
+
+/*
+    Queries walk the archetype chunks that have all of the query components, each view is one chunk with a
+    column per query component in the order they were added. Only archetype stored components can be queried.
+ 
+    Adding or removing an archetype component or freeing an entity moves entities between chunks, so component pointers
+    and views are only valid until the next add or free.
+*/
+XE_API void Ecs_QueryInit( ecs_query_t * query );
+XE_API void Ecs_QueryAddNamed( ecs_query_t * query, const char * componentName );
+XE_API void Ecs_QueryBegin( const ecs_query_t * query, ecs_query_iter_t * iter );
+XE_API bool_t Ecs_QueryNext( ecs_query_iter_t * iter, ecs_chunk_view_t * view );
+
 XE_API void Ecs_EndFrame(void);
 
+/*
+    Profiling times each system job and counts the entities it thought about, the messages passed to its message
+    function and the bytes of messages and deferred commands it wrote. Each frame ends at Ecs_EndFrame and the
+    last ECS_PROFILE_FRAMES - 1 are kept, framesAgo 0 being the last one that ended. The trace is the Chrome trace
+    event format, for chrome://tracing or Perfetto. Profiling is only compiled in when ECS_PROFILE is defined,
+    which it is for debug builds, otherwise there are no frames.
+*/
+XE_API uint32_t Ecs_ProfileGetFrameCount(void);
+XE_API bool_t Ecs_ProfileGetFrame( uint32_t framesAgo, ecs_profile_frame_t * frameOut );
+XE_API bool_t Ecs_ProfileDumpTrace( const char * path );
+
+/*
+    A snapshot is the entities, the component arrays and archetype chunks as raw memory and the messages that
+    haven't been seen yet, in one buffer that can be written to a file and mapped back in. Restoring copies the
+    memory back and only works out again which chunk and row each entity is in, the constructors and destructors
+    of the systems aren't run and pointers held in components are copied as they are. The snapshot has to be
+    restored with the same components registered, in the same order and with the same sizes, and with room in
+    the component arrays. Topics are cleared. Neither can be done while systems think.
+*/
+XE_API size_t Ecs_SnapshotSize(void);
+XE_API size_t Ecs_SnapshotSave( void * buffer, size_t bufferSize );
+XE_API bool_t Ecs_SnapshotRestore( const void * buffer, size_t bufferSize );
+
 
 
 #endif
@@ -0,0 +1,365 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "ecs/EcsArchetype.h"
+#include "core/Sys.h"
+#include "mem/Mem.h"
+#include <assert.h>
+#include <string.h>
+
+#define ECS_CHUNK_ALIGN         64
+#define ECS_COLUMN_ALIGN        16
+#define ECS_COLUMN_NONE         0xFF
+
+struct ecs_archetype_s {
+    ecs_component_mask_t    mask;
+    uint32_t                componentCount;
+    uint32_t                components[ ECS_ARCHETYPE_MAX_COMPONENTS ];         /* Component types in ascending order */
+    uint32_t                componentSizes[ ECS_ARCHETYPE_MAX_COMPONENTS ];
+    uint32_t                columnOffsets[ ECS_ARCHETYPE_MAX_COMPONENTS ];      /* Offset of each column from the start of the chunk */
+    uint8_t                 columnLookup[ ECS_MAX_COMPONENT_TYPES ];            /* Column of a component type or ECS_COLUMN_NONE */
+    uint32_t                entityOffset;
+    uint32_t                chunkDataEnd;                                       /* End of the last column */
+    uint32_t                chunkCapacity;                                      /* Entities per chunk */
+    uint32_t                entityCount;
+    
+    ecs_chunk_t **          chunks;
+    uint32_t                chunkCount;                                         /* Chunks allocated, chunks past the entity count are empty and kept for reuse */
+    uint32_t                chunkArraySize;
+};
+
+typedef struct ecs_archetype_snapshot_s {
+    uint32_t                entityCount;
+    uint32_t                chunkCount;
+    uint32_t                chunkDataSize;                                      /* Bytes of each chunk from the entity ids on */
+    uint32_t                pad;
+} ecs_archetype_snapshot_t;
+
+struct ecs_chunk_s {
+    ecs_archetype_t *       archetype;
+    uint32_t                count;
+    uint32_t                index;
+};
+
+/*=======================================================================================================================================*/
+static uint32_t EcsArchetype_CalcLayout( ecs_archetype_t * self_, uint32_t capacity ) {
+    /* Lay out the entity ids then each column, returns the end of the data */
+    uint32_t offset = (uint32_t) Sys_Align( sizeof( ecs_chunk_t ), ECS_COLUMN_ALIGN );
+    
+    self_->entityOffset = offset;
+    offset += (uint32_t) sizeof( ecs_entity_t ) * capacity;
+    
+    for ( uint32_t n = 0; n < self_->componentCount; ++n ) {
+        offset = (uint32_t) Sys_Align( offset, ECS_COLUMN_ALIGN );
+        self_->columnOffsets[ n ] = offset;
+        offset += self_->componentSizes[ n ] * capacity;
+    }
+    
+    return offset;
+}
+
+/*=======================================================================================================================================*/
+ecs_archetype_t * EcsArchetype_Create( const ecs_component_mask_t * mask, const uint32_t * components, const size_t * componentSizes, uint32_t count ) {
+    xassert( count <= ECS_ARCHETYPE_MAX_COMPONENTS );
+    
+    ecs_archetype_t * self_ = (ecs_archetype_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( ecs_archetype_t ) );
+    memset( self_, 0, sizeof( ecs_archetype_t ) );
+    memset( self_->columnLookup, ECS_COLUMN_NONE, sizeof( self_->columnLookup ) );
+    
+    self_->mask = *mask;
+    self_->componentCount = count;
+    
+    uint32_t rowSize = sizeof( ecs_entity_t );
+    for ( uint32_t n = 0; n < count; ++n ) {
+        xassert( n == 0 || components[ n ] > components[ n - 1 ] );
+        self_->components[ n ] = components[ n ];
+        self_->componentSizes[ n ] = (uint32_t) componentSizes[ n ];
+        self_->columnLookup[ components[ n ] ] = (uint8_t) n;
+        rowSize += (uint32_t) componentSizes[ n ];
+    }
+    
+    /* Start from the capacity ignoring the column alignment and back off until everything fits */
+    uint32_t capacity = ( ECS_ARCHETYPE_CHUNK_SIZE - (uint32_t) sizeof( ecs_chunk_t ) ) / rowSize;
+    while ( capacity > 1 && EcsArchetype_CalcLayout( self_, capacity ) > ECS_ARCHETYPE_CHUNK_SIZE ) {
+        --capacity;
+    }
+    
+    self_->chunkDataEnd = EcsArchetype_CalcLayout( self_, capacity );
+    xassertmsg( self_->chunkDataEnd <= ECS_ARCHETYPE_CHUNK_SIZE, "ECS : Components are too big to fit an archetype chunk\n" );
+    self_->chunkCapacity = capacity;
+    
+    return self_;
+}
+
+/*=======================================================================================================================================*/
+void EcsArchetype_Destroy( ecs_archetype_t * self_ ) {
+    for ( uint32_t n = 0; n < self_->chunkCount; ++n ) {
+        Mem_Free( self_->chunks[ n ] );
+    }
+    
+    if ( self_->chunks != NULL ) {
+        Mem_Free( self_->chunks );
+    }
+    
+    Mem_Free( self_ );
+}
+
+/*=======================================================================================================================================*/
+const ecs_component_mask_t * EcsArchetype_GetMask( const ecs_archetype_t * self_ ) {
+    return &self_->mask;
+}
+
+/*=======================================================================================================================================*/
+uint32_t EcsArchetype_GetEntityCount( const ecs_archetype_t * self_ ) {
+    return self_->entityCount;
+}
+
+/*=======================================================================================================================================*/
+uint32_t EcsArchetype_GetChunkCount( const ecs_archetype_t * self_ ) {
+    /* Only the chunks that hold entities */
+    return ( self_->entityCount + self_->chunkCapacity - 1 ) / self_->chunkCapacity;
+}
+
+/*=======================================================================================================================================*/
+ecs_chunk_t * EcsArchetype_GetChunk( const ecs_archetype_t * self_, uint32_t index ) {
+    xassert( index < self_->chunkCount );
+    return self_->chunks[ index ];
+}
+
+/*=======================================================================================================================================*/
+uint32_t EcsArchetype_GetChunkCapacity( const ecs_archetype_t * self_ ) {
+    return self_->chunkCapacity;
+}
+
+/*=======================================================================================================================================*/
+static ecs_chunk_t * EcsArchetype_GetTailChunk( ecs_archetype_t * self_ ) {
+    uint32_t chunkIndex = self_->entityCount / self_->chunkCapacity;
+    
+    if ( chunkIndex == self_->chunkCount ) {
+        /* All of the chunks are full */
+        if ( self_->chunkCount == self_->chunkArraySize ) {
+            uint32_t newSize = ( self_->chunkArraySize == 0 ) ? 8 : self_->chunkArraySize * 2;
+            ecs_chunk_t ** chunks = (ecs_chunk_t **) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( ecs_chunk_t * ) * newSize );
+            
+            if ( self_->chunks != NULL ) {
+                memcpy( chunks, self_->chunks, sizeof( ecs_chunk_t * ) * self_->chunkCount );
+                Mem_Free( self_->chunks );
+            }
+            
+            self_->chunks = chunks;
+            self_->chunkArraySize = newSize;
+        }
+        
+        ecs_chunk_t * chunk = (ecs_chunk_t *) Mem_HeapAllocAligned( MEM_HEAP_ECS, ECS_ARCHETYPE_CHUNK_SIZE, ECS_CHUNK_ALIGN );
+        chunk->archetype = self_;
+        chunk->count = 0;
+        chunk->index = self_->chunkCount;
+        
+        self_->chunks[ self_->chunkCount ] = chunk;
+        ++self_->chunkCount;
+    }
+    
+    return self_->chunks[ chunkIndex ];
+}
+
+/*=======================================================================================================================================*/
+uint32_t EcsArchetype_AddEntity( ecs_archetype_t * self_, ecs_entity_t ent, ecs_chunk_t ** chunkOut ) {
+    ecs_chunk_t * chunk = EcsArchetype_GetTailChunk( self_ );
+    uint32_t row = chunk->count;
+    
+    ecs_entity_t * entities = (ecs_entity_t *) ( (uint8_t *) chunk + self_->entityOffset );
+    entities[ row ] = ent;
+    
+    ++chunk->count;
+    ++self_->entityCount;
+    
+    *chunkOut = chunk;
+    return row;
+}
+
+/*=======================================================================================================================================*/
+uint32_t EcsArchetype_AddEntities( ecs_archetype_t * self_, const ecs_entity_t * ents, uint32_t count, ecs_chunk_t ** chunkOut, uint32_t * rowOut ) {
+    /* Fill up the space left in the last chunk, the caller comes back for the rest */
+    ecs_chunk_t * chunk = EcsArchetype_GetTailChunk( self_ );
+    uint32_t row = chunk->count;
+    uint32_t added = self_->chunkCapacity - row;
+    
+    if ( added > count ) {
+        added = count;
+    }
+    
+    ecs_entity_t * entities = (ecs_entity_t *) ( (uint8_t *) chunk + self_->entityOffset );
+    memcpy( entities + row, ents, sizeof( ecs_entity_t ) * added );
+    
+    chunk->count += added;
+    self_->entityCount += added;
+    
+    *chunkOut = chunk;
+    *rowOut = row;
+    return added;
+}
+
+/*=======================================================================================================================================*/
+ecs_entity_t EcsArchetype_RemoveEntity( ecs_archetype_t * self_, ecs_chunk_t * chunk, uint32_t row ) {
+    xassert( chunk->archetype == self_ );
+    xassert( row < chunk->count );
+    
+    /* Move the last entity of the archetype down into the row being removed */
+    uint32_t lastIndex = self_->entityCount - 1;
+    ecs_chunk_t * lastChunk = self_->chunks[ lastIndex / self_->chunkCapacity ];
+    uint32_t lastRow = lastIndex % self_->chunkCapacity;
+    ecs_entity_t movedEnt = ECS_ENTITY_NULL;
+    
+    if ( lastChunk != chunk || lastRow != row ) {
+        EcsArchetype_CopyEntity( chunk, row, lastChunk, lastRow );
+        
+        ecs_entity_t * entities = (ecs_entity_t *) ( (uint8_t *) chunk + self_->entityOffset );
+        ecs_entity_t * lastEntities = (ecs_entity_t *) ( (uint8_t *) lastChunk + self_->entityOffset );
+        entities[ row ] = lastEntities[ lastRow ];
+        movedEnt = entities[ row ];
+    }
+    
+    --lastChunk->count;
+    --self_->entityCount;
+    
+    return movedEnt;
+}
+
+/*=======================================================================================================================================*/
+void EcsArchetype_CopyEntity( ecs_chunk_t * dstChunk, uint32_t dstRow, const ecs_chunk_t * srcChunk, uint32_t srcRow ) {
+    const ecs_archetype_t * dst = dstChunk->archetype;
+    const ecs_archetype_t * src = srcChunk->archetype;
+    
+    /* Copy the components that both archetypes have, the component lists are sorted so walk them together */
+    uint32_t s = 0;
+    for ( uint32_t d = 0; d < dst->componentCount; ++d ) {
+        while ( s < src->componentCount && src->components[ s ] < dst->components[ d ] ) {
+            ++s;
+        }
+        
+        if ( s < src->componentCount && src->components[ s ] == dst->components[ d ] ) {
+            uint32_t size = dst->componentSizes[ d ];
+            memcpy( (uint8_t *) dstChunk + dst->columnOffsets[ d ] + size * dstRow,
+                    (const uint8_t *) srcChunk + src->columnOffsets[ s ] + size * srcRow, size );
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+void EcsArchetype_Clear( ecs_archetype_t * self_ ) {
+    /* The chunks are kept for reuse */
+    for ( uint32_t n = 0; n < self_->chunkCount; ++n ) {
+        self_->chunks[ n ]->count = 0;
+    }
+    
+    self_->entityCount = 0;
+}
+
+/*=======================================================================================================================================*/
+size_t EcsArchetype_GetSnapshotSize( const ecs_archetype_t * self_ ) {
+    return sizeof( ecs_archetype_snapshot_t ) + (size_t) EcsArchetype_GetChunkCount( self_ ) * ( self_->chunkDataEnd - self_->entityOffset );
+}
+
+/*=======================================================================================================================================*/
+size_t EcsArchetype_WriteSnapshot( const ecs_archetype_t * self_, void * dst ) {
+    ecs_archetype_snapshot_t * header = (ecs_archetype_snapshot_t *) dst;
+    uint32_t chunkDataSize = self_->chunkDataEnd - self_->entityOffset;
+    
+    header->entityCount = self_->entityCount;
+    header->chunkCount = EcsArchetype_GetChunkCount( self_ );
+    header->chunkDataSize = chunkDataSize;
+    header->pad = 0;
+    
+    uint8_t * ptr = (uint8_t *) ( header + 1 );
+    for ( uint32_t n = 0; n < header->chunkCount; ++n ) {
+        memcpy( ptr, (const uint8_t *) self_->chunks[ n ] + self_->entityOffset, chunkDataSize );
+        ptr += chunkDataSize;
+    }
+    
+    return sizeof( ecs_archetype_snapshot_t ) + (size_t) header->chunkCount * chunkDataSize;
+}
+
+/*=======================================================================================================================================*/
+size_t EcsArchetype_ReadSnapshot( ecs_archetype_t * self_, const void * src ) {
+    const ecs_archetype_snapshot_t * header = (const ecs_archetype_snapshot_t *) src;
+    uint32_t chunkDataSize = self_->chunkDataEnd - self_->entityOffset;
+    
+    xassert( header->chunkDataSize == chunkDataSize );
+    
+    EcsArchetype_Clear( self_ );
+    
+    /* Every chunk but the last is full, so the tail chunk is always the next one to fill */
+    const uint8_t * ptr = (const uint8_t *) ( header + 1 );
+    for ( uint32_t n = 0; n < header->chunkCount; ++n ) {
+        ecs_chunk_t * chunk = EcsArchetype_GetTailChunk( self_ );
+        uint32_t count = header->entityCount - self_->entityCount;
+        
+        memcpy( (uint8_t *) chunk + self_->entityOffset, ptr, chunkDataSize );
+        ptr += chunkDataSize;
+        
+        chunk->count = ( count < self_->chunkCapacity ) ? count : self_->chunkCapacity;
+        self_->entityCount += chunk->count;
+    }
+    
+    xassert( self_->entityCount == header->entityCount );
+    
+    return sizeof( ecs_archetype_snapshot_t ) + (size_t) header->chunkCount * chunkDataSize;
+}
+
+/*=======================================================================================================================================*/
+uint32_t EcsChunk_GetCount( const ecs_chunk_t * self_ ) {
+    return self_->count;
+}
+
+/*=======================================================================================================================================*/
+ecs_entity_t * EcsChunk_GetEntities( ecs_chunk_t * self_ ) {
+    return (ecs_entity_t *) ( (uint8_t *) self_ + self_->archetype->entityOffset );
+}
+
+/*=======================================================================================================================================*/
+void * EcsChunk_GetColumn( ecs_chunk_t * self_, uint32_t componentType ) {
+    xassert( componentType < ECS_MAX_COMPONENT_TYPES );
+    
+    uint8_t column = self_->archetype->columnLookup[ componentType ];
+    if ( column == ECS_COLUMN_NONE ) {
+        return NULL;
+    }
+    
+    return (uint8_t *) self_ + self_->archetype->columnOffsets[ column ];
+}
+
+/*=======================================================================================================================================*/
+void * EcsChunk_GetComponent( ecs_chunk_t * self_, uint32_t row, uint32_t componentType ) {
+    xassert( componentType < ECS_MAX_COMPONENT_TYPES );
+    xassert( row < self_->count );
+    
+    uint8_t column = self_->archetype->columnLookup[ componentType ];
+    if ( column == ECS_COLUMN_NONE ) {
+        return NULL;
+    }
+    
+    return (uint8_t *) self_ + self_->archetype->columnOffsets[ column ] + self_->archetype->componentSizes[ column ] * row;
+}
+
+/*=======================================================================================================================================*/
+size_t EcsChunk_GetComponentSize( const ecs_chunk_t * self_, uint32_t componentType ) {
+    uint8_t column = self_->archetype->columnLookup[ componentType ];
+    return ( column == ECS_COLUMN_NONE ) ? 0 : self_->archetype->componentSizes[ column ];
+}
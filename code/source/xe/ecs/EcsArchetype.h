@@ -0,0 +1,63 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __ECSARCHETYPE_H__
+#define __ECSARCHETYPE_H__
+
+#include "core/Platform.h"
+#include "ecs/EcsTypes.h"
+
+/*
+    An archetype holds every entity that has the same set of archetype stored components. The entities
+    are packed into fixed size chunks, each chunk has the entity ids followed by one column per component,
+    so iterating several components of the entities is a walk over a few contiguous arrays.
+ 
+    Rows are kept dense, removing an entity moves the last entity of the archetype into the hole.
+*/
+
+typedef struct ecs_archetype_s ecs_archetype_t;
+typedef struct ecs_chunk_s ecs_chunk_t;
+
+XE_API ecs_archetype_t *        EcsArchetype_Create( const ecs_component_mask_t * mask, const uint32_t * components, const size_t * componentSizes, uint32_t count );
+XE_API void                     EcsArchetype_Destroy( ecs_archetype_t * self_ );
+XE_API const ecs_component_mask_t * EcsArchetype_GetMask( const ecs_archetype_t * self_ );
+XE_API uint32_t                 EcsArchetype_GetEntityCount( const ecs_archetype_t * self_ );
+XE_API uint32_t                 EcsArchetype_GetChunkCount( const ecs_archetype_t * self_ );
+XE_API ecs_chunk_t *            EcsArchetype_GetChunk( const ecs_archetype_t * self_, uint32_t index );
+XE_API uint32_t                 EcsArchetype_GetChunkCapacity( const ecs_archetype_t * self_ );
+
+XE_API uint32_t                 EcsArchetype_AddEntity( ecs_archetype_t * self_, ecs_entity_t ent, ecs_chunk_t ** chunkOut );
+XE_API uint32_t                 EcsArchetype_AddEntities( ecs_archetype_t * self_, const ecs_entity_t * ents, uint32_t count, ecs_chunk_t ** chunkOut, uint32_t * rowOut );
+XE_API ecs_entity_t             EcsArchetype_RemoveEntity( ecs_archetype_t * self_, ecs_chunk_t * chunk, uint32_t row );
+XE_API void                     EcsArchetype_CopyEntity( ecs_chunk_t * dstChunk, uint32_t dstRow, const ecs_chunk_t * srcChunk, uint32_t srcRow );
+XE_API void                     EcsArchetype_Clear( ecs_archetype_t * self_ );
+
+/* Snapshots are the raw chunks, the chunk layout only depends on the components so they can be copied straight back */
+XE_API size_t                   EcsArchetype_GetSnapshotSize( const ecs_archetype_t * self_ );
+XE_API size_t                   EcsArchetype_WriteSnapshot( const ecs_archetype_t * self_, void * dst );
+XE_API size_t                   EcsArchetype_ReadSnapshot( ecs_archetype_t * self_, const void * src );
+
+XE_API uint32_t                 EcsChunk_GetCount( const ecs_chunk_t * self_ );
+XE_API ecs_entity_t *           EcsChunk_GetEntities( ecs_chunk_t * self_ );
+XE_API void *                   EcsChunk_GetColumn( ecs_chunk_t * self_, uint32_t componentType );
+XE_API void *                   EcsChunk_GetComponent( ecs_chunk_t * self_, uint32_t row, uint32_t componentType );
+XE_API size_t                   EcsChunk_GetComponentSize( const ecs_chunk_t * self_, uint32_t componentType );
+
+#endif
@@ -32,12 +32,18 @@ typedef struct ecs_array_data_s {
     size_t          componentCapacity;          /* Maximum number of components */
     void **         componentPointers;          /* Array of pointers to the data for each component in the array */
     
-    ecs_component_index_t * entityComponentMap;     /* Quick look-up of component indices by entity id */
+    ecs_component_index_t * entityComponentMap;     /* Quick look-up of component indices by entity index */
+    size_t                  entityMapSize;          /* Number of entity indices the map covers, grows with the entity count */
     ecs_entity_t *          componentEntityMap;     /* Quick look-up of entity id by component index */
     size_t                  componentCount;         /* Number of active components */
 
 } ecs_array_data_t;
 
+typedef struct ecs_array_snapshot_s {
+    uint64_t        count;
+    uint64_t        componentSize;
+} ecs_array_snapshot_t;
+
 /*=======================================================================================================================================*/
 void EcsComponentArray_Create( ecs_component_array_t * self_, size_t capacity, size_t componentSize, const char * name ) {
     static_assert( sizeof(ecs_array_data_t) <= sizeof(ecs_component_array_t), "Size of ecs_component_array_t.data is too small for implementation" );
@@ -49,15 +55,15 @@ void EcsComponentArray_Create( ecs_component_array_t * self_, size_t capacity, s
     data->componentSize         = Sys_Align( componentSize, ECS_COMPONENT_SIZE_ALIGN );
     data->componentDataSize     = data->componentSize * capacity;
     data->componentCapacity     = capacity;
-    data->componentData         = (uintptr_t) Mem_Alloc( data->componentDataSize );
-    data->componentPointers     = (void**) Mem_Alloc( sizeof(void*) * capacity );
-    data->entityComponentMap    = (ecs_component_index_t *) Mem_Alloc( sizeof(ecs_component_index_t) * ECS_MAX_ENTITIES );
-    data->componentEntityMap    = (ecs_entity_t *) Mem_Alloc( sizeof(ecs_entity_t) * capacity );
+    data->componentData         = (uintptr_t) Mem_HeapAlloc( MEM_HEAP_ECS, data->componentDataSize );
+    data->componentPointers     = (void**) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof(void*) * capacity );
+    data->entityMapSize         = Sys_Align( capacity, ECS_ENTITY_PAGE_SIZE );
+    data->entityComponentMap    = (ecs_component_index_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof(ecs_component_index_t) * data->entityMapSize );
+    data->componentEntityMap    = (ecs_entity_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof(ecs_entity_t) * capacity );
     data->componentCount         = 0;
     
-    for ( int n = 0; n < ECS_MAX_ENTITIES; ++n ) {
+    for ( int n = 0; n < data->entityMapSize; ++n ) {
         data->entityComponentMap[ n ] = ECS_COMPONENT_INVALID;
-
     }
     
     uintptr_t addrr = data->componentData;
@@ -77,58 +83,119 @@ const char * EcsComponentArray_GetName( const ecs_component_array_t * self_ ) {
 /*=======================================================================================================================================*/
 void EcsComponentArray_Destroy( ecs_component_array_t * self_ ) {
     ecs_array_data_t * data = (ecs_array_data_t *) self_;
+    
+    if ( data->componentData != 0 ) {
+        Mem_Free( (void *) data->componentData );
+        Mem_Free( data->componentPointers );
+        Mem_Free( data->componentEntityMap );
+    }
+    
+    if ( data->entityComponentMap != NULL ) {
+        Mem_Free( data->entityComponentMap );
+    }
+    
+    memset( data, 0, sizeof( *data ) );
+}
+
+/*=======================================================================================================================================*/
+static void EcsComponentArray_GrowEntityMap( ecs_array_data_t * data, uint32_t entIndex ) {
+    size_t newSize = ( data->entityMapSize == 0 ) ? ECS_ENTITY_PAGE_SIZE : data->entityMapSize * 2;
+    while ( newSize <= entIndex ) {
+        newSize *= 2;
+    }
+    
+    ecs_component_index_t * newMap = (ecs_component_index_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof(ecs_component_index_t) * newSize );
+    memcpy( newMap, data->entityComponentMap, sizeof(ecs_component_index_t) * data->entityMapSize );
+    
+    for ( size_t n = data->entityMapSize; n < newSize; ++n ) {
+        newMap[ n ] = ECS_COMPONENT_INVALID;
+    }
+    
+    Mem_Free( data->entityComponentMap );
+    data->entityComponentMap = newMap;
+    data->entityMapSize = newSize;
 }
 
 /*=======================================================================================================================================*/
 void * EcsComponentArray_AddEntity( ecs_component_array_t * self_, ecs_entity_t ent ) {
     ecs_array_data_t * data = (ecs_array_data_t *) self_;
+    uint32_t entIndex = ECS_ENTITY_INDEX( ent );
     
-    xassert( ent >= 0 && ent < ECS_MAX_ENTITIES );
+    xassert( ent >= 0 );
     xassert( data->componentCount < data->componentCapacity );
     
+    if ( entIndex >= data->entityMapSize ) {
+        EcsComponentArray_GrowEntityMap( data, entIndex );
+    }
+    
     /* Cache */
     ecs_component_index_t componentIndex = ( ecs_component_index_t ) data->componentCount;
     ++data->componentCount;
     
     /* Set the component / entity mapping indices */
-    data->entityComponentMap[ ent ] = componentIndex;
+    data->entityComponentMap[ entIndex ] = componentIndex;
     data->componentEntityMap[ componentIndex ] = ent;
     
     return data->componentPointers[ componentIndex ];
 }
 
+/*=======================================================================================================================================*/
+void * EcsComponentArray_AddEntities( ecs_component_array_t * self_, const ecs_entity_t * ents, size_t count, size_t * strideOut ) {
+    ecs_array_data_t * data = (ecs_array_data_t *) self_;
+    
+    xassert( count > 0 && data->componentCount + count <= data->componentCapacity );
+    
+    /* The component memory is one block, so new components are always contiguous at the end of the array */
+    ecs_component_index_t firstIndex = ( ecs_component_index_t ) data->componentCount;
+    
+    for ( size_t n = 0; n < count; ++n ) {
+        uint32_t entIndex = ECS_ENTITY_INDEX( ents[ n ] );
+        
+        if ( entIndex >= data->entityMapSize ) {
+            EcsComponentArray_GrowEntityMap( data, entIndex );
+        }
+        
+        data->entityComponentMap[ entIndex ] = firstIndex + (ecs_component_index_t) n;
+        data->componentEntityMap[ firstIndex + n ] = ents[ n ];
+    }
+    
+    data->componentCount += count;
+    
+    *strideOut = data->componentSize;
+    return data->componentPointers[ firstIndex ];
+}
+
 /*=======================================================================================================================================*/
 void EcsComponentArray_RemoveEntity( ecs_component_array_t * self_, ecs_entity_t ent ) {
     ecs_array_data_t * data = (ecs_array_data_t *) self_;
     
-    xassert( ent >= 0 && ent < ECS_MAX_ENTITIES );
+    uint32_t entIndex = ECS_ENTITY_INDEX( ent );
+    
+    xassert( ent >= 0 && entIndex < data->entityMapSize );
     xassert( data->componentCount > 0 );
-    xassert( data->entityComponentMap[ ent ] != -1 );
+    xassert( data->entityComponentMap[ entIndex ] != -1 );
     
-    /* Grab the index of the component of the entit that we're removing */
-    ecs_component_index_t componentIndex = data->entityComponentMap[ ent ];
+    /* Grab the index of the component of the entity that we're removing */
+    ecs_component_index_t componentIndex = data->entityComponentMap[ entIndex ];
+    ecs_component_index_t lastIndex = ( ecs_component_index_t ) data->componentCount - 1;
     
-    if ( data->componentCount > 1 && componentIndex < data->componentCount ) {
-        /* If we have more than one component active ( before removal )and it's not at
-           the end of the array of data, then we just move the component for the entity
-           at the end of the list down to the compinent that we're removing
-        */
-        ecs_entity_t lastEnt = data->componentEntityMap[ data->componentCount ];
+    if ( componentIndex != lastIndex ) {
+        /* The component isn't at the end of the array, so move the last component down into its slot
+           to keep the array packed */
+        ecs_entity_t lastEnt = data->componentEntityMap[ lastIndex ];
         
-        void * oldComponentMem = data->componentPointers[ data->componentSize - 1];
+        void * oldComponentMem = data->componentPointers[ lastIndex ];
         void * newComponentMem = data->componentPointers[ componentIndex ];
         
-        /* Copy component from last entry to the slot that */
-        memcpy(newComponentMem, oldComponentMem, data->componentSize );
+        /* Copy component from last entry to the slot that is being removed */
+        memcpy( newComponentMem, oldComponentMem, data->componentSize );
         
-        data->entityComponentMap[ lastEnt ] = componentIndex;
+        data->entityComponentMap[ ECS_ENTITY_INDEX( lastEnt ) ] = componentIndex;
         data->componentEntityMap[ componentIndex ] = lastEnt;
     }
-    else {
-        /* Either a single component or the component is at the end of the data array */
-        data->entityComponentMap[ ent ] = -1;
-        data->componentEntityMap[ componentIndex ] = - 1;
-    }
+    
+    data->entityComponentMap[ entIndex ] = ECS_COMPONENT_INVALID;
+    data->componentEntityMap[ lastIndex ] = ECS_ENTITY_NULL;
     
     --data->componentCount;
 }
@@ -138,9 +205,9 @@ void * EcsComponentArray_GetComponentForEntity( ecs_component_array_t * self_, e
     ecs_array_data_t * data = (ecs_array_data_t *) self_;
     
     xassert( ent != ECS_ENTITY_NULL );
-    xassert( ent < ECS_MAX_ENTITIES );
+    xassert( ECS_ENTITY_INDEX( ent ) < data->entityMapSize );
     
-    ecs_component_index_t componentIndex = data->entityComponentMap[ ent ];
+    ecs_component_index_t componentIndex = data->entityComponentMap[ ECS_ENTITY_INDEX( ent ) ];
     xassert ( componentIndex  != ECS_COMPONENT_INVALID );
     
     return data->componentPointers[ componentIndex ];
@@ -151,9 +218,12 @@ bool_t EcsComponentArray_HasEntity( const ecs_component_array_t * self_, ecs_ent
     ecs_array_data_t * data = (ecs_array_data_t *) self_;
     
     xassert( ent != ECS_ENTITY_NULL );
-    xassert( ent < ECS_MAX_ENTITIES );
     
-    return ( data->entityComponentMap[ ent ] != ECS_COMPONENT_INVALID ) ? true : false;
+    if ( ECS_ENTITY_INDEX( ent ) >= data->entityMapSize ) {
+        return false;
+    }
+    
+    return ( data->entityComponentMap[ ECS_ENTITY_INDEX( ent ) ] != ECS_COMPONENT_INVALID ) ? true : false;
 }
 
 /*=======================================================================================================================================*/
@@ -164,8 +234,74 @@ void EcsComponentArray_GetActiveComponents( ecs_component_array_t * self_, ecs_c
         activeListOut->componentData = data->componentPointers;
         activeListOut->entities = data->componentEntityMap;
         activeListOut->count = data->componentCount;
+        activeListOut->stride = data->componentSize;
     }
     else {
         memset( activeListOut, 0,   sizeof( ecs_component_list_t ) );
     }
 }
+
+/*=======================================================================================================================================*/
+size_t EcsComponentArray_GetCapacity( const ecs_component_array_t * self_ ) {
+    const ecs_array_data_t * data = (const ecs_array_data_t *) self_;
+    return data->componentCapacity;
+}
+
+/*=======================================================================================================================================*/
+size_t EcsComponentArray_GetSnapshotSize( const ecs_component_array_t * self_ ) {
+    const ecs_array_data_t * data = (const ecs_array_data_t *) self_;
+    size_t entitiesSize = Sys_Align( sizeof( ecs_entity_t ) * data->componentCount, 16 );
+    
+    return sizeof( ecs_array_snapshot_t ) + entitiesSize + data->componentSize * data->componentCount;
+}
+
+/*=======================================================================================================================================*/
+size_t EcsComponentArray_WriteSnapshot( const ecs_component_array_t * self_, void * dst ) {
+    const ecs_array_data_t * data = (const ecs_array_data_t *) self_;
+    ecs_array_snapshot_t * header = (ecs_array_snapshot_t *) dst;
+    size_t entitiesSize = Sys_Align( sizeof( ecs_entity_t ) * data->componentCount, 16 );
+    
+    header->count = data->componentCount;
+    header->componentSize = data->componentSize;
+    
+    /* The components are one block, so they go in one copy */
+    uint8_t * ptr = (uint8_t *) ( header + 1 );
+    memcpy( ptr, data->componentEntityMap, sizeof( ecs_entity_t ) * data->componentCount );
+    memcpy( ptr + entitiesSize, (const void *) data->componentData, data->componentSize * data->componentCount );
+    
+    return sizeof( ecs_array_snapshot_t ) + entitiesSize + data->componentSize * data->componentCount;
+}
+
+/*=======================================================================================================================================*/
+size_t EcsComponentArray_ReadSnapshot( ecs_component_array_t * self_, const void * src ) {
+    ecs_array_data_t * data = (ecs_array_data_t *) self_;
+    const ecs_array_snapshot_t * header = (const ecs_array_snapshot_t *) src;
+    size_t count = (size_t) header->count;
+    size_t entitiesSize = Sys_Align( sizeof( ecs_entity_t ) * count, 16 );
+    
+    xassert( header->componentSize == data->componentSize );
+    xassert( count <= data->componentCapacity );
+    
+    /* Unmap the entities that have components now, then map the ones in the snapshot */
+    for ( size_t n = 0; n < data->componentCount; ++n ) {
+        data->entityComponentMap[ ECS_ENTITY_INDEX( data->componentEntityMap[ n ] ) ] = ECS_COMPONENT_INVALID;
+        data->componentEntityMap[ n ] = ECS_ENTITY_NULL;
+    }
+    
+    const uint8_t * ptr = (const uint8_t *) ( header + 1 );
+    memcpy( data->componentEntityMap, ptr, sizeof( ecs_entity_t ) * count );
+    memcpy( (void *) data->componentData, ptr + entitiesSize, data->componentSize * count );
+    
+    for ( size_t n = 0; n < count; ++n ) {
+        uint32_t entIndex = ECS_ENTITY_INDEX( data->componentEntityMap[ n ] );
+        
+        if ( entIndex >= data->entityMapSize ) {
+            EcsComponentArray_GrowEntityMap( data, entIndex );
+        }
+        data->entityComponentMap[ entIndex ] = (ecs_component_index_t) n;
+    }
+    
+    data->componentCount = count;
+    
+    return sizeof( ecs_array_snapshot_t ) + entitiesSize + data->componentSize * count;
+}
@@ -32,16 +32,24 @@ typedef struct ecs_component_list_s {
     void ** componentData;
     ecs_entity_t * entities;
     size_t count;
+    size_t stride;          /* The components are in one block, componentData[ n ] is stride * n bytes after componentData[ 0 ] */
 } ecs_component_list_t;
 
 XE_API void EcsComponentArray_Create( ecs_component_array_t * self_, size_t capacity, size_t componentSize, const char * name );
 XE_API void EcsComponentArray_Destroy( ecs_component_array_t * self_ );
 XE_API void * EcsComponentArray_AddEntity( ecs_component_array_t * self_, ecs_entity_t ent );
+XE_API void * EcsComponentArray_AddEntities( ecs_component_array_t * self_, const ecs_entity_t * ents, size_t count, size_t * strideOut );
 XE_API void EcsComponentArray_RemoveEntity( ecs_component_array_t * self_, ecs_entity_t ent );
 XE_API void * EcsComponentArray_GetComponentForEntity( ecs_component_array_t * self_, ecs_entity_t ent );
 XE_API bool_t EcsComponentArray_HasEntity( const ecs_component_array_t * self_, ecs_entity_t ent );
 XE_API const char * EcsComponentArray_GetName( const ecs_component_array_t * self_ );
 XE_API void EcsComponentArray_GetActiveComponents( ecs_component_array_t * self_, ecs_component_list_t * activeListOut );
+XE_API size_t EcsComponentArray_GetCapacity( const ecs_component_array_t * self_ );
+
+/* Snapshots are the entity ids and the raw component memory, reading one back rebuilds the entity look-up */
+XE_API size_t EcsComponentArray_GetSnapshotSize( const ecs_component_array_t * self_ );
+XE_API size_t EcsComponentArray_WriteSnapshot( const ecs_component_array_t * self_, void * dst );
+XE_API size_t EcsComponentArray_ReadSnapshot( ecs_component_array_t * self_, const void * src );
 
 
 #endif
@@ -0,0 +1,390 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "ecs/EcsMessage.h"
+#include "core/Sys.h"
+#include "mem/Mem.h"
+#include <string.h>
+
+#define ECS_MESSAGE_ALIGN       8
+
+typedef enum ecs_msg_state_e {
+    ECS_MSG_STATE_EMPTY     = 0,        /* Not written yet, or still being written */
+    ECS_MSG_STATE_COMMITTED,            /* Message is complete and can be read */
+    ECS_MSG_STATE_END,                  /* The message reserved here didn't fit, carry on in the next block */
+} ecs_msg_state_t;
+
+/* Every message in a block is preceded by a slot that says whether it can be read yet */
+typedef struct ecs_msg_slot_s {
+    atomic_uint         state;
+    uint32_t            stride;         /* Size of the slot and the message */
+} ecs_msg_slot_t;
+
+struct ecs_msg_block_s {
+    _Atomic( ecs_msg_block_t * ) next;
+    atomic_uint         reserved;       /* Writers reserve space by adding to this, it can go past the capacity */
+    uint32_t            start;          /* Start of the first message that hasn't been retired */
+    uint32_t            capacity;
+    uint32_t            large;          /* Allocated on its own rather than from a pool page */
+    uint32_t            pad;
+    uint8_t             data[];
+};
+
+typedef struct ecs_msg_pool_s {
+    sys_mutex_t         mutex;
+    ecs_msg_block_t *   freeList;
+    void **             pages;
+    uint32_t            pageCount;
+    uint32_t            pageArraySize;
+    uint32_t            blocksUsed;
+    uint32_t            largeBlocksUsed;
+} ecs_msg_pool_t;
+
+static ecs_msg_pool_t msgPool;
+
+/*=======================================================================================================================================*/
+static uint32_t EcsMessage_Stride( size_t size ) {
+    size_t stride = Sys_Align( sizeof( ecs_msg_slot_t ) + size, ECS_MESSAGE_ALIGN );
+    return (uint32_t) stride;
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_Initialise(void) {
+    memset( &msgPool, 0, sizeof( msgPool ) );
+    Sys_MutexCreate( &msgPool.mutex );
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_Finalise(void) {
+    xassertmsg( msgPool.largeBlocksUsed == 0, "ECS : Message queues still hold %u large blocks\n", msgPool.largeBlocksUsed );
+    
+    for ( uint32_t n = 0; n < msgPool.pageCount; ++n ) {
+        Mem_Free( msgPool.pages[ n ] );
+    }
+    
+    if ( msgPool.pages != NULL ) {
+        Mem_Free( msgPool.pages );
+    }
+    
+    Sys_MutexDestroy( &msgPool.mutex );
+    memset( &msgPool, 0, sizeof( msgPool ) );
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_GetPoolStats( ecs_msg_pool_stats_t * stats ) {
+    Sys_MutexLock( &msgPool.mutex );
+    stats->pageCount = msgPool.pageCount;
+    stats->blocksUsed = msgPool.blocksUsed;
+    stats->largeBlocksUsed = msgPool.largeBlocksUsed;
+    stats->bytesReserved = (size_t) msgPool.pageCount * ECS_MESSAGE_PAGE_SIZE;
+    Sys_MutexUnlock( &msgPool.mutex );
+}
+
+/*=======================================================================================================================================*/
+static void EcsMessage_AddPage(void) {
+    if ( msgPool.pageCount == msgPool.pageArraySize ) {
+        uint32_t newSize = ( msgPool.pageArraySize == 0 ) ? 16 : msgPool.pageArraySize * 2;
+        void ** pages = (void **) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( void * ) * newSize );
+        
+        if ( msgPool.pages != NULL ) {
+            memcpy( pages, msgPool.pages, sizeof( void * ) * msgPool.pageCount );
+            Mem_Free( msgPool.pages );
+        }
+        
+        msgPool.pages = pages;
+        msgPool.pageArraySize = newSize;
+    }
+    
+    uint8_t * page = (uint8_t *) Mem_HeapAlloc( MEM_HEAP_ECS, ECS_MESSAGE_PAGE_SIZE );
+    msgPool.pages[ msgPool.pageCount ] = page;
+    ++msgPool.pageCount;
+    
+    /* Carve the page up into blocks */
+    for ( uint32_t offset = 0; offset + ECS_MESSAGE_BLOCK_SIZE <= ECS_MESSAGE_PAGE_SIZE; offset += ECS_MESSAGE_BLOCK_SIZE ) {
+        ecs_msg_block_t * block = (ecs_msg_block_t *) ( page + offset );
+        atomic_store_explicit( &block->next, msgPool.freeList, memory_order_relaxed );
+        msgPool.freeList = block;
+    }
+}
+
+/*=======================================================================================================================================*/
+static ecs_msg_block_t * EcsMessage_AllocBlock( uint32_t stride ) {
+    ecs_msg_block_t * block = NULL;
+    uint32_t capacity = ECS_MESSAGE_BLOCK_SIZE - (uint32_t) sizeof( ecs_msg_block_t );
+    
+    Sys_MutexLock( &msgPool.mutex );
+    
+    if ( stride > capacity ) {
+        /* Too big for a pool block, give the message a block of its own */
+        capacity = stride;
+        block = (ecs_msg_block_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( ecs_msg_block_t ) + capacity );
+        block->large = 1;
+        ++msgPool.largeBlocksUsed;
+    }
+    else {
+        if ( msgPool.freeList == NULL ) {
+            EcsMessage_AddPage();
+        }
+        
+        block = msgPool.freeList;
+        msgPool.freeList = atomic_load_explicit( &block->next, memory_order_relaxed );
+        block->large = 0;
+        ++msgPool.blocksUsed;
+    }
+    
+    Sys_MutexUnlock( &msgPool.mutex );
+    
+    /* Slots have to start out empty so readers stop at the ones that haven't been written */
+    memset( block->data, 0, capacity );
+    atomic_init( &block->next, NULL );
+    atomic_init( &block->reserved, 0 );
+    block->start = 0;
+    block->capacity = capacity;
+    
+    return block;
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_FreeBlocks( ecs_msg_block_t * blocks ) {
+    if ( blocks == NULL ) {
+        return;
+    }
+    
+    Sys_MutexLock( &msgPool.mutex );
+    
+    while ( blocks != NULL ) {
+        ecs_msg_block_t * next = atomic_load_explicit( &blocks->next, memory_order_relaxed );
+        
+        if ( blocks->large != 0 ) {
+            --msgPool.largeBlocksUsed;
+            Mem_Free( blocks );
+        }
+        else {
+            atomic_store_explicit( &blocks->next, msgPool.freeList, memory_order_relaxed );
+            msgPool.freeList = blocks;
+            --msgPool.blocksUsed;
+        }
+        
+        blocks = next;
+    }
+    
+    Sys_MutexUnlock( &msgPool.mutex );
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_QueueInit( ecs_msg_queue_t * queue ) {
+    atomic_init( &queue->head, NULL );
+    atomic_init( &queue->tail, NULL );
+    atomic_init( &queue->seenCount, 0 );
+}
+
+/*=======================================================================================================================================*/
+static ecs_msg_block_t * EcsMessage_Extend( ecs_msg_queue_t * queue, ecs_msg_block_t * block, uint32_t stride ) {
+    /* Link a new block after the given one, or the first block if it's NULL. If another writer gets there
+       first then theirs is used and ours goes back */
+    ecs_msg_block_t * next = ( block != NULL ) ? atomic_load_explicit( &block->next, memory_order_acquire ) : NULL;
+    
+    if ( next == NULL ) {
+        ecs_msg_block_t * newBlock = EcsMessage_AllocBlock( stride );
+        bool_t linked;
+        
+        if ( block != NULL ) {
+            linked = atomic_compare_exchange_strong_explicit( &block->next, &next, newBlock, memory_order_acq_rel, memory_order_acquire );
+        }
+        else {
+            ecs_msg_block_t * expected = NULL;
+            linked = atomic_compare_exchange_strong_explicit( &queue->tail, &expected, newBlock, memory_order_acq_rel, memory_order_acquire );
+            next = expected;
+            
+            if ( linked == true ) {
+                atomic_store_explicit( &queue->head, newBlock, memory_order_release );
+                return newBlock;
+            }
+        }
+        
+        if ( linked == true ) {
+            next = newBlock;
+        }
+        else {
+            EcsMessage_FreeBlocks( newBlock );
+        }
+    }
+    
+    /* Move the tail on for everyone, fine if someone else already has */
+    if ( block != NULL ) {
+        atomic_compare_exchange_strong_explicit( &queue->tail, &block, next, memory_order_acq_rel, memory_order_relaxed );
+    }
+    
+    return next;
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_Push( ecs_msg_queue_t * queue, uint16_t msgId, const void * data, size_t dataSize ) {
+    xassert( dataSize >= sizeof( ecs_msg_t ) );
+    uint32_t stride = EcsMessage_Stride( dataSize );
+    
+    ecs_msg_block_t * block = atomic_load_explicit( &queue->tail, memory_order_acquire );
+    
+    for ( ;; ) {
+        if ( block == NULL ) {
+            block = EcsMessage_Extend( queue, NULL, stride );
+            continue;
+        }
+        
+        uint32_t offset = atomic_fetch_add_explicit( &block->reserved, stride, memory_order_relaxed );
+        
+        if ( offset + stride <= block->capacity ) {
+            ecs_msg_slot_t * slot = (ecs_msg_slot_t *) ( block->data + offset );
+            ecs_msg_t * msg = (ecs_msg_t *) ( slot + 1 );
+            
+            /* Write the message and fill in the header, it can be read once the slot is committed */
+            memcpy( msg, data, dataSize );
+            msg->msg = msgId;
+            msg->size = (uint32_t) dataSize;
+            msg->seen = 0;
+            msg->complete = 1;
+            
+            slot->stride = stride;
+            atomic_store_explicit( &slot->state, ECS_MSG_STATE_COMMITTED, memory_order_release );
+            return;
+        }
+        
+        /* Didn't fit. Whoever reserved the space over the end of the block marks where the block stops, slots
+           are aligned so there's always room for the marker */
+        if ( offset < block->capacity ) {
+            ecs_msg_slot_t * slot = (ecs_msg_slot_t *) ( block->data + offset );
+            atomic_store_explicit( &slot->state, ECS_MSG_STATE_END, memory_order_release );
+        }
+        
+        block = EcsMessage_Extend( queue, block, stride );
+    }
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_Begin( ecs_msg_queue_t * queue, ecs_msg_iter_t * iter ) {
+    iter->block = atomic_load_explicit( &queue->head, memory_order_acquire );
+    iter->offset = ( iter->block != NULL ) ? iter->block->start : 0;
+    iter->count = 0;
+}
+
+/*=======================================================================================================================================*/
+ecs_msg_t * EcsMessage_Next( ecs_msg_iter_t * iter ) {
+    ecs_msg_block_t * block = iter->block;
+    
+    while ( block != NULL ) {
+        if ( iter->offset < block->capacity ) {
+            ecs_msg_slot_t * slot = (ecs_msg_slot_t *) ( block->data + iter->offset );
+            uint32_t state = atomic_load_explicit( &slot->state, memory_order_acquire );
+            
+            if ( state == ECS_MSG_STATE_COMMITTED ) {
+                iter->offset += slot->stride;
+                ++iter->count;
+                return (ecs_msg_t *) ( slot + 1 );
+            }
+            
+            if ( state == ECS_MSG_STATE_EMPTY ) {
+                /* Not committed yet, messages after it have to wait so the order is kept */
+                return NULL;
+            }
+        }
+        
+        /* End of the block, the next one may not have been linked yet */
+        ecs_msg_block_t * next = atomic_load_explicit( &block->next, memory_order_acquire );
+        if ( next == NULL ) {
+            return NULL;
+        }
+        
+        block = next;
+        iter->block = block;
+        iter->offset = 0;
+    }
+    
+    return NULL;
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_MarkSeen( ecs_msg_queue_t * queue, uint32_t count ) {
+    /* Several systems can be reading the messages of an entity at once, so only ever move the count forward */
+    uint32_t seenCount = atomic_load( &queue->seenCount );
+    while ( seenCount < count ) {
+        if ( atomic_compare_exchange_weak( &queue->seenCount, &seenCount, count ) ) {
+            break;
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static bool_t EcsMessage_BlockDone( const ecs_msg_block_t * block ) {
+    /* Every message that was reserved in the block has been retired */
+    uint32_t reserved = atomic_load_explicit( &block->reserved, memory_order_relaxed );
+    if ( block->start >= block->capacity || block->start >= reserved ) {
+        return true;
+    }
+    
+    const ecs_msg_slot_t * slot = (const ecs_msg_slot_t *) ( block->data + block->start );
+    return ( atomic_load_explicit( &slot->state, memory_order_relaxed ) == ECS_MSG_STATE_END ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+bool_t EcsMessage_Retire( ecs_msg_queue_t * queue, ecs_msg_block_t ** freeBlocks ) {
+    /* Nothing else can be touching the queue, so there's no ordering to enforce */
+    uint32_t seenCount = atomic_load_explicit( &queue->seenCount, memory_order_relaxed );
+    ecs_msg_block_t * head = atomic_load_explicit( &queue->head, memory_order_relaxed );
+    
+    /* Step the head past the seen messages, handing back blocks as they empty. Unseen messages aren't moved. */
+    for ( uint32_t n = 0; n < seenCount; ) {
+        if ( EcsMessage_BlockDone( head ) == true ) {
+            ecs_msg_block_t * next = atomic_load_explicit( &head->next, memory_order_relaxed );
+            atomic_store_explicit( &head->next, *freeBlocks, memory_order_relaxed );
+            *freeBlocks = head;
+            head = next;
+            continue;
+        }
+        
+        const ecs_msg_slot_t * slot = (const ecs_msg_slot_t *) ( head->data + head->start );
+        head->start += slot->stride;
+        ++n;
+    }
+    
+    while ( head != NULL && EcsMessage_BlockDone( head ) == true ) {
+        ecs_msg_block_t * next = atomic_load_explicit( &head->next, memory_order_relaxed );
+        atomic_store_explicit( &head->next, *freeBlocks, memory_order_relaxed );
+        *freeBlocks = head;
+        head = next;
+    }
+    
+    atomic_store_explicit( &queue->head, head, memory_order_relaxed );
+    if ( head == NULL ) {
+        atomic_store_explicit( &queue->tail, NULL, memory_order_relaxed );
+    }
+    
+    atomic_store_explicit( &queue->seenCount, 0, memory_order_relaxed );
+    
+    return ( head != NULL ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+void EcsMessage_Clear( ecs_msg_queue_t * queue ) {
+    EcsMessage_FreeBlocks( atomic_load_explicit( &queue->head, memory_order_relaxed ) );
+    
+    atomic_store_explicit( &queue->head, NULL, memory_order_relaxed );
+    atomic_store_explicit( &queue->tail, NULL, memory_order_relaxed );
+    atomic_store_explicit( &queue->seenCount, 0, memory_order_relaxed );
+}
@@ -0,0 +1,74 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __ECSMESSAGE_H__
+#define __ECSMESSAGE_H__
+
+#include "core/Platform.h"
+#include "ecs/EcsTypes.h"
+#include "core/Atomic.h"
+
+/*
+    Message queues hold the messages sent to an entity in a list of blocks taken from a shared pool, so an
+    entity that never gets a message doesn't use any message memory. Messages that have been seen are
+    retired at the end of the frame, the ones that haven't been seen stay where they are. Retiring chains the
+    emptied blocks on to a list so a whole frame of them can go back to the pool in one go.
+ 
+    Any number of threads can push to a queue while another reads it without taking a lock. A writer reserves
+    space in the tail block with an atomic add, writes its message and then flags it as committed, so a slow
+    writer doesn't hold up the others. Readers stop at the first message that hasn't been committed yet and
+    pick up the rest next time round. Retiring and clearing a queue must not overlap with a push or a read.
+*/
+
+typedef struct ecs_msg_block_s ecs_msg_block_t;
+
+typedef struct ecs_msg_queue_s {
+    _Atomic( ecs_msg_block_t * ) head;
+    _Atomic( ecs_msg_block_t * ) tail;  /* Block that writers reserve from, may lag behind the real end of the list */
+    atomic_uint         seenCount;      /* Messages at the start of the queue that have been passed to a system */
+} ecs_msg_queue_t;
+
+typedef struct ecs_msg_iter_s {
+    ecs_msg_block_t *   block;
+    uint32_t            offset;
+    uint32_t            count;          /* Number of messages the iterator has returned */
+} ecs_msg_iter_t;
+
+typedef struct ecs_msg_pool_stats_s {
+    uint32_t            pageCount;
+    uint32_t            blocksUsed;
+    uint32_t            largeBlocksUsed;    /* Blocks for messages too big for a pool block */
+    size_t              bytesReserved;
+} ecs_msg_pool_stats_t;
+
+XE_API void         EcsMessage_Initialise(void);
+XE_API void         EcsMessage_Finalise(void);
+XE_API void         EcsMessage_GetPoolStats( ecs_msg_pool_stats_t * stats );
+
+XE_API void         EcsMessage_QueueInit( ecs_msg_queue_t * queue );
+XE_API void         EcsMessage_Push( ecs_msg_queue_t * queue, uint16_t msgId, const void * data, size_t dataSize );
+XE_API void         EcsMessage_Begin( ecs_msg_queue_t * queue, ecs_msg_iter_t * iter );
+XE_API ecs_msg_t *  EcsMessage_Next( ecs_msg_iter_t * iter );
+XE_API void         EcsMessage_MarkSeen( ecs_msg_queue_t * queue, uint32_t count );
+XE_API bool_t       EcsMessage_Retire( ecs_msg_queue_t * queue, ecs_msg_block_t ** freeBlocks );
+XE_API void         EcsMessage_Clear( ecs_msg_queue_t * queue );
+XE_API void         EcsMessage_FreeBlocks( ecs_msg_block_t * blocks );
+
+#endif
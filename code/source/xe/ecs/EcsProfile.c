@@ -0,0 +1,297 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "ecs/EcsProfile.h"
+#include "ecs/Ecs.h"
+#include "core/Sys.h"
+#include "core/Job.h"
+#include "core/Fs.h"
+#include "mem/Mem.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ECS_PROFILE
+
+/* Timed job or phase in the trace */
+typedef struct ecs_profile_event_s {
+    uint64_t        startNs;            /* From the start of the frame */
+    uint64_t        durationNs;
+    uint64_t        bytesCopied;
+    int32_t         name;               /* System index, or -1 - the phase */
+    uint32_t        worker;
+    uint32_t        entityCount;
+    uint32_t        messageCount;
+} ecs_profile_event_t;
+
+typedef struct ecs_profile_s {
+    ecs_profile_frame_t *   frames;                             /* Ring of ECS_PROFILE_FRAMES frames */
+    ecs_profile_event_t *   events;                             /* ECS_PROFILE_MAX_EVENTS for each frame */
+    const char *            systemNames[ ECS_MAX_SYSTEMS ];
+    uint64_t                frameIndex;                         /* Frame being recorded */
+} ecs_profile_t;
+
+static ecs_profile_t ecsProfile;
+
+static const char * ecsProfilePhaseNames[ ECS_PROFILE_PHASE_COUNT ] = {
+    "Commit messages",
+    "Play commands",
+    "End frame",
+};
+
+/*=======================================================================================================================================*/
+static inline ecs_profile_frame_t * EcsProfile_GetFrame( uint64_t frameIndex ) {
+    return &ecsProfile.frames[ frameIndex % ECS_PROFILE_FRAMES ];
+}
+
+/*=======================================================================================================================================*/
+static inline ecs_profile_event_t * EcsProfile_GetEvents( uint64_t frameIndex ) {
+    return &ecsProfile.events[ ( frameIndex % ECS_PROFILE_FRAMES ) * ECS_PROFILE_MAX_EVENTS ];
+}
+
+/*=======================================================================================================================================*/
+static void EcsProfile_StartFrame(void) {
+    ecs_profile_frame_t * frame = EcsProfile_GetFrame( ecsProfile.frameIndex );
+    
+    memset( frame, 0, sizeof( ecs_profile_frame_t ) );
+    frame->frameIndex = ecsProfile.frameIndex;
+    frame->startNs = Sys_GetTicksNs();
+}
+
+/*=======================================================================================================================================*/
+static void EcsProfile_AddEvent( const ecs_profile_event_t * event ) {
+    ecs_profile_frame_t * frame = EcsProfile_GetFrame( ecsProfile.frameIndex );
+    
+    if ( frame->eventCount < ECS_PROFILE_MAX_EVENTS ) {
+        EcsProfile_GetEvents( ecsProfile.frameIndex )[ frame->eventCount++ ] = *event;
+    }
+    else {
+        ++frame->droppedEvents;
+    }
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_Initialise(void) {
+    memset( &ecsProfile, 0, sizeof( ecsProfile ) );
+    
+    ecsProfile.frames = (ecs_profile_frame_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( ecs_profile_frame_t ) * ECS_PROFILE_FRAMES );
+    ecsProfile.events = (ecs_profile_event_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( ecs_profile_event_t ) * ECS_PROFILE_FRAMES * ECS_PROFILE_MAX_EVENTS );
+    
+    EcsProfile_StartFrame();
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_Finalise(void) {
+    Mem_Free( ecsProfile.frames );
+    Mem_Free( ecsProfile.events );
+    memset( &ecsProfile, 0, sizeof( ecsProfile ) );
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_SetSystemName( int32_t systemIndex, const char * name ) {
+    ecsProfile.systemNames[ systemIndex ] = name;
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_BeginJob( ecs_profile_job_t * job, int32_t systemIndex ) {
+    job->bytesCopied = 0;
+    job->entityCount = 0;
+    job->messageCount = 0;
+    job->systemIndex = systemIndex;
+    job->worker = Job_GetWorkerIndex();
+    job->startNs = Sys_GetTicksNs();
+    job->endNs = job->startNs;
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_EndJob( ecs_profile_job_t * job ) {
+    job->endNs = Sys_GetTicksNs();
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_AddJob( const ecs_profile_job_t * job ) {
+    ecs_profile_frame_t * frame = EcsProfile_GetFrame( ecsProfile.frameIndex );
+    ecs_profile_system_t * system = &frame->systems[ job->systemIndex ];
+    uint64_t startNs = job->startNs - frame->startNs;
+    uint64_t endNs = job->endNs - frame->startNs;
+    
+    if ( system->jobCount == 0 || startNs < system->startNs ) {
+        system->startNs = startNs;
+    }
+    system->endNs = ( endNs > system->endNs ) ? endNs : system->endNs;
+    system->timeNs += job->endNs - job->startNs;
+    system->bytesCopied += job->bytesCopied;
+    system->entityCount += job->entityCount;
+    system->messageCount += job->messageCount;
+    ++system->jobCount;
+    
+    if ( (uint32_t) job->systemIndex >= frame->systemCount ) {
+        frame->systemCount = (uint32_t) job->systemIndex + 1;
+    }
+    
+    ecs_profile_event_t event;
+    event.startNs = startNs;
+    event.durationNs = job->endNs - job->startNs;
+    event.bytesCopied = job->bytesCopied;
+    event.name = job->systemIndex;
+    event.worker = job->worker;
+    event.entityCount = job->entityCount;
+    event.messageCount = job->messageCount;
+    EcsProfile_AddEvent( &event );
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_AddPhase( ecs_profile_phase_t phase, uint64_t startNs ) {
+    ecs_profile_frame_t * frame = EcsProfile_GetFrame( ecsProfile.frameIndex );
+    uint64_t durationNs = Sys_GetTicksNs() - startNs;
+    
+    switch ( phase ) {
+        case ECS_PROFILE_PHASE_COMMIT:      frame->commitNs += durationNs;      break;
+        case ECS_PROFILE_PHASE_COMMANDS:    frame->commandsNs += durationNs;    break;
+        case ECS_PROFILE_PHASE_END_FRAME:   frame->endFrameNs += durationNs;    break;
+        default:                                                                break;
+    }
+    
+    ecs_profile_event_t event;
+    memset( &event, 0, sizeof( event ) );
+    event.startNs = startNs - frame->startNs;
+    event.durationNs = durationNs;
+    event.name = -1 - (int32_t) phase;
+    event.worker = Job_GetWorkerIndex();
+    EcsProfile_AddEvent( &event );
+}
+
+/*=======================================================================================================================================*/
+void EcsProfile_EndFrame(void) {
+    ecs_profile_frame_t * frame = EcsProfile_GetFrame( ecsProfile.frameIndex );
+    frame->durationNs = Sys_GetTicksNs() - frame->startNs;
+    
+    ++ecsProfile.frameIndex;
+    EcsProfile_StartFrame();
+}
+
+/*=======================================================================================================================================*/
+uint32_t Ecs_ProfileGetFrameCount(void) {
+    /* The frame being recorded isn't finished */
+    return ( ecsProfile.frameIndex < ECS_PROFILE_FRAMES - 1 ) ? (uint32_t) ecsProfile.frameIndex : ECS_PROFILE_FRAMES - 1;
+}
+
+/*=======================================================================================================================================*/
+bool_t Ecs_ProfileGetFrame( uint32_t framesAgo, ecs_profile_frame_t * frameOut ) {
+    if ( ecsProfile.frames == NULL || framesAgo >= Ecs_ProfileGetFrameCount() ) {
+        return false;
+    }
+    
+    *frameOut = *EcsProfile_GetFrame( ecsProfile.frameIndex - 1 - framesAgo );
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static void EcsProfile_WriteRaw( file_t * file, const char * str ) {
+    FS_FileWrite( file, str, 1, strlen( str ) );
+}
+
+/*=======================================================================================================================================*/
+static void EcsProfile_WriteString( file_t * file, const char * str ) {
+    for ( const char * c = str; *c != 0; ++c ) {
+        if ( *c == '\\' || *c == '"' ) {
+            FS_FileWrite( file, "\\", 1, 1 );
+        }
+        FS_FileWrite( file, c, 1, 1 );
+    }
+}
+
+/*=======================================================================================================================================*/
+bool_t Ecs_ProfileDumpTrace( const char * path ) {
+    uint32_t frameCount = Ecs_ProfileGetFrameCount();
+    file_t file;
+    
+    if ( frameCount == 0 || FS_FileOpen( &file, path, "wb" ) == false ) {
+        xprintf( "ECS : unable to write profile trace to '%s'\n", path );
+        return false;
+    }
+    
+    /* Chrome trace event format, times are in microseconds from the start of the oldest frame */
+    uint64_t firstFrame = ecsProfile.frameIndex - frameCount;
+    uint64_t baseNs = EcsProfile_GetFrame( firstFrame )->startNs;
+    uint32_t workerCount = Job_GetWorkerCount();
+    char buffer[ 512 ];
+    int len = 0;
+    
+    EcsProfile_WriteRaw( &file, "{\n    \"displayTimeUnit\": \"ns\",\n    \"traceEvents\": [\n" );
+    
+    for ( uint32_t w = 0; w < workerCount; ++w ) {
+        len = snprintf( buffer, sizeof( buffer ), "        { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": { \"name\": \"%s %u\" } },\n",
+                        w, ( w == 0 ) ? "Main thread, worker" : "Worker", w );
+        FS_FileWrite( &file, buffer, 1, len );
+    }
+    
+    for ( uint64_t f = firstFrame; f < ecsProfile.frameIndex; ++f ) {
+        const ecs_profile_frame_t * frame = EcsProfile_GetFrame( f );
+        const ecs_profile_event_t * events = EcsProfile_GetEvents( f );
+        double frameUs = (double) ( frame->startNs - baseNs ) / 1000.0;
+        
+        len = snprintf( buffer, sizeof( buffer ), "        { \"name\": \"Frame %llu\", \"cat\": \"frame\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": 0, "
+                        "\"args\": { \"commitNs\": %llu, \"commandsNs\": %llu, \"endFrameNs\": %llu, \"droppedEvents\": %u } }",
+                        (unsigned long long) frame->frameIndex, frameUs, (double) frame->durationNs / 1000.0,
+                        (unsigned long long) frame->commitNs, (unsigned long long) frame->commandsNs, (unsigned long long) frame->endFrameNs, frame->droppedEvents );
+        FS_FileWrite( &file, buffer, 1, len );
+        
+        for ( uint32_t e = 0; e < frame->eventCount; ++e ) {
+            const ecs_profile_event_t * event = &events[ e ];
+            const char * name = ( event->name >= 0 ) ? ecsProfile.systemNames[ event->name ] : ecsProfilePhaseNames[ -1 - event->name ];
+            
+            EcsProfile_WriteRaw( &file, ",\n        { \"name\": \"" );
+            EcsProfile_WriteString( &file, ( name != NULL ) ? name : "System" );
+            len = snprintf( buffer, sizeof( buffer ), "\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u, "
+                            "\"args\": { \"entities\": %u, \"messages\": %u, \"bytesCopied\": %llu } }",
+                            ( event->name >= 0 ) ? "system" : "ecs", frameUs + (double) event->startNs / 1000.0, (double) event->durationNs / 1000.0,
+                            event->worker, event->entityCount, event->messageCount, (unsigned long long) event->bytesCopied );
+            FS_FileWrite( &file, buffer, 1, len );
+        }
+        
+        EcsProfile_WriteRaw( &file, ( f + 1 < ecsProfile.frameIndex ) ? ",\n" : "\n" );
+    }
+    
+    EcsProfile_WriteRaw( &file, "    ]\n}\n" );
+    FS_FileClose( &file );
+    
+    xprintf( "ECS : wrote %u frames of profiling to '%s'\n", frameCount, path );
+    return true;
+}
+
+#else
+
+/*=======================================================================================================================================*/
+uint32_t Ecs_ProfileGetFrameCount(void) {
+    return 0;
+}
+
+/*=======================================================================================================================================*/
+bool_t Ecs_ProfileGetFrame( uint32_t framesAgo, ecs_profile_frame_t * frameOut ) {
+    return false;
+}
+
+/*=======================================================================================================================================*/
+bool_t Ecs_ProfileDumpTrace( const char * path ) {
+    xprintf( "ECS : profiling is compiled out, define ECS_PROFILE to turn it on\n" );
+    return false;
+}
+
+#endif
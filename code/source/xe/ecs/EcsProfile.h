@@ -0,0 +1,63 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __ECSPROFILE_H__
+#define __ECSPROFILE_H__
+
+#include "core/Platform.h"
+#include "ecs/EcsTypes.h"
+
+/*
+    Profiling keeps the counters for each system and a timed event for each job in a ring of frames. Jobs are
+    timed and counted on the thread that runs them, into the job, and only added to the frame by the thread
+    that ran the systems once they have all finished, so nothing here needs to be thread safe.
+*/
+
+#ifdef ECS_PROFILE
+
+typedef enum ecs_profile_phase_e {
+    ECS_PROFILE_PHASE_COMMIT = 0,
+    ECS_PROFILE_PHASE_COMMANDS,
+    ECS_PROFILE_PHASE_END_FRAME,
+    ECS_PROFILE_PHASE_COUNT
+} ecs_profile_phase_t;
+
+typedef struct ecs_profile_job_s {
+    uint64_t        startNs;
+    uint64_t        endNs;
+    uint64_t        bytesCopied;
+    uint32_t        entityCount;
+    uint32_t        messageCount;
+    int32_t         systemIndex;
+    uint32_t        worker;
+} ecs_profile_job_t;
+
+XE_API void EcsProfile_Initialise(void);
+XE_API void EcsProfile_Finalise(void);
+XE_API void EcsProfile_SetSystemName( int32_t systemIndex, const char * name );
+XE_API void EcsProfile_BeginJob( ecs_profile_job_t * job, int32_t systemIndex );
+XE_API void EcsProfile_EndJob( ecs_profile_job_t * job );
+XE_API void EcsProfile_AddJob( const ecs_profile_job_t * job );
+XE_API void EcsProfile_AddPhase( ecs_profile_phase_t phase, uint64_t startNs );
+XE_API void EcsProfile_EndFrame(void);
+
+#endif
+
+#endif
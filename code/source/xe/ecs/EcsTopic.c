@@ -0,0 +1,218 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "ecs/EcsTopic.h"
+#include "core/Sys.h"
+#include "mem/Mem.h"
+#include <string.h>
+
+#define ECS_TOPIC_ALIGN             16
+#define ECS_TOPIC_MIN_DATA_SIZE     ( 1024 * 4 )
+#define ECS_TOPIC_MIN_CAPACITY      256
+#define ECS_TOPIC_ALL_INDEX         0xFFFFFFFFu         /* Entity index of a message for every entity */
+
+/* Every message in the data is preceded by the entity that it was published for */
+typedef struct ecs_topic_record_s {
+    ecs_entity_t        ent;
+    uint32_t            stride;
+    uint32_t            pad;
+} ecs_topic_record_t;
+
+/*=======================================================================================================================================*/
+void EcsTopic_Init( ecs_topic_t * topic ) {
+    memset( topic, 0, sizeof( ecs_topic_t ) );
+    atomic_init( &topic->sorted, true );
+}
+
+/*=======================================================================================================================================*/
+void EcsTopic_Destroy( ecs_topic_t * topic ) {
+    if ( topic->data != NULL ) {
+        Mem_Free( topic->data );
+    }
+    
+    if ( topic->offsets != NULL ) {
+        Mem_Free( topic->offsets );
+        Mem_Free( topic->indices );
+        Mem_Free( topic->order );
+    }
+    
+    if ( topic->entityStarts != NULL ) {
+        Mem_Free( topic->entityStarts );
+    }
+    
+    EcsTopic_Init( topic );
+}
+
+/*=======================================================================================================================================*/
+static void EcsTopic_GrowData( ecs_topic_t * topic, uint32_t size ) {
+    uint32_t newSize = ( topic->dataSize == 0 ) ? ECS_TOPIC_MIN_DATA_SIZE : topic->dataSize * 2;
+    while ( newSize < size ) {
+        newSize *= 2;
+    }
+    
+    uint8_t * data = (uint8_t *) Mem_HeapAllocAligned( MEM_HEAP_ECS, newSize, ECS_TOPIC_ALIGN );
+    if ( topic->data != NULL ) {
+        memcpy( data, topic->data, topic->dataUsed );
+        Mem_Free( topic->data );
+    }
+    
+    topic->data = data;
+    topic->dataSize = newSize;
+}
+
+/*=======================================================================================================================================*/
+static uint32_t * EcsTopic_GrowArray( uint32_t * array, uint32_t count, uint32_t newSize ) {
+    uint32_t * newArray = (uint32_t *) Mem_HeapAlloc( MEM_HEAP_ECS, sizeof( uint32_t ) * newSize );
+    
+    if ( array != NULL ) {
+        memcpy( newArray, array, sizeof( uint32_t ) * count );
+        Mem_Free( array );
+    }
+    
+    return newArray;
+}
+
+/*=======================================================================================================================================*/
+void EcsTopic_Publish( ecs_topic_t * topic, ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize ) {
+    xassert( dataSize >= sizeof( ecs_msg_t ) );
+    
+    size_t stride = Sys_Align( sizeof( ecs_topic_record_t ) + dataSize, ECS_TOPIC_ALIGN );
+    
+    if ( topic->dataUsed + stride > topic->dataSize ) {
+        EcsTopic_GrowData( topic, topic->dataUsed + (uint32_t) stride );
+    }
+    
+    if ( topic->count == topic->capacity ) {
+        uint32_t newCapacity = ( topic->capacity == 0 ) ? ECS_TOPIC_MIN_CAPACITY : topic->capacity * 2;
+        topic->offsets = EcsTopic_GrowArray( topic->offsets, topic->count, newCapacity );
+        topic->indices = EcsTopic_GrowArray( topic->indices, topic->count, newCapacity );
+        topic->order = EcsTopic_GrowArray( topic->order, 0, newCapacity );
+        topic->capacity = newCapacity;
+    }
+    
+    ecs_topic_record_t * record = (ecs_topic_record_t *) ( topic->data + topic->dataUsed );
+    ecs_msg_t * msg = (ecs_msg_t *) ( record + 1 );
+    
+    record->ent = ent;
+    record->stride = (uint32_t) stride;
+    
+    memcpy( msg, data, dataSize );
+    msg->msg = msgId;
+    msg->size = (uint32_t) dataSize;
+    msg->seen = 0;
+    msg->complete = 1;
+    
+    topic->offsets[ topic->count ] = topic->dataUsed;
+    topic->indices[ topic->count ] = ( ent == ECS_ENTITY_NULL ) ? ECS_TOPIC_ALL_INDEX : ECS_ENTITY_INDEX( ent );
+    
+    topic->dataUsed += (uint32_t) stride;
+    ++topic->count;
+    
+    atomic_store_explicit( &topic->sorted, false, memory_order_relaxed );
+}
+
+/*=======================================================================================================================================*/
+void EcsTopic_Sort( ecs_topic_t * topic, uint32_t entityCount ) {
+    if ( atomic_load_explicit( &topic->sorted, memory_order_acquire ) == true ) {
+        return;
+    }
+    
+    if ( entityCount + 1 > topic->entityStartsSize ) {
+        uint32_t newSize = ( topic->entityStartsSize == 0 ) ? ECS_TOPIC_MIN_CAPACITY : topic->entityStartsSize;
+        while ( newSize < entityCount + 1 ) {
+            newSize *= 2;
+        }
+        
+        topic->entityStarts = EcsTopic_GrowArray( topic->entityStarts, 0, newSize );
+        topic->entityStartsSize = newSize;
+    }
+    
+    /* Counting sort on the entity index. Count the messages for each entity, the ones for every entity are
+       counted in the slot past the last entity so they end up at the back. */
+    uint32_t * starts = topic->entityStarts;
+    memset( starts, 0, sizeof( uint32_t ) * ( entityCount + 1 ) );
+    
+    for ( uint32_t n = 0; n < topic->count; ++n ) {
+        uint32_t entIndex = topic->indices[ n ];
+        ++starts[ ( entIndex == ECS_TOPIC_ALL_INDEX ) ? entityCount : entIndex ];
+    }
+    
+    /* Turn the counts into starts */
+    uint32_t total = 0;
+    for ( uint32_t n = 0; n <= entityCount; ++n ) {
+        uint32_t entCount = starts[ n ];
+        starts[ n ] = total;
+        total += entCount;
+    }
+    
+    /* Place the messages in publish order, which bumps each start along to the start of the next entity */
+    for ( uint32_t n = 0; n < topic->count; ++n ) {
+        uint32_t entIndex = topic->indices[ n ];
+        uint32_t slot = ( entIndex == ECS_TOPIC_ALL_INDEX ) ? entityCount : entIndex;
+        topic->order[ starts[ slot ]++ ] = n;
+    }
+    
+    /* Each start now holds the end of its entity, which is the start of the one after it */
+    memmove( starts + 1, starts, sizeof( uint32_t ) * entityCount );
+    starts[ 0 ] = 0;
+    
+    topic->allStart = starts[ entityCount ];
+    topic->entityCount = entityCount;
+    
+    atomic_store_explicit( &topic->sorted, true, memory_order_release );
+}
+
+/*=======================================================================================================================================*/
+void EcsTopic_Reset( ecs_topic_t * topic ) {
+    topic->dataUsed = 0;
+    topic->count = 0;
+    topic->allStart = 0;
+    topic->entityCount = 0;
+    atomic_store_explicit( &topic->sorted, true, memory_order_relaxed );
+}
+
+/*=======================================================================================================================================*/
+void EcsTopic_FindEntity( const ecs_topic_t * topic, ecs_entity_t ent, uint32_t * start, uint32_t * end ) {
+    uint32_t entIndex = ECS_ENTITY_INDEX( ent );
+    
+    xassert( atomic_load_explicit( &topic->sorted, memory_order_relaxed ) == true );
+    
+    /* Entities added since the sort have no messages */
+    if ( entIndex >= topic->entityCount ) {
+        *start = topic->allStart;
+        *end = topic->allStart;
+        return;
+    }
+    
+    *start = topic->entityStarts[ entIndex ];
+    *end = topic->entityStarts[ entIndex + 1 ];
+}
+
+/*=======================================================================================================================================*/
+ecs_msg_t * EcsTopic_GetMessage( const ecs_topic_t * topic, uint32_t index, ecs_entity_t * ent ) {
+    xassert( index < topic->count );
+    
+    const ecs_topic_record_t * record = (const ecs_topic_record_t *) ( topic->data + topic->offsets[ topic->order[ index ] ] );
+    if ( ent != NULL ) {
+        *ent = record->ent;
+    }
+    
+    return (ecs_msg_t *) ( record + 1 );
+}
@@ -0,0 +1,62 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __ECSTOPIC_H__
+#define __ECSTOPIC_H__
+
+#include "core/Platform.h"
+#include "ecs/EcsTypes.h"
+#include "core/Atomic.h"
+
+/*
+    A topic is a stream of messages shared by everything that publishes to it, rather than a queue per entity.
+    Each message is written once, tagged with the entity that it is for, or with ECS_ENTITY_NULL when it is for
+    every entity. Once publishing is done the stream is sorted by entity index, with a counting sort that keeps
+    the publish order for each entity, and the messages for an entity are found with a look-up by its index.
+    The messages for every entity come after all of the others.
+ 
+    Topics are not thread safe, the ECS serialises publishing and only reads a topic once it has been sorted.
+*/
+
+typedef struct ecs_topic_s {
+    uint8_t *       data;               /* Messages in the order they were published */
+    uint32_t        dataUsed;
+    uint32_t        dataSize;
+    uint32_t *      offsets;            /* Offset of each message in the data, in publish order */
+    uint32_t *      indices;            /* Entity index of each message, in publish order */
+    uint32_t *      order;              /* Publish order of the messages, sorted by entity */
+    uint32_t        count;
+    uint32_t        capacity;
+    uint32_t *      entityStarts;       /* First sorted message for each entity index, plus one for the end */
+    uint32_t        entityCount;        /* Number of entity indices covered by the starts */
+    uint32_t        entityStartsSize;
+    uint32_t        allStart;           /* First sorted message for every entity */
+    atomic_bool     sorted;
+} ecs_topic_t;
+
+XE_API void         EcsTopic_Init( ecs_topic_t * topic );
+XE_API void         EcsTopic_Destroy( ecs_topic_t * topic );
+XE_API void         EcsTopic_Publish( ecs_topic_t * topic, ecs_entity_t ent, uint16_t msgId, const void * data, size_t dataSize );
+XE_API void         EcsTopic_Sort( ecs_topic_t * topic, uint32_t entityCount );
+XE_API void         EcsTopic_Reset( ecs_topic_t * topic );
+XE_API void         EcsTopic_FindEntity( const ecs_topic_t * topic, ecs_entity_t ent, uint32_t * start, uint32_t * end );
+XE_API ecs_msg_t *  EcsTopic_GetMessage( const ecs_topic_t * topic, uint32_t index, ecs_entity_t * ent );
+
+#endif
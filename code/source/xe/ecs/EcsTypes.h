@@ -23,27 +23,101 @@
 
 #include "core/Platform.h"
 
-#define ECS_MAX_ENTITIES 2048
+#define ECS_ENTITY_PAGE_SIZE 64                             /* Entities per block of entity info, blocks are allocated as the entity count grows */
 #define ECS_MAX_SYSTEMS 128
 #define ECS_MAX_COMPONENT_TYPES 128
 #define ECS_MAX_MESSAGES 128
 
 #define ECS_ENTITY_NULL -1
+#define ECS_ENTITY_INDEX_MASK 0xFFFFFFFFull
+#define ECS_ENTITY_GENERATION_MASK 0x7FFFFFFFu           /* Top bit stays clear so a handle is never negative */
 #define ECS_COMPONENT_INVALID -1
 #define ECS_COMPONENT_SIZE_ALIGN 16
 
+#define ECS_SYSTEM_CHUNK_SIZE 256                           /* Entities per job when a system is split across workers */
+#define ECS_SCHEDULE_MEM_SIZE ( 1024 * 1024 * 2 )           /* Per-run memory for the schedule and staged messages */
+#define ECS_MESSAGE_STAGE_BLOCK_SIZE ( 1024 * 4 )
+
+#define ECS_ARCHETYPE_CHUNK_SIZE ( 1024 * 16 )              /* Size of a block of entities that share the same set of components */
+#define ECS_MAX_ARCHETYPES 256
+#define ECS_ARCHETYPE_MAX_COMPONENTS 32
+#define ECS_QUERY_MAX_COMPONENTS 8
+
+#define ECS_COMPONENT_MASK_WORDS ( ( ECS_MAX_COMPONENT_TYPES + 63 ) / 64 )
+
 #define ECS_BLUEPRINT_MAX_COMPONENTS 16
 #define ECS_MAX_NUM_MESSAGES 256
-#define ECS_MESSAGE_DATA_SIZE 1024 * 2
+#define ECS_MESSAGE_BLOCK_SIZE 256                          /* Messages for an entity are held in a list of blocks of this size */
+#define ECS_MESSAGE_PAGE_SIZE ( 1024 * 64 )                 /* Message blocks are allocated a page at a time */
+#define ECS_MAX_TOPICS 64
+#define ECS_TOPIC_BROADCAST 0                               /* Topic that every system with a message function is subscribed to */
+
+/* Profiling is on in debug builds, and can be turned on for release builds by defining ECS_PROFILE */
+#if ( defined( DEBUG ) || defined( _DEBUG ) ) && !defined( ECS_NO_PROFILE ) && !defined( ECS_PROFILE )
+#   define ECS_PROFILE
+#endif
 
+#define ECS_PROFILE_FRAMES 32                               /* Frames of profiling kept, including the one being recorded */
+#define ECS_PROFILE_MAX_EVENTS 1024                         /* Timed jobs kept per frame for the trace, the counters don't have a limit */
+
+/* Entity handles hold the index of the entity in the low 32 bits and the generation of that index in the high bits,
+   freeing an entity bumps the generation so old handles to it can be told apart from the entity that reuses the index */
 typedef int64_t ecs_entity_t;
+
+#define ECS_ENTITY_INDEX( __ent__ ) ( (uint32_t) ( (uint64_t) (__ent__) & ECS_ENTITY_INDEX_MASK ) )
+#define ECS_ENTITY_GENERATION( __ent__ ) ( (uint32_t) ( (uint64_t) (__ent__) >> 32 ) )
+#define ECS_ENTITY_MAKE( __index__, __generation__ ) ( (ecs_entity_t) ( ( (uint64_t) (__generation__) << 32 ) | (uint64_t) (__index__) ) )
 typedef int64_t ecs_component_index_t;
+typedef int32_t ecs_component_id_t;                 /* Index of a registered component type */
 typedef int64_t ecs_system_id_t;
 
-typedef struct ecs_entity_blueprint_s {
-    void * components[ECS_BLUEPRINT_MAX_COMPONENTS];
-    size_t componentCount;
-} ecs_entity_blueprint_s;
+typedef enum ecs_storage_e {
+    ECS_STORAGE_ARRAY       = 0,                /* Component has its own array, indexed through the entity */
+    ECS_STORAGE_ARCHETYPE,                      /* Component is stored in chunks with the other archetype components of the entity */
+} ecs_storage_t;
+
+typedef struct ecs_component_mask_s {
+    uint64_t        bits[ ECS_COMPONENT_MASK_WORDS ];
+} ecs_component_mask_t;
+
+typedef struct ecs_query_s {
+    ecs_component_mask_t    mask;
+    uint32_t                componentCount;
+    uint32_t                components[ ECS_QUERY_MAX_COMPONENTS ];
+} ecs_query_t;
+
+typedef struct ecs_query_iter_s {
+    const ecs_query_t *     query;
+    uint32_t                archetypeIndex;
+    uint32_t                chunkIndex;
+} ecs_query_iter_t;
+
+typedef struct ecs_chunk_view_s {
+    uint32_t                count;                                      /* Number of entities in the chunk */
+    const ecs_entity_t *    entities;
+    void *                  components[ ECS_QUERY_MAX_COMPONENTS ];     /* Start of each component column */
+} ecs_chunk_view_t;
+
+typedef enum ecs_access_e {
+    ECS_ACCESS_READ         = 1 << 0,
+    ECS_ACCESS_WRITE        = 1 << 1,
+} ecs_access_t;
+
+typedef enum ecs_system_flags_e {
+    ECS_SYSTEM_FLAG_NONE            = 0,
+    ECS_SYSTEM_FLAG_NO_SPLIT        = 1 << 0,       /* Think is not safe to run on several entities at once, so run the array as one job */
+    ECS_SYSTEM_FLAG_MAIN_THREAD     = 1 << 1,       /* Run on the thread calling Ecs_RunSystems, e.g. systems that submit to the renderer */
+    ECS_SYSTEM_FLAG_SENDS_MESSAGES  = 1 << 2,       /* Think sends entity messages or broadcasts, so it must run before the systems that receive them */
+} ecs_system_flags_t;
+
+/* Set of components with their default values, for spawning lots of the same kind of entity */
+typedef struct ecs_blueprint_s {
+    ecs_component_mask_t    mask;
+    uint32_t                componentCount;
+    int32_t                 archetypeIndex;                                 /* Archetype of the archetype stored components, -1 until resolved */
+    ecs_component_id_t      components[ ECS_BLUEPRINT_MAX_COMPONENTS ];
+    void *                  defaults[ ECS_BLUEPRINT_MAX_COMPONENTS ];       /* Copy of the default component, NULL to zero it */
+} ecs_blueprint_t;
 
 typedef struct ecs_msg_s {
     uint16_t        msg;            /* Message type */
@@ -52,17 +126,62 @@ typedef struct ecs_msg_s {
     uint32_t        size;           /* Size of the message header */
 } ecs_msg_t;
 
+typedef struct ecs_topic_iter_s {
+    uint16_t        topic;
+    uint16_t        pad;
+    uint32_t        index;          /* Next message for an entity */
+    uint32_t        end;
+    uint32_t        allIndex;       /* Next message for every entity */
+    uint32_t        allEnd;
+    ecs_entity_t    ent;            /* Entity the iterator was started for, or ECS_ENTITY_NULL for the whole topic */
+} ecs_topic_iter_t;
+
+/* Run of components that a batch think works through in one call, the components are stride bytes apart */
+typedef struct ecs_batch_s {
+    uint32_t                count;
+    uint32_t                stride;
+    const ecs_entity_t *    entities;
+    void *                  components;     /* First component of the run */
+} ecs_batch_t;
+
 typedef struct ecs_think_params_s {
     float       timeStep;           /* Time in seconds since the last think was called */
     void *      context;            /* User context */
 } ecs_think_params_t;
 
+/* What a system did in a frame, times are in nanoseconds from the start of the frame */
+typedef struct ecs_profile_system_s {
+    uint64_t        timeNs;             /* Time spent in the system, summed over its jobs */
+    uint64_t        startNs;            /* Start of the first job */
+    uint64_t        endNs;              /* End of the last job */
+    uint64_t        bytesCopied;        /* Messages sent and published, and deferred commands recorded */
+    uint32_t        entityCount;        /* Entities thought about */
+    uint32_t        messageCount;       /* Messages passed to the message function */
+    uint32_t        jobCount;
+    uint32_t        pad;
+} ecs_profile_system_t;
+
+typedef struct ecs_profile_frame_s {
+    uint64_t                frameIndex;
+    uint64_t                startNs;        /* Sys_GetTicksNs at the start of the frame */
+    uint64_t                durationNs;
+    uint64_t                commitNs;       /* Committing the messages staged by systems */
+    uint64_t                commandsNs;     /* Playing back deferred commands */
+    uint64_t                endFrameNs;     /* Ecs_EndFrame retiring messages */
+    uint32_t                systemCount;
+    uint32_t                eventCount;
+    uint32_t                droppedEvents;  /* Jobs that didn't fit in the trace */
+    uint32_t                pad;
+    ecs_profile_system_t    systems[ ECS_MAX_SYSTEMS ];
+} ecs_profile_frame_t;
+
 typedef struct ecs_system_s {
     const char * desc;
     void (*constructDefault)( ecs_entity_t ent, void * component );
     void (*destruct)( void * component );
     void (*think)( ecs_entity_t ent, void * component, ecs_think_params_t * params );
     void (*message)( ecs_msg_t * msg, void * componentPtr );
+    void (*thinkBatch)( const ecs_batch_t * batch, ecs_think_params_t * params );   /* Optional, called with runs of components instead of think */
 } ecs_system_t;
 
 
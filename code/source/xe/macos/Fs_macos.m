@@ -23,13 +23,18 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <errno.h>
 #include <Foundation/Foundation.h>
 
 #include "Fs.h"
 #include "Str.h"
 #include "core/Sys.h"
+#include "core/Pak.h"
+#include "core/PakStream.h"
+#include "mem/Mem.h"
 
 #define FS_MAX_PATH_LENGTH 512
 #define FS_MAX_FILES 64
@@ -38,6 +43,14 @@ typedef struct file_data_s {
     uint64_t    index;
     FILE*       file;
     bool_t       free;
+    
+    /* Files in a mounted pack have no FILE of their own, they are read with pread from the pack's descriptor */
+    bool_t      inPak;
+    int         fd;
+    uint64_t    base;
+    uint64_t    length;
+    uint64_t    offset;
+    uint8_t *   mem;            /* Inflated copy of a compressed pack file */
 } file_data_t;
 
 typedef struct fs_s {
@@ -88,6 +101,7 @@ void FS_Initialise(void) {
 /*---------------------------------------------------------------------------------------------------------------------------------------*/
 void FS_Finalise(void) {
     assert(fileSystem != NULL);
+    Pak_UnmountAll();
     fileSystem = NULL;
 }
 
@@ -98,6 +112,54 @@ void FS_SetDataPath( const char * path ) {
     xprintf("Data now set to path: %s\n", fileSystem->dataFolderPath );
 }
 
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+static size_t FS_ReadAt( int fd, void * buffer, size_t size, uint64_t offset ) {
+    uint8_t * dest = ( uint8_t * ) buffer;
+    size_t amtRead = 0;
+    
+    while ( amtRead < size ) {
+        ssize_t res = pread( fd, dest + amtRead, size - amtRead, ( off_t ) ( offset + amtRead ) );
+        if ( res > 0 ) {
+            amtRead += ( size_t ) res;
+        }
+        else if ( res == 0 || errno != EINTR ) {
+            break;
+        }
+    }
+    
+    return amtRead;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+static bool_t FS_FileOpenPak( file_t * self_, const pak_file_t * pakFile ) {
+    const file_data_t * pakData = (const file_data_t *) pakFile->pak->data;
+    file_data_t * fileData = (file_data_t * ) self_->data;
+    
+    memset( fileData, 0, sizeof( file_data_t ) );
+    fileData->fd = fileno( pakData->file );
+    fileData->inPak = true;
+    fileData->base = pakFile->offset;
+    fileData->length = pakFile->size;
+    
+    if ( ( pakFile->flags & PAKSTREAM_F_ZLIB ) != 0 ) {
+        /* Compressed files are inflated up front and read from memory */
+        void * compressed = Mem_Alloc( (size_t) pakFile->compressedSize );
+        fileData->mem = (uint8_t *) Mem_Alloc( ( pakFile->size > 0 ) ? (size_t) pakFile->size : 1 );
+        
+        bool_t ok = ( FS_ReadAt( fileData->fd, compressed, (size_t) pakFile->compressedSize, pakFile->offset ) == pakFile->compressedSize ) ? true : false;
+        ok = ok && Pak_Inflate( fileData->mem, (size_t) pakFile->size, compressed, (size_t) pakFile->compressedSize );
+        Mem_Free( compressed );
+        
+        if ( ok == false ) {
+            Mem_Free( fileData->mem );
+            fileData->mem = NULL;
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 /*---------------------------------------------------------------------------------------------------------------------------------------*/
 bool_t FS_FileOpen( file_t * self_, const char* path, const char* mode) {
     bool_t makePathOk = FALSE;
@@ -107,15 +169,26 @@ bool_t FS_FileOpen( file_t * self_, const char* path, const char* mode) {
     assert(fileSystem != NULL);
     assert(path != NULL);
     assert(mode != NULL);
+    
+    /* Files in the data folder that are only being read come from the mounted packs first */
+    pak_file_t pakFile;
+    if ( path[ 0 ] == '~' && mode[ 0 ] == 'r' && strchr( mode, '+' ) == NULL && Pak_Find( path, &pakFile ) == true ) {
+        return FS_FileOpenPak( self_, &pakFile );
+    }
 
-    /* Make the full path to the file */
-    makePathOk = FS_MakePath( &fileSystem->filePathTmp, path );
-    if (makePathOk == FALSE) {
+    /* Make the full path to the file, in a local string so files can be opened from any thread */
+    str_t fullPath = NULL;
+    makePathOk = FS_MakePath( &fullPath, path );
+    if (makePathOk == FALSE || fullPath == NULL) {
+        if ( fullPath != NULL ) {
+            Str_Destroy( &fullPath );
+        }
         return false;
     }
     
     /* Attempt tp open the file */
-    file = fopen( fileSystem->filePathTmp, mode );
+    file = fopen( fullPath, mode );
+    Str_Destroy( &fullPath );
     if ( file == NULL ) {
         return false;
     }
@@ -124,6 +197,7 @@ bool_t FS_FileOpen( file_t * self_, const char* path, const char* mode) {
     static_assert( sizeof( file_t ) >= sizeof(file_data_t), "Size of file_t.data is too small for implementation " );
     
     file_data_t * fileData = (file_data_t * ) self_->data;
+    memset( fileData, 0, sizeof( file_data_t ) );
 
     fileData->file = file;
     fileData->free = FALSE;
@@ -136,6 +210,15 @@ void FS_FileClose( file_t * file) {
     assert(file != NULL);
     
     file_data_t * fileData = (file_data_t * ) file->data;
+    if ( fileData->inPak == true ) {
+        if ( fileData->mem != NULL ) {
+            Mem_Free( fileData->mem );
+            fileData->mem = NULL;
+        }
+        fileData->fd = -1;
+        return;
+    }
+    
     fclose( fileData->file );
     fileData->file = NULL;
 }
@@ -145,6 +228,10 @@ size_t FS_FileLength(file_t* file) {
     struct stat buf;
     assert(file != NULL);
     
+    if ( ((file_data_t*)file)->inPak == true ) {
+        return ( size_t ) ((file_data_t*)file)->length;
+    }
+    
     fstat(fileno( ((file_data_t*)file)->file), &buf);
     off_t size = buf.st_size;
     
@@ -157,6 +244,10 @@ uintptr_t FS_FileTell(file_t* file) {
     
     assert(file != NULL);
     
+    if ( fileData->inPak == true ) {
+        return ( uintptr_t ) fileData->offset;
+    }
+    
     return ftello(fileData->file);
 }
 
@@ -166,6 +257,12 @@ bool_t FS_FileSeek(file_t* file, uintptr_t pos) {
     int res;
     
     assert(file != NULL);
+    
+    if ( fileData->inPak == true ) {
+        fileData->offset = pos;
+        return true;
+    }
+    
     res = fseek( fileData->file, pos, SEEK_SET );
     
     return (res == 0);
@@ -176,6 +273,26 @@ size_t FS_FileRead(file_t* file, void* buffer, size_t elementSize, size_t elemen
     file_data_t * fileData = (file_data_t * ) file->data;
     assert(file != NULL);
     
+    if ( fileData->inPak == true ) {
+        /* Stop at the end of the file rather than reading on into the next one in the pack */
+        size_t total = elementSize * elementCount;
+        uint64_t remaining = ( fileData->offset < fileData->length ) ? fileData->length - fileData->offset : 0;
+        if ( total > remaining ) {
+            total = ( size_t ) remaining;
+        }
+        
+        size_t amtRead = total;
+        if ( fileData->mem != NULL ) {
+            memcpy( buffer, fileData->mem + fileData->offset, total );
+        }
+        else {
+            amtRead = FS_ReadAt( fileData->fd, buffer, total, fileData->base + fileData->offset );
+        }
+        
+        fileData->offset += amtRead;
+        return ( elementSize > 0 ) ? amtRead / elementSize : 0;
+    }
+    
     return fread( buffer, elementSize, elementCount, fileData->file );
 }
 
@@ -184,9 +301,64 @@ size_t FS_FileWrite(file_t* file, const void* buffer, size_t elementSize, size_t
     file_data_t * fileData = (file_data_t * ) file->data;
     assert(file != NULL);
     
+    /* Packs are read only */
+    if ( fileData->inPak == true ) {
+        return 0;
+    }
+    
     return fwrite( buffer, elementSize, elementCount, fileData->file );
 }
 
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+bool_t FS_FileMap( file_t * file, file_map_t * mapOut ) {
+    assert( file != NULL );
+    assert( mapOut != NULL );
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    memset( mapOut, 0, sizeof( file_map_t ) );
+    
+    size_t length = FS_FileLength( file );
+    if ( length == 0 ) {
+        return false;
+    }
+    
+    /* Compressed pack files are already in memory */
+    if ( fileData->mem != NULL ) {
+        mapOut->data = fileData->mem;
+        mapOut->size = length;
+        return true;
+    }
+    
+    /* mmap wants a page aligned offset, so files in a pack map from the page they start in */
+    int fd = ( fileData->inPak == true ) ? fileData->fd : fileno( fileData->file );
+    uint64_t pageSize = ( uint64_t ) getpagesize();
+    uint64_t start = ( fileData->inPak == true ) ? fileData->base : 0;
+    uint64_t delta = start % pageSize;
+    size_t baseSize = length + ( size_t ) delta;
+    
+    void * base = mmap( NULL, baseSize, PROT_READ, MAP_PRIVATE, fd, ( off_t ) ( start - delta ) );
+    if ( base == MAP_FAILED ) {
+        return false;
+    }
+    
+    mapOut->data = ( const uint8_t * ) base + delta;
+    mapOut->size = length;
+    mapOut->base = base;
+    mapOut->baseSize = baseSize;
+    
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+void FS_FileUnmap( file_map_t * map ) {
+    assert( map != NULL );
+    
+    if ( map->base != NULL ) {
+        munmap( map->base, map->baseSize );
+    }
+    memset( map, 0, sizeof( file_map_t ) );
+}
+
 /*---------------------------------------------------------------------------------------------------------------------------------------*/
 bool_t FS_MakePath( str_t * pathOut, const char * path ) {
     if (path[0] == '~') {
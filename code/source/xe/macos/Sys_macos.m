@@ -82,6 +82,22 @@ uint64_t Sys_GetTicks(void) {
     return ticks;
 }
 
+/*======================================================================================================================================= */
+uint64_t Sys_GetTicksNs(void) {
+    uint64_t ticks;
+    
+    if ( sys.timeIsMonotomic == true) {
+        uint64_t now = mach_absolute_time();
+        ticks = (uint64_t)(((now - sys.machStartTime) * sys.timeBaseInfo.numer) / sys.timeBaseInfo.denom);
+    } else {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        ticks = (uint64_t)((now.tv_sec - sys.tvStartTime.tv_sec) * 1000000000ull + (now.tv_usec - sys.tvStartTime.tv_usec) * 1000ull);
+    }
+    
+    return ticks;
+}
+
 /*======================================================================================================================================= */
 void Sys_Printf( const char * fmt, ... ) {
     /* initialize use of the variable argument array */
@@ -119,28 +135,3 @@ void Sys_AssertPrintf( const char * file, int line, const char * fmt, ... ) {
     Str_Destroy( &msg );
     Str_Destroy( &header );
 }
-
-/*======================================================================================================================================= */
-void Sys_MutexCreate( sys_mutex_t * self_ ) {
-    
-}
-
-/*======================================================================================================================================= */
-void Sys_MutexDestroy( sys_mutex_t * self_ ) {
-    
-}
-
-/*======================================================================================================================================= */
-void Sys_MutexLock( sys_mutex_t * self_ ) {
-    
-}
-
-/*======================================================================================================================================= */
-void Sys_MutexTryLock( sys_mutex_t * self_ ) {
-    
-}
-
-/*======================================================================================================================================= */
-void Sys_MutexUnlock( sys_mutex_t * self_ ) {
-    
-}
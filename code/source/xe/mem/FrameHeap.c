@@ -20,18 +20,34 @@
 
 #include "mem/FrameHeap.h"
 #include "core/Id.h"
+#include "core/Sys.h"
+#include "core/Atomic.h"
 #include <assert.h>
 
 #define MAGIC MAKE_ID( F, R, A, M, E, H, E, A, P, _, _, _ )
+#define MAGIC_RING MAKE_ID( F, R, A, M, E, H, E, A, P, R, N, G )
 #define FRAME_HEAP_DEFAULT_ALIGNMENT 8
+#define FRAME_HEAP_RING_ALIGNMENT 64
+#define FRAME_HEAP_RING_CAPACITY 4
 
 typedef struct frame_heap_s {
-    uint64_t        magic;
-    uintptr_t       memStart;
-    uintptr_t       memEnd;
-    uintptr_t       memPtr;
+    uint64_t             magic;
+    uintptr_t            memStart;
+    uintptr_t            memEnd;
+    atomic_uintptr_t     memPtr;                                    /* Bumped with a compare and swap so any thread can allocate */
+    size_t               lastFrameUsed;
+    size_t               highWater;
 } frame_heap_t;
 
+typedef struct frame_heap_ring_s {
+    uint64_t             magic;
+    frame_heap_t *       heaps[ FRAME_HEAP_RING_CAPACITY ];
+    uint64_t             heapFrames[ FRAME_HEAP_RING_CAPACITY ];    /* Frame that last recorded into each heap */
+    uint32_t             frameCount;
+    uint64_t             frameIndex;                                /* Frame currently recording, starts at 1 */
+    atomic_uint_fast64_t retiredFrame;                              /* Newest frame that has been fully consumed */
+} frame_heap_ring_t;
+
 /*=======================================================================================================================================*/
 frame_heap_t * FrameHeap_Create( uintptr_t mem, size_t memSize ) {
     uintptr_t newMemStart = mem + sizeof( frame_heap_t );
@@ -41,11 +57,34 @@ frame_heap_t * FrameHeap_Create( uintptr_t mem, size_t memSize ) {
     heap->magic = MAGIC;
     heap->memStart = newMemStart;
     heap->memEnd = newMemStart + newMemSize;
-    heap->memPtr = newMemStart;
+    heap->lastFrameUsed = 0;
+    heap->highWater = 0;
+    atomic_init( &heap->memPtr, newMemStart );
     
     return heap;
 }
 
+/*=======================================================================================================================================*/
+static void * FrameHeap_AllocInternal( frame_heap_t * self_, size_t size, size_t alignment ) {
+    uintptr_t ptr, rem, curr;
+    
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC );
+    
+    curr = atomic_load_explicit( &self_->memPtr, memory_order_relaxed );
+    do {
+        ptr = curr;
+        rem = ( ptr % alignment );
+        ptr = ( rem == 0 ) ? ptr : ptr + alignment - rem;
+        
+        if ( ptr + size > self_->memEnd ) {
+            return NULL;
+        }
+    } while ( atomic_compare_exchange_weak_explicit( &self_->memPtr, &curr, ptr + size, memory_order_relaxed, memory_order_relaxed ) == false );
+    
+    return (void *) ptr;
+}
+
 /*=======================================================================================================================================*/
 void * FrameHeap_Alloc( frame_heap_t * self_, size_t size ) {
     return FrameHeap_AllocAligned( self_, size, FRAME_HEAP_DEFAULT_ALIGNMENT );
@@ -53,24 +92,127 @@ void * FrameHeap_Alloc( frame_heap_t * self_, size_t size ) {
 
 /*=======================================================================================================================================*/
 void * FrameHeap_AllocAligned( frame_heap_t * self_, size_t size, size_t alignment ) {
-    uintptr_t ptr, rem;
-    
+    void * mem = FrameHeap_AllocInternal( self_, size, alignment );
+    xassertmsg( mem != NULL, "Frame heap out of memory allocating %zu bytes\n", size );
+    return mem;
+}
+
+/*=======================================================================================================================================*/
+void * FrameHeap_TryAlloc( frame_heap_t * self_, size_t size ) {
+    return FrameHeap_AllocInternal( self_, size, FRAME_HEAP_DEFAULT_ALIGNMENT );
+}
+
+/*=======================================================================================================================================*/
+void FrameHeap_Reset( frame_heap_t * self_ ) {
     assert( self_ != NULL );
     assert( self_->magic == MAGIC );
-        
-    ptr = self_->memPtr;
-    rem = ( ptr % alignment );
-    ptr = ( rem == 0 ) ? ptr : ptr + alignment - rem;
-        
-    assert( ptr + size <= self_->memEnd );
-    self_->memPtr = ptr + size;
     
-    return (void *) ptr;
+    /* Only the thread that owns the frame resets the heap, so no one else can be
+       allocating from it here */
+    size_t used = atomic_load_explicit( &self_->memPtr, memory_order_relaxed ) - self_->memStart;
+    self_->lastFrameUsed = used;
+    self_->highWater = ( used > self_->highWater ) ? used : self_->highWater;
+    
+    atomic_store_explicit( &self_->memPtr, self_->memStart, memory_order_relaxed );
 }
 
 /*=======================================================================================================================================*/
-void FrameHeap_Reset( frame_heap_t * self_ ) {
+void FrameHeap_GetStats( frame_heap_t * self_, frame_heap_stats_t * stats ) {
     assert( self_ != NULL );
     assert( self_->magic == MAGIC );
-    self_->memPtr = self_->memStart;
+    
+    stats->size = self_->memEnd - self_->memStart;
+    stats->used = atomic_load_explicit( &self_->memPtr, memory_order_relaxed ) - self_->memStart;
+    stats->lastFrameUsed = self_->lastFrameUsed;
+    stats->highWater = ( stats->used > self_->highWater ) ? stats->used : self_->highWater;
+}
+
+/*=======================================================================================================================================*/
+frame_heap_ring_t * FrameHeapRing_Create( uintptr_t mem, size_t memSize, uint32_t frameCount ) {
+    assert( frameCount > 0 && frameCount <= FRAME_HEAP_RING_CAPACITY );
+    
+    frame_heap_ring_t * ring = (frame_heap_ring_t *) mem;
+    uintptr_t heapMem = Sys_Align( mem + sizeof( frame_heap_ring_t ), FRAME_HEAP_RING_ALIGNMENT );
+    size_t heapSize = ( ( mem + memSize ) - heapMem ) / frameCount;
+    heapSize -= heapSize % FRAME_HEAP_RING_ALIGNMENT;
+    
+    ring->magic = MAGIC_RING;
+    ring->frameCount = frameCount;
+    ring->frameIndex = 0;
+    atomic_init( &ring->retiredFrame, 0 );
+    
+    for ( uint32_t n = 0; n < frameCount; ++n ) {
+        ring->heaps[ n ] = FrameHeap_Create( heapMem, heapSize );
+        ring->heapFrames[ n ] = 0;
+        heapMem += heapSize;
+    }
+    
+    return ring;
+}
+
+/*=======================================================================================================================================*/
+frame_heap_t * FrameHeapRing_BeginFrame( frame_heap_ring_t * self_ ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC_RING );
+    
+    ++self_->frameIndex;
+    uint32_t heapIndex = (uint32_t) ( self_->frameIndex % self_->frameCount );
+    uint64_t lastFrame = self_->heapFrames[ heapIndex ];
+    
+    /* The heap can't be reused until the frame that last recorded into it has been
+       retired. Callers should already be throttling on their own fences, so this
+       should only ever wait for a moment. Give the time slice away while waiting,
+       the thread retiring the frame may need this core */
+    while ( atomic_load_explicit( &self_->retiredFrame, memory_order_acquire ) < lastFrame ) {
+        Sys_ThreadYield();
+    }
+    
+    frame_heap_t * heap = self_->heaps[ heapIndex ];
+    FrameHeap_Reset( heap );
+    self_->heapFrames[ heapIndex ] = self_->frameIndex;
+    
+    return heap;
+}
+
+/*=======================================================================================================================================*/
+void FrameHeapRing_RetireFrame( frame_heap_ring_t * self_, uint64_t frameIndex ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC_RING );
+    
+    /* Frames can complete out of order, so only ever move the retired frame forwards */
+    uint64_t retired = atomic_load_explicit( &self_->retiredFrame, memory_order_relaxed );
+    while ( frameIndex > retired ) {
+        if ( atomic_compare_exchange_weak_explicit( &self_->retiredFrame, &retired, frameIndex, memory_order_release, memory_order_relaxed ) == true ) {
+            break;
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+frame_heap_t * FrameHeapRing_GetHeap( frame_heap_ring_t * self_ ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC_RING );
+    return self_->heaps[ self_->frameIndex % self_->frameCount ];
+}
+
+/*=======================================================================================================================================*/
+uint64_t FrameHeapRing_GetFrameIndex( frame_heap_ring_t * self_ ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC_RING );
+    return self_->frameIndex;
+}
+
+/*=======================================================================================================================================*/
+void FrameHeapRing_GetStats( frame_heap_ring_t * self_, frame_heap_stats_t * stats ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC_RING );
+    
+    /* Stats for the frame being recorded, with the high water mark taken over every heap */
+    FrameHeap_GetStats( FrameHeapRing_GetHeap( self_ ), stats );
+    
+    for ( uint32_t n = 0; n < self_->frameCount; ++n ) {
+        frame_heap_stats_t heapStats;
+        FrameHeap_GetStats( self_->heaps[ n ], &heapStats );
+        stats->highWater = ( heapStats.highWater > stats->highWater ) ? heapStats.highWater : stats->highWater;
+    }
 }
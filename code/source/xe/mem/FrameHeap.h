@@ -24,10 +24,30 @@
 #include "core/Platform.h"
 
 typedef struct frame_heap_s frame_heap_t;
+typedef struct frame_heap_ring_s frame_heap_ring_t;
+
+typedef struct frame_heap_stats_s {
+    size_t          size;               /* Total memory the heap can hand out */
+    size_t          used;               /* Memory handed out since the last reset */
+    size_t          lastFrameUsed;      /* Memory that was in use when the heap was last reset */
+    size_t          highWater;          /* Most memory ever in use between two resets */
+} frame_heap_stats_t;
 
 XE_API frame_heap_t *      FrameHeap_Create( uintptr_t mem, size_t memSize );
 XE_API void *              FrameHeap_Alloc( frame_heap_t * self_, size_t size );
 XE_API void *              FrameHeap_AllocAligned( frame_heap_t * self_, size_t size, size_t alignment );
+XE_API void *              FrameHeap_TryAlloc( frame_heap_t * self_, size_t size );         /* NULL when the heap is full, without asserting */
 XE_API void                FrameHeap_Reset( frame_heap_t * self_ );
+XE_API void                FrameHeap_GetStats( frame_heap_t * self_, frame_heap_stats_t * stats );
+
+/* A ring of frame heaps, one per frame that can be in flight. Each frame records
+   into the next heap in the ring, and a heap is only reset once the frame that
+   last used it has been retired (e.g. from a GPU completion handler) */
+XE_API frame_heap_ring_t * FrameHeapRing_Create( uintptr_t mem, size_t memSize, uint32_t frameCount );
+XE_API frame_heap_t *      FrameHeapRing_BeginFrame( frame_heap_ring_t * self_ );
+XE_API void                FrameHeapRing_RetireFrame( frame_heap_ring_t * self_, uint64_t frameIndex );
+XE_API frame_heap_t *      FrameHeapRing_GetHeap( frame_heap_ring_t * self_ );
+XE_API uint64_t            FrameHeapRing_GetFrameIndex( frame_heap_ring_t * self_ );
+XE_API void                FrameHeapRing_GetStats( frame_heap_ring_t * self_, frame_heap_stats_t * stats );
 
 #endif
@@ -24,38 +24,195 @@
 #include "core/CVar.h"
 #include "core/Bsearch.h"
 #include "core/Array.h"
+#include "core/Fs.h"
+#include "core/Atomic.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-//#include "tlsf/tlsf.h"
-//#include <pthread.h>
+#include "tlsf.h"
 
 #ifdef __APPLE__
 #   include <malloc/malloc.h>
+#elif defined( __linux__ ) || defined( _WIN32 )
+#   include <malloc.h>
 #endif
 
+#define MEM_SIZE_CLASS_COUNT        12
+#define MEM_SIZE_CLASS_LARGE        0xFFFFFFFF
+#define MEM_SIZE_CLASS_HEAP         0xFFFFFFFE
+#define MEM_SMALL_SIZE_MAX          1024
+#define MEM_SMALL_ALIGN             16
+#define MEM_CHUNK_SIZE              ( 64 * 1024 )
+#define MEM_CACHE_BATCH_COUNT       32                              /* Number of blocks moved between a thread cache and the global pool */
+#define MEM_CACHE_MAX_COUNT         ( MEM_CACHE_BATCH_COUNT * 2 )   /* Blocks a thread can hold per size class before returning a batch */
+
+/* Default sizes of the engine heaps created by Mem_CreateHeaps, a size of zero
+   leaves that heap out and its allocations go to the default allocator */
+#ifndef MEM_HEAP_RENDER_SIZE
+#   define MEM_HEAP_RENDER_SIZE     ( 10 * 1024 * 1024 )
+#endif
+#ifndef MEM_HEAP_RESOURCE_SIZE
+#   define MEM_HEAP_RESOURCE_SIZE   ( 16 * 1024 * 1024 )
+#endif
+#ifndef MEM_HEAP_ECS_SIZE
+#   define MEM_HEAP_ECS_SIZE        ( 8 * 1024 * 1024 )
+#endif
+
+/* Every block handed out by Mem_Alloc is preceeded by this header. It lets Mem_Free
+   route the block back to the right place and keeps the stats without asking the
+   allocator for the block size. */
+typedef struct mem_block_header_s {
+#ifdef MEM_TRACKING
+    uint32_t        tag;                /* Tracking record the block is counted against */
+    uint32_t        pad[ 3 ];           /* Keeps the header a multiple of 16 bytes */
+#endif
+    uint32_t        sizeClass;          /* Size class of the block or MEM_SIZE_CLASS_LARGE */
+    uint32_t        offset;             /* Distance from the start of the allocator block to the user pointer */
+    uint64_t        size;               /* Size of the block counted against the stats */
+} mem_block_header_t;
+
+typedef struct mem_free_node_s {
+    struct mem_free_node_s * next;
+} mem_free_node_t;
+
+typedef struct mem_free_list_s {
+    mem_free_node_t *   head;
+    uint32_t            count;
+} mem_free_list_t;
+
+/* Per-thread cache of small blocks. Caches are never freed, they are kept in a list
+   so that Mem_GetStats can merge the counters, and are reused when a thread exits. */
+typedef struct mem_thread_cache_s {
+    mem_free_list_t                 freeLists[ MEM_SIZE_CLASS_COUNT ];
+    atomic_uint_fast64_t            numAllocs;
+    atomic_uint_fast64_t            numFrees;
+    atomic_int_fast64_t             sizeAlloc;
+    atomic_bool                     inUse;
+    struct mem_thread_cache_s *     next;
+} mem_thread_cache_t;
+
+/* A fixed size block of memory managed by a tlsf allocator */
+typedef struct mem_heap_s {
+    const char *            name;
+    void *                  memory;
+    size_t                  memorySize;
+    tlsf_t                  tlsf;
+    bool_t                  ownsMemory;
+    sys_mutex_t             mutex;
+    uint64_t                numAllocs;
+    uint64_t                numFrees;
+    uint64_t                numOverflows;
+} mem_heap_t;
+
 typedef struct mem_s {
-    mem_allocator_t     defaultAllocator;
-    mem_allocator_t *   allocator;
-    sys_mutex_t         mutex;
-    uint64_t            numAllocs;
-    uint64_t            numFrees;
-    uint64_t            memSizeAlloc;
+    mem_allocator_t         defaultAllocator;
+    mem_allocator_t *       allocator;
+    sys_mutex_t             mutex;
+    mem_free_list_t         freeLists[ MEM_SIZE_CLASS_COUNT ];      /* Global pool of small blocks, guarded by mutex */
+    void *                  chunks;                                 /* List of chunks carved into small blocks */
+    mem_thread_cache_t *    threadCaches;                           /* List of every thread cache that was created */
+    uint8_t                 sizeClassLookup[ ( MEM_SMALL_SIZE_MAX / MEM_SMALL_ALIGN ) + 1 ];
+    mem_heap_t              heaps[ MEM_HEAP_CAPACITY ];
+    uintptr_t               heapAddressSorted[ MEM_HEAP_CAPACITY ];     /* Heap base addresses, sorted so a block can be mapped to its heap */
+    uint32_t                heapAddressMap[ MEM_HEAP_CAPACITY ];        /* Heap id for each entry of heapAddressSorted */
+    size_t                  heapCount;
 } mem_t;
 
+static const uint32_t MEM_SIZE_CLASSES[ MEM_SIZE_CLASS_COUNT ] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+
 mem_t mem;
 bool_t memInit = false;
+static XE_THREAD_LOCAL mem_thread_cache_t * memThreadCache = NULL;
+
+#ifdef MEM_TRACKING
+
+#define MEM_TRACK_CAPACITY          1024
+#define MEM_TRACK_UNTAGGED          0
+#define MEM_TRACK_HISTOGRAM_COUNT   18          /* Power of two size buckets, from 16 bytes and under up to over 1MB */
+#define MEM_TRACK_TAG_STACK_DEPTH   16
+
+/* Allocation stats for a single tag or call site */
+typedef struct mem_track_record_s {
+    const char *    name;                       /* Tag name, or source file of the call site */
+    int32_t         line;                       /* Line of the call site, zero for a tag */
+    uint64_t        liveBytes;
+    uint64_t        peakBytes;
+    uint64_t        numAllocs;
+    uint64_t        numFrees;
+    uint64_t        frameAllocs;                /* Allocations made so far this frame */
+    uint64_t        frameBytes;
+    uint64_t        lastFrameAllocs;            /* Allocations made during the last full frame */
+    uint64_t        lastFrameBytes;
+    uint64_t        peakFrameAllocs;            /* Most allocations made during any one frame */
+    uint64_t        peakFrameBytes;
+    uint64_t        histogram[ MEM_TRACK_HISTOGRAM_COUNT ];
+} mem_track_record_t;
+
+typedef struct mem_track_s {
+    sys_mutex_t             mutex;
+    uint64_t                recordKeys[ MEM_TRACK_CAPACITY ];       /* Sorted keys so a call site can be found quickly */
+    uint32_t                recordKeyMap[ MEM_TRACK_CAPACITY ];     /* Record index for each entry of recordKeys */
+    mem_track_record_t      records[ MEM_TRACK_CAPACITY ];
+    size_t                  recordCount;
+} mem_track_t;
+
+static mem_track_t memTrack;
+static XE_THREAD_LOCAL const char * memTagStack[ MEM_TRACK_TAG_STACK_DEPTH ];
+static XE_THREAD_LOCAL uint32_t memTagStackCount = 0;
+
+#endif
+
+#ifdef _WIN32
+
+/* Blocks from _aligned_malloc have to go back through _aligned_free, so on Windows every block the default
+   allocator hands out is an aligned one, and the unaligned ones just use the small block alignment */
 
 /*=======================================================================================================================================*/
 void * default_malloc( size_t size ) {
-    return malloc( size );
+    return _aligned_malloc( size, MEM_SMALL_ALIGN );
 }
 
 /*=======================================================================================================================================*/
 void * default_mallocAligned(size_t size, size_t align) {
+    return _aligned_malloc( size, ( align < MEM_SMALL_ALIGN ) ? MEM_SMALL_ALIGN : align );
+}
+
+/*=======================================================================================================================================*/
+void * default_realloc( void * mem, size_t newSize ) {
+    return _aligned_realloc( mem, newSize, MEM_SMALL_ALIGN );
+}
+
+/*=======================================================================================================================================*/
+void default_free( void * memory ) {
+    _aligned_free( memory );
+}
+
+/*=======================================================================================================================================*/
+size_t default_get_block_size( void * memory ) {
+    /* Only right for blocks that were allocated with the small block alignment */
+    return _aligned_msize( memory, MEM_SMALL_ALIGN, 0 );
+}
+
+#else
+
+/*=======================================================================================================================================*/
+void * default_malloc( size_t size ) {
     return malloc( size );
 }
 
+/*=======================================================================================================================================*/
+void * default_mallocAligned(size_t size, size_t align) {
+    void * ptr = NULL;
+    
+    if ( align < sizeof( void * ) ) {
+        align = sizeof( void * );
+    }
+    
+    return ( posix_memalign( &ptr, align, size ) == 0 ) ? ptr : NULL;
+}
+
 /*=======================================================================================================================================*/
 void * default_realloc( void * mem, size_t newSize ) {
     return realloc( mem, newSize );
@@ -68,7 +225,135 @@ void default_free( void * memory ) {
 
 /*=======================================================================================================================================*//*=======================================================================================================================================*/
 size_t default_get_block_size( void * memory ) {
+#ifdef __APPLE__
     return malloc_size( memory );
+#else
+    return malloc_usable_size( memory );
+#endif
+}
+
+#endif
+
+/*=======================================================================================================================================*/
+static X_INLINE mem_block_header_t * Mem_GetHeader( void * ptr ) {
+    return ( mem_block_header_t * ) ( ( uintptr_t ) ptr - sizeof( mem_block_header_t ) );
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void Mem_CounterAdd( atomic_uint_fast64_t * counter, uint64_t value ) {
+    /* Only the owning thread writes the counter, so a relaxed load/store pair is enough */
+    atomic_store_explicit( counter, atomic_load_explicit( counter, memory_order_relaxed ) + value, memory_order_relaxed );
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void Mem_SizeAdd( atomic_int_fast64_t * counter, int64_t value ) {
+    atomic_store_explicit( counter, atomic_load_explicit( counter, memory_order_relaxed ) + value, memory_order_relaxed );
+}
+
+/*=======================================================================================================================================*/
+static void Mem_AllocChunk( uint32_t sizeClass ) {
+    /* Called with the mutex held. Carves a new chunk into blocks for the size class
+       and pushes them onto the global free list */
+    size_t blockSize = MEM_SIZE_CLASSES[ sizeClass ] + sizeof( mem_block_header_t );
+    uintptr_t chunk = ( uintptr_t ) mem.allocator->mallocAligned( MEM_CHUNK_SIZE, 64 );
+    xerror( chunk == 0, "Out of memory allocating a %u byte chunk\n", MEM_CHUNK_SIZE );
+    
+    /* First few bytes of the chunk link it into the chunk list */
+    *( void ** ) chunk = mem.chunks;
+    mem.chunks = ( void * ) chunk;
+    
+    uintptr_t curr = chunk + 64;
+    uintptr_t end = chunk + MEM_CHUNK_SIZE;
+    mem_free_list_t * list = &mem.freeLists[ sizeClass ];
+    
+    while ( curr + blockSize <= end ) {
+        mem_block_header_t * header = ( mem_block_header_t * ) curr;
+        mem_free_node_t * node = ( mem_free_node_t * ) ( curr + sizeof( mem_block_header_t ) );
+        
+        header->sizeClass = sizeClass;
+        header->offset = sizeof( mem_block_header_t );
+        header->size = MEM_SIZE_CLASSES[ sizeClass ];
+        
+        node->next = list->head;
+        list->head = node;
+        ++list->count;
+        
+        curr += blockSize;
+    }
+}
+
+/*=======================================================================================================================================*/
+static mem_thread_cache_t * Mem_GetThreadCache( void ) {
+    mem_thread_cache_t * cache = memThreadCache;
+    if ( cache != NULL ) {
+        return cache;
+    }
+    
+    Sys_MutexLock( &mem.mutex );
+    {
+        /* Try and pick up a cache left behind by a thread that has exited */
+        for ( cache = mem.threadCaches; cache != NULL; cache = cache->next ) {
+            if ( atomic_load( &cache->inUse ) == false ) {
+                break;
+            }
+        }
+        
+        if ( cache == NULL ) {
+            cache = ( mem_thread_cache_t * ) mem.allocator->mallocAligned( sizeof( mem_thread_cache_t ), 64 );
+            xerror( cache == NULL, "Out of memory allocating a thread cache\n" );
+            memset( cache, 0, sizeof( *cache ) );
+            cache->next = mem.threadCaches;
+            mem.threadCaches = cache;
+        }
+        
+        atomic_store( &cache->inUse, true );
+    }
+    Sys_MutexUnlock( &mem.mutex );
+    
+    memThreadCache = cache;
+    return cache;
+}
+
+/*=======================================================================================================================================*/
+static void Mem_RefillCache( mem_free_list_t * list, uint32_t sizeClass ) {
+    Sys_MutexLock( &mem.mutex );
+    {
+        mem_free_list_t * globalList = &mem.freeLists[ sizeClass ];
+        if ( globalList->count == 0 ) {
+            Mem_AllocChunk( sizeClass );
+        }
+        
+        /* Move a batch of blocks over in one go, so that we don't come back
+           here for a while */
+        for ( uint32_t n = 0; n < MEM_CACHE_BATCH_COUNT && globalList->head != NULL; ++n ) {
+            mem_free_node_t * node = globalList->head;
+            globalList->head = node->next;
+            --globalList->count;
+            
+            node->next = list->head;
+            list->head = node;
+            ++list->count;
+        }
+    }
+    Sys_MutexUnlock( &mem.mutex );
+}
+
+/*=======================================================================================================================================*/
+static void Mem_ReturnToGlobal( mem_free_list_t * list, uint32_t sizeClass, uint32_t count ) {
+    Sys_MutexLock( &mem.mutex );
+    {
+        mem_free_list_t * globalList = &mem.freeLists[ sizeClass ];
+        for ( uint32_t n = 0; n < count && list->head != NULL; ++n ) {
+            mem_free_node_t * node = list->head;
+            list->head = node->next;
+            --list->count;
+            
+            node->next = globalList->head;
+            globalList->head = node;
+            ++globalList->count;
+        }
+    }
+    Sys_MutexUnlock( &mem.mutex );
 }
 
 /*=======================================================================================================================================*/
@@ -77,6 +362,8 @@ void Mem_Initialise( mem_allocator_t * allocator ) {
         return;
     }
     
+    memset( &mem, 0, sizeof( mem ) );
+    
     Sys_MutexCreate( &mem.mutex );
     mem.defaultAllocator.malloc = default_malloc;
     mem.defaultAllocator.mallocAligned = default_mallocAligned;
@@ -84,12 +371,24 @@ void Mem_Initialise( mem_allocator_t * allocator ) {
     mem.defaultAllocator.free = default_free;
     mem.defaultAllocator.get_block_size = default_get_block_size;
     
-    mem.numAllocs = 0;
-    mem.numFrees = 0;
-    mem.memSizeAlloc = 0;
-    
     mem.allocator = ( allocator == NULL ) ? &mem.defaultAllocator : allocator;
     
+    /* Build the table that maps a size (in 16 byte steps) to its size class */
+    uint32_t sizeClass = 0;
+    for ( uint32_t n = 0; n <= MEM_SMALL_SIZE_MAX / MEM_SMALL_ALIGN; ++n ) {
+        while ( MEM_SIZE_CLASSES[ sizeClass ] < n * MEM_SMALL_ALIGN ) {
+            ++sizeClass;
+        }
+        mem.sizeClassLookup[ n ] = (uint8_t) sizeClass;
+    }
+    
+#ifdef MEM_TRACKING
+    memset( &memTrack, 0, sizeof( memTrack ) );
+    Sys_MutexCreate( &memTrack.mutex );
+    memTrack.records[ MEM_TRACK_UNTAGGED ].name = "untagged";
+    memTrack.recordCount = 1;
+#endif
+    
     memInit = true;
 }
 
@@ -99,287 +398,638 @@ void Mem_Finalise(void) {
         return;
     }
     
+    mem_thread_cache_t * cache = mem.threadCaches;
+    while ( cache != NULL ) {
+        mem_thread_cache_t * next = cache->next;
+        mem.allocator->free( cache );
+        cache = next;
+    }
+    
+    for ( uint32_t n = 0; n < MEM_HEAP_CAPACITY; ++n ) {
+        mem_heap_t * heap = &mem.heaps[ n ];
+        if ( heap->tlsf == NULL ) {
+            continue;
+        }
+        
+        tlsf_destroy( heap->tlsf );
+        Sys_MutexDestroy( &heap->mutex );
+        if ( heap->ownsMemory == true ) {
+            mem.allocator->free( heap->memory );
+        }
+    }
+    
+    void * chunk = mem.chunks;
+    while ( chunk != NULL ) {
+        void * next = *( void ** ) chunk;
+        mem.allocator->free( chunk );
+        chunk = next;
+    }
+    
+    memThreadCache = NULL;
     Sys_MutexDestroy( &mem.mutex );
+#ifdef MEM_TRACKING
+    Sys_MutexDestroy( &memTrack.mutex );
+#endif
     memInit = false;
 }
 
 /*=======================================================================================================================================*/
-void * Mem_Alloc( size_t size ) {
-    void * ptr = NULL;
-    assert( memInit == true );
+void Mem_ThreadFinalise(void) {
+    mem_thread_cache_t * cache = memThreadCache;
+    if ( cache == NULL ) {
+        return;
+    }
     
-    Sys_MutexLock( &mem.mutex );
+    /* Hand every cached block back to the global pool. The counters stay with the
+       cache so that they are still merged into the stats. */
+    for ( uint32_t c = 0; c < MEM_SIZE_CLASS_COUNT; ++c ) {
+        Mem_ReturnToGlobal( &cache->freeLists[ c ], c, cache->freeLists[ c ].count );
+    }
+    
+    atomic_store( &cache->inUse, false );
+    memThreadCache = NULL;
+}
+
+#ifdef MEM_TRACKING
+
+/*=======================================================================================================================================*/
+static uint32_t Mem_FindTagLocked( const char * name, int32_t line ) {
+    if ( name == NULL ) {
+        return MEM_TRACK_UNTAGGED;
+    }
+    
+    /* Tags and file names are string literals, so the pointer is enough to
+       identify them */
+    uint64_t key = ( ( uint64_t ) ( uintptr_t ) name * 0x9E3779B97F4A7C15ull ) ^ ( uint64_t ) line;
+    
+    int32_t index = -1;
+    bool_t found = Bsearch_FindUint64( &index, key, memTrack.recordKeys, memTrack.recordCount - 1 );
+    
+    if ( found == true ) {
+        uint32_t tag = memTrack.recordKeyMap[ index ];
+        
+        /* Two call sites with the same key just share the untagged record */
+        if ( memTrack.records[ tag ].name != name || memTrack.records[ tag ].line != line ) {
+            return MEM_TRACK_UNTAGGED;
+        }
+        return tag;
+    }
+    
+    if ( memTrack.recordCount >= MEM_TRACK_CAPACITY ) {
+        return MEM_TRACK_UNTAGGED;
+    }
+    
+    uint32_t tag = (uint32_t) memTrack.recordCount;
+    memTrack.records[ tag ].name = name;
+    memTrack.records[ tag ].line = line;
+    
+    /* Record zero (untagged) has no key, so the key arrays are one shorter than the records */
+    Array_InsertAtPosUint64( index, key, memTrack.recordKeys, memTrack.recordCount - 1, MEM_TRACK_CAPACITY );
+    Array_InsertAtPosUint32( index, tag, memTrack.recordKeyMap, memTrack.recordCount - 1, MEM_TRACK_CAPACITY );
+    ++memTrack.recordCount;
+    
+    return tag;
+}
+
+/*=======================================================================================================================================*/
+static void Mem_TrackAlloc( mem_block_header_t * header, const char * file, int32_t line ) {
+    /* A pushed tag wins over the call site */
+    const char * name = file;
+    if ( memTagStackCount > 0 ) {
+        name = memTagStack[ memTagStackCount - 1 ];
+        line = 0;
+    }
+    
+    uint32_t bucket = 0;
+    while ( bucket < MEM_TRACK_HISTOGRAM_COUNT - 1 && header->size > ( 16ull << bucket ) ) {
+        ++bucket;
+    }
+    
+    /* The tag is found and the allocation counted against it under the one lock */
+    Sys_MutexLock( &memTrack.mutex );
     {
-        ++mem.numAllocs;
-        ptr =  mem.allocator->malloc( size );
-        mem.memSizeAlloc += mem.allocator->get_block_size( ptr );
+        uint32_t tag = Mem_FindTagLocked( name, line );
+        header->tag = tag;
+        
+        mem_track_record_t * record = &memTrack.records[ tag ];
+        record->liveBytes += header->size;
+        record->peakBytes = ( record->liveBytes > record->peakBytes ) ? record->liveBytes : record->peakBytes;
+        record->frameBytes += header->size;
+        ++record->frameAllocs;
+        ++record->numAllocs;
+        ++record->histogram[ bucket ];
+    }
+    Sys_MutexUnlock( &memTrack.mutex );
+}
+
+/*=======================================================================================================================================*/
+static void Mem_TrackFree( mem_block_header_t * header ) {
+    Sys_MutexLock( &memTrack.mutex );
+    {
+        mem_track_record_t * record = &memTrack.records[ header->tag ];
+        record->liveBytes -= header->size;
+        ++record->numFrees;
+    }
+    Sys_MutexUnlock( &memTrack.mutex );
+}
+
+#else
+
+#define Mem_TrackAlloc( HEADER, FILE, LINE )
+#define Mem_TrackFree( HEADER )
+
+#endif
+
+/*=======================================================================================================================================*/
+static void * Mem_AllocLarge( size_t size, size_t alignment ) {
+    /* Pad the front of the allocation so that the header fits and the user pointer
+       keeps the requested alignment */
+    size_t offset = ( alignment > sizeof( mem_block_header_t ) ) ? alignment : sizeof( mem_block_header_t );
+    uintptr_t block = ( uintptr_t ) mem.allocator->mallocAligned( size + offset, alignment );
+    if ( block == 0 ) {
+        return NULL;
     }
-    Sys_MutexUnlock( &mem.mutex );
     
-    return ptr;
+    mem_block_header_t * header = ( mem_block_header_t * ) ( block + offset - sizeof( mem_block_header_t ) );
+    header->sizeClass = MEM_SIZE_CLASS_LARGE;
+    header->offset = (uint32_t) offset;
+    header->size = size;
+    
+    return ( void * ) ( block + offset );
 }
 
 /*=======================================================================================================================================*/
-void * Mem_AllocAligned( size_t size, size_t alignment ) {
+static void * Mem_AllocInternal( size_t size, size_t alignment, const char * file, int32_t line ) {
     void * ptr = NULL;
     assert( memInit == true );
     
-    Sys_MutexLock( &mem.mutex );
-    {
-        ++mem.numAllocs;
-        ptr =  mem.allocator->mallocAligned( size, alignment );
-        mem.memSizeAlloc += mem.allocator->get_block_size( ptr );
+    mem_thread_cache_t * cache = Mem_GetThreadCache();
+    
+    if ( size <= MEM_SMALL_SIZE_MAX && alignment <= MEM_SMALL_ALIGN ) {
+        uint32_t sizeClass = mem.sizeClassLookup[ ( size + MEM_SMALL_ALIGN - 1 ) / MEM_SMALL_ALIGN ];
+        mem_free_list_t * list = &cache->freeLists[ sizeClass ];
+        
+        if ( list->head == NULL ) {
+            Mem_RefillCache( list, sizeClass );
+        }
+        
+        mem_free_node_t * node = list->head;
+        list->head = node->next;
+        --list->count;
+        
+        ptr = node;
     }
-    Sys_MutexUnlock( &mem.mutex );
+    else {
+        ptr = Mem_AllocLarge( size, ( alignment < MEM_SMALL_ALIGN ) ? MEM_SMALL_ALIGN : alignment );
+        if ( ptr == NULL ) {
+            return NULL;
+        }
+    }
+    
+    Mem_CounterAdd( &cache->numAllocs, 1 );
+    Mem_SizeAdd( &cache->sizeAlloc, (int64_t) Mem_GetHeader( ptr )->size );
+    Mem_TrackAlloc( Mem_GetHeader( ptr ), file, line );
     
     return ptr;
 }
 
 /*=======================================================================================================================================*/
-void * Mem_CAlloc( size_t count, size_t size ) {
-    return Mem_AllocAligned( count * size, 16 );
+void * ( Mem_AllocAligned )( size_t size, size_t alignment ) {
+    return Mem_AllocInternal( size, alignment, NULL, 0 );
+}
+
+/*=======================================================================================================================================*/
+static mem_heap_t * Mem_FindHeapByAddress( void * address ) {
+    /* Heaps are only added during start up, so the sorted arrays can be read
+       without taking the mutex */
+    int32_t index = -1;
+    bool_t found = Bsearch_FindUintPtr( &index, ( uintptr_t ) address, mem.heapAddressSorted, mem.heapCount );
+    
+    if ( found == false ) {
+        /* We get the index of the heap ABOVE the address, so the heap that may
+           hold the address is the one before it */
+        if ( index == 0 ) {
+            return NULL;
+        }
+        --index;
+    }
+    
+    /* Make sure the address really is inside the heap, and not just somewhere
+       between two heaps */
+    mem_heap_t * heap = &mem.heaps[ mem.heapAddressMap[ index ] ];
+    uintptr_t addressUint = ( uintptr_t ) address;
+    uintptr_t heapStart = ( uintptr_t ) heap->memory;
+    
+    if ( ( addressUint < heapStart ) || ( addressUint >= heapStart + heap->memorySize ) ) {
+        return NULL;
+    }
+    
+    return heap;
+}
+
+/*=======================================================================================================================================*/
+static void Mem_HeapFree( void * block, mem_block_header_t * header ) {
+    void * heapBlock = ( void * ) ( ( uintptr_t ) block - header->offset );
+    mem_heap_t * heap = Mem_FindHeapByAddress( heapBlock );
+    xassertmsg( heap != NULL, "Block %p is marked as a heap block but is not inside any heap\n", block );
+    
+    Sys_MutexLock( &heap->mutex );
+    {
+        tlsf_free( heap->tlsf, heapBlock );
+        ++heap->numFrees;
+    }
+    Sys_MutexUnlock( &heap->mutex );
+}
+
+/*=======================================================================================================================================*/
+void * ( Mem_Alloc )( size_t size ) {
+    return Mem_AllocInternal( size, MEM_SMALL_ALIGN, NULL, 0 );
+}
+
+/*=======================================================================================================================================*/
+void * ( Mem_CAlloc )( size_t count, size_t size ) {
+    return Mem_AllocInternal( count * size, MEM_SMALL_ALIGN, NULL, 0 );
 }
 
 /*=======================================================================================================================================*/
 void Mem_Free( void * block ) {
     assert( memInit == true );
-    Sys_MutexLock( &mem.mutex );
-    {
-        ++mem.numFrees;
-        mem.memSizeAlloc -= mem.allocator->get_block_size( block );
-        mem.allocator->free( block );
+    if ( block == NULL ) {
+        return;
     }
-    Sys_MutexUnlock( &mem.mutex );
     
+    mem_thread_cache_t * cache = Mem_GetThreadCache();
+    mem_block_header_t * header = Mem_GetHeader( block );
+    
+    Mem_CounterAdd( &cache->numFrees, 1 );
+    Mem_SizeAdd( &cache->sizeAlloc, -(int64_t) header->size );
+    Mem_TrackFree( header );
+    
+    if ( header->sizeClass == MEM_SIZE_CLASS_LARGE ) {
+        mem.allocator->free( ( void * ) ( ( uintptr_t ) block - header->offset ) );
+        return;
+    }
+    
+    if ( header->sizeClass == MEM_SIZE_CLASS_HEAP ) {
+        Mem_HeapFree( block, header );
+        return;
+    }
+    
+    /* Small blocks go back on the free list of the thread that frees them */
+    mem_free_list_t * list = &cache->freeLists[ header->sizeClass ];
+    mem_free_node_t * node = ( mem_free_node_t * ) block;
+    node->next = list->head;
+    list->head = node;
+    ++list->count;
+    
+    if ( list->count > MEM_CACHE_MAX_COUNT ) {
+        Mem_ReturnToGlobal( list, header->sizeClass, MEM_CACHE_BATCH_COUNT );
+    }
 }
 
 /*=======================================================================================================================================*/
 void Mem_GetStats( mem_stats_t * stats ) {
     assert( memInit == true );
     
+    int64_t sizeAlloc = 0;
+    stats->numAllocs = 0;
+    stats->numFrees = 0;
+    
     Sys_MutexLock( &mem.mutex );
     {
-        stats->numAllocs = mem.numAllocs;
-        stats->numFrees = mem.numFrees;
-        stats->sizeAlloc = mem.memSizeAlloc;
+        for ( mem_thread_cache_t * cache = mem.threadCaches; cache != NULL; cache = cache->next ) {
+            stats->numAllocs += atomic_load_explicit( &cache->numAllocs, memory_order_relaxed );
+            stats->numFrees += atomic_load_explicit( &cache->numFrees, memory_order_relaxed );
+            sizeAlloc += atomic_load_explicit( &cache->sizeAlloc, memory_order_relaxed );
+        }
     }
     Sys_MutexUnlock( &mem.mutex );
+    
+    /* A thread can free blocks that another thread allocated, so only the sum of
+       the per-thread sizes is meaningful */
+    stats->sizeAlloc = ( sizeAlloc > 0 ) ? (uint64_t) sizeAlloc : 0;
 }
 
 
-
-#if 0
-
-#define HEAP_CAPACITY 128
-
-CVAR_INT( mem_allocEngineHeaps, "Tells the memory system to allocate the core engine heaps (true by default)", TRUE );
-CVAR_INT(mem_renderHeapSize, "Size of the heap to use for the render system in KB", 1024 * 10);
-CVAR_INT(mem_renderHeapSizeRes, "Size of the heap to use for the render objects in KB", 1024 * 2);
-
-/* Internal struct used to describe a memory heap managed by the system */
-typedef struct heap_s {
-    void*       memory;
-    size_t      memorySize;
-    tlsf_t      tlsf;
-} heap_t;
-
-/* Internal struct used to hold the memory system state */
-typedef struct mem_manager_s {
-    pthread_sys_mutex_t mutex;
-    heap_t          heaps[HEAP_CAPACITY];
-    uintptr_t       heapAddresSorted[HEAP_CAPACITY];
-    uint32_t        heapAddressMap[HEAP_CAPACITY];
-    size_t          heapCount;
-    allocator_t     globalAlloctor;
-} mem_manager_t;
-
-static bool_t memManagerInit = FALSE;
-static mem_manager_t memManager;
-
-static void* AllocatorDefault_MallocAligned( size_t size, size_t alignAmt );
-static void* AllocatorDefault_Malloc( size_t size );
-static void AllocatorDefault_Free( void* memory );
-static uintptr_t AllocatorDefault_Align(uintptr_t rhs, uintptr_t alignAmt);
-
-static heap_t* Mem_FindHeapByAddress(void* address);
-
 /*=======================================================================================================================================*/
-uintptr_t AllocatorDefault_Align(uintptr_t rhs, uintptr_t alignAmt) {
-    uintptr_t rem = rhs % alignAmt;
-    uintptr_t pad = alignAmt - rem;
-    return rhs + pad;
-}
+void Mem_AddHeap( mem_heap_id_t heapId, const char * name, void * heapMem, size_t heapMemSize ) {
+    assert( memInit == true );
+    xassertmsg( heapId > MEM_HEAP_DEFAULT && heapId < MEM_HEAP_CAPACITY, "Invalid heap id %u\n", heapId );
+    xassertmsg( mem.heaps[ heapId ].tlsf == NULL, "Heap with id %u has already been added\n", heapId );
+    xassertmsg( heapMemSize > tlsf_size() + tlsf_pool_overhead(), "Heap '%s' is too small\n", name );
     
-/*=======================================================================================================================================*/
-void* AllocatorDefault_Malloc( size_t size ) {
-    return AllocatorDefault_MallocAligned( size, 16 );
+    Sys_MutexLock( &mem.mutex );
+    {
+        /* Setup the heap info and create the tlsf allocator */
+        mem_heap_t * heap = &mem.heaps[ heapId ];
+        heap->name = name;
+        heap->memory = heapMem;
+        heap->memorySize = heapMemSize;
+        heap->tlsf = tlsf_create_with_pool( heapMem, heapMemSize );
+        Sys_MutexCreate( &heap->mutex );
+        
+        /* Add the heap into the arrays sorted by the heap base address */
+        int32_t index = -1;
+        bool_t found = Bsearch_FindUintPtr( &index, ( uintptr_t ) heapMem, mem.heapAddressSorted, mem.heapCount );
+        xassertmsg( found == false, "This heap address is already in use\n" );
+        ( void ) found;
+        
+        Array_InsertAtPosUintPtr( index, ( uintptr_t ) heapMem, mem.heapAddressSorted, mem.heapCount, MEM_HEAP_CAPACITY );
+        Array_InsertAtPosUint32( index, heapId, mem.heapAddressMap, mem.heapCount, MEM_HEAP_CAPACITY );
+        
+        ++mem.heapCount;
+    }
+    Sys_MutexUnlock( &mem.mutex );
 }
 
 /*=======================================================================================================================================*/
-void* AllocatorDefault_MallocAligned( size_t size, size_t alignAmt ) {
-    size_t addressSize = sizeof( uintptr_t );
-    size_t actualSize = size + addressSize + alignAmt;
-
-    uintptr_t memAllocated = ( uintptr_t ) malloc( actualSize );
-    uintptr_t memReturned = AllocatorDefault_Align( memAllocated + addressSize, alignAmt );
-    uintptr_t memAllocatedAddrPtr = memReturned - addressSize;
-
-    *( (uintptr_t*)memAllocatedAddrPtr ) = memAllocated;
-
-    return (void*) memReturned;
+void Mem_CreateHeap( mem_heap_id_t heapId, const char * name, size_t size ) {
+    assert( memInit == true );
+    
+    void * heapMem = mem.allocator->mallocAligned( size, 64 );
+    xerror( heapMem == NULL, "Out of memory allocating the %zu byte heap '%s'\n", size, name );
+    
+    Mem_AddHeap( heapId, name, heapMem, size );
+    mem.heaps[ heapId ].ownsMemory = true;
 }
 
 /*=======================================================================================================================================*/
-void AllocatorDefault_Free( void* memory ) {
-    if (memory == NULL) {
-        return;
+void Mem_CreateHeaps(void) {
+    static const struct {
+        mem_heap_id_t   heapId;
+        const char *    name;
+        size_t          size;
+    } engineHeaps[] = {
+        { MEM_HEAP_RENDER,      "render",       MEM_HEAP_RENDER_SIZE },
+        { MEM_HEAP_RESOURCE,    "resource",     MEM_HEAP_RESOURCE_SIZE },
+        { MEM_HEAP_ECS,         "ecs",          MEM_HEAP_ECS_SIZE },
+    };
+    
+    for ( size_t n = 0; n < sizeof( engineHeaps ) / sizeof( engineHeaps[ 0 ] ); ++n ) {
+        if ( engineHeaps[ n ].size > 0 && mem.heaps[ engineHeaps[ n ].heapId ].tlsf == NULL ) {
+            Mem_CreateHeap( engineHeaps[ n ].heapId, engineHeaps[ n ].name, engineHeaps[ n ].size );
+        }
     }
-
-    uintptr_t* memoryUintPtr = (uintptr_t*)memory;
-    uintptr_t * actualMemoryAddPtr = memoryUintPtr - 1;
-    void* actualMemoryAlloced = (void*)( *actualMemoryAddPtr );
-
-    free( actualMemoryAlloced );
 }
 
 /*=======================================================================================================================================*/
-void Mem_Initialise() {
-    xassert(memManagerInit == FALSE);
+static void * Mem_HeapAllocInternal( mem_heap_id_t heapId, size_t size, size_t alignment, const char * file, int32_t line ) {
+    assert( memInit == true );
+    xassert( heapId < MEM_HEAP_CAPACITY );
+    
+    mem_heap_t * heap = &mem.heaps[ heapId ];
+    if ( heap->tlsf == NULL ) {
+        /* If the heap has not been added (or it's the default heap) then just
+           use the global allocator */
+        return Mem_AllocInternal( size, alignment, file, line );
+    }
+    
+    if ( alignment < MEM_SMALL_ALIGN ) {
+        alignment = MEM_SMALL_ALIGN;
+    }
     
-    memset(&memManager, 0, sizeof(memManager));
+    /* Same layout as the large blocks, the header sits just in front of the
+       aligned user pointer */
+    size_t offset = ( alignment > sizeof( mem_block_header_t ) ) ? alignment : sizeof( mem_block_header_t );
+    uintptr_t block = 0;
+    uint64_t numOverflows = 0;
     
-    memManager.globalAlloctor.malloc = AllocatorDefault_Malloc;
-    memManager.globalAlloctor.mallocAligned = AllocatorDefault_MallocAligned;
-    memManager.globalAlloctor.free = AllocatorDefault_Free;
+    Sys_MutexLock( &heap->mutex );
+    {
+        block = ( uintptr_t ) tlsf_memalign( heap->tlsf, alignment, size + offset );
+        if ( block != 0 ) {
+            ++heap->numAllocs;
+        } else {
+            numOverflows = ++heap->numOverflows;
+        }
+    }
+    Sys_MutexUnlock( &heap->mutex );
+    
+    if ( block == 0 ) {
+        /* Don't fail the allocation, the overflow shows up in the heap stats so
+           the heap size can be tuned. A full heap tends to stay full, so only the
+           first overflow is logged */
+        if ( numOverflows == 1 ) {
+            xprintf( "Mem: heap '%s' is full, allocating %zu bytes from the default allocator. Further overflows are only counted in the heap stats\n", heap->name, size );
+        }
+        return Mem_AllocInternal( size, alignment, file, line );
+    }
+    
+    mem_block_header_t * header = ( mem_block_header_t * ) ( block + offset - sizeof( mem_block_header_t ) );
+    header->sizeClass = MEM_SIZE_CLASS_HEAP;
+    header->offset = (uint32_t) offset;
+    header->size = size;
     
-    pthread_mutex_init(&memManager.mutex, NULL);
+    mem_thread_cache_t * cache = Mem_GetThreadCache();
+    Mem_CounterAdd( &cache->numAllocs, 1 );
+    Mem_SizeAdd( &cache->sizeAlloc, (int64_t) size );
+    Mem_TrackAlloc( header, file, line );
     
-    memManagerInit = TRUE;
+    return ( void * ) ( block + offset );
 }
 
 /*=======================================================================================================================================*/
-void Mem_Finalise() {
+void * ( Mem_HeapAlloc )( mem_heap_id_t heapId, size_t size ) {
+    return Mem_HeapAllocInternal( heapId, size, MEM_SMALL_ALIGN, NULL, 0 );
 }
 
 /*=======================================================================================================================================*/
-void Mem_createHeaps() {
-#if 0
-    HeapCreateInfo hci;
+void * ( Mem_HeapAllocAligned )( mem_heap_id_t heapId, size_t size, size_t alignment ) {
+    return Mem_HeapAllocInternal( heapId, size, alignment, NULL, 0 );
+}
 
-    bool allocEngineHeaps = mem_allocEngineHeaps.getValueBool();
+/*=======================================================================================================================================*/
+static void Mem_HeapWalker( void * ptr, size_t size, int used, void * user ) {
+    mem_heap_stats_t * stats = ( mem_heap_stats_t * ) user;
     
-    hci.addEntry(HEAP_STL,              mem_stlHeapSize.getValueInt() * 1024);
-    hci.addEntry(HEAP_STL_STRING,       mem_stlStringHeapSize.getValueInt() * 1024);
-
-    if ( allocEngineHeaps == true ) {
-        hci.addEntry( HEAP_GX, mem_gxHeapSize.getValueInt() * 1024 );
-        hci.addEntry( HEAP_GX_RES, mem_gxHeapSizeRes.getValueInt() * 1024 );
+    if ( used != 0 ) {
+        stats->used += size;
+        ++stats->usedBlockCount;
+    } else {
+        stats->free += size;
+        ++stats->freeBlockCount;
+        if ( size > stats->largestFree ) {
+            stats->largestFree = size;
+        }
+    }
+}
 
-        hci.addEntry( HEAP_RENDER, mem_renderHeapSize.getValueInt() * 1024 );
-        hci.addEntry( HEAP_RENDER_RES, mem_renderHeapSizeRes.getValueInt() * 1024 );
+/*=======================================================================================================================================*/
+bool_t Mem_GetHeapStats( mem_heap_id_t heapId, mem_heap_stats_t * stats ) {
+    assert( memInit == true );
+    xassert( heapId < MEM_HEAP_CAPACITY );
+    
+    memset( stats, 0, sizeof( *stats ) );
+    
+    mem_heap_t * heap = &mem.heaps[ heapId ];
+    if ( heap->tlsf == NULL ) {
+        return false;
     }
     
-    for(int32_t i=0; i < (int32_t) hci.m_count; ++i) {
-        HeapCreateEntry& entry = hci.m_entries[i];
-        addHeap(entry.m_heapId, entry.m_size);
+    Sys_MutexLock( &heap->mutex );
+    {
+        stats->name = heap->name;
+        stats->size = heap->memorySize;
+        stats->numAllocs = heap->numAllocs;
+        stats->numFrees = heap->numFrees;
+        stats->numOverflows = heap->numOverflows;
+        
+        tlsf_walk_pool( tlsf_get_pool( heap->tlsf ), Mem_HeapWalker, stats );
     }
-#endif
+    Sys_MutexUnlock( &heap->mutex );
+    
+    stats->fragmentation = ( stats->free > 0 ) ? 1.0f - ( (float) stats->largestFree / (float) stats->free ) : 0.0f;
+    
+    return true;
 }
 
+#ifdef MEM_TRACKING
+
 /*=======================================================================================================================================*/
-void Mem_AllocateHeap(uint32_t heapId, size_t heapMemSize) {
-    void* heapMem = memManager.globalAlloctor.malloc(heapMemSize);
-    Mem_AddHeap(heapId, heapMem, heapMemSize);
+void * Mem_AllocTagged( size_t size, size_t alignment, const char * file, int32_t line ) {
+    return Mem_AllocInternal( size, alignment, file, line );
 }
 
 /*=======================================================================================================================================*/
-void Mem_AddHeap(uint32_t heapId, void* heapMem, size_t heapMemSize) {
-    xasserte(memManager.heapCount < HEAP_CAPACITY, "Too many heaps");
-    xasserte(memManager.heaps[heapId] == 0, "Heap with id %u has already been added", heapId);
-    
-    /* Setup the heap info and create the tlsf allocator */
-    heap_t* info = &memManager.heaps[heapId];
-    info->memory = heapMem;
-    info->memorySize = heapMemSize;
-    info->tlsf = tlsf_create_with_pool(heapMem, heapMemSize);
-    
-    /* Add the heap into the arrays sorted by the heap base address */
-    int32_t index = - 1;
-    bool_t found = Bsearch_FindUintPtr(&index, (uintptr_t)heapMem, memManager.heapAddresSorted, memManager.heapCount);
-    xasserte(found == false, "This heap address is already in use");
-    
-    Array_InsertAtPosUintPtr(index, (uintptr_t) heapMem, memManager.heapAddresSorted, memManager.heapCount, HEAP_CAPACITY);
-    Array_InsertAtPosUint32(index, heapId, memManager.heapAddressMap, memManager.heapCount, HEAP_CAPACITY);
-    
-    ++memManager.heapCount;
+void * Mem_HeapAllocTagged( mem_heap_id_t heapId, size_t size, size_t alignment, const char * file, int32_t line ) {
+    return Mem_HeapAllocInternal( heapId, size, alignment, file, line );
 }
 
 /*=======================================================================================================================================*/
-heap_t* Mem_FindHeapByAddress(void* address) {
-    int32_t index = - 1;
-    Bsearch_FindUintPtr(&index, (uintptr_t)address, memManager.heapAddresSorted, memManager.heapCount);
-   
-    if (index == 0) {
-       /* Out of range of managed memory, so return NULL
-          Note: this is because we expect to get the index of the heap ABOVE the heap
-          the memory was allocated from. So an index of zero means that the address
-          was not allocated from one of the heaps. */
-       return NULL;
-    }
-   
-    /* We have a valid heap index -BUT- it may not be the case that the address is
-       in that heap. We support deleting and adding of heaps, so there may have
-       been a naughty allocation between the heaps being moved around / added. So
-       check that the address is really within the heap. */
-    uint32_t heapId = memManager.heapAddressMap[index-1];
-    heap_t* info = &memManager.heaps[heapId];
-    uintptr_t endOfHeap = ((uintptr_t) info->memory) + info->memorySize;
-    uintptr_t addressUint = (uintptr_t) address;
+void Mem_PushTag( const char * tag ) {
+    xassertmsg( memTagStackCount < MEM_TRACK_TAG_STACK_DEPTH, "Memory tag stack overflow pushing '%s'\n", tag );
+    memTagStack[ memTagStackCount++ ] = tag;
+}
+
+/*=======================================================================================================================================*/
+void Mem_PopTag( void ) {
+    xassertmsg( memTagStackCount > 0, "Memory tag stack underflow\n" );
+    --memTagStackCount;
+}
+
+/*=======================================================================================================================================*/
+void Mem_TrackFrame( void ) {
+    assert( memInit == true );
     
-    if ((addressUint < (uintptr_t) info->memory) || (addressUint >= endOfHeap)) {
-       return NULL;
+    Sys_MutexLock( &memTrack.mutex );
+    {
+        for ( size_t n = 0; n < memTrack.recordCount; ++n ) {
+            mem_track_record_t * record = &memTrack.records[ n ];
+            record->lastFrameAllocs = record->frameAllocs;
+            record->lastFrameBytes = record->frameBytes;
+            record->peakFrameAllocs = ( record->frameAllocs > record->peakFrameAllocs ) ? record->frameAllocs : record->peakFrameAllocs;
+            record->peakFrameBytes = ( record->frameBytes > record->peakFrameBytes ) ? record->frameBytes : record->peakFrameBytes;
+            record->frameAllocs = 0;
+            record->frameBytes = 0;
+        }
     }
-   
-    return info;
+    Sys_MutexUnlock( &memTrack.mutex );
 }
 
 /*=======================================================================================================================================*/
-void* Mem_Malloc(uint32_t heapId, size_t size) {
-    return Mem_MallocAligned(heapId, size, 8);
+static void Mem_DumpRaw( file_t * file, const char * str ) {
+    FS_FileWrite( file, str, 1, strlen( str ) );
 }
 
 /*=======================================================================================================================================*/
-void* Mem_MallocAligned(uint32_t heapId, size_t size, size_t alignment) {
-    pthread_mutex_lock(&memManager.mutex);
-    
-    void* mem = NULL;
-    heap_t* info = &memManager.heaps[heapId];
-    
-    if (info->memorySize == 0) {
-        /* If the heap has not been added yet (or it's the default heap)
-         then just use the global allocator */
-        pthread_mutex_unlock(&memManager.mutex);
-        return memManager.globalAlloctor.mallocAligned(size, alignment);
+static void Mem_DumpString( file_t * file, const char * str ) {
+    /* Escape the few characters that can turn up in a source path */
+    for ( const char * c = str; *c != 0; ++c ) {
+        if ( *c == '\\' || *c == '"' ) {
+            FS_FileWrite( file, "\\", 1, 1 );
+        }
+        FS_FileWrite( file, c, 1, 1 );
     }
-    
-    /* heapId references a valid heap, so allocate from it */
-    mem = tlsf_memalign(info->tlsf, alignment, size);
-    pthread_mutex_unlock(&memManager.mutex);
-    return mem;
 }
 
 /*=======================================================================================================================================*/
-void Mem_Free(void* memory) {
-    pthread_mutex_lock(&memManager.mutex);
+bool_t Mem_DumpTags( const char * path, mem_dump_format_t format ) {
+    assert( memInit == true );
     
-    heap_t* info = Mem_FindHeapByAddress(memory);
-    if (info != NULL) {
-        tlsf_free(info->tlsf, memory);
-    } else {
-        memManager.globalAlloctor.free(memory);
+    /* Take a copy of the records, writing the file will allocate memory */
+    size_t count = 0;
+    mem_track_record_t * records = NULL;
+    
+    Sys_MutexLock( &memTrack.mutex );
+    {
+        count = memTrack.recordCount;
+        records = ( mem_track_record_t * ) mem.allocator->malloc( sizeof( mem_track_record_t ) * count );
+        if ( records != NULL ) {
+            memcpy( records, memTrack.records, sizeof( mem_track_record_t ) * count );
+        }
+    }
+    Sys_MutexUnlock( &memTrack.mutex );
+    
+    file_t file;
+    if ( records == NULL || FS_FileOpen( &file, path, "wb" ) == false ) {
+        xprintf( "Mem: unable to write memory tags to '%s'\n", path );
+        mem.allocator->free( records );
+        return false;
     }
     
-    pthread_mutex_unlock(&memManager.mutex);
+    char buffer[ 512 ];
+    int len = 0;
+    
+    if ( format == MEM_DUMP_CSV ) {
+        len = snprintf( buffer, sizeof( buffer ), "name,line,liveBytes,peakBytes,numAllocs,numFrees,lastFrameAllocs,lastFrameBytes,peakFrameAllocs,peakFrameBytes" );
+        FS_FileWrite( &file, buffer, 1, len );
+        for ( uint32_t b = 0; b < MEM_TRACK_HISTOGRAM_COUNT; ++b ) {
+            len = snprintf( buffer, sizeof( buffer ), ( b < MEM_TRACK_HISTOGRAM_COUNT - 1 ) ? ",<=%llu" : ",>%llu", ( b < MEM_TRACK_HISTOGRAM_COUNT - 1 ) ? 16ull << b : 16ull << ( b - 1 ) );
+            FS_FileWrite( &file, buffer, 1, len );
+        }
+        Mem_DumpRaw( &file, "\n" );
+    }
+    else {
+        Mem_DumpRaw( &file, "{\n    \"tags\": [\n" );
+    }
+    
+    for ( size_t n = 0; n < count; ++n ) {
+        const mem_track_record_t * record = &records[ n ];
+        
+        if ( format == MEM_DUMP_CSV ) {
+            Mem_DumpRaw( &file, "\"" );
+            Mem_DumpString( &file, record->name );
+            len = snprintf( buffer, sizeof( buffer ), "\",%d,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu", record->line,
+                            (unsigned long long) record->liveBytes, (unsigned long long) record->peakBytes,
+                            (unsigned long long) record->numAllocs, (unsigned long long) record->numFrees,
+                            (unsigned long long) record->lastFrameAllocs, (unsigned long long) record->lastFrameBytes,
+                            (unsigned long long) record->peakFrameAllocs, (unsigned long long) record->peakFrameBytes );
+            FS_FileWrite( &file, buffer, 1, len );
+            
+            for ( uint32_t b = 0; b < MEM_TRACK_HISTOGRAM_COUNT; ++b ) {
+                len = snprintf( buffer, sizeof( buffer ), ",%llu", (unsigned long long) record->histogram[ b ] );
+                FS_FileWrite( &file, buffer, 1, len );
+            }
+            Mem_DumpRaw( &file, "\n" );
+        }
+        else {
+            Mem_DumpRaw( &file, "        { \"name\": \"" );
+            Mem_DumpString( &file, record->name );
+            len = snprintf( buffer, sizeof( buffer ), "\", \"line\": %d, \"liveBytes\": %llu, \"peakBytes\": %llu, \"numAllocs\": %llu, \"numFrees\": %llu, "
+                            "\"lastFrameAllocs\": %llu, \"lastFrameBytes\": %llu, \"peakFrameAllocs\": %llu, \"peakFrameBytes\": %llu, \"histogram\": [", record->line,
+                            (unsigned long long) record->liveBytes, (unsigned long long) record->peakBytes,
+                            (unsigned long long) record->numAllocs, (unsigned long long) record->numFrees,
+                            (unsigned long long) record->lastFrameAllocs, (unsigned long long) record->lastFrameBytes,
+                            (unsigned long long) record->peakFrameAllocs, (unsigned long long) record->peakFrameBytes );
+            FS_FileWrite( &file, buffer, 1, len );
+            
+            for ( uint32_t b = 0; b < MEM_TRACK_HISTOGRAM_COUNT; ++b ) {
+                len = snprintf( buffer, sizeof( buffer ), ( b == 0 ) ? "%llu" : ", %llu", (unsigned long long) record->histogram[ b ] );
+                FS_FileWrite( &file, buffer, 1, len );
+            }
+            Mem_DumpRaw( &file, ( n + 1 < count ) ? "] },\n" : "] }\n" );
+        }
+    }
+    
+    if ( format == MEM_DUMP_JSON ) {
+        Mem_DumpRaw( &file, "    ]\n}\n" );
+    }
+    
+    FS_FileClose( &file );
+    mem.allocator->free( records );
+    
+    xprintf( "Mem: wrote %zu memory tags to '%s'\n", count, path );
+    return true;
 }
 
 #endif
@@ -23,6 +23,11 @@
 
 #include "core/Platform.h"
 
+/* Allocation tracking is on in debug builds, and compiles out completely otherwise */
+#if ( defined( DEBUG ) || defined( _DEBUG ) ) && !defined( MEM_NO_TRACKING )
+#   define MEM_TRACKING
+#endif
+
 typedef struct mem_allocator_s {
     void *      (* malloc )(size_t size);
     void *      (* mallocAligned )(size_t size, size_t align);
@@ -37,12 +42,75 @@ typedef struct mem_stats_s {
     uint64_t        sizeAlloc;
 } mem_stats_t;
 
+/* Ids of the fixed size heaps. Allocations from a heap that has not been created
+   fall through to the default allocator */
+typedef enum mem_heap_id_e {
+    MEM_HEAP_DEFAULT = 0,
+    MEM_HEAP_RENDER,
+    MEM_HEAP_RESOURCE,
+    MEM_HEAP_ECS,
+    MEM_HEAP_CAPACITY = 16
+} mem_heap_id_t;
+
+typedef struct mem_heap_stats_s {
+    const char *    name;
+    uint64_t        size;               /* Total size of the heap memory */
+    uint64_t        used;               /* Bytes in used blocks */
+    uint64_t        free;               /* Bytes in free blocks */
+    uint64_t        largestFree;        /* Size of the largest free block */
+    uint32_t        freeBlockCount;
+    uint32_t        usedBlockCount;
+    uint64_t        numAllocs;
+    uint64_t        numFrees;
+    uint64_t        numOverflows;       /* Allocations that did not fit and went to the default allocator */
+    float           fragmentation;      /* 0 when all the free memory is in one block, towards 1 as it gets split up */
+} mem_heap_stats_t;
+
 XE_API void Mem_Initialise( mem_allocator_t * allocator );
 XE_API void Mem_Finalise(void);
+XE_API void Mem_ThreadFinalise(void);
 XE_API void * Mem_Alloc( size_t size );
 XE_API void * Mem_CAlloc( size_t count, size_t size );
 XE_API void * Mem_AllocAligned( size_t size, size_t alignment );
 XE_API void Mem_Free( void * mem );
 XE_API void Mem_GetStats( mem_stats_t * stats );
 
+XE_API void Mem_CreateHeaps(void);
+XE_API void Mem_CreateHeap( mem_heap_id_t heapId, const char * name, size_t size );
+XE_API void Mem_AddHeap( mem_heap_id_t heapId, const char * name, void * heapMem, size_t heapMemSize );
+XE_API void * Mem_HeapAlloc( mem_heap_id_t heapId, size_t size );
+XE_API void * Mem_HeapAllocAligned( mem_heap_id_t heapId, size_t size, size_t alignment );
+XE_API bool_t Mem_GetHeapStats( mem_heap_id_t heapId, mem_heap_stats_t * stats );
+
+typedef enum mem_dump_format_e {
+    MEM_DUMP_CSV,
+    MEM_DUMP_JSON
+} mem_dump_format_t;
+
+#ifdef MEM_TRACKING
+
+/* Every allocation is counted against the tag on top of the calling thread's tag
+   stack, or against its call site when no tag has been pushed */
+XE_API void * Mem_AllocTagged( size_t size, size_t alignment, const char * file, int32_t line );
+XE_API void * Mem_HeapAllocTagged( mem_heap_id_t heapId, size_t size, size_t alignment, const char * file, int32_t line );
+XE_API void Mem_PushTag( const char * tag );
+XE_API void Mem_PopTag( void );
+XE_API void Mem_TrackFrame( void );
+XE_API bool_t Mem_DumpTags( const char * path, mem_dump_format_t format );
+
+#   define Mem_Alloc( SIZE )                           Mem_AllocTagged( (SIZE), 16, __FILE__, __LINE__ )
+#   define Mem_CAlloc( COUNT, SIZE )                   Mem_AllocTagged( (COUNT) * (SIZE), 16, __FILE__, __LINE__ )
+#   define Mem_AllocAligned( SIZE, ALIGN )             Mem_AllocTagged( (SIZE), (ALIGN), __FILE__, __LINE__ )
+#   define Mem_HeapAlloc( HEAP, SIZE )                 Mem_HeapAllocTagged( (HEAP), (SIZE), 16, __FILE__, __LINE__ )
+#   define Mem_HeapAllocAligned( HEAP, SIZE, ALIGN )   Mem_HeapAllocTagged( (HEAP), (SIZE), (ALIGN), __FILE__, __LINE__ )
+
+#else
+
+#   define Mem_PushTag( TAG )
+#   define Mem_PopTag()
+#   define Mem_TrackFrame()
+#   define Mem_DumpTags( PATH, FORMAT )
+
+#endif
+
 #endif
@@ -20,63 +20,254 @@
 
 #include "mem/UnitHeap.h"
 #include "core/Sys.h"
+#include "core/Id.h"
+#include "core/Atomic.h"
+#include <assert.h>
+#include <string.h>
 
+#define MAGIC MAKE_ID( U, N, I, T, H, E, A, P, _, _, _, _ )
+#define UNIT_HEAP_ALIGNMENT         64
+#define UNIT_HEAP_UNIT_ALIGNMENT    16
+#define UNIT_HEAP_POISON_FREE       0xDD
+#define UNIT_HEAP_POISON_ALLOC      0xCD
+
+/* The free list head packs the index of the first free unit (plus one, so zero
+   means empty) in the low 32 bits with a tag in the high 32 bits. The tag is
+   bumped on every change so a stale head can't win the compare and swap (ABA) */
+#define UNIT_HEAP_HEAD_INDEX( H )       ( (uint32_t) ( (H) & 0xFFFFFFFF ) )
+#define UNIT_HEAP_HEAD_TAG( H )         ( (uint32_t) ( (H) >> 32 ) )
+#define UNIT_HEAP_MAKE_HEAD( I, T )     ( ( (uint64_t) (T) << 32 ) | (uint64_t) (I) )
+
+/* Each free unit holds the index (plus one) of the next free unit in its first bytes */
 typedef struct unit_entry_s {
-    struct unit_entry_s * prev;
-    struct unit_entry_s * next;
+    atomic_uint             next;
 } unit_entry_t;
 
 typedef struct unit_heap_s {
-    unit_entry_t *  listHead;
-    unit_entry_t *  listTail;
-    uint64_t        memory;
-    size_t          unitSize;
+    uint64_t                magic;
+    uintptr_t               memStart;
+    uintptr_t               memEnd;
+    size_t                  unitSize;
+    uint32_t                unitCount;
+    uint32_t                flags;
+    atomic_uint_fast64_t    freeHead;
+    atomic_uint             usedCount;
+    atomic_uint             peakCount;
+    atomic_uint_fast64_t    numAllocs;
+    atomic_uint_fast64_t    numFrees;
+    atomic_uint_fast64_t    numFailed;
 } unit_heap_t;
 
 /*=======================================================================================================================================*/
-unit_heap_t * UnitHeap_Create( uintptr_t memory, size_t memSize, size_t unitSize ) {
+static X_INLINE unit_entry_t * UnitHeap_GetEntry( const unit_heap_t * self_, uint32_t index ) {
+    return ( unit_entry_t * ) ( self_->memStart + ( (uintptr_t) ( index - 1 ) * self_->unitSize ) );
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE uint32_t UnitHeap_CounterAdd( const unit_heap_t * self_, atomic_uint * counter, uint32_t value ) {
+    if ( ( self_->flags & UNIT_HEAP_FLAG_THREAD_SAFE ) != 0 ) {
+        return (uint32_t) atomic_fetch_add_explicit( counter, value, memory_order_relaxed ) + value;
+    }
+    
+    /* Single threaded, so skip the locked add */
+    uint32_t result = (uint32_t) atomic_load_explicit( counter, memory_order_relaxed ) + value;
+    atomic_store_explicit( counter, result, memory_order_relaxed );
+    return result;
+}
+
+/*=======================================================================================================================================*/
+static X_INLINE void UnitHeap_Counter64Add( const unit_heap_t * self_, atomic_uint_fast64_t * counter, uint64_t value ) {
+    if ( ( self_->flags & UNIT_HEAP_FLAG_THREAD_SAFE ) != 0 ) {
+        atomic_fetch_add_explicit( counter, value, memory_order_relaxed );
+    }
+    else {
+        atomic_store_explicit( counter, atomic_load_explicit( counter, memory_order_relaxed ) + value, memory_order_relaxed );
+    }
+}
+
+/*=======================================================================================================================================*/
+size_t UnitHeap_CalcMemSize( size_t unitSize, uint32_t unitCount ) {
     unitSize = ( unitSize >= sizeof( unit_entry_t ) ) ? unitSize : sizeof( unit_entry_t );
+    unitSize = Sys_Align( unitSize, UNIT_HEAP_UNIT_ALIGNMENT );
     
-    size_t actualMemSize;
-    size_t numUnits;
-    uintptr_t memStart = Sys_Align( memory, 64 );
-    uintptr_t currAddr;
-    unit_heap_t * heap = ( unit_heap_t * ) memStart;
-    memStart = Sys_Align( memStart + sizeof( unit_heap_t ), 64 );
-    actualMemSize = memStart - memory;
-    
-    numUnits = actualMemSize / unitSize;
-    currAddr = memStart;
-    unit_entry_t * entry;
-    unit_entry_t * prev = NULL;
-    
-    for ( int n = 0; n < numUnits; ++n ) {
-        entry = (unit_entry_t *) currAddr;
-        entry->prev = ( prev == NULL ) ? NULL : prev;
-        entry->next = NULL;
-        
-        if ( prev != NULL ) {
-            prev->next = entry;
-        }
-        
-        prev = entry;
-        currAddr += unitSize;
+    /* Leave room to align the start of the memory, the heap header and the start
+       of the units */
+    size_t headerSize = Sys_Align( sizeof( unit_heap_t ), UNIT_HEAP_ALIGNMENT );
+    return UNIT_HEAP_ALIGNMENT + headerSize + ( unitSize * unitCount );
+}
+
+/*=======================================================================================================================================*/
+unit_heap_t * UnitHeap_Create( uintptr_t memory, size_t memSize, size_t unitSize, uint32_t flags ) {
+    unitSize = ( unitSize >= sizeof( unit_entry_t ) ) ? unitSize : sizeof( unit_entry_t );
+    unitSize = Sys_Align( unitSize, UNIT_HEAP_UNIT_ALIGNMENT );
+    
+    /* The heap header lives at the (aligned) start of the memory, the units follow it */
+    uintptr_t memEnd = memory + memSize;
+    uintptr_t heapStart = Sys_Align( memory, UNIT_HEAP_ALIGNMENT );
+    uintptr_t memStart = Sys_Align( heapStart + sizeof( unit_heap_t ), UNIT_HEAP_ALIGNMENT );
+    xassertmsg( memStart + unitSize <= memEnd, "Not enough memory for a unit heap of %zu byte units\n", unitSize );
+    
+    size_t numUnits = ( memEnd - memStart ) / unitSize;
+    xassert( numUnits < 0xFFFFFFFF );
+    
+    unit_heap_t * heap = ( unit_heap_t * ) heapStart;
+    heap->magic = MAGIC;
+    heap->memStart = memStart;
+    heap->memEnd = memStart + ( numUnits * unitSize );
+    heap->unitSize = unitSize;
+    heap->unitCount = (uint32_t) numUnits;
+    heap->flags = flags;
+    atomic_init( &heap->usedCount, 0 );
+    atomic_init( &heap->peakCount, 0 );
+    atomic_init( &heap->numAllocs, 0 );
+    atomic_init( &heap->numFrees, 0 );
+    atomic_init( &heap->numFailed, 0 );
+    
+#ifdef DEBUG
+    memset( (void *) heap->memStart, UNIT_HEAP_POISON_FREE, heap->memEnd - heap->memStart );
+#endif
+    
+    /* Link all the units into the free list in address order */
+    for ( uint32_t n = 1; n <= heap->unitCount; ++n ) {
+        unit_entry_t * entry = UnitHeap_GetEntry( heap, n );
+        atomic_init( &entry->next, ( n < heap->unitCount ) ? n + 1 : 0 );
     }
     
+    atomic_init( &heap->freeHead, UNIT_HEAP_MAKE_HEAD( ( heap->unitCount > 0 ) ? 1 : 0, 0 ) );
+    
     return heap;
 }
 
 /*=======================================================================================================================================*/
 void UnitHeap_Destroy( unit_heap_t * self_ ) {
-    
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC );
+    /* The heap doesn't own the memory, so just make sure it can't be used again */
+    self_->magic = 0;
 }
 
 /*=======================================================================================================================================*/
 void * UnitHeap_Alloc( unit_heap_t * self_ ) {
-    return NULL;
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC );
+    
+    uint64_t head = atomic_load_explicit( &self_->freeHead, memory_order_acquire );
+    uint32_t index = 0;
+    
+    if ( ( self_->flags & UNIT_HEAP_FLAG_THREAD_SAFE ) != 0 ) {
+        uint64_t newHead;
+        do {
+            index = UNIT_HEAP_HEAD_INDEX( head );
+            if ( index == 0 ) {
+                break;
+            }
+            
+            /* The unit can be handed out by another thread before our swap, in which case the
+               next index read here is rubbish, but the tag will have moved on and the swap fails */
+            uint32_t next = (uint32_t) atomic_load_explicit( &UnitHeap_GetEntry( self_, index )->next, memory_order_relaxed );
+            newHead = UNIT_HEAP_MAKE_HEAD( next, UNIT_HEAP_HEAD_TAG( head ) + 1 );
+        } while ( atomic_compare_exchange_weak_explicit( &self_->freeHead, &head, newHead, memory_order_acquire, memory_order_acquire ) == false );
+    }
+    else {
+        index = UNIT_HEAP_HEAD_INDEX( head );
+        if ( index != 0 ) {
+            uint32_t next = (uint32_t) atomic_load_explicit( &UnitHeap_GetEntry( self_, index )->next, memory_order_relaxed );
+            atomic_store_explicit( &self_->freeHead, UNIT_HEAP_MAKE_HEAD( next, UNIT_HEAP_HEAD_TAG( head ) + 1 ), memory_order_relaxed );
+        }
+    }
+    
+    if ( index == 0 ) {
+        UnitHeap_Counter64Add( self_, &self_->numFailed, 1 );
+        return NULL;
+    }
+    
+    uint32_t used = UnitHeap_CounterAdd( self_, &self_->usedCount, 1 );
+    uint32_t peak = (uint32_t) atomic_load_explicit( &self_->peakCount, memory_order_relaxed );
+    while ( used > peak ) {
+        if ( atomic_compare_exchange_weak_explicit( &self_->peakCount, &peak, used, memory_order_relaxed, memory_order_relaxed ) == true ) {
+            break;
+        }
+    }
+    UnitHeap_Counter64Add( self_, &self_->numAllocs, 1 );
+    
+    uint8_t * unit = ( uint8_t * ) UnitHeap_GetEntry( self_, index );
+    
+#ifdef DEBUG
+    /* Everything after the free list link should still hold the free pattern, if not
+       then something wrote to the unit after it was freed */
+    for ( size_t n = sizeof( unit_entry_t ); n < self_->unitSize; ++n ) {
+        if ( unit[ n ] != UNIT_HEAP_POISON_FREE ) {
+            xassertmsg( false, "Unit %p was modified after it was freed\n", unit );
+            break;
+        }
+    }
+    memset( unit, UNIT_HEAP_POISON_ALLOC, self_->unitSize );
+#endif
+    
+    return unit;
 }
 
 /*=======================================================================================================================================*/
-void UnitHeap_Free( unit_heap_t * self_ ) {
-    NULL;
+void UnitHeap_Free( unit_heap_t * self_, void * unit ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC );
+    
+    if ( unit == NULL ) {
+        return;
+    }
+    
+    xassertmsg( UnitHeap_Owns( self_, unit ) == true, "Unit %p does not belong to this heap\n", unit );
+    
+    uintptr_t offset = ( uintptr_t ) unit - self_->memStart;
+    xassertmsg( ( offset % self_->unitSize ) == 0, "Unit %p is not the start of a unit\n", unit );
+    
+    uint32_t index = (uint32_t) ( offset / self_->unitSize ) + 1;
+    unit_entry_t * entry = ( unit_entry_t * ) unit;
+    
+#ifdef DEBUG
+    memset( unit, UNIT_HEAP_POISON_FREE, self_->unitSize );
+#endif
+    
+    UnitHeap_CounterAdd( self_, &self_->usedCount, (uint32_t) -1 );
+    UnitHeap_Counter64Add( self_, &self_->numFrees, 1 );
+    
+    uint64_t head = atomic_load_explicit( &self_->freeHead, memory_order_relaxed );
+    
+    if ( ( self_->flags & UNIT_HEAP_FLAG_THREAD_SAFE ) != 0 ) {
+        uint64_t newHead;
+        do {
+            atomic_store_explicit( &entry->next, UNIT_HEAP_HEAD_INDEX( head ), memory_order_relaxed );
+            newHead = UNIT_HEAP_MAKE_HEAD( index, UNIT_HEAP_HEAD_TAG( head ) + 1 );
+        } while ( atomic_compare_exchange_weak_explicit( &self_->freeHead, &head, newHead, memory_order_release, memory_order_relaxed ) == false );
+    }
+    else {
+        atomic_store_explicit( &entry->next, UNIT_HEAP_HEAD_INDEX( head ), memory_order_relaxed );
+        atomic_store_explicit( &self_->freeHead, UNIT_HEAP_MAKE_HEAD( index, UNIT_HEAP_HEAD_TAG( head ) + 1 ), memory_order_relaxed );
+    }
+}
+
+/*=======================================================================================================================================*/
+bool_t UnitHeap_Owns( const unit_heap_t * self_, const void * unit ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC );
+    
+    uintptr_t addr = ( uintptr_t ) unit;
+    return ( addr >= self_->memStart && addr < self_->memEnd ) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+void UnitHeap_GetStats( const unit_heap_t * self_, unit_heap_stats_t * stats ) {
+    assert( self_ != NULL );
+    assert( self_->magic == MAGIC );
+    
+    /* Casts are needed as the atomic loads don't take const pointers on every compiler */
+    unit_heap_t * heap = ( unit_heap_t * ) self_;
+    
+    stats->unitSize = heap->unitSize;
+    stats->unitCount = heap->unitCount;
+    stats->usedCount = (uint32_t) atomic_load_explicit( &heap->usedCount, memory_order_relaxed );
+    stats->peakCount = (uint32_t) atomic_load_explicit( &heap->peakCount, memory_order_relaxed );
+    stats->numAllocs = atomic_load_explicit( &heap->numAllocs, memory_order_relaxed );
+    stats->numFrees = atomic_load_explicit( &heap->numFrees, memory_order_relaxed );
+    stats->numFailed = atomic_load_explicit( &heap->numFailed, memory_order_relaxed );
 }
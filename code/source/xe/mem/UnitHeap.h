@@ -25,9 +25,27 @@
 
 typedef struct unit_heap_s unit_heap_t;
 
-XE_API unit_heap_t * UnitHeap_Create( uintptr_t memory, size_t memSize, size_t unitSize );
-XE_API void UnitHeap_Destroy( unit_heap_t * self_ );
-XE_API void * UnitHeap_Alloc( unit_heap_t * self_ );
-XE_API void UnitHeap_Free( unit_heap_t * self_ );
+typedef enum unit_heap_flags_e {
+    UNIT_HEAP_FLAG_NONE         = 0,
+    UNIT_HEAP_FLAG_THREAD_SAFE  = 1 << 0        /* Use a lock-free free list so that any thread can alloc and free */
+} unit_heap_flags_t;
+
+typedef struct unit_heap_stats_s {
+    size_t          unitSize;           /* Size of a unit after alignment */
+    uint32_t        unitCount;          /* Total number of units in the heap */
+    uint32_t        usedCount;          /* Units currently allocated */
+    uint32_t        peakCount;          /* Highest number of units allocated at once */
+    uint64_t        numAllocs;
+    uint64_t        numFrees;
+    uint64_t        numFailed;          /* Allocations made while the heap was empty */
+} unit_heap_stats_t;
+
+XE_API size_t               UnitHeap_CalcMemSize( size_t unitSize, uint32_t unitCount );
+XE_API unit_heap_t *        UnitHeap_Create( uintptr_t memory, size_t memSize, size_t unitSize, uint32_t flags );
+XE_API void                 UnitHeap_Destroy( unit_heap_t * self_ );
+XE_API void *               UnitHeap_Alloc( unit_heap_t * self_ );
+XE_API void                 UnitHeap_Free( unit_heap_t * self_, void * unit );
+XE_API bool_t               UnitHeap_Owns( const unit_heap_t * self_, const void * unit );
+XE_API void                 UnitHeap_GetStats( const unit_heap_t * self_, unit_heap_stats_t * stats );
 
 #endif
@@ -19,6 +19,7 @@
 */
 
 #include "render/Model.h"
+#include "render/Material.h"
 #include "metal/Model_metal.h"
 #include "metal/Render_metal.h"
 #include "mem/Mem.h"
@@ -59,6 +60,12 @@ void Model_Destroy( model_t * self_ ) {
     modelMtl->vertices = nil;
     modelMtl->indices = nil;
     
+    for ( size_t m = 0; m < modelMtl->meshCount; ++m ) {
+        if ( modelMtl->materials[ m ] != nullptr ) {
+            Material_Release( modelMtl->materials[ m ] );
+        }
+    }
+    
     Mem_Free( modelMtl->meshes );
     Mem_Free( modelMtl->materials );
     
@@ -85,6 +92,7 @@ void Model_WriteVertexData( model_t * self_, const void * src, uintptr_t start,
     uintptr_t startBytes = start * modelMtl->vertexStride;
     size_t countBytes = count * modelMtl->vertexStride;
     memcpy( ((uint8_t*) modelMtl->vertices.contents) + startBytes, src, countBytes );
+    Render_CountUpload( countBytes );
 }
 
 /*=======================================================================================================================================*/
@@ -96,6 +104,7 @@ void Model_WriteIndexData( model_t * self_, const void * src, uintptr_t start, s
     uintptr_t startBytes = start * modelMtl->indexStride;
     size_t countBytes = count * modelMtl->indexStride;
     memcpy( ((uint8_t*) modelMtl->indices.contents) + startBytes, src, countBytes );
+    Render_CountUpload( countBytes );
 }
 
 /*=======================================================================================================================================*/
@@ -126,6 +135,11 @@ void Model_SetMaterial( model_t * self_, uint32_t index, material_t * mat ) {
     model_metal_t * modelMtl = (model_metal_t *) self_;
     
     assert( index < modelMtl->meshCount );
+    
+    /* The model takes over the reference to the material */
+    if ( modelMtl->materials[ index ] != nullptr ) {
+        Material_Release( modelMtl->materials[ index ] );
+    }
     modelMtl->materials[ index ] = mat;
 }
 
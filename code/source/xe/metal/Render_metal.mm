@@ -64,10 +64,15 @@ void Render_Initialise( render_params_t * params ) {
     render3dMetal->base.materialTimestamp   = 0;
     render3dMetal->base.batchMemSize        = 1024 * 1024 * 2;
     render3dMetal->base.batchMaterialCapacity = 128;
-    render3dMetal->base.batchMem = Mem_Alloc( render3d->batchMemSize );
-    render3dMetal->base.batchHeap = FrameHeap_Create( (uintptr_t) render3d->batchMem, render3d->batchMemSize );
     
     assert( params->maxBuffersInflight > 0 && params->maxBuffersInflight <= 3);
+    
+    /* One batch heap for each buffer in flight plus the one being recorded */
+    uint32_t batchFrameCount = (uint32_t) params->maxBuffersInflight + 1;
+    size_t batchMemTotal = ( render3d->batchMemSize + 256 ) * batchFrameCount;     /* Extra bytes cover the heap headers */
+    render3dMetal->base.batchMem = Mem_HeapAlloc( MEM_HEAP_RENDER, batchMemTotal );
+    render3dMetal->base.batchHeapRing = FrameHeapRing_Create( (uintptr_t) render3d->batchMem, batchMemTotal, batchFrameCount );
+    render3dMetal->base.batchHeap = NULL;
     render3d->maxBuffersInflight = params->maxBuffersInflight;
     render3dMetal->inflightSemaphore = dispatch_semaphore_create( params->maxBuffersInflight );
     
@@ -192,8 +197,11 @@ extern "C" void Render_SubmitScene( render_cmd_scene3d_t * scene ) {
     commandBuffer.label = @"MyCommand";
 
     __block dispatch_semaphore_t block_sema = render3dMetal->inflightSemaphore;
+    __block frame_heap_ring_t * block_ring = render3d->batchHeapRing;
+    uint64_t frameIndex = scene->frameIndex;
     [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> buffer)
      {
+         FrameHeapRing_RetireFrame( block_ring, frameIndex );
          dispatch_semaphore_signal(block_sema);
     }];
     
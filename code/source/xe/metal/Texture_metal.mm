@@ -226,15 +226,19 @@ void Texture_Write( texture_t * self_, const void * srcBuffer, uint32_t mip ) {
     region.size.depth = 1;
    
     NSUInteger bytesPerRow = ( texMetal->m_pitch >> mip);
+    NSUInteger rowCount = region.size.height;
     
     if (Texture_IsBlockCompressed( texMetal->m_format )) {
         bytesPerRow = (region.size.width / texMetal->m_blockSizeX) * texMetal->m_blockSize;
+        rowCount = region.size.height / texMetal->m_blockSizeY;
     }
     
     [texMetal->m_texture replaceRegion: region
                            mipmapLevel: mip
                              withBytes: srcBuffer
                            bytesPerRow: bytesPerRow];
+    
+    Render_CountUpload( bytesPerRow * rowCount );
 }
 
 /*=======================================================================================================================================*/
@@ -0,0 +1,162 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "render/Model.h"
+#include "render/Material.h"
+#include "null/Model_null.h"
+#include "null/Render_null.h"
+#include "mem/Mem.h"
+#include <assert.h>
+#include <string.h>
+
+/*=======================================================================================================================================*/
+void Model_Create( model_t * self_, size_t vertexCount, size_t indexCount, size_t meshCount, uint64_t flags) {
+    static_assert( sizeof(model_t) >= sizeof(model_null_t), "Size of model_t is too small for implementation" );
+    
+    model_null_t * modelNull = (model_null_t *) self_;
+    memset( modelNull, 0, sizeof( model_null_t ) );
+    
+    modelNull->vertexCount = vertexCount;
+    modelNull->vertexStride = sizeof(vertex_t);
+    modelNull->vertexSize = modelNull->vertexCount * modelNull->vertexStride;
+    
+    modelNull->indexCount = indexCount;
+    modelNull->indexStride = sizeof(uint32_t);
+    modelNull->indexSize = modelNull->indexCount * modelNull->indexStride;
+    
+    modelNull->meshCount = meshCount;
+    modelNull->meshes = (mesh_t *) Mem_Alloc( sizeof(mesh_t) * meshCount );
+    modelNull->materials = (material_t**) Mem_Alloc( sizeof(void*) * meshCount );
+    memset( modelNull->materials, 0, sizeof(void*) * meshCount );
+    
+    /* The system memory copies take the place of the GPU buffers */
+    modelNull->vertices = (uint8_t *) Mem_HeapAlloc( MEM_HEAP_RENDER, modelNull->vertexSize );
+    modelNull->indices = (uint8_t *) Mem_HeapAlloc( MEM_HEAP_RENDER, modelNull->indexSize );
+    
+    Vec3_Set( modelNull->boundsMin, 0, 0, 0);
+    Vec3_Set( modelNull->boundsMax, 0, 0, 0);
+}
+
+/*=======================================================================================================================================*/
+void Model_Destroy( model_t * self_ ) {
+    model_null_t * modelNull = (model_null_t *) self_;
+    assert( self_ != NULL );
+    
+    Mem_Free( modelNull->vertices );
+    Mem_Free( modelNull->indices );
+    for ( size_t m = 0; m < modelNull->meshCount; ++m ) {
+        if ( modelNull->materials[ m ] != NULL ) {
+            Material_Release( modelNull->materials[ m ] );
+        }
+    }
+    
+    Mem_Free( modelNull->meshes );
+    Mem_Free( modelNull->materials );
+    
+    memset( modelNull, 0, sizeof( model_null_t ) );
+}
+
+/*=======================================================================================================================================*/
+void Model_WriteMeshData( model_t * self_, const void * src, uintptr_t start, size_t count ) {
+    model_null_t * modelNull = (model_null_t *) self_;
+    
+    assert( self_ != NULL );
+    assert( start + count <= modelNull->meshCount );
+    
+    size_t countBytes = count * sizeof( mesh_t );
+    memcpy( &modelNull->meshes[ start ], src, countBytes );
+}
+
+/*=======================================================================================================================================*/
+void Model_WriteVertexData( model_t * self_, const void * src, uintptr_t start, size_t count ) {
+    assert( self_ != NULL );
+    model_null_t * modelNull = (model_null_t *) self_;
+    
+    assert( start + count <= modelNull->vertexCount );
+    uintptr_t startBytes = start * modelNull->vertexStride;
+    size_t countBytes = count * modelNull->vertexStride;
+    memcpy( modelNull->vertices + startBytes, src, countBytes );
+    Render_CountUpload( countBytes );
+}
+
+/*=======================================================================================================================================*/
+void Model_WriteIndexData( model_t * self_, const void * src, uintptr_t start, size_t count ) {
+    assert( self_ != NULL );
+    model_null_t * modelNull = (model_null_t *) self_;
+    
+    assert( start + count <= modelNull->indexCount );
+    uintptr_t startBytes = start * modelNull->indexStride;
+    size_t countBytes = count * modelNull->indexStride;
+    memcpy( modelNull->indices + startBytes, src, countBytes );
+    Render_CountUpload( countBytes );
+}
+
+/*=======================================================================================================================================*/
+void Model_SetBounds( model_t * self_, const vec3_t * boundsMin, const vec3_t * boundsMax ) {
+    assert( self_ != NULL );
+    model_null_t * modelNull = (model_null_t *) self_;
+    Vec3_Copy( modelNull->boundsMin, *boundsMin );
+    Vec3_Copy( modelNull->boundsMax, *boundsMax );
+}
+
+/*=======================================================================================================================================*/
+void Model_GetBounds( model_t * self_, vec3_t * boundsMin, vec3_t * boundsMax ) {
+    assert( self_ != NULL );
+    model_null_t * modelNull = (model_null_t *) self_;
+    if ( boundsMin != NULL ) {
+        Vec3_Copy( *boundsMin,  modelNull->boundsMin );
+    }
+    
+    if ( boundsMax != NULL ) {
+        Vec3_Copy( *boundsMax,  modelNull->boundsMax );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Model_SetMaterial( model_t * self_, uint32_t index, material_t * mat ) {
+    assert( self_ != NULL );
+    model_null_t * modelNull = (model_null_t *) self_;
+    
+    assert( index < modelNull->meshCount );
+    
+    /* The model takes over the reference to the material */
+    if ( modelNull->materials[ index ] != NULL ) {
+        Material_Release( modelNull->materials[ index ] );
+    }
+    modelNull->materials[ index ] = mat;
+}
+
+/*=======================================================================================================================================*/
+material_t ** Model_GetMaterials( model_t * self_ ) {
+    model_null_t * modelNull = (model_null_t *) self_;
+    return modelNull->materials;
+}
+
+/*=======================================================================================================================================*/
+size_t Model_GetMeshCount( model_t * self_ ) {
+    model_null_t * modelNull = (model_null_t *) self_;
+    return modelNull->meshCount;
+}
+
+/*=======================================================================================================================================*/
+const mesh_t *  Model_GetMeshes( model_t * self_ ) {
+    model_null_t * modelNull = (model_null_t *) self_;
+    return modelNull->meshes;
+}
@@ -0,0 +1,144 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "core/Sys.h"
+#include "mem/Mem.h"
+#include "math/Math3d.h"
+#include "null/Render_null.h"
+#include "null/Model_null.h"
+#include "render/Material_local.h"
+#include <assert.h>
+#include <string.h>
+
+#define RENDER_NULL_DEFAULT_WIDTH   1280
+#define RENDER_NULL_DEFAULT_HEIGHT  720
+
+uint8_t render3dMemory[sizeof(render3d_null_t)];
+render3d_null_t * const render3dNull = (render3d_null_t*) render3dMemory;
+render3d_t * const render3d = (render3d_t*) render3dMemory;
+bool_t render3dInit = false;
+
+/*=======================================================================================================================================*/
+void Render_Initialise( render_params_t * params ) {
+    if ( render3dInit == true ) {
+        /* Nothing to do */
+        return;
+    }
+    
+    memset( render3dMemory, 0, sizeof( render3dMemory ) );
+    
+    render3dNull->base.currScene            = NULL;
+    render3dNull->base.materialTimestamp    = 0;
+    render3dNull->base.batchMemSize         = 1024 * 1024 * 2;
+    render3dNull->base.batchMaterialCapacity = 128;
+    
+    /* There is no GPU to wait on so frames are retired as soon as they are submitted, a
+       single buffer in flight is enough, but honour the request so the memory use matches */
+    int32_t maxBuffersInflight = ( params->maxBuffersInflight > 0 ) ? params->maxBuffersInflight : 1;
+    assert( maxBuffersInflight <= 3 );
+    
+    uint32_t batchFrameCount = (uint32_t) maxBuffersInflight + 1;
+    size_t batchMemTotal = ( render3d->batchMemSize + 256 ) * batchFrameCount;     /* Extra bytes cover the heap headers */
+    render3dNull->base.batchMem = Mem_HeapAlloc( MEM_HEAP_RENDER, batchMemTotal );
+    render3dNull->base.batchHeapRing = FrameHeapRing_Create( (uintptr_t) render3d->batchMem, batchMemTotal, batchFrameCount );
+    render3dNull->base.batchHeap = NULL;
+    render3d->maxBuffersInflight = maxBuffersInflight;
+    
+    render3dNull->dispWidth = ( params->displayWidth > 0 ) ? (uint32_t) params->displayWidth : RENDER_NULL_DEFAULT_WIDTH;
+    render3dNull->dispHeight = ( params->displayHeight > 0 ) ? (uint32_t) params->displayHeight : RENDER_NULL_DEFAULT_HEIGHT;
+    
+    render3dInit = true;
+    
+    xprintf( "=== Render Init ================\n" );
+    xprintf( "    Null renderer %ux%u\n", render3dNull->dispWidth, render3dNull->dispHeight );
+}
+
+/*=======================================================================================================================================*/
+void Render_SetResolution( uint32_t dispWidth, uint32_t dispHeight ) {
+    render3dNull->dispWidth = dispWidth;
+    render3dNull->dispHeight = dispHeight;
+}
+
+/*=======================================================================================================================================*/
+void Render_GetDisplaySize( uint32_t * dispWidth, uint32_t * dispHeight ) {
+    if ( dispWidth != NULL ) {
+        *dispWidth = render3dNull->dispWidth;
+    }
+    
+    if ( dispHeight != NULL ) {
+        *dispHeight = render3dNull->dispHeight;
+    }
+}
+
+/*=======================================================================================================================================*/
+float Render_GetDisplayScale(void) {
+    return 1.0f;
+}
+
+/*=======================================================================================================================================*/
+void Render_Calc3dProjectionMat( mat4_t * mat, float fov, float aspect, float nearClip, float farClip ) {
+    /* Same left handed projection as the metal backend so that the game code behaves identically */
+    float yScale = 1.0f / scalar_Tan(fov * 0.5f);
+    float xScale = yScale / aspect;
+    
+    Vec4_Set( mat->rows[0],             xScale,         0,          0,                              0 );
+    Vec4_Set( mat->rows[1],             0,              yScale,     0,                              0 );
+    Vec4_Set( mat->rows[2],             0,              0,          farClip / (farClip-nearClip),   1 );
+    Vec4_Set( mat->rows[3],             0,              0,          -nearClip*farClip / (farClip-nearClip),     0);
+}
+
+/*=======================================================================================================================================*/
+void Render_Finalise(void) {
+    if ( render3dInit == false ) {
+        return;
+    }
+    
+    Mem_Free( render3d->batchMem );
+    render3d->batchMem = NULL;
+    render3d->batchHeapRing = NULL;
+    render3d->batchHeap = NULL;
+    
+    render3dInit = false;
+}
+
+/*=======================================================================================================================================*/
+void Render_SubmitScene( render_cmd_scene3d_t * scene ) {
+    uint64_t indexCount = 0;
+    
+    /* Walk the commands the same way a real backend would, so the cost of reading the batches is
+       still part of the frame */
+    for ( render_cmd_material_t * matCmd = scene->materials; matCmd != &scene->materials[scene->materialCount]; ++matCmd ) {
+        assert( matCmd->material != NULL );
+        
+        for ( render_cmd_draw_t * drawCmd = matCmd->head; drawCmd != NULL; drawCmd = drawCmd->next ) {
+            model_null_t * modelNull = (model_null_t *) drawCmd->model;
+            assert( drawCmd->indexStart + drawCmd->indexCount <= modelNull->indexCount );
+            (void) modelNull;
+            
+            indexCount += drawCmd->indexCount;
+        }
+    }
+    
+    render3dNull->indicesSubmitted += indexCount;
+    ++render3dNull->scenesSubmitted;
+    
+    /* Nothing is in flight, the batch memory can be reused straight away */
+    FrameHeapRing_RetireFrame( render3d->batchHeapRing, scene->frameIndex );
+}
@@ -0,0 +1,42 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __RENDER3D_NULL_H__
+#define __RENDER3D_NULL_H__
+
+#include "render/Render3d_local.h"
+#include "render/RenderCmd.h"
+#include "math/Math3d.h"
+#include "mem/FrameHeap.h"
+
+/* Headless backend, scenes are walked on the CPU and then thrown away. Used for servers and for
+   profiling the CPU side of the renderer and the resource loaders on machines without a GPU */
+typedef struct render3d_null_s {
+    render3d_t                  base;               /* Base data for the common render functionality */
+    
+    uint32_t                    dispWidth;
+    uint32_t                    dispHeight;
+    uint64_t                    scenesSubmitted;
+    uint64_t                    indicesSubmitted;   /* Running total of the indices walked by the scene submits */
+} render3d_null_t;
+
+extern render3d_null_t * const render3dNull;
+
+#endif
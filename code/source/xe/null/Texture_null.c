@@ -0,0 +1,156 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "null/Render_null.h"
+#include "null/Texture_null.h"
+#include "core/Id.h"
+#include <assert.h>
+#include <string.h>
+
+#define TEXTURE_MAGIC MAKE_ID(X,e,T,e,x,t,u,r,e,_,_,_)
+
+static const size_t PIXEL_SIZE_TABLE[] = {
+    0,          // FORMAT_NONE = 0,
+    
+    3,          // FORMAT_RGB_S8,
+    3,          // FORMAT_RGB_U8,
+    4,          // FORMAT_RGBA_S8,
+    4,          // FORMAT_RGBA_U8,
+    
+    4,          // DEPTH_F32,
+    5,          // DEPTH_STENCIL_F32_U8
+};
+
+/*=======================================================================================================================================*/
+static bool_t Texture_IsBlockCompressed( SURFACE_FORMAT format) {
+    return (format >= SURFACE_FORMAT_RGB_BC1 && format <= SURFACE_FORMAT_RGBA_ETC2) ? true : false;
+}
+
+/*=======================================================================================================================================*/
+static size_t Texture_GetPixelSize( SURFACE_FORMAT fmt ) {
+    if ( fmt >= SURFACE_FORMAT_RGB_S8 && fmt <= SURFACE_FORMAT_DEPTH_STENCIL_F32_U8 ) {
+        return PIXEL_SIZE_TABLE[ (uint32_t) fmt];
+    }
+    else if ( fmt == SURFACE_FORMAT_RGB_BC1 ) {
+        return 8;
+    }
+    else if ( fmt == SURFACE_FORMAT_RGBA_BC2 || fmt == SURFACE_FORMAT_RGBA_BC3 ) {
+        return 16;
+    }
+    else if ( fmt >= SURFACE_FORMAT_RGB_ETC2 && fmt <= SURFACE_FORMAT_RGBA_ETC2 ) {
+        return 8;
+    }
+    
+    return 0;
+}
+
+/*=======================================================================================================================================*/
+static size_t Texture_GetMipByteSize( texture_null_t * texNull, uint32_t mip ) {
+    uint32_t width = texNull->m_width >> mip;
+    uint32_t height = texNull->m_height >> mip;
+    size_t pixelSize = Texture_GetPixelSize( texNull->m_format );
+    
+    if ( Texture_IsBlockCompressed( texNull->m_format ) == true ) {
+        /* Size is in 4x4 blocks */
+        width = ( width + 3 ) / 4;
+        height = ( height + 3 ) / 4;
+    }
+    
+    return (size_t) width * (size_t) height * pixelSize;
+}
+
+/*=======================================================================================================================================*/
+void Texture_Create( texture_t * self_, SURFACE_FORMAT format, uint32_t width, uint32_t height, uint32_t mipCount, uint64_t flags ) {
+    static_assert( sizeof(texture_t) >= sizeof(texture_null_t), "Size of texture_t.data is too small for implementation" );
+    
+    texture_null_t * texNull = (texture_null_t *) self_->data;
+    memset( texNull, 0, sizeof( texture_null_t ) );
+    
+    texNull->magic      = TEXTURE_MAGIC;
+    texNull->m_format   = format;
+    texNull->m_width    = width;
+    texNull->m_height   = height;
+    texNull->m_mipCount = mipCount;
+    texNull->m_flags    = flags;
+}
+
+/*=======================================================================================================================================*/
+void Texture_Destroy( texture_t * self_ ) {
+    texture_null_t * texNull = (texture_null_t *) self_;
+    
+    assert( self_ != NULL );
+    assert( texNull->magic == TEXTURE_MAGIC );
+    
+    texNull->magic = 0;
+}
+
+/*=======================================================================================================================================*/
+void Texture_Write( texture_t * self_, const void * srcBuffer, uint32_t mip ) {
+    texture_null_t * texNull = (texture_null_t *) self_;
+    
+    assert( self_ != NULL );
+    assert( texNull->magic == TEXTURE_MAGIC );
+    assert( srcBuffer != NULL );
+    assert( mip <= texNull->m_mipCount );
+    
+    size_t byteSize = Texture_GetMipByteSize( texNull, mip );
+    texNull->m_byteSize += byteSize;
+    Render_CountUpload( byteSize );
+}
+
+/*=======================================================================================================================================*/
+SURFACE_FORMAT Texture_GetFormat( texture_t * self_ ) {
+    texture_null_t * texNull = (texture_null_t *) self_;
+    
+    assert( self_ != NULL );
+    assert( texNull->magic == TEXTURE_MAGIC );
+    
+    return texNull->m_format;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Texture_GetWidth( texture_t * self_ ) {
+    texture_null_t * texNull = (texture_null_t *) self_;
+    
+    assert( self_ != NULL );
+    assert( texNull->magic == TEXTURE_MAGIC );
+    
+    return texNull->m_width;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Texture_GetHeight( texture_t * self_ ) {
+    texture_null_t * texNull = (texture_null_t *) self_;
+    
+    assert( self_ != NULL );
+    assert( texNull->magic == TEXTURE_MAGIC );
+    
+    return texNull->m_height;
+}
+
+/*=======================================================================================================================================*/
+uint32_t Texture_GetMipCount( texture_t * self_ ) {
+    texture_null_t * texNull = (texture_null_t *) self_;
+    
+    assert( self_ != NULL );
+    assert( texNull->magic == TEXTURE_MAGIC );
+    
+    return texNull->m_mipCount;
+}
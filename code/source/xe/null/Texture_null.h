@@ -0,0 +1,38 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#ifndef __TEXTURE_NULL_H__
+#define __TEXTURE_NULL_H__
+
+#include "core/Platform.h"
+#include "render/Texture.h"
+
+/* Texel data is counted and then discarded, only the description of the texture is kept */
+typedef struct texture_null_s {
+    uint64_t                magic;
+    SURFACE_FORMAT          m_format;
+    uint32_t                m_width;
+    uint32_t                m_height;
+    uint32_t                m_mipCount;
+    uint64_t                m_flags;
+    size_t                  m_byteSize;         /* Total bytes written across all of the mips */
+} texture_null_t;
+
+#endif
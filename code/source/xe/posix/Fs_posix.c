@@ -0,0 +1,438 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "Fs.h"
+#include "Str.h"
+#include "core/Sys.h"
+#include "core/Pak.h"
+#include "core/PakStream.h"
+#include "mem/Mem.h"
+
+/* Files are read and written with pread / pwrite at an offset that we track
+   ourselves, so there is no hidden stdio buffering and a file can be read from
+   several threads at once */
+typedef struct file_data_s {
+    int         fd;
+    uint64_t    offset;
+    bool_t      append;
+    bool_t      inPak;          /* File is a window onto a mounted pack, the fd belongs to the pack */
+    uint64_t    base;           /* Start of the file in the pack */
+    uint64_t    length;
+    uint8_t *   mem;            /* Inflated copy of a compressed pack file */
+} file_data_t;
+
+typedef struct fs_s {
+    str_t       basePath;
+    str_t       filePathTmp;
+    str_t       dataFolderPath;
+    str_t       assetFolderPath;
+} fs_t;
+
+fs_t fsLocal;
+fs_t* fileSystem = NULL;
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+void FS_Initialise(void) {
+    if ( fileSystem != NULL ) {
+        return;
+    }
+    
+    memset(&fsLocal, 0, sizeof(fsLocal) );
+    fileSystem = &fsLocal;
+    
+    Str_SetCapacity( &fsLocal.basePath, 2048 );
+    Str_SetCapacity( &fsLocal.filePathTmp, 2048 );
+    Str_SetCapacity( &fsLocal.dataFolderPath, 2048 );
+    Str_SetCapacity( &fsLocal.assetFolderPath, 2048 );
+    
+    /* Setup the data folder based on the current folder */
+    FS_GetCurrentFolder( &fileSystem->basePath );
+    
+    Str_Copy( &fsLocal.dataFolderPath, fileSystem->basePath );
+    Str_AppendPathCStr( &fsLocal.dataFolderPath, "/data" );
+    
+    Str_Copy( &fsLocal.assetFolderPath, fileSystem->basePath );
+    Str_AppendPathCStr( &fsLocal.assetFolderPath, "/assets" );
+    
+    xprintf("=== FS Init ====================\n");
+    xprintf("     Working path: %s\n", fileSystem->basePath );
+    xprintf("        Data path: %s\n", fileSystem->dataFolderPath );
+    xprintf("       Asset path: %s\n", fileSystem->assetFolderPath );
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+void FS_Finalise(void) {
+    assert(fileSystem != NULL);
+    Pak_UnmountAll();
+    fileSystem = NULL;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+void FS_SetDataPath( const char * path ) {
+    Str_CopyCStr( &fsLocal.dataFolderPath, path );
+    xprintf("Data now set to path: %s\n", fileSystem->dataFolderPath );
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+static int FS_ModeToFlags( const char * mode, bool_t * append ) {
+    /* Same meaning as the fopen modes, 'b' makes no difference here */
+    bool_t update = ( strchr( mode, '+' ) != NULL ) ? true : false;
+    *append = false;
+    
+    switch ( mode[ 0 ] ) {
+        case 'r':
+            return update ? O_RDWR : O_RDONLY;
+        case 'w':
+            return ( update ? O_RDWR : O_WRONLY ) | O_CREAT | O_TRUNC;
+        case 'a':
+            *append = true;
+            return ( update ? O_RDWR : O_WRONLY ) | O_CREAT | O_APPEND;
+        default:
+            return -1;
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+static size_t FS_ReadAt( int fd, void * buffer, size_t size, uint64_t offset ) {
+    uint8_t * dest = ( uint8_t * ) buffer;
+    size_t amtRead = 0;
+    
+    /* pread can return less than asked for, so keep going until we hit the end of the file */
+    while ( amtRead < size ) {
+        ssize_t res = pread( fd, dest + amtRead, size - amtRead, ( off_t ) ( offset + amtRead ) );
+        if ( res > 0 ) {
+            amtRead += ( size_t ) res;
+        }
+        else if ( res == 0 || errno != EINTR ) {
+            break;
+        }
+    }
+    
+    return amtRead;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+static bool_t FS_FileOpenPak( file_t * self_, const pak_file_t * pakFile ) {
+    const file_data_t * pakData = (const file_data_t *) pakFile->pak->data;
+    file_data_t * fileData = (file_data_t * ) self_->data;
+    
+    memset( fileData, 0, sizeof( file_data_t ) );
+    fileData->fd = pakData->fd;
+    fileData->inPak = true;
+    fileData->base = pakFile->offset;
+    fileData->length = pakFile->size;
+    
+    if ( ( pakFile->flags & PAKSTREAM_F_ZLIB ) != 0 ) {
+        /* Compressed files are inflated up front and read from memory */
+        void * compressed = Mem_Alloc( (size_t) pakFile->compressedSize );
+        fileData->mem = (uint8_t *) Mem_Alloc( ( pakFile->size > 0 ) ? (size_t) pakFile->size : 1 );
+        
+        bool_t ok = ( FS_ReadAt( fileData->fd, compressed, (size_t) pakFile->compressedSize, pakFile->offset ) == pakFile->compressedSize ) ? true : false;
+        ok = ok && Pak_Inflate( fileData->mem, (size_t) pakFile->size, compressed, (size_t) pakFile->compressedSize );
+        Mem_Free( compressed );
+        
+        if ( ok == false ) {
+            Mem_Free( fileData->mem );
+            fileData->mem = NULL;
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+bool_t FS_FileOpen( file_t * self_, const char* path, const char* mode) {
+    assert(fileSystem != NULL);
+    assert(path != NULL);
+    assert(mode != NULL);
+    
+    bool_t append = false;
+    int flags = FS_ModeToFlags( mode, &append );
+    if ( flags == -1 ) {
+        return false;
+    }
+    
+    /* Files in the data folder that are only being read come from the mounted packs first */
+    pak_file_t pakFile;
+    if ( path[ 0 ] == '~' && flags == O_RDONLY && Pak_Find( path, &pakFile ) == true ) {
+        return FS_FileOpenPak( self_, &pakFile );
+    }
+
+    /* Make the full path to the file, in a local string so files can be opened from any thread */
+    str_t fullPath = NULL;
+    bool_t makePathOk = FS_MakePath( &fullPath, path );
+    if ( makePathOk == false || fullPath == NULL ) {
+        if ( fullPath != NULL ) {
+            Str_Destroy( &fullPath );
+        }
+        return false;
+    }
+    
+    int fd = open( fullPath, flags | O_CLOEXEC, 0644 );
+    Str_Destroy( &fullPath );
+    if ( fd == -1 ) {
+        return false;
+    }
+    
+    static_assert( sizeof( file_t ) >= sizeof(file_data_t), "Size of file_t.data is too small for implementation " );
+    
+    file_data_t * fileData = (file_data_t * ) self_->data;
+    memset( fileData, 0, sizeof( file_data_t ) );
+    fileData->fd = fd;
+    fileData->offset = 0;
+    fileData->append = append;
+    
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+void FS_FileClose( file_t * file) {
+    assert(file != NULL);
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    if ( fileData->mem != NULL ) {
+        Mem_Free( fileData->mem );
+        fileData->mem = NULL;
+    }
+    if ( fileData->inPak == false ) {
+        close( fileData->fd );
+    }
+    fileData->fd = -1;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+size_t FS_FileLength(file_t* file) {
+    struct stat buf;
+    assert(file != NULL);
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    if ( fileData->inPak == true ) {
+        return ( size_t ) fileData->length;
+    }
+    
+    if ( fstat( fileData->fd, &buf ) != 0 ) {
+        return 0;
+    }
+    
+    return ( size_t ) buf.st_size;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+uintptr_t FS_FileTell(file_t* file) {
+    assert(file != NULL);
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    return ( uintptr_t ) fileData->offset;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+bool_t FS_FileSeek(file_t* file, uintptr_t pos) {
+    assert(file != NULL);
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    fileData->offset = pos;
+    
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+size_t FS_FileRead(file_t* file, void* buffer, size_t elementSize, size_t elementCount) {
+    assert(file != NULL);
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    size_t total = elementSize * elementCount;
+    size_t amtRead = 0;
+    
+    if ( fileData->inPak == true ) {
+        /* Stop at the end of the file rather than reading on into the next one in the pack */
+        uint64_t remaining = ( fileData->offset < fileData->length ) ? fileData->length - fileData->offset : 0;
+        if ( total > remaining ) {
+            total = ( size_t ) remaining;
+        }
+        
+        if ( fileData->mem != NULL ) {
+            memcpy( buffer, fileData->mem + fileData->offset, total );
+            amtRead = total;
+        }
+        else {
+            amtRead = FS_ReadAt( fileData->fd, buffer, total, fileData->base + fileData->offset );
+        }
+    }
+    else {
+        amtRead = FS_ReadAt( fileData->fd, buffer, total, fileData->offset );
+    }
+    
+    fileData->offset += amtRead;
+    
+    /* Match fread and return the number of whole elements */
+    return ( elementSize > 0 ) ? amtRead / elementSize : 0;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+size_t FS_FileWrite(file_t* file, const void* buffer, size_t elementSize, size_t elementCount) {
+    assert(file != NULL);
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    const uint8_t * src = ( const uint8_t * ) buffer;
+    size_t total = elementSize * elementCount;
+    size_t amtWritten = 0;
+    
+    /* Packs are read only */
+    if ( fileData->inPak == true ) {
+        return 0;
+    }
+    
+    while ( amtWritten < total ) {
+        /* pwrite ignores the offset for files opened with O_APPEND on some systems, so use write */
+        ssize_t res = ( fileData->append == true ) ?
+            write( fileData->fd, src + amtWritten, total - amtWritten ) :
+            pwrite( fileData->fd, src + amtWritten, total - amtWritten, ( off_t ) ( fileData->offset + amtWritten ) );
+        
+        if ( res > 0 ) {
+            amtWritten += ( size_t ) res;
+        }
+        else if ( res == 0 || errno != EINTR ) {
+            break;
+        }
+    }
+    
+    fileData->offset += amtWritten;
+    
+    return ( elementSize > 0 ) ? amtWritten / elementSize : 0;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+bool_t FS_FileMap( file_t * file, file_map_t * mapOut ) {
+    assert( file != NULL );
+    assert( mapOut != NULL );
+    
+    file_data_t * fileData = (file_data_t * ) file->data;
+    memset( mapOut, 0, sizeof( file_map_t ) );
+    
+    size_t length = FS_FileLength( file );
+    if ( length == 0 ) {
+        return false;
+    }
+    
+    /* Compressed pack files are already in memory */
+    if ( fileData->mem != NULL ) {
+        mapOut->data = fileData->mem;
+        mapOut->size = length;
+        return true;
+    }
+    
+    /* mmap wants a page aligned offset, so files in a pack map from the page they start in */
+    uint64_t pageSize = ( uint64_t ) sysconf( _SC_PAGESIZE );
+    uint64_t start = ( fileData->inPak == true ) ? fileData->base : 0;
+    uint64_t delta = start % pageSize;
+    size_t baseSize = length + ( size_t ) delta;
+    
+    void * base = mmap( NULL, baseSize, PROT_READ, MAP_PRIVATE, fileData->fd, ( off_t ) ( start - delta ) );
+    if ( base == MAP_FAILED ) {
+        return false;
+    }
+    
+    mapOut->data = ( const uint8_t * ) base + delta;
+    mapOut->size = length;
+    mapOut->base = base;
+    mapOut->baseSize = baseSize;
+    
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+void FS_FileUnmap( file_map_t * map ) {
+    assert( map != NULL );
+    
+    if ( map->base != NULL ) {
+        munmap( map->base, map->baseSize );
+    }
+    memset( map, 0, sizeof( file_map_t ) );
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+bool_t FS_MakePath( str_t * pathOut, const char * path ) {
+    if (path[0] == '~') {
+        /* Path has a ~ prefix - so make an absolute path based on the data folder */
+        Str_Copy( pathOut, fileSystem->dataFolderPath );
+        Str_AppendPathCStr( pathOut, path+1 );
+    } else if (path[0] == '@') {
+        /* Path has a @ prefix - so make an absolute path based on the asset folder */
+        Str_Copy( pathOut, fileSystem->assetFolderPath );
+        Str_AppendPathCStr( pathOut, path+1 );
+    } else {
+        /* Path has no prefix - just treat it as a normal path and copy */
+        Str_CopyCStr( pathOut, path );
+    }
+    
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+void FS_GetCurrentFolder( str_t * pathOut ) {
+    char path[ 4096 ];
+    
+    if ( getcwd( path, sizeof( path ) ) != NULL ) {
+        Str_CopyCStr( pathOut, path );
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+bool_t FS_CreateFolder( const char * path ) {
+    FS_MakePath( &fileSystem->filePathTmp, path );
+    
+    /* Create each folder along the path in turn, like mkdir -p */
+    char * curr = fileSystem->filePathTmp;
+    for ( char * c = curr + 1; *c != 0; ++c ) {
+        if ( *c == '/' ) {
+            *c = 0;
+            int res = mkdir( curr, 0755 );
+            *c = '/';
+            
+            if ( res != 0 && errno != EEXIST ) {
+                return false;
+            }
+        }
+    }
+    
+    return ( mkdir( curr, 0755 ) == 0 || errno == EEXIST ) ? true : false;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+char FS_FolderSep() {
+    return '/';
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------*/
+char FS_FolderSepOther() {
+    return '/';
+}
@@ -0,0 +1,148 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "core/Sys.h"
+#include "mem/Mem.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+/* Shared by every POSIX platform (Linux and macOS) */
+
+typedef struct sys_thread_data_s {
+    pthread_t           thread;
+    sys_thread_func_t   func;
+    void *              arg;
+} sys_thread_data_t;
+
+/*======================================================================================================================================= */
+void Sys_MutexCreate( sys_mutex_t * self_ ) {
+    static_assert( sizeof( pthread_mutex_t ) <= sizeof( sys_mutex_t ), "Size of sys_mutex_t.data is too small for implementation" );
+    
+    int res = pthread_mutex_init( ( pthread_mutex_t * ) self_->data, NULL );
+    xerror( res != 0, "Unable to create mutex (%d)\n", res );
+}
+
+/*======================================================================================================================================= */
+void Sys_MutexDestroy( sys_mutex_t * self_ ) {
+    pthread_mutex_destroy( ( pthread_mutex_t * ) self_->data );
+}
+
+/*======================================================================================================================================= */
+void Sys_MutexLock( sys_mutex_t * self_ ) {
+    pthread_mutex_lock( ( pthread_mutex_t * ) self_->data );
+}
+
+/*======================================================================================================================================= */
+bool_t Sys_MutexTryLock( sys_mutex_t * self_ ) {
+    return ( pthread_mutex_trylock( ( pthread_mutex_t * ) self_->data ) == 0 ) ? true : false;
+}
+
+/*======================================================================================================================================= */
+void Sys_MutexUnlock( sys_mutex_t * self_ ) {
+    pthread_mutex_unlock( ( pthread_mutex_t * ) self_->data );
+}
+
+/*======================================================================================================================================= */
+void Sys_CondCreate( sys_cond_t * self_ ) {
+    static_assert( sizeof( pthread_cond_t ) <= sizeof( sys_cond_t ), "Size of sys_cond_t.data is too small for implementation" );
+    
+    int res = pthread_cond_init( ( pthread_cond_t * ) self_->data, NULL );
+    xerror( res != 0, "Unable to create condition variable (%d)\n", res );
+}
+
+/*======================================================================================================================================= */
+void Sys_CondDestroy( sys_cond_t * self_ ) {
+    pthread_cond_destroy( ( pthread_cond_t * ) self_->data );
+}
+
+/*======================================================================================================================================= */
+void Sys_CondWait( sys_cond_t * self_, sys_mutex_t * mutex ) {
+    /* Can wake up spuriously, callers need to re-check their condition */
+    pthread_cond_wait( ( pthread_cond_t * ) self_->data, ( pthread_mutex_t * ) mutex->data );
+}
+
+/*======================================================================================================================================= */
+void Sys_CondSignal( sys_cond_t * self_ ) {
+    pthread_cond_signal( ( pthread_cond_t * ) self_->data );
+}
+
+/*======================================================================================================================================= */
+void Sys_CondBroadcast( sys_cond_t * self_ ) {
+    pthread_cond_broadcast( ( pthread_cond_t * ) self_->data );
+}
+
+/*======================================================================================================================================= */
+static void * Sys_ThreadEntry( void * arg ) {
+    sys_thread_data_t * data = ( sys_thread_data_t * ) arg;
+    data->func( data->arg );
+    
+    /* Hand back anything the thread has cached in the memory system */
+    Mem_ThreadFinalise();
+    return NULL;
+}
+
+/*======================================================================================================================================= */
+bool_t Sys_ThreadCreate( sys_thread_t * self_, sys_thread_func_t func, void * arg ) {
+    static_assert( sizeof( sys_thread_data_t ) <= sizeof( sys_thread_t ), "Size of sys_thread_t.data is too small for implementation" );
+    
+    /* The thread reads func and arg from self_, so it must stay put until the thread is joined */
+    sys_thread_data_t * data = ( sys_thread_data_t * ) self_->data;
+    data->func = func;
+    data->arg = arg;
+    
+    int res = pthread_create( &data->thread, NULL, Sys_ThreadEntry, data );
+    if ( res != 0 ) {
+        xprintf( "Unable to create thread (%d)\n", res );
+        return false;
+    }
+    
+    return true;
+}
+
+/*======================================================================================================================================= */
+void Sys_ThreadJoin( sys_thread_t * self_ ) {
+    sys_thread_data_t * data = ( sys_thread_data_t * ) self_->data;
+    pthread_join( data->thread, NULL );
+}
+
+/*======================================================================================================================================= */
+void Sys_ThreadYield(void) {
+    sched_yield();
+}
+
+/*======================================================================================================================================= */
+void Sys_Sleep( uint32_t ms ) {
+    struct timespec req;
+    req.tv_sec = ms / 1000;
+    req.tv_nsec = ( long ) ( ms % 1000 ) * 1000000L;
+    
+    /* Carry on sleeping if a signal wakes us early */
+    while ( nanosleep( &req, &req ) == -1 && errno == EINTR ) {
+    }
+}
+
+/*======================================================================================================================================= */
+uint32_t Sys_GetCpuCount(void) {
+    long count = sysconf( _SC_NPROCESSORS_ONLN );
+    return ( count > 0 ) ? ( uint32_t ) count : 1;
+}
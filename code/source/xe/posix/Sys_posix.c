@@ -0,0 +1,99 @@
+/*
+===========================================================================================================================================
+
+    Copyright 2016 - 2022 James Steele
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+    files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions :
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+    THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+===========================================================================================================================================
+*/
+
+#include "posix/Sys_posix.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+static sys_posix_t sys;
+static bool_t sysInit = false;
+
+/*======================================================================================================================================= */
+void Sys_Initialise(void) {
+    if ( sysInit == true ) {
+        return;
+    }
+    
+    /* CLOCK_MONOTONIC never jumps, so it is safe to measure frame times with */
+    clock_gettime( CLOCK_MONOTONIC, &sys.startTime );
+    
+    sysInit = true;
+    
+    xprintf( "=== Sys Init ===================\n" );
+    xprintf( "    Time is monotonic\n" );
+    xprintf( "    %u CPUs\n", Sys_GetCpuCount() );
+}
+
+/*======================================================================================================================================= */
+void Sys_Finalise(void) {
+    if ( sysInit == false ) {
+        return;
+    }
+    
+    sysInit = false;
+}
+
+/*======================================================================================================================================= */
+uint64_t Sys_GetTicksNs(void) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    
+    int64_t sec = ( int64_t ) now.tv_sec - ( int64_t ) sys.startTime.tv_sec;
+    int64_t nsec = ( int64_t ) now.tv_nsec - ( int64_t ) sys.startTime.tv_nsec;
+    
+    return ( uint64_t ) ( sec * 1000000000ll + nsec );
+}
+
+/*======================================================================================================================================= */
+uint64_t Sys_GetTicks(void) {
+    return Sys_GetTicksNs() / 1000000;
+}
+
+/*======================================================================================================================================= */
+void Sys_Printf( const char * fmt, ... ) {
+    /* stdio locks the stream, so this is safe to call from any thread */
+    va_list vaArgs;
+    va_start( vaArgs, fmt );
+    vprintf( fmt, vaArgs );
+    va_end( vaArgs );
+}
+
+/*======================================================================================================================================= */
+void Sys_Breakpoint(void) {
+    __builtin_trap();
+}
+
+/*======================================================================================================================================= */
+void Sys_Exit( int code ) {
+    exit(code);
+}
+
+/*======================================================================================================================================= */
+void Sys_AssertPrintf( const char * file, int line, const char * fmt, ... ) {
+    va_list vaArgs;
+    va_start( vaArgs, fmt );
+    
+    flockfile( stdout );
+    printf( "!!!ASSERT!!!\nFile: %s\nLine %u\n", file, line );
+    vprintf( fmt, vaArgs );
+    funlockfile( stdout );
+    
+    va_end( vaArgs );
+}
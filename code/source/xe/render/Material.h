@@ -30,17 +30,38 @@ typedef struct material_s {
 } material_t;
 
 XE_API void Material_Initialise( void );
-XE_API void Material_LoadLibrary( const char * path );
+XE_API void Material_Finalise( void );
+
+/*
+    Library materials are shared by name and reference counted. Material_LoadLibrary takes a reference to each of the
+    named materials, loading the ones that aren't loaded yet from the library, and gives NULL for any the library
+    doesn't have. Each reference is given back with Material_Release, the last one frees the material and releases
+    its textures.
+*/
+XE_API void Material_LoadLibrary( const char * path, const char * const * names, uint32_t count, material_t ** materials );
+XE_API void Material_Release( material_t * mat );
+
+/*
+    The library can also be loaded as a resource, so async loads can wait on it with Resource_LoadDependency.
+    Material_GetLibraryTextures gives the texture paths of the named materials that aren't loaded yet, pathsOut needs
+    room for three per name. Once those have loaded too, Material_LoadLibraryResource makes the materials the same
+    way Material_LoadLibrary does without touching a file.
+*/
+XE_API void Material_LoadLibraryResource( resource_t * libRes, const char * const * names, uint32_t count, material_t ** materials );
+XE_API uint32_t Material_GetLibraryTextures( resource_t * libRes, const char * const * names, uint32_t count, const char ** pathsOut );
 
 XE_API void Material_Create( material_t * self_ );
 XE_API void Material_Destroy( material_t * self_ );
-XE_API void Material_SetTextureAlbedo( material_t * self_, texture_t * tex );
-XE_API void Material_SetTextureGlow( material_t * self_, texture_t * tex );
-XE_API void Material_SetTextureAmr( material_t * self_, texture_t * tex );
+
+/* The material takes over the reference to the texture resource, the one it had before is released */
+XE_API void Material_SetTextureAlbedo( material_t * self_, resource_t * texRes );
+XE_API void Material_SetTextureGlow( material_t * self_, resource_t * texRes );
+XE_API void Material_SetTextureAmr( material_t * self_, resource_t * texRes );
 
 XE_API material_t * Material_Find( const char * name );
 //XE_API material_t * Load( )
 
 extern resource_factory_t * material_resource_factory;
+extern resource_factory_t * material_library_resource_factory;
 
 #endif
@@ -86,7 +86,7 @@ void MaterialResource_SetAlbedoTexture( parse_literal_t * path ) {
     xassert( path->type == PARSE_LITERAL_STRING );
     
     texRes = Resource_Load( path->value.stringVal );
-    Material_SetTextureAlbedo( matParse.mat, (texture_t*) Resource_GetData( texRes ) );
+    Material_SetTextureAlbedo( matParse.mat, texRes );
 }
 
 /*=======================================================================================================================================*/
@@ -97,7 +97,7 @@ void MaterialResource_SetGlowTexture( parse_literal_t * path ) {
     xassert( path->type == PARSE_LITERAL_STRING );
     
     texRes = Resource_Load( path->value.stringVal );
-    Material_SetTextureGlow( matParse.mat, (texture_t*) Resource_GetData( texRes ) );
+    Material_SetTextureGlow( matParse.mat, texRes );
 }
 
 /*=======================================================================================================================================*/
@@ -118,9 +118,14 @@ void MaterialResource_Load( resource_t * self_, file_t * file, const char * path
     Str_Destroy( &ext );
 }
 
+/*=======================================================================================================================================*/
+void MaterialResource_Unload( resource_t * self_ ) {
+    Material_Destroy( (material_t*) Resource_GetData( self_ ) );
+}
+
 /*=======================================================================================================================================*/
 void * MaterialResource_Alloc(void) {
-    material_t * mat = (material_t*) Mem_Alloc(sizeof(material_t));
+    material_t * mat = (material_t*) Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof(material_t) );
     Material_Create( mat );
     return mat;
 }
@@ -26,8 +26,7 @@
 #include "core/Sys.h"
 #include "core/Fs.h"
 #include "core/fh64.h"
-#include "core/Bsearch.h"
-#include "core/Array.h"
+#include "core/HashMap.h"
 #include "mem/Mem.h"
 #include <assert.h>
 #include <string.h>
@@ -37,32 +36,39 @@
 #define MATERIAL_ID MAKE_ID( X, E, M, a, t, e, r, i, a, l, _, _ )
 
 #define MATERIAL_CAPACITY 1024
+#define MATERIAL_TEXTURE_COUNT 3                        /* Albedo, glow and amr, the textures a library material can have */
 
 typedef struct material_lib_s {
     material_t          materials[ MATERIAL_CAPACITY ];
     uint64_t            materialsFree[ MATERIAL_CAPACITY ];
-    uint64_t            materialHashArray[ MATERIAL_CAPACITY ];
-    uint64_t            materialHashMap[ MATERIAL_CAPACITY ];
+    hash_map_t          materialMap;                /* Name hash to index in materials */
     size_t              materialFreeCount;
-    size_t              materialAllocCount;
     sys_mutex_t         mutex;
 } material_lib_t;
 
+/* A material library loaded as a resource, the stream is a copy of the file so it outlives the load */
+typedef struct material_library_s {
+    material_stream_t * stream;
+    size_t              size;
+} material_library_t;
+
 bool_t materialLibInit = false;
 material_lib_t materialLib;
 
+DEFINE_RESOURCE_FACTORY_ASYNC( "Material Library", MaterialLibrary, material_library )
+
 
 /*=======================================================================================================================================*/
-material_t * Material_FindInternal( const char * name ) {
+static material_t * Material_FindInternal( const char * name ) {
     uint64_t nameHash = FH64_CalcFromCStr( name );
-    int32_t index = -1;
+    uint64_t index = 0;
     
-    bool_t found = Bsearch_FindUint64( &index, nameHash, materialLib.materialHashArray, materialLib.materialAllocCount );
+    bool_t found = HashMap_Find( &materialLib.materialMap, nameHash, &index );
     if ( found == false ) {
         return NULL;
     }
     
-    return &materialLib.materials[ materialLib.materialHashMap[ index ] ];
+    return &materialLib.materials[ index ];
 }
 
 
@@ -78,7 +84,7 @@ material_t * Material_Find( const char * name ) {
 }
 
 /*=======================================================================================================================================*/
-void Material_Initialise() {
+void Material_Initialise( void ) {
     if ( materialLibInit == true ) {
         return;
     }
@@ -95,151 +101,376 @@ void Material_Initialise() {
     }
     
     materialLib.materialFreeCount = MATERIAL_CAPACITY;
+    HashMap_Create( &materialLib.materialMap, MATERIAL_CAPACITY, MEM_HEAP_RENDER );
+    Sys_MutexCreate( &materialLib.mutex );
     materialLibInit = true;
 }
 
 /*=======================================================================================================================================*/
-material_t * Material_Alloc( const char * name ) {
-    int32_t insertIndex = -1;
-    uint64_t matNameHash = 0;
+void Material_Finalise( void ) {
+    if ( materialLibInit == false ) {
+        return;
+    }
+    
+    /* Materials are freed when their last reference is released, anything left was never released. This runs after the
+       resources are finalised, so the textures of what's left have already gone */
+    uint32_t leakCount = HashMap_GetCount( &materialLib.materialMap );
+    if ( leakCount > 0 ) {
+        xprintf( "%u materials were still referenced at shutdown\n", leakCount );
+    }
+    
+    HashMap_Destroy( &materialLib.materialMap );
+    Sys_MutexDestroy( &materialLib.mutex );
+    materialLibInit = false;
+}
+
+/*=======================================================================================================================================*/
+static material_t * Material_Alloc( const char * name ) {
     uint64_t matIndex = 0;
-    material_local_t * matLocal = NULL;
     
+    xerror( materialLib.materialFreeCount == 0, "Maximum number of materials reached\n" );
+    --materialLib.materialFreeCount;
+    matIndex = materialLib.materialsFree[ materialLib.materialFreeCount ];
+    
+    material_t * mat = &materialLib.materials[ matIndex ];
+    material_local_t * matLocal = ( material_local_t * ) mat;
+    
+    Material_Create( mat );
+    matLocal->index = matIndex;
+    matLocal->name = FH64_CalcFromCStr( name );
+    matLocal->refCount = 1;
+    
+    HashMap_Insert( &materialLib.materialMap, matLocal->name, matIndex );
+    
+    return mat;
+}
+
+/*=======================================================================================================================================*/
+static material_t * Material_Acquire( const char * name ) {
     Sys_MutexLock( &materialLib.mutex );
     
     material_t * mat = Material_FindInternal( name );
     if ( mat != NULL ) {
-        Sys_MutexUnlock( &materialLib.mutex );
-        return mat;
+        ++( ( material_local_t * ) mat )->refCount;
     }
     
-    matNameHash = FH64_CalcFromCStr( name );
-    
-    insertIndex = -1;
-    Bsearch_FindUint64( &insertIndex, matNameHash, materialLib.materialHashArray, materialLib.materialAllocCount );
-    
-    matIndex = materialLib.materialsFree[ materialLib.materialFreeCount ];
-    --materialLib.materialFreeCount;
-    
-    Array_InsertAtPosUint64( insertIndex, matNameHash, materialLib.materialHashArray, materialLib.materialAllocCount, MATERIAL_CAPACITY );
-    Array_InsertAtPosUint64( insertIndex, matIndex, materialLib.materialHashMap, materialLib.materialAllocCount, MATERIAL_CAPACITY );
-    ++materialLib.materialAllocCount;
-
     Sys_MutexUnlock( &materialLib.mutex );
     
-    mat = &materialLib.materials[ matIndex ];
-    matLocal = ( material_local_t * ) mat;
-    matLocal->name = matNameHash;
-    matLocal->magic = MATERIAL_ID;
-    
     return mat;
 }
 
-
 /*=======================================================================================================================================*/
-void Material_Free( material_t * mat ) {
+void Material_Release( material_t * mat ) {
+    material_local_t * matLocal = ( material_local_t * ) mat;
+    assert( mat != NULL );
+    assert( matLocal->magic == MATERIAL_ID );
     
     Sys_MutexLock( &materialLib.mutex );
     
-    material_local_t * matLocal = ( material_local_t * ) mat;
+    xerror( matLocal->refCount == 0, "Material released more times than it was loaded\n" );
+    --matLocal->refCount;
+    bool_t freed = ( matLocal->refCount == 0 ) ? true : false;
     
-    int32_t index = -1;
-    bool_t found = Bsearch_FindUint64( &index, matLocal->name, materialLib.materialHashArray, materialLib.materialAllocCount );
-    xassert( found == true );
+    if ( freed == true ) {
+        bool_t found = HashMap_Remove( &materialLib.materialMap, matLocal->name, NULL );
+        xassert( found == true );
+        (void) found;
+    }
     
-    Array_RemoveAtPosUint64( index, materialLib.materialHashArray, materialLib.materialAllocCount );
-    Array_RemoveAtPosUint64( index, materialLib.materialHashMap, materialLib.materialAllocCount );
-    --materialLib.materialAllocCount;
+    Sys_MutexUnlock( &materialLib.mutex );
     
-    materialLib.materialsFree[ materialLib.materialFreeCount ] = matLocal->index;
-    ++ materialLib.materialFreeCount;    
+    if ( freed == false ) {
+        return;
+    }
+    
+    /* Nothing can find it once it's out of the map, the slot is only handed back after its textures are released */
+    Material_Destroy( mat );
     
+    Sys_MutexLock( &materialLib.mutex );
+    materialLib.materialsFree[ materialLib.materialFreeCount ] = matLocal->index;
+    ++materialLib.materialFreeCount;
     Sys_MutexUnlock( &materialLib.mutex );
 }
 
+/*=======================================================================================================================================*/
+static const material_stream_entry_t * Material_FindLibraryEntry( const material_stream_t * matLibStr, const char * name ) {
+    const char * matLibStrings = MaterialStream_GetStrings( matLibStr );
+    const material_stream_entry_t * matEntry = MaterialStream_GetMaterials( matLibStr );
+    
+    for ( uint32_t m = 0; m < matLibStr->count; ++m, ++matEntry ) {
+        if ( strcmp( &matLibStrings[ matEntry->offsName ], name ) == 0 ) {
+            return matEntry;
+        }
+    }
+    
+    return NULL;
+}
 
 /*=======================================================================================================================================*/
-void Material_LoadLibrary( const char * path ) {
-    file_t file;
-    bool_t opened = FS_FileOpen( &file, path, "rb" );
-    xerror( opened == false, "Unable to open material library %s\n", path );
+static resource_t * Material_LoadTexture( const char * path ) {
+    resource_t * texRes = Resource_Load( path );
     
-    uint8_t * buffer = Mem_Alloc( FS_FileLength( &file ) );
-    FS_FileRead( &file, buffer, 1, FS_FileLength( &file ) );
-    FS_FileClose( &file );
+    /* An async load of the texture may have failed already, the material goes without it rather than holding a texture that isn't there */
+    if ( Resource_GetState( texRes ) != RESOURCE_STATE_LOADED ) {
+        xprintf( "Material texture %s failed to load\n", path );
+        Resource_Release( texRes );
+        return NULL;
+    }
+    
+    return texRes;
+}
+
+/*=======================================================================================================================================*/
+static material_t * Material_CreateFromLibrary( const material_stream_t * matLibStr, const char * name ) {
+    const material_stream_entry_t * matEntry = Material_FindLibraryEntry( matLibStr, name );
+    if ( matEntry == NULL ) {
+        return NULL;
+    }
     
-    material_stream_t * matLibStr = ( material_stream_t * ) buffer;
     const char * matLibStrings = MaterialStream_GetStrings( matLibStr );
-    const material_stream_entry_t * matEntry = MaterialStream_GetMaterials( matLibStr );
     
-    for ( uint32_t m = 0; m < matLibStr->count; ++m ) {
-        const char * name = &matLibStrings[ matEntry->offsName ];
-        material_t * mat = Material_Find( name );
+    Sys_MutexLock( &materialLib.mutex );
+    material_t * mat = Material_Alloc( name );
+    Sys_MutexUnlock( &materialLib.mutex );
+    
+    if ( matEntry->offsAlbedoTexture != 0 ) {
+        Material_SetTextureAlbedo( mat, Material_LoadTexture( matLibStrings + matEntry->offsAlbedoTexture ) );
+    }
+    
+    if ( matEntry->offsGlowTexture != 0 ) {
+        Material_SetTextureGlow( mat, Material_LoadTexture( matLibStrings + matEntry->offsGlowTexture ) );
+    }
+    
+    if ( matEntry->offsAmrTexture != 0 ) {
+        Material_SetTextureAmr( mat, Material_LoadTexture( matLibStrings + matEntry->offsAmrTexture ) );
+    }
+    
+    return mat;
+}
+
+/*=======================================================================================================================================*/
+void Material_LoadLibrary( const char * path, const char * const * names, uint32_t count, material_t ** materials ) {
+    file_t file;
+    file_map_t map;
+    const material_stream_t * matLibStr = NULL;
+    
+    Mem_PushTag( "Material_LoadLibrary" );
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        materials[ n ] = Material_Acquire( names[ n ] );
+        if ( materials[ n ] != NULL ) {
+            continue;
+        }
         
-        if ( mat == NULL ) {
-            resource_t * texRes = NULL;
-            mat = Material_Alloc( name );
-            
-            const char * albedoPath = ( matEntry->offsAlbedoTexture == 0 ) ? NULL : matLibStrings + matEntry->offsAlbedoTexture;
-            const char * glowPath = ( matEntry->offsGlowTexture == 0 ) ? NULL : matLibStrings + matEntry->offsGlowTexture;
-            const char * amrPath = ( matEntry->offsAmrTexture == 0 ) ? NULL : matLibStrings + matEntry->offsAmrTexture;
-                        
-            if ( albedoPath != NULL ) {
-                texRes = Resource_Load( albedoPath );
-                Material_SetTextureAlbedo( mat, (texture_t*) Resource_GetData( texRes ) );
-            }
+        /* The library is only opened for materials that aren't loaded yet, and walked in place in the mapped file */
+        if ( matLibStr == NULL ) {
+            bool_t opened = FS_FileOpen( &file, path, "rb" );
+            xerror( opened == false, "Unable to open material library %s\n", path );
             
-            if ( amrPath != NULL ) {
-                texRes = Resource_Load( amrPath );
-                Material_SetTextureAmr( mat, (texture_t*) Resource_GetData( texRes ) );
-            }
+            bool_t mapped = FS_FileMap( &file, &map );
+            xerror( mapped == false, "Unable to map material library %s\n", path );
             
-            if ( amrPath != NULL ) {
-                texRes = Resource_Load( amrPath );
-                Material_SetTextureAmr( mat, (texture_t*) Resource_GetData( texRes ) );
-            }
+            matLibStr = ( const material_stream_t * ) map.data;
+        }
+        
+        materials[ n ] = Material_CreateFromLibrary( matLibStr, names[ n ] );
+        
+        if ( materials[ n ] == NULL ) {
+            xprintf( "Material %s is not in the library %s\n", names[ n ], path );
+        }
+    }
+    
+    if ( matLibStr != NULL ) {
+        FS_FileUnmap( &map );
+        FS_FileClose( &file );
+    }
+    
+    Mem_PopTag();
+}
+
+/*=======================================================================================================================================*/
+void Material_LoadLibraryResource( resource_t * libRes, const char * const * names, uint32_t count, material_t ** materials ) {
+    const material_library_t * lib = ( const material_library_t * ) Resource_GetData( libRes );
+    bool_t loaded = ( Resource_GetState( libRes ) == RESOURCE_STATE_LOADED && lib->stream != NULL ) ? true : false;
+    
+    Mem_PushTag( "Material_LoadLibrary" );
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        materials[ n ] = Material_Acquire( names[ n ] );
+        
+        if ( materials[ n ] == NULL && loaded == true ) {
+            materials[ n ] = Material_CreateFromLibrary( lib->stream, names[ n ] );
         }
         
-        /* Next material entry */
-        ++matEntry;
+        if ( materials[ n ] == NULL ) {
+            xprintf( "Material %s is not in the library\n", names[ n ] );
+        }
+    }
+    
+    Mem_PopTag();
+}
+
+/*=======================================================================================================================================*/
+uint32_t Material_GetLibraryTextures( resource_t * libRes, const char * const * names, uint32_t count, const char ** pathsOut ) {
+    const material_library_t * lib = ( const material_library_t * ) Resource_GetData( libRes );
+    uint32_t pathCount = 0;
+    
+    if ( Resource_GetState( libRes ) != RESOURCE_STATE_LOADED || lib->stream == NULL ) {
+        return 0;
+    }
+    
+    const char * matLibStrings = MaterialStream_GetStrings( lib->stream );
+    
+    for ( uint32_t n = 0; n < count; ++n ) {
+        const material_stream_entry_t * matEntry = ( Material_Find( names[ n ] ) == NULL ) ? Material_FindLibraryEntry( lib->stream, names[ n ] ) : NULL;
+        if ( matEntry == NULL ) {
+            continue;
+        }
+        
+        const uint32_t offsets[ MATERIAL_TEXTURE_COUNT ] = { matEntry->offsAlbedoTexture, matEntry->offsGlowTexture, matEntry->offsAmrTexture };
+        for ( uint32_t t = 0; t < MATERIAL_TEXTURE_COUNT; ++t ) {
+            if ( offsets[ t ] != 0 ) {
+                pathsOut[ pathCount ] = matLibStrings + offsets[ t ];
+                ++pathCount;
+            }
+        }
+    }
+    
+    return pathCount;
+}
+
+/*=======================================================================================================================================*/
+static bool_t MaterialLibrary_Check( const void * data, size_t size, const char * path ) {
+    const material_stream_t * matLibStr = ( const material_stream_t * ) data;
+    
+    if ( size < sizeof( material_stream_t ) || matLibStr->version != MATERIAL_STREAM_VERSION ) {
+        xprintf( "Material library '%s' is not a version %u material stream\n", path, MATERIAL_STREAM_VERSION );
+        return false;
+    }
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+void MaterialLibraryResource_Load( resource_t * self_, file_t * file, const char * path ) {
+    material_library_t * lib = ( material_library_t * ) Resource_GetData( self_ );
+    file_map_t map;
+    
+    bool_t mapped = FS_FileMap( file, &map );
+    xerror( mapped == false, "Unable to map material library %s\n", path );
+    
+    if ( MaterialLibrary_Check( map.data, map.size, path ) == true ) {
+        lib->stream = ( material_stream_t * ) Mem_HeapAlloc( MEM_HEAP_RESOURCE, map.size );
+        lib->size = map.size;
+        memcpy( lib->stream, map.data, map.size );
+    }
+    
+    FS_FileUnmap( &map );
+}
+
+/*=======================================================================================================================================*/
+void MaterialLibraryResource_Unload( resource_t * self_ ) {
+    material_library_t * lib = ( material_library_t * ) Resource_GetData( self_ );
+    
+    if ( lib->stream != NULL ) {
+        Mem_Free( lib->stream );
     }
     
-    Mem_Free( buffer );
+    lib->stream = NULL;
+    lib->size = 0;
 }
 
+/*=======================================================================================================================================*/
+bool_t MaterialLibraryResource_Decode( resource_t * self_, resource_load_t * load ) {
+    if ( MaterialLibrary_Check( load->fileData, load->fileSize, load->path ) == false ) {
+        return false;
+    }
+    
+    /* The library is small, the copy is made here so the mapping can go once the load is finished */
+    load->decoded = Mem_HeapAlloc( MEM_HEAP_RESOURCE, load->fileSize );
+    memcpy( load->decoded, load->fileData, load->fileSize );
+    
+    return true;
+}
 
+/*=======================================================================================================================================*/
+bool_t MaterialLibraryResource_Finish( resource_t * self_, resource_load_t * load ) {
+    material_library_t * lib = ( material_library_t * ) Resource_GetData( self_ );
+    
+    lib->stream = ( material_stream_t * ) load->decoded;
+    lib->size = load->fileSize;
+    load->decoded = NULL;
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+void * MaterialLibraryResource_Alloc( void ) {
+    material_library_t * lib = ( material_library_t * ) Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof( material_library_t ) );
+    memset( lib, 0, sizeof( material_library_t ) );
+    return lib;
+}
+
+/*=======================================================================================================================================*/
+void MaterialLibraryResource_Free( void * data ) {
+    Mem_Free( data );
+}
+
+/*=======================================================================================================================================*/
+static void Material_SetTexture( resource_t ** res, texture_t ** tex, resource_t * texRes ) {
+    resource_t * prevRes = *res;
+    
+    *res = texRes;
+    *tex = ( texRes != NULL ) ? (texture_t*) Resource_GetData( texRes ) : NULL;
+    
+    if ( prevRes != NULL ) {
+        Resource_Release( prevRes );
+    }
+}
 
 /*=======================================================================================================================================*/
 void Material_Create( material_t * self_ ) {
+    material_local_t * matLocal = (material_local_t*) self_;
+    assert( self_ != NULL );
+    
+    memset( self_, 0, sizeof( material_t ) );
+    matLocal->magic = MATERIAL_ID;
 }
 
 /*=======================================================================================================================================*/
 void Material_Destroy( material_t * self_ ) {
+    material_local_t * matLocal = (material_local_t*) self_;
+    assert( self_ != NULL );
+    assert( matLocal->magic == MATERIAL_ID );
+    
+    Material_SetTexture( &matLocal->resAlbedo, &matLocal->textureAlbedo, NULL );
+    Material_SetTexture( &matLocal->resGlow, &matLocal->textureGlow, NULL );
+    Material_SetTexture( &matLocal->resAmr, &matLocal->textureAmr, NULL );
 }
 
 /*=======================================================================================================================================*/
-void Material_SetTextureAlbedo( material_t * self_, texture_t * tex ) {
+void Material_SetTextureAlbedo( material_t * self_, resource_t * texRes ) {
     material_local_t * matLocal = (material_local_t*) self_;
     assert( self_ != NULL );
     assert( matLocal->magic == MATERIAL_ID );
     
-    matLocal->textureAlbedo = tex;
+    Material_SetTexture( &matLocal->resAlbedo, &matLocal->textureAlbedo, texRes );
 }
 
 /*=======================================================================================================================================*/
-void Material_SetTextureGlow( material_t * self_, texture_t * tex ) {
+void Material_SetTextureGlow( material_t * self_, resource_t * texRes ) {
     material_local_t * matLocal = (material_local_t*) self_;
     assert( self_ != NULL );
     assert( matLocal->magic == MATERIAL_ID );
     
-    matLocal->textureGlow = tex;
+    Material_SetTexture( &matLocal->resGlow, &matLocal->textureGlow, texRes );
 }
 
 /*=======================================================================================================================================*/
-void Material_SetTextureAmr( material_t * self_, texture_t * tex ) {
+void Material_SetTextureAmr( material_t * self_, resource_t * texRes ) {
     material_local_t * matLocal = (material_local_t*) self_;
     assert( self_ != NULL );
     assert( matLocal->magic == MATERIAL_ID );
     
-    matLocal->textureAmr = tex;
+    Material_SetTexture( &matLocal->resAmr, &matLocal->textureAmr, texRes );
 }
@@ -30,9 +30,14 @@ typedef struct material_local_s {
     uint64_t        name;
     int64_t         timeStamp;
     int64_t         batchIndex;
+    uint32_t        refCount;       /* Owners of a library material, it is freed when the last one releases it */
+    uint32_t        pad;
     texture_t *     textureAlbedo;
     texture_t *     textureGlow;
     texture_t *     textureAmr;
+    resource_t *    resAlbedo;      /* Texture resources the material holds a reference to, released by Material_Destroy */
+    resource_t *    resGlow;
+    resource_t *    resAmr;
 } material_local_t;
 
 #endif
@@ -44,13 +44,14 @@ typedef struct model_s {
 #define MODEL_MESHNAMELOOKUP    0x0000000000000002
 
 XE_API void        Model_Create( model_t * self_, size_t vertexCount, size_t indexCount, size_t meshCount, uint64_t flags );
+XE_API void        Model_Destroy( model_t * self_ );
 XE_API void        Model_WriteVertexData( model_t * self_, const void * src, uintptr_t start, size_t count );
 XE_API void        Model_WriteIndexData( model_t * self_, const void * src, uintptr_t start, size_t count );
 XE_API void        Model_WriteMeshData( model_t * self_, const void * sec, uintptr_t start, size_t count );
 XE_API void        Model_SetBounds( model_t * self_, const vec3_t * boundsMin, const vec3_t * boundsMax );
 XE_API void        Model_GetBounds( model_t * self_, vec3_t * boundsMin, vec3_t * boundsMax );
 XE_API void        Model_Load( model_t * self_, file_t * file,  const char * path );
-XE_API void        Model_SetMaterial( model_t * self_, uint32_t index, material_t * mat );
+XE_API void        Model_SetMaterial( model_t * self_, uint32_t index, material_t * mat );     /* Takes over the reference to a library material */
 XE_API material_t ** Model_GetMaterials( model_t * self_ );
 XE_API size_t       Model_GetMeshCount( model_t * self_ );
 XE_API const mesh_t * Model_GetMeshes( model_t * self_ );
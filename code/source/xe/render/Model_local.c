@@ -22,6 +22,7 @@
 #include "render/ModelStream.h"
 #include "render/Material.h"
 #include "core/Fs.h"
+#include "core/Sys.h"
 #include "mem/Mem.h"
 #include "resource/Resource.h"
 #include <assert.h>
@@ -30,29 +31,63 @@
 static void         ModelResource_Load( resource_t * self_, file_t * file, const char * path );
 static void *       ModelResource_Alloc( void );
 static void         ModelResource_Free( void * data );
+static bool_t       ModelResource_Decode( resource_t * self_, resource_load_t * load );
+static bool_t       ModelResource_Finish( resource_t * self_, resource_load_t * load );
+static bool_t       ModelResource_Depend( resource_t * self_, resource_load_t * load );
 
-static void         Model_LoadMaterials( model_t * self_, model_stream_t * str, const char * path );
+static void         Model_LoadData( model_t * self_, model_stream_t * str );
+static void         Model_LoadMaterials( model_t * self_, model_stream_t * str, const char * libPath, resource_t * libRes );
 
-DEFINE_RESOURCE_FACTORY("Model", Model, model )
+DEFINE_RESOURCE_FACTORY_DEPENDS("Model", Model, model )
+
+/*=======================================================================================================================================*/
+static bool_t Model_GetLibraryPath( str_t * pathOut, const char * path ) {
+    /* Models under ~/models have their materials in the library of the same name under ~/materials */
+    const char * modelsStr = strstr( path, "models" );
+    if ( modelsStr == NULL || modelsStr - path > 3 ) {
+        return false;
+    }
+    
+    Str_CopyCStr( pathOut, "~/materials" );
+    Str_AppendPathCStr( pathOut, modelsStr + 6 );
+    Str_PathRemoveExtension( pathOut );
+    Str_AppendCStr( pathOut, ".bmat" );
+    
+    return true;
+}
 
 /*=======================================================================================================================================*/
 void Model_Load( model_t * self_, file_t * file, const char * path ) {
-    model_stream_t * str = NULL;
+    file_map_t map;
+    
+    Mem_PushTag( "Model_Load" );
+    
+    /* The stream is used in place from the mapped file, there is no copy of it in memory */
+    bool_t mapped = FS_FileMap( file, &map );
+    assert( mapped == true );
+    
+    if ( mapped == true ) {
+        str_t libPath = NULL;
+        
+        Model_LoadData( self_, (model_stream_t *) map.data );
+        if ( Model_GetLibraryPath( &libPath, path ) == true ) {
+            Model_LoadMaterials( self_, (model_stream_t *) map.data, libPath, NULL );
+            Str_Destroy( &libPath );
+        }
+        
+        FS_FileUnmap( &map );
+    }
+    
+    Mem_PopTag();
+}
+
+/*=======================================================================================================================================*/
+void Model_LoadData( model_t * self_, model_stream_t * str ) {
     const void * vertexStr = NULL;
     const void * indexStr = NULL;
     vec3_t bmin, bmax;
-    size_t amtRead;
-    
-    /* Read the data fom the file */
-    size_t dataLength = FS_FileLength( file );
-    void * data = Mem_Alloc( dataLength );
-    assert( data != NULL );
-    
-    amtRead = FS_FileRead( file, data, sizeof(uint8_t) , dataLength );
-    assert( amtRead == dataLength );
     
     /* We only load the most recent model versions */
-    str = (model_stream_t *) data;
     assert( str->version == MODEL_STREAM_VERSION );
     
     vertexStr = ModelStream_GetVertices( str );
@@ -72,62 +107,124 @@ void Model_Load( model_t * self_, file_t * file, const char * path ) {
     /* Set model bounds */
     ModelStream_GetBounds( str, &bmin, &bmax );
     Model_SetBounds( self_, &bmin, &bmax );
+}
+
+/*=======================================================================================================================================*/
+static const char ** Model_GetMaterialNames( model_stream_t * str ) {
+    const mesh_stream_t * meshStr = ModelStream_GetMeshes( str );
+    const char ** names = (const char **) Mem_Alloc( sizeof( const char * ) * str->meshCount );
     
-    /* Load materials */
-    if ( path != NULL ) {
-        Model_LoadMaterials( self_, str, path );
+    for ( uint32_t m = 0; m < str->meshCount; ++m ) {
+        names[ m ] = ModelStream_GetMaterialNames( str ) + meshStr[ m ].material;
     }
     
-    /* All done. Clean up! */
-    Mem_Free( data );
+    return names;
 }
 
 /*=======================================================================================================================================*/
-void Model_LoadMaterials( model_t * self_, model_stream_t * str, const char * path ) {
+void Model_LoadMaterials( model_t * self_, model_stream_t * str, const char * libPath, resource_t * libRes ) {
+    if ( str->meshCount == 0 ) {
+        return;
+    }
     
-    const mesh_stream_t * meshStr = ModelStream_GetMeshes( str );
-    resource_t * res = NULL;
+    /* The model takes a reference to the material of each mesh, they are released when it's destroyed */
+    const char ** names = Model_GetMaterialNames( str );
+    material_t ** materials = (material_t **) Mem_Alloc( sizeof( material_t * ) * str->meshCount );
     
-    uint32_t modelsStrIndex = 0;
-    const char * modelsStr = strstr( path, "models" );
-    const char * matPathBase = NULL;
-    if ( modelsStr == NULL) {
-        return;
+    if ( libRes != NULL ) {
+        Material_LoadLibraryResource( libRes, names, str->meshCount, materials );
     }
-     
-    modelsStrIndex = (uint32_t) ( modelsStr - path );
-    if ( modelsStrIndex > 3 ) {
-        return;
+    else {
+        Material_LoadLibrary( libPath, names, str->meshCount, materials );
+    }
+    
+    for ( uint32_t m = 0; m < str->meshCount; ++m ) {
+        Model_SetMaterial( self_, m, materials[ m ] );
+    }
+    
+    Mem_Free( materials );
+    Mem_Free( names );
+}
+
+/*=======================================================================================================================================*/
+void ModelResource_Load( resource_t * self_, file_t * file, const char * path ) {
+    model_t * model = (model_t*) Resource_GetData( self_ );
+    Model_Load( model, file, path );
+}
+
+/*=======================================================================================================================================*/
+void ModelResource_Unload( resource_t * self_ ) {
+    Model_Destroy( (model_t*) Resource_GetData( self_ ) );
+}
+
+/*=======================================================================================================================================*/
+bool_t ModelResource_Decode( resource_t * self_, resource_load_t * load ) {
+    const model_stream_t * str = (const model_stream_t *) load->fileData;
+    
+    /* The stream is used in place, all there is to do off the main thread is check it */
+    if ( load->fileSize < sizeof( model_stream_t ) || str->version != MODEL_STREAM_VERSION ) {
+        xprintf( "Model '%s' is not a version %u model stream\n", load->path, MODEL_STREAM_VERSION );
+        return false;
     }
     
-    matPathBase = path + modelsStrIndex + 6;
+    return true;
+}
+
+/*=======================================================================================================================================*/
+bool_t ModelResource_Depend( resource_t * self_, resource_load_t * load ) {
+    model_stream_t * str = (model_stream_t *) load->fileData;
+    str_t libPath = NULL;
+    
+    if ( str->meshCount == 0 || Model_GetLibraryPath( &libPath, load->path ) == false ) {
+        return true;
+    }
     
-    str_t matLibPath = NULL;
-    Str_CopyCStr( &matLibPath, "~/materials" );
-    Str_AppendPathCStr( &matLibPath, matPathBase );
-    Str_PathRemoveExtension( &matLibPath );
-    Str_AppendCStr( &matLibPath, ".bmat" );
+    /* The library first, then the textures of the materials in it that aren't loaded yet. Finish makes the materials
+       once all of them are in, without going to a file on this thread */
+    resource_t * libRes = Resource_LoadDependency( load, libPath );
+    Str_Destroy( &libPath );
     
-    Material_LoadLibrary( matLibPath );
+    if ( Resource_GetState( libRes ) != RESOURCE_STATE_LOADED ) {
+        return true;
+    }
     
-    Str_Destroy( &matLibPath );
+    const char ** names = Model_GetMaterialNames( str );
+    const char ** texturePaths = (const char **) Mem_Alloc( sizeof( const char * ) * str->meshCount * 3 );
+    uint32_t textureCount = Material_GetLibraryTextures( libRes, names, str->meshCount, texturePaths );
     
-    for ( uint32_t m = 0; m < str->meshCount; ++m ) {
-        const char * meshMatName = ModelStream_GetMaterialNames( str ) + meshStr->material;
-        material_t * mat = Material_Find( meshMatName );
-        Model_SetMaterial( self_, m, mat );
+    for ( uint32_t t = 0; t < textureCount; ++t ) {
+        Resource_LoadDependency( load, texturePaths[ t ] );
     }
+    
+    Mem_Free( texturePaths );
+    Mem_Free( names );
+    
+    return true;
 }
 
 /*=======================================================================================================================================*/
-void ModelResource_Load( resource_t * self_, file_t * file, const char * path ) {
+bool_t ModelResource_Finish( resource_t * self_, resource_load_t * load ) {
     model_t * model = (model_t*) Resource_GetData( self_ );
-    Model_Load( model, file, path );
+    model_stream_t * str = (model_stream_t *) load->fileData;
+    str_t libPath = NULL;
+    
+    Mem_PushTag( "Model_Load" );
+    
+    Model_LoadData( model, str );
+    if ( Model_GetLibraryPath( &libPath, load->path ) == true ) {
+        /* Already a dependency, so this gives back the library the depend step loaded */
+        Model_LoadMaterials( model, str, libPath, ( str->meshCount > 0 ) ? Resource_LoadDependency( load, libPath ) : NULL );
+        Str_Destroy( &libPath );
+    }
+    
+    Mem_PopTag();
+    
+    return true;
 }
 
 /*=======================================================================================================================================*/
 void * ModelResource_Alloc(void) {
-    return Mem_Alloc(sizeof(model_t));
+    return Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof(model_t) );
 }
 
 /*=======================================================================================================================================*/
@@ -34,6 +34,15 @@ typedef struct render_params_s {
     int32_t     maxBuffersInflight;
 } render_params_t;
 
+/* Counters for a single frame, draws are counted per mesh submitted */
+typedef struct render_stats_s {
+    uint64_t    frameIndex;
+    uint64_t    drawCalls;
+    uint64_t    materials;
+    uint64_t    triangles;
+    uint64_t    bytesUploaded;          /* Vertex, index and texture data written since the previous frame */
+} render_stats_t;
+
 typedef struct camera_s camera_t;
 
 XE_API void Render_Initialise( render_params_t * params );
@@ -54,4 +63,6 @@ XE_API void Render_End(void);
 
 XE_API void Render_SubmitModel( model_t * model, material_t ** materials, const mat4_t * xform );
 
+XE_API void Render_GetFrameStats( render_stats_t * stats );
+
 #endif
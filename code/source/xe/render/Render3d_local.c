@@ -23,6 +23,7 @@
 #include "Camera.h"
 #include "math/Math3d.h"
 #include <assert.h>
+#include <string.h>
 
 /* To be provided by the implementation */
 extern void Render_SubmitScene( render_cmd_scene3d_t * scene );
@@ -65,9 +66,12 @@ void Render_Begin( camera_t * camera, const int32_t * viewport ) {
     
     assert( render3d->currScene == NULL );
     
-    FrameHeap_Reset( render3d->batchHeap );
+    /* Move on to the next heap in the ring, the frames still in flight keep their
+       command data until they are retired */
+    render3d->batchHeap = FrameHeapRing_BeginFrame( render3d->batchHeapRing );
     
     scene = (render_cmd_scene3d_t*) FrameHeap_Alloc( render3d->batchHeap,  sizeof( render_cmd_scene3d_t ) );
+    scene->frameIndex = FrameHeapRing_GetFrameIndex( render3d->batchHeapRing );
     scene->matProj = camera->projection;
     scene->matViewWorld = camera->transform;
     _Mat4_Inverse( &scene->matView, &camera->transform );
@@ -91,6 +95,11 @@ void Render_End(void) {
     assert( scene != NULL );
     render3d->currScene = NULL;
     
+    render3d->frameStats.frameIndex = scene->frameIndex;
+    render3d->frameStats.materials = scene->materialCount;
+    render3d->lastFrameStats = render3d->frameStats;
+    memset( &render3d->frameStats, 0, sizeof( render3d->frameStats ) );
+    
     Render_SubmitScene( scene );
 }
 
@@ -112,6 +121,15 @@ void Render_SubmitModel( model_t * model, material_t ** materials, const mat4_t
         
         RENDER_CMD_ADD_ITEM( matCmd, drawCmd )
         
+        ++render3d->frameStats.drawCalls;
+        render3d->frameStats.triangles += meshes[ m ].indexCount / 3;
+        
         ++drawCmd;
     }
 }
+
+/*=======================================================================================================================================*/
+void Render_GetFrameStats( render_stats_t * stats ) {
+    assert( stats != NULL );
+    *stats = render3d->lastFrameStats;
+}
@@ -31,13 +31,22 @@
 typedef struct render3d_s {
     uint64_t                    materialTimestamp;
     render_cmd_scene3d_t *      currScene;
-    frame_heap_t *              batchHeap;
+    frame_heap_ring_t *         batchHeapRing;          /* One batch heap per frame that can be in flight */
+    frame_heap_t *              batchHeap;              /* Batch heap of the frame being recorded */
     void *                      batchMem;
-    size_t                      batchMemSize;
+    size_t                      batchMemSize;           /* Size of the batch memory for a single frame */
     size_t                      batchMaterialCapacity;
     int32_t                     maxBuffersInflight;
+    render_stats_t              frameStats;             /* Stats of the frame being recorded */
+    render_stats_t              lastFrameStats;         /* Stats of the last frame submitted */
 } render3d_t;
 
 extern render3d_t * const render3d;
 
+/*=======================================================================================================================================*/
+static inline void Render_CountUpload( size_t bytes ) {
+    /* Resources are created on the main thread, so this does not need to be atomic */
+    render3d->frameStats.bytesUploaded += bytes;
+}
+
 #endif
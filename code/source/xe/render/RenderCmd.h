@@ -64,6 +64,8 @@ typedef struct render_cmd_scene3d_s {
     render_cmd_material_t * materials;
     uintptr_t   materialCapacity;
     uintptr_t   materialCount;
+    
+    uint64_t    frameIndex;         /* Frame the scene was recorded in, passed back to the batch heap ring when the GPU is done */
 } render_cmd_scene3d_t;
 
 #endif
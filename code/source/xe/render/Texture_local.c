@@ -22,11 +22,23 @@
 #include "render/TexStream.h"
 #include "stb_image.h"
 #include "core/Fs.h"
+#include "core/Str.h"
+#include "core/Sys.h"
 #include "mem/Mem.h"
 #include <assert.h>
 #include <string.h>
 
-DEFINE_RESOURCE_FACTORY( "Texture", Texture, texture )
+DEFINE_RESOURCE_FACTORY_ASYNC( "Texture", Texture, texture )
+
+/* Image decoded by a job during an async load, waiting for the texture to be created */
+typedef struct texture_image_s {
+    int32_t             width;
+    int32_t             height;
+    unsigned char *     pixels;
+} texture_image_t;
+
+static void Texture_CreateFromBtex( texture_t * self_, const void * data );
+static bool_t Texture_IsBtex( const char * path );
 
 static const SURFACE_FORMAT TEX_FORMAT_TABLE[] = {
     SURFACE_FORMAT_RGB_U8,            // FORMAT_RGB_U8
@@ -49,9 +61,7 @@ static const SURFACE_FORMAT TEX_FORMAT_TABLE[] = {
 void TextureResource_Load( resource_t * self_, file_t * file, const char * path ) {
     texture_t * tex = (texture_t*) Resource_GetData( self_ );
     
-    const char * btexExt = strstr( path, ".btex" );
-    
-    if ( btexExt != NULL ) {
+    if ( Texture_IsBtex( path ) == true ) {
         Texture_LoadBtex( tex, file, path );
     }
     else {
@@ -59,9 +69,72 @@ void TextureResource_Load( resource_t * self_, file_t * file, const char * path
     }
 }
 
+/*=======================================================================================================================================*/
+static bool_t Texture_IsBtex( const char * path ) {
+    /* Match only the extension, lowered as the resource type dispatch does; a local string since decode runs on a job */
+    str_t pathStr = NULL;
+    str_t ext = NULL;
+    Str_CopyCStr( &pathStr, path );
+    
+    bool_t isBtex = false;
+    if ( Str_PathGetExtension( &ext, pathStr ) == true ) {
+        Str_ToLower( ext );
+        isBtex = ( strcmp( ext, "btex" ) == 0 ) ? true : false;
+        Str_Destroy( &ext );
+    }
+    
+    Str_Destroy( &pathStr );
+    return isBtex;
+}
+
+/*=======================================================================================================================================*/
+void TextureResource_Unload( resource_t * self_ ) {
+    Texture_Destroy( (texture_t*) Resource_GetData( self_ ) );
+}
+
+/*=======================================================================================================================================*/
+bool_t TextureResource_Decode( resource_t * self_, resource_load_t * load ) {
+    /* A btex is ready to use as it is */
+    if ( Texture_IsBtex( load->path ) == true ) {
+        return true;
+    }
+    
+    texture_image_t * image = (texture_image_t *) Mem_Alloc( sizeof( texture_image_t ) );
+    int32_t numChannels = 0;
+    image->pixels = stbi_load_from_memory( load->fileData, (int) load->fileSize, &image->width, &image->height, &numChannels, 4 );
+    
+    if ( image->pixels == NULL ) {
+        xprintf( "Could not decode image '%s'\n", load->path );
+        Mem_Free( image );
+        return false;
+    }
+    
+    load->decoded = image;
+    return true;
+}
+
+/*=======================================================================================================================================*/
+bool_t TextureResource_Finish( resource_t * self_, resource_load_t * load ) {
+    texture_t * tex = (texture_t*) Resource_GetData( self_ );
+    texture_image_t * image = (texture_image_t *) load->decoded;
+    
+    if ( image == NULL ) {
+        Texture_CreateFromBtex( tex, load->fileData );
+        return true;
+    }
+    
+    Texture_Create( tex, SURFACE_FORMAT_RGBA_U8, image->width, image->height, 0, TEXTURE_USAGE_SHADER_READ );
+    Texture_Write( tex, image->pixels, 0 );
+    
+    stbi_image_free( image->pixels );
+    Mem_Free( image );
+    
+    return true;
+}
+
 /*=======================================================================================================================================*/
 void * TextureResource_Alloc(void) {
-    return Mem_Alloc(sizeof(texture_t));
+    return Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof(texture_t) );
 }
 
 /*=======================================================================================================================================*/
@@ -71,28 +144,31 @@ void  TextureResource_Free( void * data ) {
 
 /*=========================================================================================================================================*/
 bool_t Texture_LoadStbi( texture_t * self_, file_t * file ) {
-    void * buffer  = NULL;
-    size_t bufferLen = 0;
-    size_t amtRead=  0;
+    file_map_t map;
     int32_t numChannels = 0;
     int32_t width = 0;
     int32_t height = 0;
     unsigned char * image = NULL;
     
-    bufferLen = FS_FileLength( file );
-    buffer = Mem_Alloc( bufferLen );
+    Mem_PushTag( "Texture_LoadStbi" );
     
-    amtRead = FS_FileRead( file, buffer, 1, bufferLen );
-    assert( amtRead == bufferLen );
+    bool_t mapped = FS_FileMap( file, &map );
+    assert( mapped == true );
+    if ( mapped == false ) {
+        Mem_PopTag();
+        return false;
+    }
 
-    image = stbi_load_from_memory(buffer, (int) bufferLen, &width, &height, &numChannels, 4 );
+    image = stbi_load_from_memory( map.data, (int) map.size, &width, &height, &numChannels, 4 );
     assert( image != NULL );
+    FS_FileUnmap( &map );
     
     Texture_Create( self_, SURFACE_FORMAT_RGBA_U8, width, height, 0, TEXTURE_USAGE_SHADER_READ );
     Texture_Write( self_, image, 0 );
     
     stbi_image_free( image );
-    Mem_Free( buffer );
+    
+    Mem_PopTag();
     
     return true;
 }
@@ -106,14 +182,26 @@ bool_t Texture_LoadImage( texture_t * self_, file_t * file, const char * path  )
 /*=========================================================================================================================================*/
 bool_t Texture_LoadBtex( texture_t * self_, file_t * file, const char * path ) {
     
-    size_t dataLength = FS_FileLength( file );
-    void * data = Mem_Alloc( dataLength );
-    assert( data != NULL );
+    Mem_PushTag( "Texture_LoadBtex" );
+    
+    /* The texture is written straight from the mapped file */
+    file_map_t map;
+    bool_t mapped = FS_FileMap( file, &map );
+    assert( mapped == true );
     
-    size_t amtRead = FS_FileRead( file, data, sizeof(uint8_t) , dataLength );
-    assert( amtRead == dataLength );
+    if ( mapped == true ) {
+        Texture_CreateFromBtex( self_, map.data );
+        FS_FileUnmap( &map );
+    }
     
-    tex_stream_t * str = ( tex_stream_t * ) data;
+    Mem_PopTag();
+    
+    return mapped;
+}
+
+/*=========================================================================================================================================*/
+static void Texture_CreateFromBtex( texture_t * self_, const void * data ) {
+    const tex_stream_t * str = ( const tex_stream_t * ) data;
     
     SURFACE_FORMAT texFmt = TEX_FORMAT_TABLE[ str->format ];
     
@@ -123,8 +211,4 @@ bool_t Texture_LoadBtex( texture_t * self_, file_t * file, const char * path ) {
         const uint8_t * buffer = TexStream_GetImage( str, i );
         Texture_Write( self_, buffer, i );
     }
-    
-    Mem_Free( data );
-    
-    return true;
 }
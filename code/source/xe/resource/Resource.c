@@ -26,39 +26,107 @@
 #include "core/Bsearch.h"
 #include "core/Sys.h"
 #include "core/Array.h"
+#include "core/HashMap.h"
+#include "core/Job.h"
+#include "core/Atomic.h"
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 
-#define MAX_RESOURCES 2048
+#define RESOURCE_MAP_CAPACITY 2048                          /* Resources the lookup has room for before it first grows */
 #define MAX_FACTORIES 128
 #define MAX_FACTORY_EXTENSIONS 128
+#define RESOURCE_PREFETCH_STRIDE 4096                       /* Page size, or smaller, for touching mapped files on the I/O thread */
+#define RESOURCE_DEPENDENCY_CAPACITY 8                      /* Dependencies a load has room for before it first grows */
+
+#ifndef RESOURCE_DEFAULT_BUDGET
+#   define RESOURCE_DEFAULT_BUDGET  ( 64 * 1024 * 1024 )
+#endif
 
 typedef struct resource_data_s {
     uint64_t                pathHash;
     str_t                   path;
     void *                  data;
     resource_factory_t *    factory;
+    atomic_uint             state;
+    uint32_t                refCount;               /* Owning thread only, like the rest of the residency info */
+    uint32_t                typeIndex;
+    uint64_t                size;                   /* Bytes counted against the type's budget once loaded */
+    struct resource_data_s * lruPrev;               /* Links in the type's list of unreferenced resources */
+    struct resource_data_s * lruNext;
 } resource_data_t;
 
+/* Residency of the resources made by one factory. Unreferenced resources are kept in release order, oldest first */
+typedef struct resource_type_s {
+    uint64_t                budget;
+    uint64_t                used;
+    uint64_t                unreferenced;
+    uint32_t                resourceCount;
+    uint32_t                unreferencedCount;
+    uint64_t                evictionCount;
+    uint64_t                evictedBytes;
+    resource_data_t *       lruHead;
+    resource_data_t *       lruTail;
+} resource_type_t;
+
+/* An async load, or a wait for a resource that is already loaded or pending */
+typedef struct resource_request_s {
+    resource_data_t *           resource;
+    resource_callback_t         callback;
+    void *                      user;
+    resource_load_t             load;
+    file_t                      file;               /* Stays open while the file is mapped */
+    file_map_t                  map;
+    bool_t                      fileOpen;
+    bool_t                      ok;
+    resource_data_t **          dependencies;       /* Loaded by the depend step, each holds a reference until finish is done */
+    uint32_t                    dependencyCount;
+    uint32_t                    dependencyCapacity;
+    struct resource_request_s * next;
+} resource_request_t;
+
+/* Requests are passed between the threads in FIFO lists */
+typedef struct resource_queue_s {
+    resource_request_t *    head;
+    resource_request_t *    tail;
+} resource_queue_t;
+
 typedef struct resource_mgr_s {
-    uint64_t        resourceHashes[ MAX_RESOURCES ];
-    resource_t *    resources[ MAX_RESOURCES ];
-    size_t          resourceCount;
+    hash_map_t      resourceMap;                    /* Path hash to resource_data_t */
     
     uint64_t                factoryHashes[ MAX_FACTORY_EXTENSIONS ];
     uint32_t                factoryHashMap[MAX_FACTORY_EXTENSIONS ];
     resource_factory_t *    factories[ MAX_FACTORIES ];
+    resource_type_t         types[ MAX_FACTORIES ];         /* Residency of each factory, same index as factories */
     size_t                  factoryCount;
     size_t                  factoryExtCount;
     
     str_t                   pathTemp;               /* Used when wporking with paths */
     str_t                   extTemp;                /* Used when getting the extension */
     str_t                   tempStr;                /* A large temporary string used internally by the resource system */
+    
+    /* Async loading, files are read on the I/O thread and the loads are finished on the owning thread */
+    sys_thread_t            ioThread;
+    sys_mutex_t             ioMutex;
+    sys_cond_t              ioCond;
+    resource_queue_t        ioQueue;                /* Files to read */
+    bool_t                  ioRunning;
+    sys_mutex_t             doneMutex;
+    resource_queue_t        doneQueue;              /* Loads ready to be finished */
+    resource_queue_t        waitQueue;              /* Requests for resources that were already loaded or pending, owning thread only */
+    resource_queue_t        dependQueue;            /* Loads waiting for their dependencies to load, owning thread only */
+    uint32_t                pendingCount;           /* Loads not finished yet, owning thread only */
+    bool_t                  finalising;             /* Releases only drop the count while everything is unloaded */
 } resource_mgr_t;
 
 static resource_mgr_t res;
 static bool_t resInit = false;
 
+static void Resource_IoThread( void * arg );
+static int32_t Resource_FindType( const resource_factory_t * factory );
+static void Resource_Unload( resource_data_t * resData );
+static void Resource_Destroy( resource_data_t * resData );
+
 /*=======================================================================================================================================*/
 void * Resource_GetData( resource_t * self_ ) {
     assert( self_ != NULL );
@@ -142,7 +210,7 @@ resource_factory_t * Resource_FindFactory( const char * path ) {
     assert( gotExtHash == true );
     
     int32_t index = -1;
-    bool_t found = Bsearch_FindUint64( &index,  hash, res.factoryHashes, res.factoryCount );
+    bool_t found = Bsearch_FindUint64( &index,  hash, res.factoryHashes, res.factoryExtCount );
     if ( found == false ) {
         return NULL;
     }
@@ -155,14 +223,13 @@ resource_factory_t * Resource_FindFactory( const char * path ) {
 resource_t * Resource_FindInternal( const char * path ) {
     uint64_t hash = Resource_CalcPathHashCStr( path );
     
-    int32_t index = -1;
-    bool_t found = Bsearch_FindUint64( &index, hash, res.resourceHashes, res.resourceCount );
+    uint64_t resource = 0;
+    bool_t found = HashMap_Find( &res.resourceMap, hash, &resource );
     if ( found == false ) {
         return NULL;
     }
     
-    resource_t * resource = res.resources[ index ];
-    return resource;
+    return (resource_t *) (uintptr_t) resource;
 }
 
 /*=======================================================================================================================================*/
@@ -177,6 +244,14 @@ void Resource_Initialise( void ) {
     Str_SetCapacity( &res.pathTemp, 2048 );
     Str_SetCapacity( &res.extTemp, 64 );
     
+    HashMap_Create( &res.resourceMap, RESOURCE_MAP_CAPACITY, MEM_HEAP_RESOURCE );
+    
+    Sys_MutexCreate( &res.ioMutex );
+    Sys_CondCreate( &res.ioCond );
+    Sys_MutexCreate( &res.doneMutex );
+    res.ioRunning = true;
+    Sys_ThreadCreate( &res.ioThread, Resource_IoThread, NULL );
+    
     xprintf("=== Resource Init ==============\n");
     
     resInit = true;
@@ -188,6 +263,49 @@ void Resource_Finalise( void ) {
         return;
     }
     
+    /* Let the loads in flight finish before stopping the I/O thread */
+    Resource_WaitAsync();
+    
+    Sys_MutexLock( &res.ioMutex );
+    res.ioRunning = false;
+    Sys_CondSignal( &res.ioCond );
+    Sys_MutexUnlock( &res.ioMutex );
+    Sys_ThreadJoin( &res.ioThread );
+    
+    Sys_MutexDestroy( &res.ioMutex );
+    Sys_CondDestroy( &res.ioCond );
+    Sys_MutexDestroy( &res.doneMutex );
+    
+    /* Everything still resident goes now, whether or not it was released. It is all unloaded before any of it is
+       freed, as unloading a resource can release others it references, like the textures of a material */
+    uint32_t referencedCount = 0;
+    uint32_t iter = 0;
+    uint64_t resource = 0;
+    while ( HashMap_Next( &res.resourceMap, &iter, NULL, &resource ) == true ) {
+        referencedCount += ( ( (resource_data_t *) (uintptr_t) resource )->refCount > 0 ) ? 1 : 0;
+    }
+    
+    res.finalising = true;
+    iter = 0;
+    while ( HashMap_Next( &res.resourceMap, &iter, NULL, &resource ) == true ) {
+        Resource_Unload( (resource_data_t *) (uintptr_t) resource );
+    }
+    
+    iter = 0;
+    while ( HashMap_Next( &res.resourceMap, &iter, NULL, &resource ) == true ) {
+        Resource_Destroy( (resource_data_t *) (uintptr_t) resource );
+    }
+    HashMap_Destroy( &res.resourceMap );
+    
+    if ( referencedCount > 0 ) {
+        xprintf( "%u resources were still referenced at shutdown\n", referencedCount );
+    }
+    
+    Str_Destroy( &res.tempStr );
+    Str_Destroy( &res.pathTemp );
+    Str_Destroy( &res.extTemp );
+    
+    res.finalising = false;
     resInit = false;
 }
 
@@ -201,42 +319,457 @@ void Resource_RegisterFactory( resource_factory_t * factory, const char * ext )
     
     /* Get the insertion position of the hash in the sorted array */
     int32_t index = -1;
-    bool_t found = Bsearch_FindUint64( &index,  hash, res.factoryHashes, res.factoryCount );
+    bool_t found = Bsearch_FindUint64( &index,  hash, res.factoryHashes, res.factoryExtCount );
     assert( found == false );
     
-    uint32_t factoryPos = (uint32_t) res.factoryCount;
+    /* A factory registered for several extensions is one resource type */
+    int32_t factoryPos = Resource_FindType( factory );
+    if ( factoryPos < 0 ) {
+        xerror( res.factoryCount >= MAX_FACTORIES, "Maximum number of resource factories reached\n" );
+        factoryPos = (int32_t) res.factoryCount;
+        res.factories[ factoryPos ] = factory;
+        memset( &res.types[ factoryPos ], 0, sizeof( resource_type_t ) );
+        res.types[ factoryPos ].budget = RESOURCE_DEFAULT_BUDGET;
+        ++res.factoryCount;
+    }
     
-    /* Add the factory to the resource system and also the hash /hash map index */
-    Array_InsertAtPosUint64( index, hash, res.factoryHashes, res.factoryCount, MAX_FACTORIES );
-    Array_InsertAtPosUint32( index, factoryPos, res.factoryHashMap, res.factoryCount, MAX_FACTORIES );
-    res.factories[res.factoryCount] = factory;
-    ++res.factoryCount;
+    /* Add the extension hash and its index into the factories */
+    Array_InsertAtPosUint64( index, hash, res.factoryHashes, res.factoryExtCount, MAX_FACTORY_EXTENSIONS );
+    Array_InsertAtPosUint32( index, (uint32_t) factoryPos, res.factoryHashMap, res.factoryExtCount, MAX_FACTORY_EXTENSIONS );
+    ++res.factoryExtCount;
 }
 
 /*=======================================================================================================================================*/
 void Resource_Add( resource_data_t * resToAdd ) {
-    int32_t index = -1;
-    bool_t found = Bsearch_FindUint64( &index, resToAdd->pathHash, res.resourceHashes, res.resourceCount );
-    assert( found == false );
+    bool_t added = HashMap_Insert( &res.resourceMap, resToAdd->pathHash, (uint64_t) (uintptr_t) resToAdd );
+    xerror( added == false, "Resource path hash collision for '%s'\n", resToAdd->path );
+}
+
+/*=======================================================================================================================================*/
+static void Resource_Remove( resource_data_t * resToRemove ) {
+    bool_t removed = HashMap_Remove( &res.resourceMap, resToRemove->pathHash, NULL );
+    assert( removed == true );
+    (void) removed;
+}
+
+/*=======================================================================================================================================*/
+static int32_t Resource_FindType( const resource_factory_t * factory ) {
+    for ( size_t f = 0; f < res.factoryCount; ++f ) {
+        if ( res.factories[ f ] == factory ) {
+            return (int32_t) f;
+        }
+    }
+    
+    return -1;
+}
+
+/*=======================================================================================================================================*/
+static void Resource_LruPush( resource_type_t * type, resource_data_t * resData ) {
+    resData->lruPrev = type->lruTail;
+    resData->lruNext = NULL;
+    
+    if ( type->lruTail != NULL ) {
+        type->lruTail->lruNext = resData;
+    }
+    else {
+        type->lruHead = resData;
+    }
+    type->lruTail = resData;
+    
+    type->unreferenced += resData->size;
+    ++type->unreferencedCount;
+}
+
+/*=======================================================================================================================================*/
+static void Resource_LruRemove( resource_type_t * type, resource_data_t * resData ) {
+    if ( resData->lruPrev != NULL ) {
+        resData->lruPrev->lruNext = resData->lruNext;
+    }
+    else {
+        type->lruHead = resData->lruNext;
+    }
+    
+    if ( resData->lruNext != NULL ) {
+        resData->lruNext->lruPrev = resData->lruPrev;
+    }
+    else {
+        type->lruTail = resData->lruPrev;
+    }
+    
+    resData->lruPrev = NULL;
+    resData->lruNext = NULL;
+    
+    type->unreferenced -= resData->size;
+    --type->unreferencedCount;
+}
+
+/*=======================================================================================================================================*/
+static void Resource_Unload( resource_data_t * resData ) {
+    resource_factory_t * factory = resData->factory;
+    
+    /* Left as failed, there's nothing loaded for it any more */
+    if ( atomic_load( &resData->state ) == RESOURCE_STATE_LOADED ) {
+        if ( factory->unload != NULL ) {
+            factory->unload( (resource_t *) resData );
+        }
+        atomic_store( &resData->state, RESOURCE_STATE_FAILED );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Resource_Destroy( resource_data_t * resData ) {
+    Resource_Unload( resData );
+    resData->factory->free( resData->data );
+    
+    if ( resData->path != NULL ) {
+        Str_Destroy( &resData->path );
+    }
+    Mem_Free( resData );
+}
+
+/*=======================================================================================================================================*/
+static void Resource_Evict( resource_data_t * resData ) {
+    resource_type_t * type = &res.types[ resData->typeIndex ];
+    
+    assert( resData->refCount == 0 );
+    assert( atomic_load( &resData->state ) != RESOURCE_STATE_PENDING );
+    
+    xprintf( "Unloading resource %s\n", resData->path );
+    
+    Resource_LruRemove( type, resData );
+    type->used -= resData->size;
+    --type->resourceCount;
+    ++type->evictionCount;
+    type->evictedBytes += resData->size;
+    
+    Resource_Remove( resData );
+    Resource_Destroy( resData );
+}
+
+/*=======================================================================================================================================*/
+static void Resource_Trim( resource_type_t * type ) {
+    resource_data_t * resData = type->lruHead;
+    
+    /* Oldest released first, anything still loading has to wait until it's done */
+    while ( type->used > type->budget && resData != NULL ) {
+        resource_data_t * next = resData->lruNext;
+        if ( atomic_load( &resData->state ) != RESOURCE_STATE_PENDING ) {
+            Resource_Evict( resData );
+        }
+        resData = next;
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Resource_SetResident( resource_data_t * resData, uint64_t size ) {
+    resData->size = size;
+    res.types[ resData->typeIndex ].used += size;
+    
+    /* Released while it was loading, so it's already in the list with no size */
+    if ( resData->refCount == 0 ) {
+        res.types[ resData->typeIndex ].unreferenced += size;
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Resource_QueuePush( resource_queue_t * queue, resource_request_t * request ) {
+    request->next = NULL;
     
-    Array_InsertAtPosUint64( index, resToAdd->pathHash, res.resourceHashes, res.resourceCount, MAX_RESOURCES );
-    Array_InsertAtPosVoidPtr( index, (void*) resToAdd, (void**) res.resources, res.resourceCount, MAX_RESOURCES );
-    ++res.resourceCount;
+    if ( queue->tail != NULL ) {
+        queue->tail->next = request;
+    }
+    else {
+        queue->head = request;
+    }
+    queue->tail = request;
 }
 
 /*=======================================================================================================================================*/
-resource_t * Resource_LoadInternal( const char * path, bool_t loadNow ) {
+static resource_request_t * Resource_QueuePop( resource_queue_t * queue ) {
+    resource_request_t * request = queue->head;
+    
+    if ( request != NULL ) {
+        queue->head = request->next;
+        if ( queue->head == NULL ) {
+            queue->tail = NULL;
+        }
+    }
+    
+    return request;
+}
+
+/*=======================================================================================================================================*/
+static void Resource_Done( resource_request_t * request ) {
+    Sys_MutexLock( &res.doneMutex );
+    Resource_QueuePush( &res.doneQueue, request );
+    Sys_MutexUnlock( &res.doneMutex );
+}
+
+/*=======================================================================================================================================*/
+static void Resource_DecodeJob( void * arg ) {
+    resource_request_t * request = (resource_request_t *) arg;
+    
+    request->ok = request->resource->factory->decode( (resource_t *) request->resource, &request->load );
+    Resource_Done( request );
+}
+
+/*=======================================================================================================================================*/
+static bool_t Resource_ReadFile( resource_request_t * request ) {
+    resource_load_t * load = &request->load;
+    
+    if ( FS_FileOpen( &request->file, load->path, "rb" ) == false ) {
+        xprintf( "Could not open resource file '%s' for reading\n", load->path );
+        return false;
+    }
+    request->fileOpen = true;
+    
+    if ( FS_FileMap( &request->file, &request->map ) == false ) {
+        xprintf( "Could not map resource file '%s'\n", load->path );
+        return false;
+    }
+    
+    load->fileData = request->map.data;
+    load->fileSize = request->map.size;
+    
+    /* Touch every page so the file is read in here, rather than faulting on the job or main thread when it's used */
+    const volatile uint8_t * bytes = (const volatile uint8_t *) load->fileData;
+    uint8_t sum = 0;
+    for ( size_t b = 0; b < load->fileSize; b += RESOURCE_PREFETCH_STRIDE ) {
+        sum += bytes[ b ];
+    }
+    (void) sum;
+    
+    return true;
+}
+
+/*=======================================================================================================================================*/
+static void Resource_IoThread( void * arg ) {
+    for ( ;; ) {
+        Sys_MutexLock( &res.ioMutex );
+        while ( res.ioQueue.head == NULL && res.ioRunning == true ) {
+            Sys_CondWait( &res.ioCond, &res.ioMutex );
+        }
+        resource_request_t * request = Resource_QueuePop( &res.ioQueue );
+        Sys_MutexUnlock( &res.ioMutex );
+        
+        if ( request == NULL ) {
+            return;
+        }
+        
+        /* The read is all this thread does, decoding is handed to the job workers so the next read can start */
+        request->ok = Resource_ReadFile( request );
+        
+        if ( request->ok == true && request->resource->factory->decode != NULL && Job_GetWorkerCount() <= 1 ) {
+            /* Only the main thread runs jobs, and it may be sleeping in Resource_WaitAsync, so decode here */
+            Resource_DecodeJob( request );
+        }
+        else if ( request->ok == true && request->resource->factory->decode != NULL ) {
+            job_decl_t job;
+            job.func = Resource_DecodeJob;
+            job.arg = request;
+            Job_Run( &job, 1, NULL );
+        }
+        else {
+            Resource_Done( request );
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Resource_FinishRequest( resource_request_t * request ) {
+    resource_data_t * resData = request->resource;
+    resource_t * resource = (resource_t *) resData;
+    resource_factory_t * factory = resData->factory;
+    
+    if ( factory->finish == NULL ) {
+        /* Nothing was read ahead, load it the same way as Resource_Load */
+        file_t file;
+        request->ok = FS_FileOpen( &file, resData->path, "rb" );
+        
+        if ( request->ok == true ) {
+            factory->load( resource, &file, resData->path );
+            Resource_SetResident( resData, FS_FileLength( &file ) );
+            FS_FileClose( &file );
+        }
+        else {
+            xprintf( "Could not open resource file '%s' for reading\n", resData->path );
+        }
+    }
+    else if ( request->ok == true ) {
+        request->ok = factory->finish( resource, &request->load );
+        if ( request->ok == true ) {
+            Resource_SetResident( resData, request->load.fileSize );
+        }
+    }
+    
+    if ( request->fileOpen == true ) {
+        FS_FileUnmap( &request->map );
+        FS_FileClose( &request->file );
+    }
+    
+    atomic_store_explicit( &resData->state, ( request->ok == true ) ? RESOURCE_STATE_LOADED : RESOURCE_STATE_FAILED, memory_order_release );
+    --res.pendingCount;
+    
+    xprintf( "%s resource %s\n", ( request->ok == true ) ? "Loaded" : "Failed to load", resData->path );
+    
+    /* Whatever finish wanted to keep it took its own reference to */
+    for ( uint32_t d = 0; d < request->dependencyCount; ++d ) {
+        Resource_Release( (resource_t *) request->dependencies[ d ] );
+    }
+    
+    if ( request->dependencies != NULL ) {
+        Mem_Free( request->dependencies );
+    }
+}
+
+/*=======================================================================================================================================*/
+static void Resource_CompleteRequest( resource_request_t * request ) {
+    Resource_FinishRequest( request );
+    
+    if ( request->callback != NULL ) {
+        request->callback( (resource_t *) request->resource, (resource_state_t) atomic_load( &request->resource->state ), request->user );
+    }
+    
+    /* A failed load that nothing wants any more has nothing worth keeping */
+    if ( atomic_load( &request->resource->state ) == RESOURCE_STATE_FAILED && request->resource->refCount == 0 ) {
+        Resource_Evict( request->resource );
+    }
+    Mem_Free( request );
+}
+
+/*=======================================================================================================================================*/
+static bool_t Resource_ResolveDependencies( resource_request_t * request ) {
+    resource_factory_t * factory = request->resource->factory;
+    
+    if ( factory->depend == NULL || request->ok == false ) {
+        return true;
+    }
+    
+    /* Dependencies that were already loaded don't need a wait, so keep asking until the depend step has nothing new */
+    for ( ;; ) {
+        for ( uint32_t d = 0; d < request->dependencyCount; ++d ) {
+            if ( Resource_GetState( (resource_t *) request->dependencies[ d ] ) == RESOURCE_STATE_PENDING ) {
+                return false;
+            }
+        }
+        
+        uint32_t dependencyCount = request->dependencyCount;
+        request->ok = factory->depend( (resource_t *) request->resource, &request->load );
+        
+        if ( request->ok == false || request->dependencyCount == dependencyCount ) {
+            return true;
+        }
+    }
+}
+
+/*=======================================================================================================================================*/
+uint32_t Resource_Update( void ) {
+    resource_request_t * request = NULL;
+    
+    /* Requests are taken one at a time, finishing one can Resource_Load another that is further down the queue */
+    for ( ;; ) {
+        Sys_MutexLock( &res.doneMutex );
+        request = Resource_QueuePop( &res.doneQueue );
+        Sys_MutexUnlock( &res.doneMutex );
+        
+        if ( request == NULL ) {
+            break;
+        }
+        
+        if ( Resource_ResolveDependencies( request ) == false ) {
+            Resource_QueuePush( &res.dependQueue, request );
+            continue;
+        }
+        
+        Resource_CompleteRequest( request );
+    }
+    
+    /* Then the loads whose dependencies were still loading, the ones just finished above may have been what they waited on */
+    resource_queue_t depending = res.dependQueue;
+    res.dependQueue.head = NULL;
+    res.dependQueue.tail = NULL;
+    
+    while ( ( request = Resource_QueuePop( &depending ) ) != NULL ) {
+        if ( Resource_ResolveDependencies( request ) == false ) {
+            Resource_QueuePush( &res.dependQueue, request );
+            continue;
+        }
+        
+        Resource_CompleteRequest( request );
+    }
+    
+    /* Then the requests for resources that were already loaded or pending */
+    resource_queue_t waiting = res.waitQueue;
+    res.waitQueue.head = NULL;
+    res.waitQueue.tail = NULL;
+    
+    while ( ( request = Resource_QueuePop( &waiting ) ) != NULL ) {
+        resource_state_t state = (resource_state_t) atomic_load( &request->resource->state );
+        
+        if ( state == RESOURCE_STATE_PENDING ) {
+            Resource_QueuePush( &res.waitQueue, request );
+            continue;
+        }
+        
+        request->callback( (resource_t *) request->resource, state, request->user );
+        Mem_Free( request );
+    }
+    
+    /* Loads that finished while their type was over budget */
+    for ( size_t t = 0; t < res.factoryCount; ++t ) {
+        Resource_Trim( &res.types[ t ] );
+    }
+    
+    return res.pendingCount;
+}
+
+/*=======================================================================================================================================*/
+void Resource_WaitAsync( void ) {
+    while ( Resource_Update() > 0 || res.waitQueue.head != NULL ) {
+        Sys_Sleep( 1 );
+    }
+}
+
+/*=======================================================================================================================================*/
+resource_state_t Resource_GetState( resource_t * self_ ) {
+    assert( self_ != NULL );
+    return (resource_state_t) atomic_load_explicit( &((resource_data_t*) self_)->state, memory_order_acquire );
+}
+
+/*=======================================================================================================================================*/
+resource_t * Resource_LoadInternal( const char * path, bool_t loadNow, resource_callback_t callback, void * user ) {
     xprintf("Loading resource %s\n", path);
     
     /* If the resource already exists, we'll just return it */
     resource_t * resource = Resource_FindInternal( path );
     if ( resource != NULL ) {
         xprintf("    Already loaded\n" );
+        
+        resource_data_t * resData = (resource_data_t *) resource;
+        if ( resData->refCount == 0 ) {
+            Resource_LruRemove( &res.types[ resData->typeIndex ], resData );
+        }
+        ++resData->refCount;
+        
+        if ( loadNow == true ) {
+            /* Loaded asynchronously and not done yet, the caller expects it to be ready */
+            while ( Resource_GetState( resource ) == RESOURCE_STATE_PENDING ) {
+                Resource_Update();
+                Sys_Sleep( 0 );
+            }
+        }
+        else if ( callback != NULL ) {
+            resource_request_t * request = (resource_request_t *) Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof( resource_request_t ) );
+            memset( request, 0, sizeof( resource_request_t ) );
+            request->resource = (resource_data_t *) resource;
+            request->callback = callback;
+            request->user = user;
+            Resource_QueuePush( &res.waitQueue, request );
+        }
+        
         return resource;
     }
     
-    xerror( res.resourceCount >= MAX_RESOURCES, "Maximum number of resources reached\n" );
-    
     /* Resouce does not exist so we want to load it */
     
     /* Get the appropriate factory and create the resource from it */
@@ -247,13 +780,17 @@ resource_t * Resource_LoadInternal( const char * path, bool_t loadNow ) {
     
     static_assert( sizeof(resource_data_t) <= sizeof( resource_t ), "resource_t.data is too small for implementation" );
     
-    resource_data_t * resData = Mem_Alloc( sizeof( resource_t ) );
+    resource_data_t * resData = (resource_data_t *) Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof( resource_t ) );
     memset(resData, 0, sizeof( resource_data_t ) );
     
     Str_CopyCStr( &resData->path, path );
     resData->pathHash = Resource_CalcPathHash( resData->path );
     resData->factory = factory;
     resData->data = factory->alloc();
+    resData->refCount = 1;
+    resData->typeIndex = (uint32_t) Resource_FindType( factory );
+    atomic_init( &resData->state, RESOURCE_STATE_PENDING );
+    ++res.types[ resData->typeIndex ].resourceCount;
     
     /* Add the resource to the internal list */
     Resource_Add( resData );
@@ -269,10 +806,33 @@ resource_t * Resource_LoadInternal( const char * path, bool_t loadNow ) {
         
         factory->load( resource, &file, path );
         
+        Resource_SetResident( resData, FS_FileLength( &file ) );
         FS_FileClose( &file );
+        atomic_store_explicit( &resData->state, RESOURCE_STATE_LOADED, memory_order_release );
+        
+        /* The new resource is referenced, so this only makes room by unloading others */
+        Resource_Trim( &res.types[ resData->typeIndex ] );
     }
     else {
-        assert(0);
+        xprintf("    Loading async\n");
+        resource_request_t * request = (resource_request_t *) Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof( resource_request_t ) );
+        memset( request, 0, sizeof( resource_request_t ) );
+        request->resource = resData;
+        request->callback = callback;
+        request->user = user;
+        request->load.path = resData->path;
+        ++res.pendingCount;
+        
+        /* Factories that can't finish from the file data are loaded on the owning thread in Resource_Update */
+        if ( factory->finish == NULL ) {
+            Resource_Done( request );
+        }
+        else {
+            Sys_MutexLock( &res.ioMutex );
+            Resource_QueuePush( &res.ioQueue, request );
+            Sys_CondSignal( &res.ioCond );
+            Sys_MutexUnlock( &res.ioMutex );
+        }
     }
     
     return resource;
@@ -280,10 +840,101 @@ resource_t * Resource_LoadInternal( const char * path, bool_t loadNow ) {
 
 /*=======================================================================================================================================*/
 resource_t * Resource_Load( const char * path ) {
-    return Resource_LoadInternal( path, true );
+    return Resource_LoadInternal( path, true, NULL, NULL );
+}
+
+/*=======================================================================================================================================*/
+resource_t * Resource_LoadAsync( const char * path, resource_callback_t callback, void * user ) {
+    return Resource_LoadInternal( path, false, callback, user );
+}
+
+/*=======================================================================================================================================*/
+resource_t * Resource_LoadDependency( resource_load_t * load, const char * path ) {
+    resource_request_t * request = (resource_request_t *) ( (uint8_t *) load - offsetof( resource_request_t, load ) );
+    resource_data_t * resData = (resource_data_t *) Resource_LoadInternal( path, false, NULL, NULL );
+    
+    for ( uint32_t d = 0; d < request->dependencyCount; ++d ) {
+        if ( request->dependencies[ d ] == resData ) {
+            Resource_Release( (resource_t *) resData );
+            return (resource_t *) resData;
+        }
+    }
+    
+    if ( request->dependencyCount == request->dependencyCapacity ) {
+        uint32_t capacity = ( request->dependencyCapacity > 0 ) ? request->dependencyCapacity * 2 : RESOURCE_DEPENDENCY_CAPACITY;
+        resource_data_t ** dependencies = (resource_data_t **) Mem_HeapAlloc( MEM_HEAP_RESOURCE, sizeof( resource_data_t * ) * capacity );
+        
+        if ( request->dependencies != NULL ) {
+            memcpy( dependencies, request->dependencies, sizeof( resource_data_t * ) * request->dependencyCount );
+            Mem_Free( request->dependencies );
+        }
+        
+        request->dependencies = dependencies;
+        request->dependencyCapacity = capacity;
+    }
+    
+    request->dependencies[ request->dependencyCount ] = resData;
+    ++request->dependencyCount;
+    
+    return (resource_t *) resData;
 }
 
 /*=======================================================================================================================================*/
 resource_t * Find( const char * path ) {
     return Resource_FindInternal( path );
 }
+
+/*=======================================================================================================================================*/
+void Resource_Release( resource_t * self_ ) {
+    resource_data_t * resData = (resource_data_t *) self_;
+    assert( self_ != NULL );
+    xerror( resData->refCount == 0, "Resource '%s' released more times than it was loaded\n", resData->path );
+    
+    --resData->refCount;
+    if ( resData->refCount > 0 || res.finalising == true ) {
+        return;
+    }
+    
+    resource_type_t * type = &res.types[ resData->typeIndex ];
+    Resource_LruPush( type, resData );
+    
+    if ( atomic_load( &resData->state ) == RESOURCE_STATE_FAILED ) {
+        Resource_Evict( resData );
+    }
+    else {
+        Resource_Trim( type );
+    }
+}
+
+/*=======================================================================================================================================*/
+void Resource_SetBudget( resource_factory_t * factory, uint64_t budget ) {
+    int32_t typeIndex = Resource_FindType( factory );
+    xerror( typeIndex < 0, "Resource factory %s has not been registered\n", factory->desc );
+    
+    res.types[ typeIndex ].budget = budget;
+    Resource_Trim( &res.types[ typeIndex ] );
+}
+
+/*=======================================================================================================================================*/
+uint32_t Resource_GetTypeCount( void ) {
+    return (uint32_t) res.factoryCount;
+}
+
+/*=======================================================================================================================================*/
+bool_t Resource_GetStats( uint32_t typeIndex, resource_stats_t * stats ) {
+    if ( typeIndex >= res.factoryCount ) {
+        return false;
+    }
+    
+    const resource_type_t * type = &res.types[ typeIndex ];
+    stats->desc = res.factories[ typeIndex ]->desc;
+    stats->budget = type->budget;
+    stats->used = type->used;
+    stats->unreferenced = type->unreferenced;
+    stats->resourceCount = type->resourceCount;
+    stats->unreferencedCount = type->unreferencedCount;
+    stats->evictionCount = type->evictionCount;
+    stats->evictedBytes = type->evictedBytes;
+    
+    return true;
+}
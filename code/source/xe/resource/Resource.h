@@ -12,14 +12,36 @@
 #include "core/Fs.h"
 
 typedef struct resource_s  {
-    uint64_t        data[8];
+    uint64_t        data[10];
 } resource_t;
 
+#define RESOURCE_BUDGET_NONE UINT64_MAX             /* Budget for a type that is never evicted */
+
+typedef enum resource_state_e {
+    RESOURCE_STATE_PENDING = 0,             /* Queued or being loaded by Resource_LoadAsync */
+    RESOURCE_STATE_LOADED,
+    RESOURCE_STATE_FAILED,
+} resource_state_t;
+
+/* File data and anything decoded from it, passed from the decode step on a worker to the finish step */
+typedef struct resource_load_s {
+    const char *        path;
+    const void *        fileData;           /* Whole file, mapped by the I/O thread */
+    size_t              fileSize;
+    void *              decoded;            /* Set by decode for finish to use, finish frees it */
+} resource_load_t;
+
+typedef void (*resource_callback_t)( resource_t * resource, resource_state_t state, void * user );
+
 typedef struct resource_factory_s {
     const char *        desc;
     void                (*load)( resource_t * self_, file_t * file, const char * path );
+    void                (*unload)( resource_t * self_ );                        /* Undo a successful load, before free is called */
     void *              (*alloc)(void);
     void                (*free)( void * data );
+    bool_t              (*decode)( resource_t * self_, resource_load_t * load );   /* Optional, run on a worker by async loads */
+    bool_t              (*finish)( resource_t * self_, resource_load_t * load );   /* Run on the owning thread by async loads, e.g. for GPU uploads */
+    bool_t              (*depend)( resource_t * self_, resource_load_t * load );   /* Optional, run on the owning thread by async loads before finish */
 } resource_factory_t;
 
 XE_API void Resource_Initialise( void );
@@ -29,15 +51,103 @@ XE_API resource_t * Resource_Load( const char * path );
 XE_API resource_t * Find( const char * path );
 XE_API void * Resource_GetData( resource_t * self_ );
 
+/* Per factory residency, resources are counted by the size of the file they were loaded from */
+typedef struct resource_stats_s {
+    const char *    desc;
+    uint64_t        budget;                 /* RESOURCE_BUDGET_NONE when the type is never evicted */
+    uint64_t        used;                   /* Bytes of resident resources, referenced or not */
+    uint64_t        unreferenced;           /* Bytes of resident resources that could be evicted */
+    uint32_t        resourceCount;
+    uint32_t        unreferencedCount;
+    uint64_t        evictionCount;
+    uint64_t        evictedBytes;
+} resource_stats_t;
+
+/*
+    Every Resource_Load and Resource_LoadAsync takes a reference that is given back with Resource_Release. Resources
+    that nothing references stay resident until their type goes over its budget, then the least recently released
+    are unloaded first. Types start with a budget of RESOURCE_DEFAULT_BUDGET bytes.
+*/
+XE_API void Resource_Release( resource_t * self_ );
+XE_API void Resource_SetBudget( resource_factory_t * factory, uint64_t budget );
+XE_API uint32_t Resource_GetTypeCount( void );
+XE_API bool_t Resource_GetStats( uint32_t typeIndex, resource_stats_t * stats );
+
+/*
+    Resource_LoadAsync returns the resource straight away in the pending state. The file is read on the I/O thread,
+    the factory decode step runs on a job worker and the finish step runs in Resource_Update, which has to be called
+    on the thread that initialised the resource system and is where the callback is called from. Factories without
+    a finish step are loaded with their load function in Resource_Update. Loading a resource that is already
+    loaded or pending calls the callback once it's done, Resource_Load on a pending resource waits for it.
+*/
+XE_API resource_t * Resource_LoadAsync( const char * path, resource_callback_t callback, void * user );
+XE_API resource_state_t Resource_GetState( resource_t * self_ );
+
+/*
+    A factory's depend step loads the other resources its finish step needs with Resource_LoadDependency, which loads
+    them asynchronously. Once none of them are pending the depend step is called again, so it can load what those
+    lead to, and finish runs after a call that loads nothing new. The load holds a reference to each dependency until
+    finish is done, loading the same one again gives it back without another reference.
+*/
+XE_API resource_t * Resource_LoadDependency( resource_load_t * load, const char * path );
+XE_API uint32_t Resource_Update( void );
+XE_API void Resource_WaitAsync( void );
+
 #define DEFINE_RESOURCE_FACTORY( NAME, FUNC, STRUCT )\
 static void         FUNC##Resource_Load( resource_t * self_, file_t * file, const char * path );\
+static void         FUNC##Resource_Unload( resource_t * self_ );\
+static void *       FUNC##Resource_Alloc( void );\
+static void         FUNC##Resource_Free( void * data );\
+resource_factory_t STRUCT##_resource_factory_inst = {\
+    NAME,\
+    FUNC##Resource_Load,\
+    FUNC##Resource_Unload,\
+    FUNC##Resource_Alloc,\
+    FUNC##Resource_Free,\
+    NULL,\
+    NULL,\
+    NULL\
+};\
+resource_factory_t * STRUCT##_resource_factory = &STRUCT##_resource_factory_inst;
+
+/* Factory that can also be loaded asynchronously, with decode and finish steps */
+#define DEFINE_RESOURCE_FACTORY_ASYNC( NAME, FUNC, STRUCT )\
+static void         FUNC##Resource_Load( resource_t * self_, file_t * file, const char * path );\
+static void         FUNC##Resource_Unload( resource_t * self_ );\
+static void *       FUNC##Resource_Alloc( void );\
+static void         FUNC##Resource_Free( void * data );\
+static bool_t       FUNC##Resource_Decode( resource_t * self_, resource_load_t * load );\
+static bool_t       FUNC##Resource_Finish( resource_t * self_, resource_load_t * load );\
+resource_factory_t STRUCT##_resource_factory_inst = {\
+    NAME,\
+    FUNC##Resource_Load,\
+    FUNC##Resource_Unload,\
+    FUNC##Resource_Alloc,\
+    FUNC##Resource_Free,\
+    FUNC##Resource_Decode,\
+    FUNC##Resource_Finish,\
+    NULL\
+};\
+resource_factory_t * STRUCT##_resource_factory = &STRUCT##_resource_factory_inst;
+
+/* Async factory that also loads other resources before it finishes */
+#define DEFINE_RESOURCE_FACTORY_DEPENDS( NAME, FUNC, STRUCT )\
+static void         FUNC##Resource_Load( resource_t * self_, file_t * file, const char * path );\
+static void         FUNC##Resource_Unload( resource_t * self_ );\
 static void *       FUNC##Resource_Alloc( void );\
 static void         FUNC##Resource_Free( void * data );\
+static bool_t       FUNC##Resource_Decode( resource_t * self_, resource_load_t * load );\
+static bool_t       FUNC##Resource_Finish( resource_t * self_, resource_load_t * load );\
+static bool_t       FUNC##Resource_Depend( resource_t * self_, resource_load_t * load );\
 resource_factory_t STRUCT##_resource_factory_inst = {\
     NAME,\
     FUNC##Resource_Load,\
+    FUNC##Resource_Unload,\
     FUNC##Resource_Alloc,\
-    FUNC##Resource_Free\
+    FUNC##Resource_Free,\
+    FUNC##Resource_Decode,\
+    FUNC##Resource_Finish,\
+    FUNC##Resource_Depend\
 };\
 resource_factory_t * STRUCT##_resource_factory = &STRUCT##_resource_factory_inst;
     